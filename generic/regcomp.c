@@ -39,9 +39,16 @@
 /* automatically gathered by fwd; do not hand-edit */
 /* === regcomp.c === */
 int compile(regex_t *, const chr *, size_t, int);
+int compileset(regex_t *, const chr *const *, const size_t *, size_t, int);
 static void moresubs(struct vars *, size_t);
 static int freev(struct vars *, int);
 static void makesearch(struct vars *, struct nfa *);
+static void findmust(struct vars *, struct nfa *, struct state *, const chr *, size_t, int, struct must *);
+static size_t mustchain(struct vars *, struct state *, const chr *, size_t, int, chr *);
+static int mustchr(struct vars *, color, const chr *, size_t, int, chr *);
+static int dominates(struct nfa *, struct state *, struct state *, size_t *, size_t, struct state **);
+static int asciire(struct vars *);
+static int asciicnfa(struct cnfa *, const char *, size_t);
 static struct subre *parse(struct vars *, int, int, struct state *, struct state *);
 static struct subre *parsebranch(struct vars *, int, int, struct state *, struct state *, int);
 static void parseqatom(struct vars *, int, int, struct state *, struct state *, struct subre *);
@@ -355,6 +362,13 @@ compile(
     v->cm = &g->cmap;
     g->lacons = NULL;
     g->nlacons = 0;
+    g->must.chrs = NULL;
+    g->must.len = 0;
+    g->setmusts = NULL;
+    g->setstates = NULL;
+    g->nset = 0;
+    g->searchdfa = NULL;
+    g->subdfas = NULL;
     ZAPCNFA(g->search);
     v->nfa = newnfa(v, v->cm, NULL);
     CNOERR();
@@ -418,6 +432,9 @@ compile(
     if (v->tree->flags&SHORTER) {
 	NOTE(REG_USHORTEST);
     }
+    if (!(re->re_info&REG_UEMPTYMATCH) && asciire(v)) {
+	NOTE(REG_UASCII);
+    }
 
     /*
      * Build compacted NFAs for tree, lacons, fast search.
@@ -433,6 +450,8 @@ compile(
 
     (void) optimize(v->nfa, debug);
     CNOERR();
+    findmust(v, v->nfa, v->nfa->post, string, len, v->cflags&REG_ICASE,
+	    &g->must);
     makesearch(v, v->nfa);
     CNOERR();
     compact(v->nfa, &g->search);
@@ -451,6 +470,10 @@ compile(
     g->tree = v->tree;
     v->tree = NULL;
     g->ntree = v->ntree;
+    g->subdfas = (struct dfa **) MALLOC(g->ntree * sizeof(struct dfa *));
+    if (g->subdfas != NULL) {	/* if not, DFAs are simply not kept */
+	memset(g->subdfas, 0, g->ntree * sizeof(struct dfa *));
+    }
     g->compare = (v->cflags&REG_ICASE) ? casecmp : cmp;
     g->lacons = v->lacons;
     v->lacons = NULL;
@@ -464,6 +487,245 @@ compile(
     return freev(v, 0);
 }
 
+/*
+ - compileset - compile a set of regular expressions into one search NFA
+ * Each RE is parsed from the shared initial state into a final state of its
+ * own, ending in a post state of its own.  Those post states are flagged like
+ * the real one so that constraints stop there, and each reaches the real
+ * post state only through a pseudocolor arc that no input ever supplies.
+ * execset() then runs the search DFA once and reports every RE whose post
+ * state shows up in a state set.  Only the search NFA is built; there is no
+ * subRE tree, so the result cannot be used with exec().  REs that use
+ * backreferences are accepted but the search NFA only approximates them, so
+ * callers should check such REs separately.
+ ^ int compileset(regex_t *, const chr *const *, const size_t *, size_t, int);
+ */
+int
+compileset(
+    regex_t *re,
+    const chr *const *strings,	/* the REs */
+    const size_t *lens,		/* and their lengths */
+    size_t n,			/* how many */
+    int flags)
+{
+    AllocVars(v);
+    struct guts *g;
+    struct state *final, *post;
+    struct state **posts;
+    size_t i, j;
+    FILE *debug = (flags&REG_PROGRESS) ? stdout : NULL;
+
+    /*
+     * Sanity checks.
+     */
+
+    if (re == NULL || strings == NULL || lens == NULL || n == 0
+	    || (flags&REG_EXPECT)) {
+	FreeVars(v);
+	return REG_INVARG;
+    }
+    if ((flags&REG_QUOTE) && (flags&(REG_ADVANCED|REG_EXPANDED|REG_NEWLINE))) {
+	FreeVars(v);
+	return REG_INVARG;
+    }
+    if (!(flags&REG_EXTENDED) && (flags&REG_ADVF)) {
+	FreeVars(v);
+	return REG_INVARG;
+    }
+
+    /*
+     * Initial setup (after which freev() is callable).
+     */
+
+    v->re = re;
+    v->now = v->stop = NULL;
+    v->savenow = v->savestop = NULL;
+    v->err = 0;
+    v->cflags = flags;
+    v->nsubexp = 0;
+    v->subs = v->sub10;
+    v->nsubs = 10;
+    for (j = 0; j < v->nsubs; j++) {
+	v->subs[j] = NULL;
+    }
+    v->nfa = NULL;
+    v->cm = NULL;
+    v->nlcolor = COLORLESS;
+    v->wordchrs = NULL;
+    v->tree = NULL;
+    v->treechain = NULL;
+    v->treefree = NULL;
+    v->cv = NULL;
+    v->cv2 = NULL;
+    v->lacons = NULL;
+    v->nlacons = 0;
+    v->spaceused = 0;
+    re->re_magic = REMAGIC;
+    re->re_info = 0;
+    re->re_guts = NULL;
+    re->re_fns = (void*)(&functions);
+
+    re->re_guts = (void*)(MALLOC(sizeof(struct guts)));
+    if (re->re_guts == NULL) {
+	return freev(v, REG_ESPACE);
+    }
+    g = (struct guts *) re->re_guts;
+    g->tree = NULL;
+    initcm(v, &g->cmap);
+    v->cm = &g->cmap;
+    g->lacons = NULL;
+    g->nlacons = 0;
+    g->must.chrs = NULL;
+    g->must.len = 0;
+    g->nset = 0;
+    g->searchdfa = NULL;
+    g->subdfas = NULL;
+    ZAPCNFA(g->search);
+    g->setstates = (size_t *) MALLOC(n * sizeof(size_t));
+    g->setmusts = (struct must *) MALLOC(n * sizeof(struct must));
+    if (g->setstates == NULL || g->setmusts == NULL) {
+	return freev(v, REG_ESPACE);
+    }
+    for (i = 0; i < n; i++) {
+	g->setmusts[i].chrs = NULL;
+	g->setmusts[i].len = 0;
+    }
+    v->nfa = newnfa(v, v->cm, NULL);
+    CNOERR();
+    v->cv = newcvec(100, 20);
+    if (v->cv == NULL) {
+	return freev(v, REG_ESPACE);
+    }
+
+    /*
+     * The post states are remembered in the guts vector for now, and
+     * replaced by their compacted state numbers at the end.
+     */
+
+    posts = (struct state **) MALLOC(n * sizeof(struct state *));
+    if (posts == NULL) {
+	return freev(v, REG_ESPACE);
+    }
+
+    /*
+     * Parsing, one RE at a time.  Each starts over with the caller's flags
+     * and its own subexpression numbering; the parse trees are discarded.
+     */
+
+    for (i = 0; i < n; i++) {
+	v->now = strings[i];
+	v->stop = v->now + lens[i];
+	v->savenow = v->savestop = NULL;
+	v->cflags = flags;
+	v->nsubexp = 0;
+	for (j = 0; j < v->nsubs; j++) {
+	    v->subs[j] = NULL;
+	}
+	lexstart(v);
+	if (((v->cflags&REG_NLSTOP) || (v->cflags&REG_NLANCH))
+		&& v->nlcolor == COLORLESS) {
+	    v->nlcolor = subcolor(v->cm, newline());
+	    okcolors(v->nfa, v->cm);
+	}
+	if (ISERR()) {
+	    break;
+	}
+	final = newstate(v->nfa);
+	post = newfstate(v->nfa, '@');
+	if (ISERR()) {
+	    break;
+	}
+	rainbow(v->nfa, v->cm, PLAIN, COLORLESS, final, post);
+	newarc(v->nfa, '$', 1, final, post);
+	newarc(v->nfa, '$', 0, final, post);
+	newarc(v->nfa, PLAIN, pseudocolor(v->cm), post, v->nfa->post);
+	posts[i] = post;
+	(void) parse(v, EOS, PLAIN, v->nfa->init, final);
+	assert(SEE(EOS));
+	if (ISERR()) {
+	    break;
+	}
+	g->setmusts[i].icase = v->cflags&REG_ICASE;
+    }
+    if (ISERR()) {
+	FREE(posts);
+	return freev(v, v->err);
+    }
+
+    /*
+     * Finish setup of nfa and build compacted NFAs for lacons.
+     */
+
+    specialcolors(v->nfa);
+    for (i = 1; i < v->nlacons && !ISERR(); i++) {
+	nfanode(v, &v->lacons[i], debug);
+    }
+
+    /*
+     * Build the search NFA.  The pushfwd() step of optimize() turns $
+     * constraints into EOS/EOL arcs only where they reach the real post
+     * state, so do the same for the per-RE post states.
+     */
+
+    if (!ISERR()) {
+	(void) optimize(v->nfa, debug);
+    }
+    for (i = 0; i < n && !ISERR(); i++) {
+	struct arc *a, *nexta;
+
+	for (a = posts[i]->ins; a != NULL; a = nexta) {
+	    nexta = a->inchain;
+	    if (a->type == '$') {
+		assert(a->co == 0 || a->co == 1);
+		newarc(v->nfa, PLAIN, v->nfa->eos[a->co], a->from, a->to);
+		freearc(v->nfa, a);
+	    }
+	}
+    }
+    for (i = 0; i < n && !ISERR(); i++) {
+	findmust(v, v->nfa, posts[i], strings[i], lens[i],
+		g->setmusts[i].icase, &g->setmusts[i]);
+    }
+    if (!ISERR()) {
+	makesearch(v, v->nfa);
+    }
+    if (!ISERR()) {
+	compact(v->nfa, &g->search);
+    }
+    if (ISERR()) {
+	FREE(posts);
+	return freev(v, v->err);
+    }
+    for (i = 0; i < n; i++) {
+	g->setstates[i] = (posts[i]->nins > 0) ? posts[i]->no : FREESTATE;
+    }
+    FREE(posts);
+
+    /*
+     * Looks okay, package it up.
+     */
+
+    re->re_nsub = 0;
+    v->re = NULL;		/* freev no longer frees re */
+    g->magic = GUTSMAGIC;
+    g->cflags = flags;
+    g->info = re->re_info;
+    g->nsub = 0;
+    g->ntree = 0;
+    g->compare = (flags&REG_ICASE) ? casecmp : cmp;
+    g->lacons = v->lacons;
+    v->lacons = NULL;
+    g->nlacons = v->nlacons;
+    g->nset = n;
+
+    if (flags&REG_DUMP) {
+	dump(re, stdout);
+    }
+
+    assert(v->err == 0);
+    return freev(v, 0);
+}
+
 /*
  - moresubs - enlarge subRE vector
  ^ static void moresubs(struct vars *, size_t);
@@ -638,6 +900,372 @@ makesearch(
     }
 }
 
+/*
+ - findmust - find a literal string that every match must contain
+ * NFA must have been optimize()d already, and not yet turned into a search
+ * NFA.  A state that lies on every path from pre to the target (post, or a
+ * per-RE post state for compileset()), followed by a run of states each
+ * having a single plain out-arc whose color stands for just one character,
+ * spells out a string that any match contains.  The longest such string is
+ * saved so that exec() can reject subjects lacking it without running a
+ * DFA.  This is purely an optimization: on any trouble we simply record
+ * nothing.
+ ^ static void findmust(struct vars *, struct nfa *, struct state *,
+ ^	const chr *, size_t, int, struct must *);
+ */
+static void
+findmust(
+    struct vars *v,
+    struct nfa *nfa,
+    struct state *target,
+    const chr *string,		/* the RE source, for candidate chrs */
+    size_t len,
+    int icase,			/* was the RE compiled with REG_ICASE? */
+    struct must *m)		/* where to save the result */
+{
+    struct state *s, *t;
+    struct state **stack;
+    struct arc *a;
+    size_t *marks;
+    chr *best, *work;
+    size_t n, nbest = 0, nlive = 0, top = 0, stamp = 1;
+#define	MUSTSTATES	1000	/* give up on anything bigger */
+
+    m->chrs = NULL;
+    m->len = 0;
+    m->icase = icase;
+    if (len == 0 || len > MUSTSTATES) {
+	return;
+    }
+    marks = (size_t *) MALLOC(nfa->nstates * sizeof(size_t));
+    stack = (struct state **) MALLOC(nfa->nstates * sizeof(struct state *));
+    best = (chr *) MALLOC(2 * len * sizeof(chr));
+    if (marks == NULL || stack == NULL || best == NULL) {
+	goto done;
+    }
+    work = best + len;
+
+    /*
+     * Only states that can reach the target matter; mark them with stamp 1.
+     */
+
+    memset(marks, 0, nfa->nstates * sizeof(size_t));
+    marks[target->no] = stamp;
+    stack[top++] = target;
+    while (top > 0) {
+	t = stack[--top];
+	nlive++;
+	for (a = t->ins; a != NULL; a = a->inchain) {
+	    if (marks[a->from->no] != stamp) {
+		marks[a->from->no] = stamp;
+		stack[top++] = a->from;
+	    }
+	}
+    }
+    if (nlive > MUSTSTATES || marks[nfa->pre->no] != stamp) {
+	goto done;
+    }
+
+    for (s = nfa->states; s != NULL; s = s->next) {
+	if (s == nfa->pre || s == target || marks[s->no] == 0) {
+	    continue;
+	}
+	n = mustchain(v, s, string, len, icase, work);
+	if (n <= nbest || !dominates(nfa, s, target, marks, ++stamp, stack)) {
+	    continue;
+	}
+	memcpy(best, work, n * sizeof(chr));
+	nbest = n;
+    }
+
+    if (nbest > 0) {
+	m->chrs = (chr *) MALLOC(nbest * sizeof(chr));
+	if (m->chrs != NULL) {
+	    memcpy(m->chrs, best, nbest * sizeof(chr));
+	    m->len = nbest;
+	}
+    }
+
+  done:
+    if (marks != NULL) {
+	FREE(marks);
+    }
+    if (stack != NULL) {
+	FREE(stack);
+    }
+    if (best != NULL) {
+	FREE(best);
+    }
+}
+
+/*
+ - mustchain - spell out the run of single-chr arcs through a state
+ * Walks backward while all inarcs carry the same single-chr color, and
+ * forward while there is exactly one plain outarc of a single-chr color.
+ * Either walk stops when a loop brings it back to where it started.
+ ^ static size_t mustchain(struct vars *, struct state *, const chr *,
+ ^	size_t, int, chr *);
+ */
+static size_t			/* length of the run */
+mustchain(
+    struct vars *v,
+    struct state *start,
+    const chr *string,
+    size_t len,
+    int icase,
+    chr *out)			/* room for len chrs */
+{
+    struct state *s = start;
+    struct arc *a;
+    size_t i, n = 0;
+    int single;
+    chr c, d;
+
+    /*
+     * Backward first; the chrs come out reversed.
+     */
+
+    while (n < len && s->nins > 0 && s->ins->type == PLAIN
+	    && mustchr(v, s->ins->co, string, len, icase, &c)) {
+	single = 1;
+	for (a = s->ins; a != NULL; a = a->inchain) {
+	    if (a->type != PLAIN || a->co != s->ins->co) {
+		break;
+	    }
+	    if (a->from != s->ins->from) {
+		single = 0;
+	    }
+	}
+	if (a != NULL) {
+	    break;
+	}
+	out[n++] = c;
+	if (!single) {
+	    break;		/* several predecessors, can't go further */
+	}
+	s = s->ins->from;
+	if (s == start) {
+	    break;
+	}
+    }
+    for (i = 0; i < n / 2; i++) {
+	d = out[i];
+	out[i] = out[n - 1 - i];
+	out[n - 1 - i] = d;
+    }
+
+    s = start;
+    while (n < len && s->nouts == 1 && s->outs->type == PLAIN
+	    && mustchr(v, s->outs->co, string, len, icase, &out[n])) {
+	n++;
+	s = s->outs->to;
+	if (s == start) {
+	    break;
+	}
+    }
+    return n;
+}
+
+/*
+ - mustchr - find the single chr (or ASCII case pair) a color stands for
+ * The colormap cannot be inverted cheaply, so candidates are taken from
+ * the RE source; colors reached only through escapes are just skipped.
+ * Under REG_ICASE only ASCII characters are accepted, and the chr is
+ * reported in lower case; exec() folds the subject to match.
+ ^ static int mustchr(struct vars *, color, const chr *, size_t, int,
+ ^	chr *);
+ */
+static int			/* 1 if found, 0 if not */
+mustchr(
+    struct vars *v,
+    color co,
+    const chr *string,
+    size_t len,
+    int icase,
+    chr *out)
+{
+    struct colormap *cm = v->cm;
+    struct colordesc *cd;
+    size_t i;
+    chr c, other;
+
+    if (co < 0 || (size_t) co > cm->max) {
+	return 0;
+    }
+    cd = &cm->cd[co];
+    if (UNUSEDCOLOR(cd) || (cd->flags&PSEUDO)) {
+	return 0;
+    }
+    for (i = 0; i < len; i++) {
+	c = string[i];
+	if (GETCOLOR(cm, c) != co) {
+	    continue;
+	}
+	if (!icase) {
+	    if (cd->nchrs != 1) {
+		return 0;
+	    }
+	    *out = c;
+	    return 1;
+	}
+	if (c >= 0x80) {
+	    return 0;
+	}
+	if (c >= 'A' && c <= 'Z') {
+	    c += 'a' - 'A';
+	}
+	if (c >= 'a' && c <= 'z') {
+	    other = c - ('a' - 'A');
+	    if (cd->nchrs != 2 || GETCOLOR(cm, other) != co) {
+		return 0;
+	    }
+	} else if (cd->nchrs != 1) {
+	    return 0;
+	}
+	*out = c;
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ - dominates - does every path from pre to the target pass through a state?
+ * Only states marked by findmust() as able to reach the target are
+ * explored; visiting one marks it with the stamp, which must be new.
+ ^ static int dominates(struct nfa *, struct state *, struct state *,
+ ^	size_t *, size_t, struct state **);
+ */
+static int
+dominates(
+    struct nfa *nfa,
+    struct state *s,
+    struct state *target,
+    size_t *marks,		/* per-state marks, 0 for dead states */
+    size_t stamp,
+    struct state **stack)	/* nfa->nstates entries of scratch */
+{
+    struct state *t;
+    struct arc *a;
+    size_t top = 0;
+
+    marks[s->no] = stamp;
+    marks[nfa->pre->no] = stamp;
+    stack[top++] = nfa->pre;
+    while (top > 0) {
+	t = stack[--top];
+	for (a = t->outs; a != NULL; a = a->outchain) {
+	    if (a->to == target) {
+		return 0;
+	    }
+	    if (marks[a->to->no] != 0 && marks[a->to->no] != stamp) {
+		marks[a->to->no] = stamp;
+		stack[top++] = a->to;
+	    }
+	}
+    }
+    return 1;
+}
+
+/*
+ - asciire - can the RE be run on UTF-8 bytes instead of chrs?
+ * It can if every chr a match consumes is ASCII, and the chrs just before
+ * and after a match (and a lookahead match) are tested alike for all
+ * non-ASCII chrs, so that a byte of a multibyte sequence gives the same
+ * answer as the whole chr.  The caller also makes sure that matches are
+ * never empty, so they start and end on chr boundaries.  NUL does not count
+ * as ASCII, since it takes two bytes in Tcl's UTF-8.
+ ^ static int asciire(struct vars *);
+ */
+static int
+asciire(
+    struct vars *v)
+{
+    struct colormap *cm = v->cm;
+    struct colordesc *cd;
+    char *kind;			/* per color: 1 ASCII, 2 non-ASCII, 0 other */
+    uchr *counts;
+    size_t i, nother = 0;
+    chr c;
+    int ok;
+
+    kind = (char *) MALLOC(cm->max + 1);
+    counts = (uchr *) MALLOC((cm->max + 1) * sizeof(uchr));
+    if (kind == NULL || counts == NULL) {
+	ok = 0;
+	goto done;
+    }
+    memset(counts, 0, (cm->max + 1) * sizeof(uchr));
+    for (c = 1; c < 0x80; c++) {
+	counts[GETCOLOR(cm, c)]++;
+    }
+    for (cd = cm->cd, i = 0; cd < CDEND(cm); cd++, i++) {
+	if (UNUSEDCOLOR(cd) || (cd->flags&PSEUDO)) {
+	    kind[i] = 0;
+	} else if (cd->nchrs == counts[i]) {
+	    kind[i] = 1;
+	} else {
+	    kind[i] = 2;
+	    nother++;
+	}
+    }
+
+    ok = asciicnfa(&v->tree->cnfa, kind, nother);
+    for (i = 1; ok && i < v->nlacons; i++) {
+	ok = asciicnfa(&v->lacons[i].cnfa, kind, nother);
+    }
+
+  done:
+    if (kind != NULL) {
+	FREE(kind);
+    }
+    if (counts != NULL) {
+	FREE(counts);
+    }
+    return ok;
+}
+
+/*
+ - asciicnfa - asciire()'s test for one compacted NFA
+ * Arcs from pre consume the chr before the match and arcs into post the one
+ * after it; between a given pair of states these must allow either all of
+ * the non-ASCII colors or none of them.  All other arcs need ASCII colors.
+ ^ static int asciicnfa(struct cnfa *, const char *, size_t);
+ */
+static int
+asciicnfa(
+    struct cnfa *cnfa,
+    const char *kind,		/* per color, from asciire() */
+    size_t nother)		/* number of non-ASCII colors */
+{
+    struct carc *ca, *cb;
+    size_t i, n;
+
+    for (i = 0; i < cnfa->nstates; i++) {
+	for (ca = cnfa->states[i]; ca->co != COLORLESS; ca++) {
+	    if (ca->co >= cnfa->ncolors) {
+		continue;		/* lookahead constraint, checked apart */
+	    }
+	    if (i != cnfa->pre && ca->to != cnfa->post) {
+		if (kind[ca->co] != 1) {
+		    return 0;
+		}
+		continue;
+	    }
+	    n = 0;
+	    for (cb = cnfa->states[i]; cb->co != COLORLESS; cb++) {
+		if (cb->to == ca->to && cb->co < cnfa->ncolors
+			&& kind[cb->co] == 2) {
+		    n++;
+		}
+	    }
+	    if (n != 0 && n != nother) {
+		return 0;
+	    }
+	}
+    }
+    return 1;
+}
+
 /*
  - parse - parse an RE
  * This is actually just the top level, which parses a bunch of branches tied
@@ -2011,6 +2639,7 @@ rfree(
     regex_t *re)
 {
     struct guts *g;
+    size_t i;
 
     if (re == NULL || re->re_magic != REMAGIC) {
 	return;
@@ -2022,6 +2651,7 @@ rfree(
     re->re_fns = NULL;
     if (g != NULL) {
 	g->magic = 0;
+	freedfas(g);
 	freecm(&g->cmap);
 	if (g->tree != NULL) {
 	    freesubre(NULL, g->tree);
@@ -2032,6 +2662,20 @@ rfree(
 	if (!NULLCNFA(g->search)) {
 	    freecnfa(&g->search);
 	}
+	if (g->must.chrs != NULL) {
+	    FREE(g->must.chrs);
+	}
+	if (g->setmusts != NULL) {
+	    for (i = 0; i < g->nset; i++) {
+		if (g->setmusts[i].chrs != NULL) {
+		    FREE(g->setmusts[i].chrs);
+		}
+	    }
+	    FREE(g->setmusts);
+	}
+	if (g->setstates != NULL) {
+	    FREE(g->setstates);
+	}
 	FREE(g);
     }
 }
@@ -2068,6 +2712,13 @@ dump(
 	    re->re_nsub, re->re_info, g->ntree);
 
     dumpcolors(&g->cmap, f);
+    if (g->must.len > 0) {
+	fprintf(f, "\nmust:");
+	for (i = 0; i < g->must.len; i++) {
+	    dumpchr(g->must.chrs[i], f);
+	}
+	fprintf(f, "\n");
+    }
     if (!NULLCNFA(g->search)) {
 	fprintf(f, "\nsearch:\n");
 	dumpcnfa(&g->search, f);
@@ -103,6 +103,18 @@ typedef int celt;		/* Type to hold chr, or NOCELT */
 
 #define	compile		TclReComp
 #define	exec		TclReExec
+#define	compileset	TclReCompSet
+#define	execset		TclReExecSet
+#define	execbytes	TclReExecBytes
+#define	freedfas	TclReFreeDFAs
+
+/*
+ * A compiled RE may be executed by several threads at once, so the DFAs it
+ * keeps between executions are claimed and given back atomically.
+ */
+
+#define	TAKEPTR(pp)	TclAtomicExchangePtr((pp), NULL)
+#define	GIVEPTR(pp, p)	TclAtomicCasPtr((pp), NULL, (p))
 
 /*
 & Enable/disable debugging code (by whether REG_DEBUG is defined or not).
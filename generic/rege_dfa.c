@@ -32,21 +32,21 @@
 
 /*
  - longest - longest-preferred matching engine
- ^ static chr *longest(struct vars *, struct dfa *, chr *, chr *, int *);
+ ^ static schr *longest(struct vars *, struct dfa *, schr *, schr *, int *);
  */
-static chr *			/* endpoint, or NULL */
+static schr *			/* endpoint, or NULL */
 longest(
     struct vars *const v,	/* used only for debug and exec flags */
     struct dfa *const d,
-    chr *const start,		/* where the match should start */
-    chr *const stop,		/* match must end at or before here */
+    schr *const start,		/* where the match should start */
+    schr *const stop,		/* match must end at or before here */
     int *const hitstopp)	/* record whether hit v->stop, if non-NULL */
 {
-    chr *cp;
-    chr *realstop = (stop == v->stop) ? stop : stop + 1;
+    schr *cp;
+    schr *realstop = (stop == v->stop) ? stop : stop + 1;
     color co;
     struct sset *css, *ss;
-    chr *post;
+    schr *post;
     size_t i;
     struct colormap *cm = d->cm;
 
@@ -158,22 +158,22 @@ longest(
 
 /*
  - shortest - shortest-preferred matching engine
- ^ static chr *shortest(struct vars *, struct dfa *, chr *, chr *, chr *,
- ^	chr **, int *);
+ ^ static schr *shortest(struct vars *, struct dfa *, schr *, schr *, schr *,
+ ^	schr **, int *);
  */
-static chr *			/* endpoint, or NULL */
+static schr *			/* endpoint, or NULL */
 shortest(
     struct vars *const v,
     struct dfa *const d,
-    chr *const start,		/* where the match should start */
-    chr *const min,		/* match must end at or after here */
-    chr *const max,		/* match must end at or before here */
-    chr **const coldp,		/* store coldstart pointer here, if nonNULL */
+    schr *const start,		/* where the match should start */
+    schr *const min,		/* match must end at or after here */
+    schr *const max,		/* match must end at or before here */
+    schr **const coldp,		/* store coldstart pointer here, if nonNULL */
     int *const hitstopp)	/* record whether hit v->stop, if non-NULL */
 {
-    chr *cp;
-    chr *realmin = (min == v->stop) ? min : min + 1;
-    chr *realmax = (max == v->stop) ? max : max + 1;
+    schr *cp;
+    schr *realmin = (min == v->stop) ? min : min + 1;
+    schr *realmax = (max == v->stop) ? max : max + 1;
     color co;
     struct sset *css, *ss;
     struct colormap *cm = d->cm;
@@ -283,15 +283,15 @@ shortest(
 
 /*
  - lastCold - determine last point at which no progress had been made
- ^ static chr *lastCold(struct vars *, struct dfa *);
+ ^ static schr *lastCold(struct vars *, struct dfa *);
  */
-static chr *			/* endpoint, or NULL */
+static schr *			/* endpoint, or NULL */
 lastCold(
     struct vars *const v,
     struct dfa *const d)
 {
     struct sset *ss;
-    chr *nopr = d->lastnopr;
+    schr *nopr = d->lastnopr;
     size_t i;
 
     if (nopr == NULL) {
@@ -411,6 +411,78 @@ freeDFA(
     }
 }
 
+/*
+ - getDFA - claim the DFA an RE keeps for a cnfa, or set up a fresh one
+ * The state-set cache of a kept DFA survives from one execution to the
+ * next, so matching the same RE against many strings does not rebuild the
+ * same state sets each time.  Its size is bounded by newDFA() as usual.
+ ^ static struct dfa *getDFA(struct vars *, struct cnfa *,
+ ^	struct colormap *, struct dfa **);
+ */
+static struct dfa *
+getDFA(
+    struct vars *const v,
+    struct cnfa *const cnfa,
+    struct colormap *const cm,
+    struct dfa **const keep)	/* where the RE keeps the DFA, or NULL */
+{
+    struct dfa *d;
+
+    if (keep != NULL && !(v->eflags&REG_SMALL)) {
+	d = (struct dfa *) TAKEPTR(keep);
+	if (d != NULL) {
+	    assert(d->cnfa == cnfa && d->cm == cm);
+	    return d;
+	}
+    }
+    return newDFA(v, cnfa, cm, NULL);
+}
+
+/*
+ - putDFA - give a DFA from getDFA() back to the RE, or free it
+ * Only one DFA is kept per slot; if another thread gave one back in the
+ * meantime, or something went wrong, this one is freed.
+ ^ static void putDFA(struct vars *, struct dfa *, struct dfa **);
+ */
+static void
+putDFA(
+    struct vars *const v,
+    struct dfa *const d,
+    struct dfa **const keep)
+{
+    if (keep == NULL || (v->eflags&REG_SMALL) || ISERR()
+	    || !GIVEPTR(keep, d)) {
+	freeDFA(d);
+    }
+}
+
+#ifndef REG_BYTES
+/*
+ - freedfas - free the DFAs kept by an RE
+ ^ void freedfas(struct guts *);
+ */
+void
+freedfas(
+    struct guts *g)
+{
+    size_t i;
+
+    if (g->searchdfa != NULL) {
+	freeDFA(g->searchdfa);
+	g->searchdfa = NULL;
+    }
+    if (g->subdfas != NULL) {
+	for (i = 0; i < g->ntree; i++) {
+	    if (g->subdfas[i] != NULL) {
+		freeDFA(g->subdfas[i]);
+	    }
+	}
+	FREE(g->subdfas);
+	g->subdfas = NULL;
+    }
+}
+#endif /* !REG_BYTES */
+
 /*
  - hash - construct a hash code for a bitvector
  * There are probably better ways, but they're more expensive.
@@ -433,13 +505,13 @@ hash(
 
 /*
  - initialize - hand-craft a cache entry for startup, otherwise get ready
- ^ static struct sset *initialize(struct vars *, struct dfa *, chr *);
+ ^ static struct sset *initialize(struct vars *, struct dfa *, schr *);
  */
 static struct sset *
 initialize(
     struct vars *const v,	/* used only for debug flags */
     struct dfa *const d,
-    chr *const start)
+    schr *const start)
 {
     struct sset *ss;
     size_t i;
@@ -477,7 +549,7 @@ initialize(
 /*
  - miss - handle a cache miss
  ^ static struct sset *miss(struct vars *, struct dfa *, struct sset *,
- ^	pcolor, chr *, chr *);
+ ^	pcolor, schr *, schr *);
  */
 static struct sset *		/* NULL if goes to empty set */
 miss(
@@ -485,8 +557,8 @@ miss(
     struct dfa *const d,
     struct sset *const css,
     const pcolor co,
-    chr *const cp,		/* next chr */
-    chr *const start)		/* where the attempt got started */
+    schr *const cp,		/* next schr */
+    schr *const start)		/* where the attempt got started */
 {
     struct cnfa *cnfa = d->cnfa;
     unsigned h;
@@ -607,20 +679,20 @@ miss(
 
 /*
  - checkLAConstraint - lookahead-constraint checker for miss()
- ^ static int checkLAConstraint(struct vars *, struct cnfa *, chr *, pcolor);
+ ^ static int checkLAConstraint(struct vars *, struct cnfa *, schr *, pcolor);
  */
 static int			/* predicate:  constraint satisfied? */
 checkLAConstraint(
     struct vars *const v,
     struct cnfa *const pcnfa,	/* parent cnfa */
-    chr *const cp,
+    schr *const cp,
     const pcolor co)		/* "color" of the lookahead constraint */
 {
     size_t n;
     struct subre *sub;
     struct dfa *d;
     struct smalldfa sd;
-    chr *end;
+    schr *end;
 
     n = co - pcnfa->ncolors;
     assert(n < v->g->nlacons && v->g->lacons != NULL);
@@ -641,14 +713,14 @@ checkLAConstraint(
  - getVacantSS - get a vacant state set
  * This routine clears out the inarcs and outarcs, but does not otherwise
  * clear the innards of the state set -- that's up to the caller.
- ^ static struct sset *getVacantSS(struct vars *, struct dfa *, chr *, chr *);
+ ^ static struct sset *getVacantSS(struct vars *, struct dfa *, schr *, schr *);
  */
 static struct sset *
 getVacantSS(
     struct vars *const v,	/* used only for debug flags */
     struct dfa *const d,
-    chr *const cp,
-    chr *const start)
+    schr *const cp,
+    schr *const start)
 {
     int i;
     struct sset *ss, *p;
@@ -721,18 +793,18 @@ getVacantSS(
 
 /*
  - pickNextSS - pick the next stateset to be used
- ^ static struct sset *pickNextSS(struct vars *, struct dfa *, chr *, chr *);
+ ^ static struct sset *pickNextSS(struct vars *, struct dfa *, schr *, schr *);
  */
 static struct sset *
 pickNextSS(
     struct vars *const v,	/* used only for debug flags */
     struct dfa *const d,
-    chr *const cp,
-    chr *const start)
+    schr *const cp,
+    schr *const start)
 {
     int i;
     struct sset *ss, *end;
-    chr *ancient;
+    schr *ancient;
 
     /*
      * Shortcut for cases where cache isn't full.
@@ -133,6 +133,7 @@ typedef struct {
 #define	REG_UEMPTYMATCH		004000
 #define	REG_UIMPOSSIBLE		010000
 #define	REG_USHORTEST		020000
+#define	REG_UASCII		040000	/* matches consume only ASCII chrs */
     char *re_endp;		/* backward compatibility kludge */
     /* the rest is opaque pointers to hidden innards */
     void *re_guts;
@@ -266,6 +267,11 @@ int regexec(regex_t *, const char *, size_t, regmatch_t [], int);
 #ifdef __REG_WIDE_T
 MODULE_SCOPE int __REG_WIDE_EXEC(regex_t *, const __REG_WIDE_T *, size_t, rm_detail_t *, size_t, regmatch_t [], int);
 #endif
+#ifdef __REG_WIDE_T
+MODULE_SCOPE int TclReCompSet(regex_t *, const __REG_WIDE_T *const *, const size_t *, size_t, int);
+MODULE_SCOPE int TclReExecSet(regex_t *, const __REG_WIDE_T *, size_t, size_t, char [], int);
+#endif
+MODULE_SCOPE int TclReExecBytes(regex_t *, const unsigned char *, size_t, rm_detail_t *, size_t, regmatch_t [], int);
 MODULE_SCOPE void regfree(regex_t *);
 MODULE_SCOPE size_t regerror(int, char *, size_t);
 /* automatically gathered by fwd; do not hand-edit */
@@ -30,6 +30,55 @@
 
 #include "regguts.h"
 
+/*
+ * The subject string is a vector of chrs or, when this file is compiled by
+ * regexecb.c, the bytes of its UTF-8 form.  The caller of the byte version
+ * must make sure that every chr a match could consume is a single byte.
+ */
+
+#ifdef REG_BYTES
+#undef exec
+#define	exec	execbytes
+typedef unsigned char schr;
+#define	COMPARE(vv, x, y, n) \
+	bytecmp((vv)->g->cflags&REG_ICASE, (x), (y), (n))
+
+/*
+ - bytecmp - compare two byte strings, ignoring ASCII case if asked to
+ */
+static int
+bytecmp(
+    int icase,
+    const schr *x,
+    const schr *y,
+    size_t len)
+{
+    size_t i;
+    schr c, d;
+
+    if (!icase) {
+	return memcmp(x, y, len);
+    }
+    for (i = 0; i < len; i++) {
+	c = x[i];
+	d = y[i];
+	if (c >= 'A' && c <= 'Z') {
+	    c += 'a' - 'A';
+	}
+	if (d >= 'A' && d <= 'Z') {
+	    d += 'a' - 'A';
+	}
+	if (c != d) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+#else
+typedef chr schr;
+#define	COMPARE(vv, x, y, n)	(*(vv)->g->compare)((x), (y), (n))
+#endif
+
 /*
  * Lazy-DFA representation.
  */
@@ -50,8 +99,9 @@ struct sset {			/* state set */
 #define	POSTSTATE	02	/* includes the goal state */
 #define	LOCKED		04	/* locked in cache */
 #define	NOPROGRESS	010	/* zero-progress state set */
+#define	SETSEEN		020	/* execset() has looked at it */
     struct arcp ins;		/* chain of inarcs pointing here */
-    chr *lastseen;		/* last entered on arrival here */
+    schr *lastseen;		/* last entered on arrival here */
     struct sset **outs;		/* outarc vector indexed by color */
     struct arcp *inchain;	/* chain-pointer vector for outarcs */
 };
@@ -70,8 +120,8 @@ struct dfa {
     struct arcp *incarea;	/* inchain storage */
     struct cnfa *cnfa;
     struct colormap *cm;
-    chr *lastpost;		/* location of last cache-flushed success */
-    chr *lastnopr;		/* location of last cache-flushed NOPROGRESS */
+    schr *lastpost;		/* location of last cache-flushed success */
+    schr *lastnopr;		/* location of last cache-flushed NOPROGRESS */
     struct sset *search;	/* replacement-search-pointer memory */
     char *mallocarea;		/* self, or malloced area, or NULL */
 };
@@ -103,12 +153,10 @@ struct vars {
     size_t nmatch;
     regmatch_t *pmatch;
     rm_detail_t *details;
-    chr *start;			/* start of string */
-    chr *stop;			/* just past end of string */
+    schr *start;			/* start of string */
+    schr *stop;			/* just past end of string */
     int err;			/* error code if any (0 none) */
     struct dfa **subdfas;	/* per-subre DFAs */
-    struct smalldfa dfa1;
-    struct smalldfa dfa2;
 };
 #define	VISERR(vv) ((vv)->err != 0)	/* have we seen an error yet? */
 #define	ISERR()	VISERR(v)
@@ -116,6 +164,8 @@ struct vars {
 #define	ERR(e)	VERR(v, e)	/* record an error */
 #define	NOERR()	{if (ISERR()) return v->err;}	/* if error seen, return it */
 #define	OFF(p)	((p) - v->start)
+#define	KEEPSUB(vv, t)	(((vv)->g->subdfas == NULL) ? NULL : \
+	&(vv)->g->subdfas[(t)->id])	/* where the RE keeps a subre's DFA */
 #define	LOFF(p)	((size_t)OFF(p))
 
 /*
@@ -124,45 +174,55 @@ struct vars {
 /* =====^!^===== begin forwards =====^!^===== */
 /* automatically gathered by fwd; do not hand-edit */
 /* === regexec.c === */
-int exec(regex_t *, const chr *, size_t, rm_detail_t *, size_t, regmatch_t [], int);
+int exec(regex_t *, const schr *, size_t, rm_detail_t *, size_t, regmatch_t [], int);
+#ifndef REG_BYTES
+int execset(regex_t *, const schr *, size_t, size_t, char [], int);
+static size_t sethits(struct vars *const, struct sset *const, char []);
+#endif
 static struct dfa *getsubdfa(struct vars *, struct subre *);
+static int hasmust(const struct must *, const schr *, size_t);
 static int simpleFind(struct vars *const, struct cnfa *const, struct colormap *const);
 static int complicatedFind(struct vars *const, struct cnfa *const, struct colormap *const);
-static int complicatedFindLoop(struct vars *const, struct dfa *const, struct dfa *const, chr **const);
+static int complicatedFindLoop(struct vars *const, struct dfa *const, struct dfa *const, schr **const);
 static void zapallsubs(regmatch_t *const, const size_t);
 static void zaptreesubs(struct vars *const, struct subre *const);
-static void subset(struct vars *const, struct subre *const, chr *const, chr *const);
-static int cdissect(struct vars *, struct subre *, chr *, chr *);
-static int ccondissect(struct vars *, struct subre *, chr *, chr *);
-static int crevcondissect(struct vars *, struct subre *, chr *, chr *);
-static int cbrdissect(struct vars *, struct subre *, chr *, chr *);
-static int caltdissect(struct vars *, struct subre *, chr *, chr *);
-static int citerdissect(struct vars *, struct subre *, chr *, chr *);
-static int creviterdissect(struct vars *, struct subre *, chr *, chr *);
+static void subset(struct vars *const, struct subre *const, schr *const, schr *const);
+static int cdissect(struct vars *, struct subre *, schr *, schr *);
+static int ccondissect(struct vars *, struct subre *, schr *, schr *);
+static int crevcondissect(struct vars *, struct subre *, schr *, schr *);
+static int cbrdissect(struct vars *, struct subre *, schr *, schr *);
+static int caltdissect(struct vars *, struct subre *, schr *, schr *);
+static int citerdissect(struct vars *, struct subre *, schr *, schr *);
+static int creviterdissect(struct vars *, struct subre *, schr *, schr *);
 /* === rege_dfa.c === */
-static chr *longest(struct vars *const, struct dfa *const, chr *const, chr *const, int *const);
-static chr *shortest(struct vars *const, struct dfa *const, chr *const, chr *const, chr *const, chr **const, int *const);
-static chr *lastCold(struct vars *const, struct dfa *const);
+static schr *longest(struct vars *const, struct dfa *const, schr *const, schr *const, int *const);
+static schr *shortest(struct vars *const, struct dfa *const, schr *const, schr *const, schr *const, schr **const, int *const);
+static schr *lastCold(struct vars *const, struct dfa *const);
 static struct dfa *newDFA(struct vars *const, struct cnfa *const, struct colormap *const, struct smalldfa *);
 static void freeDFA(struct dfa *const);
+static struct dfa *getDFA(struct vars *const, struct cnfa *const, struct colormap *const, struct dfa **const);
+static void putDFA(struct vars *const, struct dfa *const, struct dfa **const);
+#ifndef REG_BYTES
+void freedfas(struct guts *);
+#endif
 static unsigned hash(unsigned *const, size_t);
-static struct sset *initialize(struct vars *const, struct dfa *const, chr *const);
-static struct sset *miss(struct vars *const, struct dfa *const, struct sset *const, const pcolor, chr *const, chr *const);
-static int checkLAConstraint(struct vars *const, struct cnfa *const, chr *const, const pcolor);
-static struct sset *getVacantSS(struct vars *const, struct dfa *const, chr *const, chr *const);
-static struct sset *pickNextSS(struct vars *const, struct dfa *const, chr *const, chr *const);
+static struct sset *initialize(struct vars *const, struct dfa *const, schr *const);
+static struct sset *miss(struct vars *const, struct dfa *const, struct sset *const, const pcolor, schr *const, schr *const);
+static int checkLAConstraint(struct vars *const, struct cnfa *const, schr *const, const pcolor);
+static struct sset *getVacantSS(struct vars *const, struct dfa *const, schr *const, schr *const);
+static struct sset *pickNextSS(struct vars *const, struct dfa *const, schr *const, schr *const);
 /* automatically gathered by fwd; do not hand-edit */
 /* =====^!^===== end forwards =====^!^===== */
 
 /*
  - exec - match regular expression
- ^ int exec(regex_t *, const chr *, size_t, rm_detail_t *,
+ ^ int exec(regex_t *, const schr *, size_t, rm_detail_t *,
  ^					size_t, regmatch_t [], int);
  */
 int
 exec(
     regex_t *re,
-    const chr *string,
+    const schr *string,
     size_t len,
     rm_detail_t *details,
     size_t nmatch,
@@ -201,6 +261,11 @@ exec(
 	FreeVars(v);
 	return REG_NOMATCH;
     }
+    if (v->g->must.len > 0 && !(v->g->cflags&REG_EXPECT)
+	    && !hasmust(&v->g->must, string, len)) {
+	FreeVars(v);
+	return REG_NOMATCH;
+    }
     backref = (v->g->info&REG_UBACKREF) ? 1 : 0;
     v->eflags = flags;
     if (v->g->cflags&REG_NOSUB) {
@@ -227,8 +292,8 @@ exec(
 	v->pmatch = pmatch;
     }
     v->details = details;
-    v->start = (chr *)string;
-    v->stop = (chr *)string + len;
+    v->start = (schr *)string;
+    v->stop = (schr *)string + len;
     v->err = 0;
     assert(v->g->ntree >= 0);
     n = v->g->ntree;
@@ -278,7 +343,8 @@ exec(
     n = v->g->ntree;
     for (i = 0; i < n; i++) {
 	if (v->subdfas[i] != NULL) {
-	    freeDFA(v->subdfas[i]);
+	    putDFA(v, v->subdfas[i], (v->g->subdfas == NULL) ? NULL
+		    : &v->g->subdfas[i]);
 	}
     }
     if (v->subdfas != subdfas) {
@@ -288,17 +354,222 @@ exec(
     return st;
 }
 
+/*
+ - hasmust - does the string contain the literal every match must contain?
+ * A plain scan for the first chr followed by a comparison of the rest; this
+ * is much cheaper than running even the search DFA over a string that
+ * cannot match.  A case-insensitive literal is ASCII and in lower case.
+ ^ static int hasmust(const struct must *, const schr *, size_t);
+ */
+static int
+hasmust(
+    const struct must *m,
+    const schr *string,
+    size_t len)
+{
+    const chr *must = m->chrs;
+    size_t nmust = m->len;
+    const schr *p, *last;
+    size_t i;
+    schr c;
+
+    if (len < nmust) {
+	return 0;
+    }
+    last = string + len - nmust;
+    if (!m->icase) {
+	for (p = string; p <= last; p++) {
+	    if (*p == must[0]) {
+		for (i = 1; i < nmust && p[i] == must[i]; i++) {
+		    /* empty loop body */
+		}
+		if (i == nmust) {
+		    return 1;
+		}
+	    }
+	}
+	return 0;
+    }
+    for (p = string; p <= last; p++) {
+	for (i = 0; i < nmust; i++) {
+	    c = p[i];
+	    if (c >= 'A' && c <= 'Z') {
+		c += 'a' - 'A';
+	    }
+	    if (c != must[i]) {
+		break;
+	    }
+	}
+	if (i == nmust) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+#ifndef REG_BYTES
+/*
+ - execset - find which REs of a set match somewhere in a string
+ * The RE must come from compileset().  REs whose required literal is absent
+ * are ruled out first; then one pass of the search DFA over the string,
+ * stopping early once every remaining RE has been seen to match.
+ ^ int execset(regex_t *, const schr *, size_t, size_t, char [], int);
+ */
+int
+execset(
+    regex_t *re,
+    const schr *string,
+    size_t len,
+    size_t nset,		/* number of entries in matched */
+    char matched[],		/* set to 1 for each RE that matches, else 0 */
+    int flags)
+{
+    AllocVars(v);
+    struct dfa *d;
+    struct sset *css, *ss;
+    struct colormap *cm;
+    schr *cp;
+    color co;
+    size_t i, left;
+    int st;
+
+    /*
+     * Sanity checks.
+     */
+
+    if (re == NULL || string == NULL || re->re_magic != REMAGIC) {
+	FreeVars(v);
+	return REG_INVARG;
+    }
+    v->re = re;
+    v->g = (struct guts *)re->re_guts;
+    if (v->g->setstates == NULL || nset != v->g->nset) {
+	FreeVars(v);
+	return REG_INVARG;
+    }
+
+    /*
+     * Setup.
+     */
+
+    left = 0;
+    for (i = 0; i < nset; i++) {
+	matched[i] = 0;
+	if (v->g->setstates[i] != FREESTATE && (v->g->setmusts[i].len == 0
+		|| hasmust(&v->g->setmusts[i], string, len))) {
+	    left++;
+	}
+    }
+    if (left == 0) {
+	FreeVars(v);
+	return REG_NOMATCH;
+    }
+    v->eflags = flags;
+    v->nmatch = 0;
+    v->pmatch = NULL;
+    v->details = NULL;
+    v->start = (schr *)string;
+    v->stop = (schr *)string + len;
+    v->err = 0;
+    v->subdfas = NULL;
+    d = getDFA(v, &v->g->search, &v->g->cmap, &v->g->searchdfa);
+    if (ISERR()) {
+	st = v->err;
+	FreeVars(v);
+	return st;
+    }
+    cm = d->cm;
+    for (i = 0; i < d->nssused; i++) {
+	d->ssets[i].flags &= ~SETSEEN;
+    }
+
+    /*
+     * Startup, then the main loop, and finally the end of the string.
+     */
+
+    cp = v->start;
+    css = initialize(v, d, cp);
+    co = d->cnfa->bos[(v->eflags&REG_NOTBOL) ? 0 : 1];
+    css = miss(v, d, css, co, cp, v->start);
+    if (css != NULL) {
+	css->lastseen = cp;
+	left -= sethits(v, css, matched);
+    }
+    while (css != NULL && left > 0 && cp < v->stop) {
+	co = GETCOLOR(cm, *cp);
+	ss = css->outs[co];
+	if (ss == NULL) {
+	    ss = miss(v, d, css, co, cp+1, v->start);
+	}
+	cp++;
+	css = ss;
+	if (css != NULL) {
+	    css->lastseen = cp;
+	    if (!(css->flags&SETSEEN)) {
+		left -= sethits(v, css, matched);
+	    }
+	}
+    }
+    if (css != NULL && left > 0) {
+	co = d->cnfa->eos[(v->eflags&REG_NOTEOL) ? 0 : 1];
+	css = miss(v, d, css, co, cp, v->start);
+	if (css != NULL) {
+	    left -= sethits(v, css, matched);
+	}
+    }
+
+    if (ISERR()) {
+	st = v->err;
+    } else {
+	st = REG_NOMATCH;
+	for (i = 0; i < nset; i++) {
+	    if (matched[i]) {
+		st = REG_OKAY;
+		break;
+	    }
+	}
+    }
+    putDFA(v, d, &v->g->searchdfa);
+    FreeVars(v);
+    return st;
+}
+
+/*
+ - sethits - note the REs whose post states are in a state set
+ ^ static size_t sethits(struct vars *const, struct sset *const, char []);
+ */
+static size_t			/* number of newly matched REs */
+sethits(
+    struct vars *const v,
+    struct sset *const css,
+    char matched[])
+{
+    size_t i, n = 0;
+    size_t *setstates = v->g->setstates;
+
+    css->flags |= SETSEEN;
+    for (i = 0; i < v->g->nset; i++) {
+	if (!matched[i] && setstates[i] != FREESTATE
+		&& ISBSET(css->states, setstates[i])) {
+	    matched[i] = 1;
+	    n++;
+	}
+    }
+    return n;
+}
+#endif /* !REG_BYTES */
+
 /*
  - getsubdfa - create or re-fetch the DFA for a subre node
- * We only need to create the DFA once per overall regex execution.
- * The DFA will be freed by the cleanup step in exec().
+ * We only need to claim the DFA once per overall regex execution.
+ * The DFA will be given back by the cleanup step in exec().
  */
 static struct dfa *
 getsubdfa(struct vars * v,
 	  struct subre * t)
 {
     if (v->subdfas[t->id] == NULL) {
-	v->subdfas[t->id] = newDFA(v, &t->cnfa, &v->g->cmap, NULL);
+	v->subdfas[t->id] = getDFA(v, &t->cnfa, &v->g->cmap, KEEPSUB(v, t));
 	if (ISERR()) {
 	    return NULL;
 	}
@@ -317,9 +588,9 @@ simpleFind(
     struct colormap *const cm)
 {
     struct dfa *s, *d;
-    chr *begin, *end = NULL;
-    chr *cold;
-    chr *open, *close;		/* Open and close of range of possible
+    schr *begin, *end = NULL;
+    schr *cold;
+    schr *open, *close;		/* Open and close of range of possible
 				 * starts */
     int hitend;
     int shorter = (v->g->tree->flags&SHORTER) ? 1 : 0;
@@ -328,13 +599,13 @@ simpleFind(
      * First, a shot with the search RE.
      */
 
-    s = newDFA(v, &v->g->search, cm, &v->dfa1);
+    s = getDFA(v, &v->g->search, cm, &v->g->searchdfa);
     assert(!(ISERR() && s != NULL));
     NOERR();
     MDEBUG(("\nsearch at %" TCL_Z_MODIFIER "u\n", LOFF(v->start)));
     cold = NULL;
     close = shortest(v, s, v->start, v->start, v->stop, &cold, NULL);
-    freeDFA(s);
+    putDFA(v, s, &v->g->searchdfa);
     NOERR();
     if (v->g->cflags&REG_EXPECT) {
 	assert(v->details != NULL);
@@ -360,7 +631,7 @@ simpleFind(
     open = cold;
     cold = NULL;
     MDEBUG(("between %" TCL_Z_MODIFIER "u and %" TCL_Z_MODIFIER "u\n", LOFF(open), LOFF(close)));
-    d = newDFA(v, cnfa, cm, &v->dfa1);
+    d = getDFA(v, cnfa, cm, KEEPSUB(v, v->g->tree));
     assert(!(ISERR() && d != NULL));
     NOERR();
     for (begin = open; begin <= close; begin++) {
@@ -371,7 +642,7 @@ simpleFind(
 	    end = longest(v, d, begin, v->stop, &hitend);
 	}
 	if (ISERR()) {
-	    freeDFA(d);
+	    putDFA(v, d, KEEPSUB(v, v->g->tree));
 	    return v->err;
 	}
 	if (hitend && cold == NULL) {
@@ -382,7 +653,7 @@ simpleFind(
 	}
     }
     assert(end != NULL);	/* search RE succeeded so loop should */
-    freeDFA(d);
+    putDFA(v, d, KEEPSUB(v, v->g->tree));
 
     /*
      * And pin down details.
@@ -422,22 +693,22 @@ complicatedFind(
     struct colormap *const cm)
 {
     struct dfa *s, *d;
-    chr *cold = NULL; /* silence gcc 4 warning */
+    schr *cold = NULL; /* silence gcc 4 warning */
     int ret;
 
-    s = newDFA(v, &v->g->search, cm, &v->dfa1);
+    s = getDFA(v, &v->g->search, cm, &v->g->searchdfa);
     NOERR();
-    d = newDFA(v, cnfa, cm, &v->dfa2);
+    d = getDFA(v, cnfa, cm, KEEPSUB(v, v->g->tree));
     if (ISERR()) {
 	assert(d == NULL);
-	freeDFA(s);
+	putDFA(v, s, &v->g->searchdfa);
 	return v->err;
     }
 
     ret = complicatedFindLoop(v, d, s, &cold);
 
-    freeDFA(d);
-    freeDFA(s);
+    putDFA(v, d, KEEPSUB(v, v->g->tree));
+    putDFA(v, s, &v->g->searchdfa);
     NOERR();
     if (v->g->cflags&REG_EXPECT) {
 	assert(v->details != NULL);
@@ -454,20 +725,20 @@ complicatedFind(
 /*
  - complicatedFindLoop - the heart of complicatedFind
  ^ static int complicatedFindLoop(struct vars *,
- ^	struct dfa *, struct dfa *, chr **);
+ ^	struct dfa *, struct dfa *, schr **);
  */
 static int
 complicatedFindLoop(
     struct vars *const v,
     struct dfa *const d,
     struct dfa *const s,
-    chr **const coldp)		/* where to put coldstart pointer */
+    schr **const coldp)		/* where to put coldstart pointer */
 {
-    chr *begin, *end;
-    chr *cold;
-    chr *open, *close;		/* Open and close of range of possible
+    schr *begin, *end;
+    schr *cold;
+    schr *open, *close;		/* Open and close of range of possible
 				 * starts */
-    chr *estart, *estop;
+    schr *estart, *estop;
     int er, hitend;
     int shorter = v->g->tree->flags&SHORTER;
 
@@ -583,14 +854,14 @@ zaptreesubs(
 
 /*
  - subset - set subexpression match data for a successful subre
- ^ static void subset(struct vars *, struct subre *, chr *, chr *);
+ ^ static void subset(struct vars *, struct subre *, schr *, schr *);
  */
 static void
 subset(
     struct vars *const v,
     struct subre *const sub,
-    chr *const begin,
-    chr *const end)
+    schr *const begin,
+    schr *const end)
 {
     size_t n = sub->subno;
 
@@ -616,14 +887,14 @@ subset(
  * much faster to check all the substrings against the child DFAs before we
  * recurse.)  Also, caller must have cleared subexpression match data via
  * zaptreesubs (or zapallsubs at the top level).
- ^ static int cdissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int cdissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 cdissect(
     struct vars *v,
     struct subre *t,
-    chr *begin,		/* beginning of relevant substring */
-    chr *end)		/* end of same */
+    schr *begin,		/* beginning of relevant substring */
+    schr *end)		/* end of same */
 {
     int er;
 
@@ -684,17 +955,17 @@ cdissect(
 
 /*
  - ccondissect - dissect match for concatenation node
- ^ static int ccondissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int ccondissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 ccondissect(
     struct vars *v,
     struct subre *t,
-    chr *begin,		/* beginning of relevant substring */
-    chr *end)		/* end of same */
+    schr *begin,		/* beginning of relevant substring */
+    schr *end)		/* end of same */
 {
     struct dfa *d, *d2;
-    chr *mid;
+    schr *mid;
 
     assert(t->op == '.');
     assert(t->left != NULL && t->left->cnfa.nstates > 0);
@@ -774,17 +1045,17 @@ ccondissect(
 
 /*
  - crevcondissect - dissect match for concatenation node, shortest-first
- ^ static int crevcondissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int crevcondissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 crevcondissect(
     struct vars *v,
     struct subre *t,
-    chr *begin,		/* beginning of relevant substring */
-    chr *end)		/* end of same */
+    schr *begin,		/* beginning of relevant substring */
+    schr *end)		/* end of same */
 {
     struct dfa *d, *d2;
-    chr *mid;
+    schr *mid;
 
     assert(t->op == '.');
     assert(t->left != NULL && t->left->cnfa.nstates > 0);
@@ -802,7 +1073,7 @@ crevcondissect(
      * Pick a tentative midpoint.
      */
 
-    mid = shortest(v, d, begin, begin, end, (chr **) NULL, (int *) NULL);
+    mid = shortest(v, d, begin, begin, end, (schr **) NULL, (int *) NULL);
     if (mid == NULL) {
 	return REG_NOMATCH;
     }
@@ -865,22 +1136,22 @@ crevcondissect(
 
 /*
  - cbrdissect - dissect match for backref node
- ^ static int cbrdissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int cbrdissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 cbrdissect(
     struct vars *v,
     struct subre *t,
-    chr *begin,		/* beginning of relevant substring */
-    chr *end)		/* end of same */
+    schr *begin,		/* beginning of relevant substring */
+    schr *end)		/* end of same */
 {
     size_t n = t->subno;
     int min = t->min, max = t->max;
     size_t numreps;
     size_t tlen;
     size_t brlen;
-    chr *brstring;
-    chr *p;
+    schr *brstring;
+    schr *p;
 
     assert(t != NULL);
     assert(t->op == 'b');
@@ -935,7 +1206,7 @@ cbrdissect(
     /* okay, compare the actual string contents */
     p = begin;
     while (numreps-- > 0) {
-	if ((*v->g->compare) (brstring, p, brlen) != 0) {
+	if (COMPARE(v, brstring, p, brlen) != 0) {
 	    return REG_NOMATCH;
 	}
 	p += brlen;
@@ -947,14 +1218,14 @@ cbrdissect(
 
 /*
  - caltdissect - dissect match for alternation node
- ^ static int caltdissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int caltdissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 caltdissect(
     struct vars *v,
     struct subre *t,
-    chr *begin,		/* beginning of relevant substring */
-    chr *end)		/* end of same */
+    schr *begin,		/* beginning of relevant substring */
+    schr *end)		/* end of same */
 {
     struct dfa *d;
     int er;
@@ -984,17 +1255,17 @@ caltdissect(
 
 /*
  - citerdissect - dissect match for iteration node
- ^ static int citerdissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int citerdissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 citerdissect(struct vars * v,
 	     struct subre * t,
-	     chr *begin,	/* beginning of relevant substring */
-	     chr *end)		/* end of same */
+	     schr *begin,	/* beginning of relevant substring */
+	     schr *end)		/* end of same */
 {
     struct dfa *d;
-    chr	  **endpts;
-    chr	   *limit;
+    schr	  **endpts;
+    schr	   *limit;
     int		min_matches;
     size_t	max_matches;
     int		nverified;
@@ -1035,7 +1306,7 @@ citerdissect(struct vars * v,
     }
     if (max_matches < (size_t)min_matches)
 	max_matches = min_matches;
-    endpts = (chr **) MALLOC((max_matches + 1) * sizeof(chr *));
+    endpts = (schr **) MALLOC((max_matches + 1) * sizeof(schr *));
     if (endpts == NULL)
 	return REG_ESPACE;
     endpts[0] = begin;
@@ -1139,7 +1410,7 @@ citerdissect(struct vars * v,
 	 * we'll only ask for a zero-length match if necessary.
 	 */
 	while (k > 0) {
-	    chr	   *prev_end = endpts[k - 1];
+	    schr	   *prev_end = endpts[k - 1];
 
 	    if (endpts[k] > prev_end) {
 		limit = endpts[k] - 1;
@@ -1162,17 +1433,17 @@ citerdissect(struct vars * v,
 
 /*
  - creviterdissect - dissect match for iteration node, shortest-first
- ^ static int creviterdissect(struct vars *, struct subre *, chr *, chr *);
+ ^ static int creviterdissect(struct vars *, struct subre *, schr *, schr *);
  */
 static int			/* regexec return code */
 creviterdissect(struct vars * v,
 		struct subre * t,
-		chr *begin,	/* beginning of relevant substring */
-		chr *end)	/* end of same */
+		schr *begin,	/* beginning of relevant substring */
+		schr *end)	/* end of same */
 {
     struct dfa *d;
-    chr	  **endpts;
-    chr	   *limit;
+    schr	  **endpts;
+    schr	   *limit;
     int		min_matches;
     size_t	max_matches;
     int		nverified;
@@ -1212,7 +1483,7 @@ creviterdissect(struct vars * v,
 	max_matches = t->max;
     if (max_matches < (size_t)min_matches)
 	max_matches = min_matches;
-    endpts = (chr **) MALLOC((max_matches + 1) * sizeof(chr *));
+    endpts = (schr **) MALLOC((max_matches + 1) * sizeof(schr *));
     if (endpts == NULL)
 	return REG_ESPACE;
     endpts[0] = begin;
@@ -1254,7 +1525,7 @@ creviterdissect(struct vars * v,
 
 	/* try to find an endpoint for the k'th sub-match */
 	endpts[k] = shortest(v, d, endpts[k - 1], limit, end,
-			     (chr **) NULL, (int *) NULL);
+			     (schr **) NULL, (int *) NULL);
 	if (endpts[k] == NULL) {
 	    /* no match possible, so see if we can lengthen previous one */
 	    k--;
@@ -0,0 +1,24 @@
+/*
+ * regexecb - match an RE against the UTF-8 bytes of a string
+ *
+ * This compiles the executor in regexec.c a second time, taking the subject
+ * as bytes rather than chrs.  Running on the UTF-8 form directly saves
+ * converting a long string to chrs, four bytes each, just to match it.  The
+ * result is the same as matching the chrs whenever every chr that a match
+ * could consume is ASCII: always for an ASCII subject, and for any subject
+ * when the RE has REG_UASCII set.  Match offsets are in bytes.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#define	REG_BYTES
+#include "regexec.c"
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
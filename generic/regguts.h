@@ -388,6 +388,17 @@ struct fns {
  * the insides of a regex_t, hidden behind a void *
  */
 
+/*
+ * A literal string that every match of an RE contains (see findmust()).
+ */
+
+struct must {
+    chr *chrs;			/* the literal, or NULL if none was found */
+    size_t len;			/* its length */
+    int icase;			/* literal is ASCII in lower case, to be
+				 * matched ignoring case */
+};
+
 struct guts {
     int magic;
 #define	GUTSMAGIC	0xFED9
@@ -401,8 +412,17 @@ struct guts {
     int (*compare) (const chr *, const chr *, size_t);
     struct subre *lacons;	/* lookahead-constraint vector */
     size_t nlacons;		/* size of lacons */
+    struct must must;		/* literal every match contains */
+    struct must *setmusts;	/* compileset() only: literal of each RE */
+    size_t *setstates;		/* compileset() only: post state of each RE */
+    size_t nset;		/* number of REs in the set */
+    struct dfa *searchdfa;	/* DFAs kept between executions (see */
+    struct dfa **subdfas;	/* regexec.c): for the search and for each
+				 * subre by id, NULL when none or claimed */
 };
 
+MODULE_SCOPE void freedfas(struct guts *);
+
 /*
  * Magic for allocating a variable workspace. This default version is
  * stack-hungry.
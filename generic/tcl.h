@@ -369,6 +369,7 @@ typedef struct Tcl_LoadHandle_ *Tcl_LoadHandle;
 typedef struct Tcl_Mutex_ *Tcl_Mutex;
 typedef struct Tcl_Pid_ *Tcl_Pid;
 typedef struct Tcl_RegExp_ *Tcl_RegExp;
+typedef struct Tcl_RegExpSet_ *Tcl_RegExpSet;
 typedef struct Tcl_ThreadDataKey_ *Tcl_ThreadDataKey;
 typedef struct Tcl_ThreadId_ *Tcl_ThreadId;
 typedef struct Tcl_TimerToken_ *Tcl_TimerToken;
@@ -1077,11 +1078,17 @@ struct Tcl_HashEntry {
  *                              than a direct compare, so it is speed-up only
  *                              flag). Don't use it if keys contain values rather
  *                              than pointers.
+ * TCL_HASH_KEY_INCREMENTAL_REHASH -
+ *				When a large table needs more buckets, move
+ *				its entries to the new bucket array a few at a
+ *				time as entries are created, rather than all
+ *				at once.
  */
 
 #define TCL_HASH_KEY_RANDOMIZE_HASH 0x1
 #define TCL_HASH_KEY_SYSTEM_HASH    0x2
 #define TCL_HASH_KEY_DIRECT_COMPARE 0x4
+#define TCL_HASH_KEY_INCREMENTAL_REHASH 0x8
 
 /*
  * Structure definition for the methods associated with a hash table key type.
@@ -142,9 +142,9 @@ TCL_DECLARE_MUTEX(cancelLock);
  * internal encoding (almost UTF-8).
  */
 
-static Tcl_HashTable commandTypeTable;
-static int commandTypeInit = 0;
-TCL_DECLARE_MUTEX(commandTypeLock);
+static TclSharedHashTable commandTypeTable = {
+    NULL, NULL, 0, TCL_ONE_WORD_KEYS, NULL
+};
 
 /*
  * Declarations for managing contexts for non-recursive coroutines. Contexts
@@ -333,9 +333,11 @@ static const CmdInfo builtInCmds[] = {
     {"join",		Tcl_JoinObjCmd,		NULL,			NULL,	CMD_IS_SAFE},
     {"lappend",		Tcl_LappendObjCmd,	TclCompileLappendCmd,	NULL,	CMD_IS_SAFE|CMD_COMPILES_EXPANDED},
     {"lassign",		Tcl_LassignObjCmd,	TclCompileLassignCmd,	NULL,	CMD_IS_SAFE},
+    {"ldiff",		Tcl_LdiffObjCmd,	NULL,			NULL,	CMD_IS_SAFE},
     {"ledit",		Tcl_LeditObjCmd,	NULL,			NULL,	CMD_IS_SAFE}, // TODO: compile
     {"lindex",		Tcl_LindexObjCmd,	TclCompileLindexCmd,	NULL,	CMD_IS_SAFE},
     {"linsert",		Tcl_LinsertObjCmd,	TclCompileLinsertCmd,	NULL,	CMD_IS_SAFE},
+    {"lintersect",	Tcl_LintersectObjCmd,	NULL,			NULL,	CMD_IS_SAFE},
     {"list",		Tcl_ListObjCmd,		TclCompileListCmd,	NULL,	CMD_IS_SAFE|CMD_COMPILES_EXPANDED},
     {"llength",		Tcl_LlengthObjCmd,	TclCompileLlengthCmd,	NULL,	CMD_IS_SAFE},
     {"lmap",		Tcl_LmapObjCmd,		TclCompileLmapCmd,	TclNRLmapCmd,	CMD_IS_SAFE},
@@ -349,6 +351,7 @@ static const CmdInfo builtInCmds[] = {
     {"lseq",		Tcl_LseqObjCmd,		NULL,			NULL,	CMD_IS_SAFE},
     {"lset",		Tcl_LsetObjCmd,		TclCompileLsetCmd,	NULL,	CMD_IS_SAFE},
     {"lsort",		Tcl_LsortObjCmd,	NULL,			NULL,	CMD_IS_SAFE},
+    {"lunion",		Tcl_LunionObjCmd,	NULL,			NULL,	CMD_IS_SAFE},
     {"package",		Tcl_PackageObjCmd,	NULL,			TclNRPackageObjCmd,	CMD_IS_SAFE},
     {"proc",		ProcObjCmd,		NULL,			NULL,	CMD_IS_SAFE},
     {"regexp",		Tcl_RegexpObjCmd,	TclCompileRegexpCmd,	NULL,	CMD_IS_SAFE},
@@ -636,12 +639,7 @@ TclFinalizeEvaluation(void)
     }
     Tcl_MutexUnlock(&cancelLock);
 
-    Tcl_MutexLock(&commandTypeLock);
-    if (commandTypeInit) {
-	Tcl_DeleteHashTable(&commandTypeTable);
-	commandTypeInit = 0;
-    }
-    Tcl_MutexUnlock(&commandTypeLock);
+    TclDeleteSharedHashTable(&commandTypeTable);
 }
 
 /*
@@ -854,7 +852,7 @@ Tcl_CreateInterp(void)
     }
 
 #undef TclObjInterpProc
-    if (commandTypeInit == 0) {
+    if (commandTypeTable.numEntries == 0) {
 	TclRegisterCommandTypeName(TclObjInterpProc, "proc");
 	TclRegisterCommandTypeName(TclEnsembleImplementationCmd, "ensemble");
 	TclRegisterCommandTypeName(TclAliasObjCmd, "alias");
@@ -1193,6 +1191,10 @@ Tcl_CreateInterp(void)
 	    Tcl_DisassembleObjCmd, INT2PTR(1), NULL);
     Tcl_CreateObjCommand(interp, "::tcl::unsupported::representation",
 	    Tcl_RepresentationCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::memory",
+	    TclMemoryProfileObjCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::regexpcache",
+	    TclRegexpCacheObjCmd, NULL, NULL);
 
     /* Adding the bytecode assembler command */
     cmdPtr = (Command *) Tcl_NRCreateCommand(interp,
@@ -1371,27 +1373,8 @@ TclRegisterCommandTypeName(
     Tcl_ObjCmdProc *implementationProc,
     const char *nameStr)
 {
-    Tcl_HashEntry *hPtr;
-
-    Tcl_MutexLock(&commandTypeLock);
-    if (commandTypeInit == 0) {
-	Tcl_InitHashTable(&commandTypeTable, TCL_ONE_WORD_KEYS);
-	commandTypeInit = 1;
-    }
-    if (nameStr != NULL) {
-	int isNew;
-
-	hPtr = Tcl_CreateHashEntry(&commandTypeTable,
-		implementationProc, &isNew);
-	Tcl_SetHashValue(hPtr, (void *) nameStr);
-    } else {
-	hPtr = Tcl_FindHashEntry(&commandTypeTable,
-		implementationProc);
-	if (hPtr != NULL) {
-	    Tcl_DeleteHashEntry(hPtr);
-	}
-    }
-    Tcl_MutexUnlock(&commandTypeLock);
+    TclSharedHashSet(&commandTypeTable, (void *) implementationProc,
+	    (void *) nameStr);
 }
 
 const char *
@@ -1400,22 +1383,14 @@ TclGetCommandTypeName(
 {
     Command *cmdPtr = (Command *) command;
     Tcl_ObjCmdProc *procPtr = cmdPtr->objProc;
-    const char *name = "native";
+    const char *name;
 
     if (procPtr == NULL) {
 	procPtr = cmdPtr->nreProc;
     }
-    Tcl_MutexLock(&commandTypeLock);
-    if (commandTypeInit) {
-	Tcl_HashEntry *hPtr = Tcl_FindHashEntry(&commandTypeTable, procPtr);
-
-	if (hPtr && Tcl_GetHashValue(hPtr)) {
-	    name = (const char *) Tcl_GetHashValue(hPtr);
-	}
-    }
-    Tcl_MutexUnlock(&commandTypeLock);
-
-    return name;
+    name = (const char *) TclSharedHashGet(&commandTypeTable,
+	    (void *) procPtr);
+    return name ? name : "native";
 }
 
 /*
@@ -4645,6 +4620,17 @@ TclNRRunCallbacks(
 				/* All callbacks down to rootPtr not inclusive
 				 * are to be run. */
 {
+    AllocCache *allocCachePtr = ((Interp *) interp)->allocCache;
+    Tcl_Interp *outerInterp = NULL;
+
+    /*
+     * Let the heap profiler know whose code the thread is running.
+     */
+
+    if (allocCachePtr != NULL) {
+	outerInterp = allocCachePtr->evalInterp;
+	allocCachePtr->evalInterp = interp;
+    }
     while (TOP_CB(interp) != rootPtr) {
 	NRE_callback *callbackPtr = TOP_CB(interp);
 	Tcl_NRPostProc *procPtr = callbackPtr->procPtr;
@@ -4653,6 +4639,9 @@ TclNRRunCallbacks(
 	result = procPtr(callbackPtr->data, interp, result);
 	TCLNR_FREE(interp, callbackPtr);
     }
+    if (allocCachePtr != NULL) {
+	allocCachePtr->evalInterp = outerInterp;
+    }
     return result;
 }
 
@@ -9681,6 +9670,13 @@ TclNRCoroutineObjCmd(
 
     corPtr = (CoroutineData *)Tcl_Alloc(sizeof(CoroutineData));
 
+    /*
+     * The coroutine may hold pointers into values from an arena of the
+     * thread while it is suspended; have such arenas leave them in place.
+     */
+
+    TclPinAllocArenas();
+
     cmdPtr = (Command *) TclNRCreateCommandInNs(interp, simpleName,
 	    (Tcl_Namespace *)nsPtr, /*objProc*/ NULL, TclNRInterpCoroutine,
 	    corPtr, DeleteCoroutine);
@@ -1032,7 +1032,7 @@ void *
 Tcl_Alloc(
     size_t size)
 {
-    void *result = TclpAlloc(size);
+    void *result = TclpAllocFrom(size, TclCallerAddress());
 
     /*
      * Most systems will not alloc(0), instead bumping it to one so that NULL
@@ -1056,7 +1056,7 @@ Tcl_DbCkalloc(
     const char *file,
     int line)
 {
-    void *result = TclpAlloc(size);
+    void *result = TclpAllocFrom(size, TclCallerAddress());
 
     if ((result == NULL) && size) {
 	fflush(stdout);
@@ -1081,7 +1081,7 @@ void *
 Tcl_AttemptAlloc(
     size_t size)
 {
-    return (char *)TclpAlloc(size);
+    return (char *)TclpAllocFrom(size, TclCallerAddress());
 }
 
 void *
@@ -1090,7 +1090,7 @@ Tcl_AttemptDbCkalloc(
     TCL_UNUSED(const char *) /*file*/,
     TCL_UNUSED(int) /*line*/)
 {
-    return (char *)TclpAlloc(size);
+    return (char *)TclpAllocFrom(size, TclCallerAddress());
 }
 
 /*
@@ -1109,7 +1109,7 @@ Tcl_Realloc(
     void *ptr,
     size_t size)
 {
-    void *result = TclpRealloc(ptr, size);
+    void *result = TclpReallocFrom(ptr, size, TclCallerAddress());
 
     if ((result == NULL) && size) {
 	Tcl_Panic("unable to realloc %" TCL_Z_MODIFIER "u bytes", size);
@@ -1124,7 +1124,7 @@ Tcl_DbCkrealloc(
     const char *file,
     int line)
 {
-    void *result = TclpRealloc(ptr, size);
+    void *result = TclpReallocFrom(ptr, size, TclCallerAddress());
 
     if ((result == NULL) && size) {
 	fflush(stdout);
@@ -1150,7 +1150,7 @@ Tcl_AttemptRealloc(
     void *ptr,
     size_t size)
 {
-    return (char *)TclpRealloc(ptr, size);
+    return (char *)TclpReallocFrom(ptr, size, TclCallerAddress());
 }
 
 void *
@@ -1160,7 +1160,7 @@ Tcl_AttemptDbCkrealloc(
     TCL_UNUSED(const char *) /*file*/,
     TCL_UNUSED(int) /*line*/)
 {
-    return (char *)TclpRealloc(ptr, size);
+    return (char *)TclpReallocFrom(ptr, size, TclCallerAddress());
 }
 
 /*
@@ -1230,6 +1230,112 @@ TclDumpMemoryInfo(
 }
 
 #endif	/* TCL_MEM_DEBUG */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclMemoryProfileObjCmd --
+ *
+ *	This is the command procedure for "::tcl::unsupported::memory", which
+ *	drives the sampling heap profiler of the threaded allocator in any
+ *	build. It is kept apart from "memory", whose mere presence tells
+ *	scripts that Tcl was built for memory debugging.
+ *
+ *	    memory profile start ?interval?
+ *	    memory profile stop
+ *	    memory profile sites
+ *	    memory profile reset
+ *
+ * Results:
+ *	Returns a standard Tcl completion code.
+ *
+ * Side effects:
+ *	Starts, stops or resets the profiler.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define DEFAULT_PROFILE_INTERVAL	(512 * 1024)
+
+int
+TclMemoryProfileObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Obj values of arguments. */
+{
+    static const char *const options[] = {
+	"profile", NULL
+    };
+    static const char *const subcommands[] = {
+	"reset", "sites", "start", "stop", NULL
+    };
+    enum ProfileSubcommands {
+	PROFILE_RESET, PROFILE_SITES, PROFILE_START, PROFILE_STOP
+    };
+    int index;
+    Tcl_WideInt interval = DEFAULT_PROFILE_INTERVAL;
+    Tcl_Obj *sitesPtr;
+
+    if (objc < 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "profile subcommand ?arg?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[2], subcommands, "subcommand", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (objc > ((index == PROFILE_START) ? 4 : 3)) {
+	Tcl_WrongNumArgs(interp, 3, objv,
+		(index == PROFILE_START) ? "?interval?" : NULL);
+	return TCL_ERROR;
+    }
+
+    switch ((enum ProfileSubcommands) index) {
+    case PROFILE_RESET:
+	TclResetAllocProfile();
+	return TCL_OK;
+    case PROFILE_SITES:
+	sitesPtr = TclGetAllocProfile();
+	if (sitesPtr == NULL) {
+	    break;
+	}
+	Tcl_SetObjResult(interp, sitesPtr);
+	return TCL_OK;
+    case PROFILE_START:
+	if (objc == 4) {
+	    if (TclGetWideIntFromObj(interp, objv[3], &interval) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (interval <= 0) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"expected positive number of bytes but got \"%s\"",
+			TclGetString(objv[3])));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "NUMBER", (char *)NULL);
+		return TCL_ERROR;
+	    }
+	}
+	if (TclSetAllocProfileRate((size_t) interval) != TCL_OK) {
+	    break;
+	}
+	return TCL_OK;
+    case PROFILE_STOP:
+	if (TclSetAllocProfileRate(0) != TCL_OK) {
+	    break;
+	}
+	return TCL_OK;
+    }
+
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+	    "heap profiling needs the threaded memory allocator", -1));
+    Tcl_SetErrorCode(interp, "TCL", "UNSUPPORTED", (char *)NULL);
+    return TCL_ERROR;
+}
+
 
 /*
  *------------------------------------------------------------------------
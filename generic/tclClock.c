@@ -63,16 +63,19 @@ TCL_DECLARE_MUTEX(clockMutex)
  * Function prototypes for local procedures in this file:
  */
 
+static Tcl_Obj *	LookupTZOffset(Tcl_Interp *, Tcl_WideInt,
+			    Tcl_Obj *tzdata, Tcl_Size, Tcl_Obj *const[],
+			    int *tzOffsetPtr, Tcl_WideInt *rangesVal);
 static int		ConvertUTCToLocalUsingTable(Tcl_Interp *,
-			    TclDateFields *, Tcl_Size, Tcl_Obj *const[],
-			    Tcl_WideInt *rangesVal);
+			    TclDateFields *, Tcl_Obj *tzdata, Tcl_Size,
+			    Tcl_Obj *const[], Tcl_WideInt *rangesVal);
 static int		ConvertUTCToLocalUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
 static int		ConvertLocalToUTC(ClockClientData *, Tcl_Interp *,
 			    TclDateFields *, Tcl_Obj *timezoneObj, int);
 static int		ConvertLocalToUTCUsingTable(Tcl_Interp *,
-			    TclDateFields *, int, Tcl_Obj *const[],
-			    Tcl_WideInt *rangesVal);
+			    TclDateFields *, Tcl_Obj *tzdata, Tcl_Size,
+			    Tcl_Obj *const[], Tcl_WideInt *rangesVal);
 static int		ConvertLocalToUTCUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
 static Tcl_ObjCmdProc	ClockConfigureObjCmd;
@@ -94,6 +97,12 @@ static Tcl_ObjCmdProc	ClockMillisecondsObjCmd;
 static Tcl_ObjCmdProc	ClockSecondsObjCmd;
 static Tcl_ObjCmdProc	ClockFormatObjCmd;
 static Tcl_ObjCmdProc	ClockScanObjCmd;
+static int		ClockScanOne(DateInfo *info, Tcl_Obj *strObj,
+			    ClockFmtScnCmdArgs *opts);
+static int		ClockScanList(DateInfo *info, Tcl_Obj *listObj,
+			    ClockFmtScnCmdArgs *opts);
+static int		ClockFormatList(DateFormat *dateFmt,
+			    ClockFmtScnCmdArgs *opts, Tcl_Obj *listObj);
 static int		ClockScanCommit(DateInfo *info,
 			    ClockFmtScnCmdArgs *opts);
 static int		ClockFreeScan(DateInfo *info,
@@ -135,6 +144,7 @@ static const struct ClockCommand clockCommands[] = {
     {"seconds",		ClockSecondsObjCmd,	TclCompileClockReadingCmd, INT2PTR(CLOCK_READ_SECS)},
     {"ConvertLocalToUTC", ClockConvertlocaltoutcObjCmd,		NULL, NULL},
     {"GetDateFields",	  ClockGetdatefieldsObjCmd,		NULL, NULL},
+    {"ReadTZDatabase",	  ClockReadTZDatabaseObjCmd,		NULL, NULL},
     {"GetJulianDayFromEraYearMonthDay",
 		ClockGetjuliandayfromerayearmonthdayObjCmd,	NULL, NULL},
     {"GetJulianDayFromEraYearWeekDay",
@@ -1910,7 +1920,12 @@ ConvertLocalToUTC(
 	return TCL_ERROR;
     }
 
-    if (TclListObjGetElements(interp, tzdata, &rowc, &rowv) != TCL_OK) {
+    if (TclHasInternalRep(tzdata, &ClockTzZoneType)) {
+	/* rows are looked up in the time zone database */
+	rowc = -1;
+	rowv = NULL;
+    } else if (TclListObjGetElements(interp, tzdata, &rowc,
+	    &rowv) != TCL_OK) {
 	return TCL_ERROR;
     }
 
@@ -1929,7 +1944,7 @@ ConvertLocalToUTC(
     } else {
 	Tcl_WideInt rangesVal[2];
 
-	if (ConvertLocalToUTCUsingTable(interp, fields, rowc, rowv,
+	if (ConvertLocalToUTCUsingTable(interp, fields, tzdata, rowc, rowv,
 		rangesVal) != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -1994,13 +2009,12 @@ static int
 ConvertLocalToUTCUsingTable(
     Tcl_Interp *interp,		/* Tcl interpreter */
     TclDateFields *fields,	/* Time to convert, with 'seconds' filled in */
-    int rowc,			/* Number of points at which time changes */
+    Tcl_Obj *tzdata,		/* Time zone data */
+    Tcl_Size rowc,		/* Number of points at which time changes */
     Tcl_Obj *const rowv[],	/* Points at which time changes */
     Tcl_WideInt *rangesVal)	/* Return bounds for time period */
 {
-    Tcl_Obj *row;
-    Tcl_Size cellc;
-    Tcl_Obj **cellv;
+    Tcl_Obj *tzName;
     struct {
 	Tcl_Obj *tzName;
 	int tzOffset;
@@ -2021,13 +2035,9 @@ ConvertLocalToUTCUsingTable(
     fields->tzOffset = 0;
     fields->seconds = fields->localSeconds;
     while (1) {
-	row = LookupLastTransition(interp, fields->seconds, rowc, rowv,
-		rangesVal);
-	if ((row == NULL)
-		|| TclListObjGetElements(interp, row, &cellc,
-		    &cellv) != TCL_OK
-		|| TclGetIntFromObj(interp, cellv[1],
-		    &fields->tzOffset) != TCL_OK) {
+	tzName = LookupTZOffset(interp, fields->seconds, tzdata, rowc, rowv,
+		&fields->tzOffset, rangesVal);
+	if (tzName == NULL) {
 	    return TCL_ERROR;
 	}
 	for (i = 0; i < nHave; ++i) {
@@ -2038,7 +2048,7 @@ ConvertLocalToUTCUsingTable(
 	if (nHave == 8) {
 	    Tcl_Panic("loop in ConvertLocalToUTCUsingTable");
 	}
-	have[nHave].tzName = cellv[3];
+	have[nHave].tzName = tzName;
 	have[nHave++].tzOffset = fields->tzOffset;
 	fields->seconds = fields->localSeconds - fields->tzOffset;
     }
@@ -2165,7 +2175,15 @@ ConvertUTCToLocal(
 	    Tcl_Obj *tzName;
 
 	    tzdata = ClockGetTZData(dataPtr, interp, timezoneObj);
-	    if (TclListObjGetElements(interp, tzdata, &rowc, &rowv) != TCL_OK
+	    if (tzdata == NULL) {
+		return TCL_ERROR;
+	    }
+	    if (TclHasInternalRep(tzdata, &ClockTzZoneType)) {
+		int tzOffset;
+
+		tzName = ClockTzZoneLookup(tzdata, 0, &tzOffset, NULL);
+	    } else if (TclListObjGetElements(interp, tzdata, &rowc,
+		    &rowv) != TCL_OK
 		    || Tcl_ListObjIndex(interp, rowv[0], 3, &tzName) != TCL_OK) {
 		return TCL_ERROR;
 	    }
@@ -2204,7 +2222,12 @@ ConvertUTCToLocal(
 	return TCL_ERROR;
     }
 
-    if (TclListObjGetElements(interp, tzdata, &rowc, &rowv) != TCL_OK) {
+    if (TclHasInternalRep(tzdata, &ClockTzZoneType)) {
+	/* rows are looked up in the time zone database */
+	rowc = -1;
+	rowv = NULL;
+    } else if (TclListObjGetElements(interp, tzdata, &rowc,
+	    &rowv) != TCL_OK) {
 	return TCL_ERROR;
     }
 
@@ -2225,7 +2248,7 @@ ConvertUTCToLocal(
     } else {
 	Tcl_WideInt rangesVal[2];
 
-	if (ConvertUTCToLocalUsingTable(interp, fields, rowc, rowv,
+	if (ConvertUTCToLocalUsingTable(interp, fields, tzdata, rowc, rowv,
 		rangesVal) != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -2278,23 +2301,21 @@ static int
 ConvertUTCToLocalUsingTable(
     Tcl_Interp *interp,		/* Tcl interpreter */
     TclDateFields *fields,	/* Fields of the date */
+    Tcl_Obj *tzdata,		/* Time zone data */
     Tcl_Size rowc,		/* Number of rows in the conversion table
-				 * (>= 1) */
+				 * (>= 1), or -1 for the database */
     Tcl_Obj *const rowv[],	/* Rows of the conversion table */
     Tcl_WideInt *rangesVal)	/* Return bounds for time period */
 {
-    Tcl_Obj *row;		/* Row containing the current information */
-    Tcl_Size cellc;		/* Count of cells in the row (must be 4) */
-    Tcl_Obj **cellv;		/* Pointers to the cells */
+    Tcl_Obj *tzName;		/* Name of the zone at the given time */
 
     /*
      * Look up the nearest transition time.
      */
 
-    row = LookupLastTransition(interp, fields->seconds, rowc, rowv, rangesVal);
-    if (row == NULL
-	    || TclListObjGetElements(interp, row, &cellc, &cellv) != TCL_OK
-	    || TclGetIntFromObj(interp, cellv[1], &fields->tzOffset) != TCL_OK) {
+    tzName = LookupTZOffset(interp, fields->seconds, tzdata, rowc, rowv,
+	    &fields->tzOffset, rangesVal);
+    if (tzName == NULL) {
 	return TCL_ERROR;
     }
 
@@ -2302,7 +2323,7 @@ ConvertUTCToLocalUsingTable(
      * Convert the time.
      */
 
-    TclSetObjRef(fields->tzName, cellv[3]);
+    TclSetObjRef(fields->tzName, tzName);
     fields->localSeconds = fields->seconds + fields->tzOffset;
     return TCL_OK;
 }
@@ -2399,6 +2420,51 @@ ConvertUTCToLocalUsingC(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupTZOffset --
+ *
+ *	Given a UTC time and the time zone data, either a table of transition
+ *	points or a zone of the time zone database, looks up the offset from
+ *	UTC in effect at that time.
+ *
+ * Results:
+ *	Returns the name of the zone at the given time and stores the offset
+ *	in *tzOffsetPtr, or returns NULL with an error in the interpreter.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+LookupTZOffset(
+    Tcl_Interp *interp,		/* Interpreter for error messages */
+    Tcl_WideInt tick,		/* Time from the epoch */
+    Tcl_Obj *tzdata,		/* Time zone data */
+    Tcl_Size rowc,		/* Number of rows of tzdata, or -1 */
+    Tcl_Obj *const *rowv,	/* Rows in tzdata */
+    int *tzOffsetPtr,		/* Return offset from UTC */
+    Tcl_WideInt *rangesVal)	/* Return bounds for time period */
+{
+    Tcl_Obj *row;		/* Row containing the current information */
+    Tcl_Size cellc;		/* Count of cells in the row (must be 4) */
+    Tcl_Obj **cellv;		/* Pointers to the cells */
+
+    if (rowv == NULL) {
+	return ClockTzZoneLookup(tzdata, tick, tzOffsetPtr, rangesVal);
+    }
+    row = LookupLastTransition(interp, tick, rowc, rowv, rangesVal);
+    if (row == NULL
+	    || TclListObjGetElements(interp, row, &cellc, &cellv) != TCL_OK
+	    || TclGetIntFromObj(interp, cellv[1], tzOffsetPtr) != TCL_OK) {
+	return NULL;
+    }
+    return cellv[3];
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3252,6 +3318,110 @@ ClockInitFmtScnArgs(
     opts->interp = interp;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ClockGetBaseFields --
+ *
+ *	Converts the base time of "clock scan" and "clock add", or a clock
+ *	value of "clock format", to date fields in the time zone of "opts".
+ *
+ * Results:
+ *	Returns a standard Tcl result, and stores the fields in "date".
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+ClockGetBaseFields(
+    ClockFmtScnCmdArgs *opts,	/* Parsed options: timezone, interp... */
+    TclDateFields *date,	/* Result: date fields of the base */
+    Tcl_Obj *baseObj)		/* Seconds, "now", or NULL for now */
+{
+    Tcl_Interp *interp = opts->interp;
+    ClockClientData *dataPtr = opts->dataPtr;
+    Tcl_WideInt baseVal;	/* Base time, expressed in seconds from the Epoch */
+
+    if (baseObj != NULL) {
+	/* bypass integer recognition if looks like "now" or "-now" */
+	if ((baseObj->bytes &&
+		((baseObj->length == 3 && baseObj->bytes[0] == 'n') ||
+		 (baseObj->length == 4 && baseObj->bytes[1] == 'n')))
+		|| TclGetWideIntFromObj(NULL, baseObj, &baseVal) != TCL_OK) {
+	    /* we accept "now" and "-now" as current date-time */
+	    static const char *const nowOpts[] = {
+		"now", "-now", NULL
+	    };
+	    int idx;
+
+	    if (Tcl_GetIndexFromObj(NULL, baseObj, nowOpts, "seconds",
+		    TCL_EXACT, &idx) == TCL_OK) {
+		goto baseNow;
+	    }
+
+	    if (TclHasInternalRep(baseObj, &tclBignumType)) {
+		goto baseOverflow;
+	    }
+
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "bad seconds \"%s\": must be now or integer",
+		    TclGetString(baseObj)));
+	    goto badBase;
+	}
+	/*
+	 * Seconds could be an unsigned number that overflowed. Make sure
+	 * that it isn't. Additionally it may be too complex to calculate
+	 * julianday etc (forwards/backwards) by too large/small values, thus
+	 * just let accept a bit shorter values to avoid overflow.
+	 * Note the year is currently an integer, thus avoid to overflow it also.
+	 */
+
+	if (TclHasInternalRep(baseObj, &tclBignumType)
+		|| baseVal < TCL_MIN_SECONDS || baseVal > TCL_MAX_SECONDS) {
+	baseOverflow:
+	    Tcl_SetObjResult(interp, dataPtr->literals[LIT_INTEGER_VALUE_TOO_LARGE]);
+	    goto badBase;
+	}
+    } else {
+	Tcl_Time now;
+
+    baseNow:
+	Tcl_GetTime(&now);
+	baseVal = (Tcl_WideInt) now.sec;
+    }
+
+    /*
+     * Extract year, month and day from the base time for the parser to use as
+     * defaults
+     */
+
+    /* check base fields already cached (by TZ, last-second cache) */
+    if (dataPtr->lastBase.timezoneObj == opts->timezoneObj
+	    && dataPtr->lastBase.date.seconds == baseVal
+	    && (!(dataPtr->lastBase.date.flags & CLF_CTZ)
+	    || dataPtr->lastTZEpoch == TzsetIfNecessary())) {
+	memcpy(date, &dataPtr->lastBase.date, ClockCacheableDateFieldsSize);
+    } else {
+	/* extact fields from base */
+	date->seconds = baseVal;
+	if (ClockGetDateFields(dataPtr, interp, date, opts->timezoneObj,
+		GREGORIAN_CHANGE_DATE) != TCL_OK) {
+	    /* TODO - GREGORIAN_CHANGE_DATE should be locale-dependent */
+	    return TCL_ERROR;
+	}
+	/* cache last base */
+	memcpy(&dataPtr->lastBase.date, date, ClockCacheableDateFieldsSize);
+	TclSetObjRef(dataPtr->lastBase.timezoneObj, opts->timezoneObj);
+    }
+
+    return TCL_OK;
+
+  badBase:
+    Tcl_SetErrorCode(interp, "CLOCK", "badOption", TclGetString(baseObj),
+	    (char *)NULL);
+    return TCL_ERROR;
+}
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -3294,19 +3464,18 @@ ClockParseFmtScnArgs(
     };
     enum optionInd {
 	CLC_ARGS_BASE, CLC_ARGS_FORMAT, CLC_ARGS_GMT, CLC_ARGS_LOCALE,
-	CLC_ARGS_TIMEZONE, CLC_ARGS_VALIDATE
+	CLC_ARGS_TIMEZONE, CLC_ARGS_VALIDATE, CLC_ARGS_LIST
     };
     int optionIndex;		/* Index of an option. */
     int saw = 0;		/* Flag == 1 if option was seen already. */
-    Tcl_Size i, baseIdx;
-    Tcl_WideInt baseVal;	/* Base time, expressed in seconds from the Epoch */
+    Tcl_Size i;
 
     if (operation == CLC_OP_SCN) {
 	/* default flags (from configure) */
 	opts->flags |= dataPtr->defFlags & CLF_VALIDATE;
     } else {
 	/* clock value (as current base) */
-	opts->baseObj = objv[(baseIdx = 1)];
+	opts->baseObj = objv[1];
 	saw |= 1 << CLC_ARGS_BASE;
     }
 
@@ -3323,11 +3492,25 @@ ClockParseFmtScnArgs(
 		continue;
 	    }
 	}
-	/* get option */
+	/*
+	 * Get option. The -list option of format and scan is not in the
+	 * table, so that -l stays an abbreviation of -locale.
+	 */
+
+	if (operation != CLC_OP_ADD) {
+	    Tcl_Size len;
+	    const char *opt = TclGetStringFromObj(objv[i], &len);
+
+	    if ((len >= 3) && (strncmp(opt, "-list", len) == 0)) {
+		optionIndex = CLC_ARGS_LIST;
+		goto gotOption;
+	    }
+	}
 	if (Tcl_GetIndexFromObj(interp, objv[i], options,
 		"option", 0, &optionIndex) != TCL_OK) {
 	    goto badOptionMsg;
 	}
+      gotOption:
 	/* if already specified */
 	if (saw & (1 << optionIndex)) {
 	    if (operation != CLC_OP_SCN && optionIndex == CLC_ARGS_BASE) {
@@ -3357,8 +3540,21 @@ ClockParseFmtScnArgs(
 	    opts->timezoneObj = objv[i + 1];
 	    break;
 	case CLC_ARGS_BASE:
-	    opts->baseObj = objv[(baseIdx = i + 1)];
+	    opts->baseObj = objv[i + 1];
+	    break;
+	case CLC_ARGS_LIST: {
+	    int val;
+
+	    if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &val) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (val) {
+		opts->flags |= CLF_LIST;
+	    } else {
+		opts->flags &= ~CLF_LIST;
+	    }
 	    break;
+	}
 	case CLC_ARGS_VALIDATE:
 	    if (operation != CLC_OP_SCN) {
 		goto badOptionMsg;
@@ -3411,85 +3607,15 @@ ClockParseFmtScnArgs(
 	return TCL_ERROR;
     }
 
-    /* Base (by scan or add) or clock value (by format) */
-
-    if (opts->baseObj != NULL) {
-	Tcl_Obj *baseObj = opts->baseObj;
-
-	/* bypass integer recognition if looks like "now" or "-now" */
-	if ((baseObj->bytes &&
-		((baseObj->length == 3 && baseObj->bytes[0] == 'n') ||
-		 (baseObj->length == 4 && baseObj->bytes[1] == 'n')))
-		|| TclGetWideIntFromObj(NULL, baseObj, &baseVal) != TCL_OK) {
-	    /* we accept "now" and "-now" as current date-time */
-	    static const char *const nowOpts[] = {
-		"now", "-now", NULL
-	    };
-	    int idx;
-
-	    if (Tcl_GetIndexFromObj(NULL, baseObj, nowOpts, "seconds",
-		    TCL_EXACT, &idx) == TCL_OK) {
-		goto baseNow;
-	    }
-
-	    if (TclHasInternalRep(baseObj, &tclBignumType)) {
-		goto baseOverflow;
-	    }
-
-	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
-		    "bad seconds \"%s\": must be now or integer",
-		    TclGetString(baseObj)));
-	    i = baseIdx;
-	    goto badOption;
-	}
-	/*
-	 * Seconds could be an unsigned number that overflowed. Make sure
-	 * that it isn't. Additionally it may be too complex to calculate
-	 * julianday etc (forwards/backwards) by too large/small values, thus
-	 * just let accept a bit shorter values to avoid overflow.
-	 * Note the year is currently an integer, thus avoid to overflow it also.
-	 */
-
-	if (TclHasInternalRep(baseObj, &tclBignumType)
-		|| baseVal < TCL_MIN_SECONDS || baseVal > TCL_MAX_SECONDS) {
-	baseOverflow:
-	    Tcl_SetObjResult(interp, dataPtr->literals[LIT_INTEGER_VALUE_TOO_LARGE]);
-	    i = baseIdx;
-	    goto badOption;
-	}
-    } else {
-	Tcl_Time now;
-
-    baseNow:
-	Tcl_GetTime(&now);
-	baseVal = (Tcl_WideInt) now.sec;
-    }
-
     /*
-     * Extract year, month and day from the base time for the parser to use as
-     * defaults
+     * Base (by scan or add) or clock value (by format). With -list, the
+     * values to format are converted one at a time by the caller.
      */
 
-    /* check base fields already cached (by TZ, last-second cache) */
-    if (dataPtr->lastBase.timezoneObj == opts->timezoneObj
-	    && dataPtr->lastBase.date.seconds == baseVal
-	    && (!(dataPtr->lastBase.date.flags & CLF_CTZ)
-	    || dataPtr->lastTZEpoch == TzsetIfNecessary())) {
-	memcpy(date, &dataPtr->lastBase.date, ClockCacheableDateFieldsSize);
-    } else {
-	/* extact fields from base */
-	date->seconds = baseVal;
-	if (ClockGetDateFields(dataPtr, interp, date, opts->timezoneObj,
-		GREGORIAN_CHANGE_DATE) != TCL_OK) {
-	    /* TODO - GREGORIAN_CHANGE_DATE should be locale-dependent */
-	    return TCL_ERROR;
-	}
-	/* cache last base */
-	memcpy(&dataPtr->lastBase.date, date, ClockCacheableDateFieldsSize);
-	TclSetObjRef(dataPtr->lastBase.timezoneObj, opts->timezoneObj);
+    if ((operation == CLC_OP_FMT) && (opts->flags & CLF_LIST)) {
+	return TCL_OK;
     }
-
-    return TCL_OK;
+    return ClockGetBaseFields(opts, date, opts->baseObj);
 
   badOptionMsg:
     Tcl_SetObjResult(interp, Tcl_ObjPrintf(
@@ -3532,7 +3658,7 @@ ClockFormatObjCmd(
     ClockClientData *dataPtr = (ClockClientData *)clientData;
     static const char *syntax = "clock format clockval|now "
 	    "?-format string? "
-	    "?-gmt boolean? "
+	    "?-gmt boolean? ?-list boolean? "
 	    "?-locale LOCALE? ?-timezone ZONE?";
     int ret;
     ClockFmtScnCmdArgs opts;	/* Format, locale, timezone and base */
@@ -3553,7 +3679,7 @@ ClockFormatObjCmd(
 
     ClockInitFmtScnArgs(dataPtr, interp, &opts);
     ret = ClockParseFmtScnArgs(&opts, &dateFmt.date, objc, objv,
-	    CLC_OP_FMT, "-format, -gmt, -locale, or -timezone");
+	    CLC_OP_FMT, "-format, -gmt, -list, -locale, or -timezone");
     if (ret != TCL_OK) {
 	goto done;
     }
@@ -3564,13 +3690,81 @@ ClockFormatObjCmd(
     }
 
     /* Use compiled version of Format - */
-    ret = ClockFormat(&dateFmt, &opts);
+    if (opts.flags & CLF_LIST) {
+	ret = ClockFormatList(&dateFmt, &opts, objv[1]);
+    } else {
+	ret = ClockFormat(&dateFmt, &opts);
+    }
 
   done:
     TclUnsetObjRef(dateFmt.date.tzName);
     return ret;
 }
 
+/*----------------------------------------------------------------------
+ *
+ * ClockFormatList --
+ *
+ *	Formats each clock value of a list for "clock format -list". The
+ *	options are parsed, and the time zone resolved, only once for the
+ *	whole list; consecutive values within the same time zone period also
+ *	reuse the last offset found (see ConvertUTCToLocal).
+ *
+ * Results:
+ *	Returns a standard Tcl result; on success the interpreter result is
+ *	the list of formatted times.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockFormatList(
+    DateFormat *dateFmt,	/* Common structure used for formatting */
+    ClockFmtScnCmdArgs *opts,	/* Format, locale and timezone */
+    Tcl_Obj *listObj)		/* List of clock values */
+{
+    Tcl_Interp *interp = opts->interp;
+    Tcl_Size i, objc;
+    Tcl_Obj **objv, *resultObj;
+    int ret = TCL_OK;
+
+    /*
+     * Work on a copy, so that the elements stay valid whatever localizing
+     * the format does to the list value.
+     */
+
+    listObj = TclListObjCopy(interp, listObj);
+    if (listObj == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_IncrRefCount(listObj);
+    TclListObjGetElements(NULL, listObj, &objc, &objv);
+    resultObj = Tcl_NewListObj(objc, NULL);
+
+    for (i = 0; i < objc; i++) {
+	TclUnsetObjRef(dateFmt->date.tzName);
+	dateFmt->localeEra = NULL;
+
+	ret = ClockGetBaseFields(opts, &dateFmt->date, objv[i]);
+	if (ret == TCL_OK) {
+	    ret = ClockFormat(dateFmt, opts);
+	}
+	if (ret != TCL_OK) {
+	    Tcl_DecrRefCount(resultObj);
+	    goto done;
+	}
+	Tcl_ListObjAppendElement(NULL, resultObj, Tcl_GetObjResult(interp));
+    }
+    Tcl_SetObjResult(interp, resultObj);
+
+  done:
+    Tcl_DecrRefCount(listObj);
+    return ret;
+}
+
 /*----------------------------------------------------------------------
  *
  * ClockScanObjCmd -- , clock scan --
@@ -3602,12 +3796,11 @@ ClockScanObjCmd(
     static const char *syntax = "clock scan string "
 	    "?-base seconds? "
 	    "?-format string? "
-	    "?-gmt boolean? "
+	    "?-gmt boolean? ?-list boolean? "
 	    "?-locale LOCALE? ?-timezone ZONE? ?-validate boolean?";
     int ret;
     ClockFmtScnCmdArgs opts;	/* Format, locale, timezone and base */
     DateInfo yy;		/* Common structure used for parsing */
-    DateInfo *info = &yy;
 
     /* even number of arguments */
     if ((objc & 1) == 1) {
@@ -3624,63 +3817,169 @@ ClockScanObjCmd(
 
     ClockInitFmtScnArgs(dataPtr, interp, &opts);
     ret = ClockParseFmtScnArgs(&opts, &yy.date, objc, objv,
-	    CLC_OP_SCN, "-base, -format, -gmt, -locale, -timezone or -validate");
+	    CLC_OP_SCN, "-base, -format, -gmt, -list, -locale, -timezone or -validate");
     if (ret != TCL_OK) {
 	goto done;
     }
 
+    if (opts.flags & CLF_LIST) {
+	ret = ClockScanList(&yy, objv[1], &opts);
+    } else {
+	ret = ClockScanOne(&yy, objv[1], &opts);
+    }
+
+  done:
+    TclUnsetObjRef(yy.date.tzName);
+    if (ret != TCL_OK || (opts.flags & CLF_LIST)) {
+	return ret;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(yy.date.seconds));
+    return TCL_OK;
+}
+
+/*----------------------------------------------------------------------
+ *
+ * ClockScanOne --
+ *
+ *	Scans one string for "clock scan", starting from the base date fields
+ *	in "info".
+ *
+ * Results:
+ *	Returns a standard Tcl result; on success the scanned time is left in
+ *	info->date.seconds.
+ *
+ * Side effects:
+ *	May change the time zone in "opts" to one given in the string.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockScanOne(
+    DateInfo *info,		/* Clock scan info structure */
+    Tcl_Obj *strObj,		/* String to scan */
+    ClockFmtScnCmdArgs *opts)	/* Format, locale, timezone and base */
+{
+    Tcl_Interp *interp = opts->interp;
+    int ret;
+
     /* seconds are in localSeconds (relative base date), so reset time here */
     yyHour = yyMinutes = yySeconds = yySecondOfDay = 0;
     yyMeridian = MER24;
 
     /* If free scan */
-    if (opts.formatObj == NULL) {
+    if (opts->formatObj == NULL) {
 	/* Use compiled version of FreeScan - */
 
 	/* [SB] TODO: Perhaps someday we'll localize the legacy code. Right now,
 	 * it's not localized. */
-	if (opts.localeObj != NULL) {
+	if (opts->localeObj != NULL) {
 	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
 		    "legacy [clock scan] does not support -locale", TCL_AUTO_LENGTH));
 	    Tcl_SetErrorCode(interp, "CLOCK", "flagWithLegacyFormat", (char *)NULL);
-	    ret = TCL_ERROR;
-	    goto done;
+	    return TCL_ERROR;
 	}
-	ret = ClockFreeScan(&yy, objv[1], &opts);
+	ret = ClockFreeScan(info, strObj, opts);
     } else {
 	/* Use compiled version of Scan - */
 
-	ret = ClockScan(&yy, objv[1], &opts);
+	ret = ClockScan(info, strObj, opts);
     }
 
     if (ret != TCL_OK) {
-	goto done;
+	return ret;
     }
 
     /* Convert date info structure into UTC seconds */
 
-    ret = ClockScanCommit(&yy, &opts);
+    ret = ClockScanCommit(info, opts);
     if (ret != TCL_OK) {
-	goto done;
+	return ret;
     }
 
     /* Apply remaining validation rules, if expected */
-    if (opts.flags & CLF_VALIDATE) {
-	ret = ClockValidDate(&yy, &opts, opts.flags & CLF_VALIDATE);
+    if (opts->flags & CLF_VALIDATE) {
+	return ClockValidDate(info, opts, opts->flags & CLF_VALIDATE);
+    }
+    return TCL_OK;
+}
+
+/*----------------------------------------------------------------------
+ *
+ * ClockScanList --
+ *
+ *	Scans each string of a list for "clock scan -list". The options are
+ *	parsed, and the time zone and base date resolved, only once for the
+ *	whole list.
+ *
+ * Results:
+ *	Returns a standard Tcl result; on success the interpreter result is
+ *	the list of scanned times.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockScanList(
+    DateInfo *info,		/* Clock scan info structure, holding the
+				 * base date fields */
+    Tcl_Obj *listObj,		/* List of strings to scan */
+    ClockFmtScnCmdArgs *opts)	/* Format, locale, timezone and base */
+{
+    Tcl_Interp *interp = opts->interp;
+    ClockFmtScnCmdArgs baseOpts = *opts;
+    TclDateFields base;
+    Tcl_Size i, objc;
+    Tcl_Obj **objv, *resultObj;
+    int ret = TCL_OK;
+
+    /*
+     * Work on a copy, so that the elements stay valid whatever scanning
+     * does to the list value.
+     */
+
+    listObj = TclListObjCopy(interp, listObj);
+    if (listObj == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_IncrRefCount(listObj);
+    TclListObjGetElements(NULL, listObj, &objc, &objv);
+    memcpy(&base, &yydate, ClockCacheableDateFieldsSize);
+    resultObj = Tcl_NewListObj(objc, NULL);
+
+    for (i = 0; i < objc; i++) {
+	/*
+	 * Each string starts from the base fields and the original options
+	 * (a zone found in a free-form string replaces opts->timezoneObj),
+	 * but keeps the locale catalog once looked up.
+	 */
+
+	Tcl_Obj *mcDictObj = opts->mcDictObj;
+
+	*opts = baseOpts;
+	opts->mcDictObj = mcDictObj;
+	TclUnsetObjRef(yydate.tzName);
+	ClockInitDateInfo(info);
+	memcpy(&yydate, &base, ClockCacheableDateFieldsSize);
+
+	ret = ClockScanOne(info, objv[i], opts);
 	if (ret != TCL_OK) {
+	    Tcl_DecrRefCount(resultObj);
 	    goto done;
 	}
+	Tcl_ListObjAppendElement(NULL, resultObj,
+		Tcl_NewWideIntObj(yydate.seconds));
     }
+    Tcl_SetObjResult(interp, resultObj);
 
   done:
-    TclUnsetObjRef(yy.date.tzName);
-    if (ret != TCL_OK) {
-	return ret;
-    }
-    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(yy.date.seconds));
-    return TCL_OK;
+    Tcl_DecrRefCount(listObj);
+    return ret;
 }
-
+
 /*----------------------------------------------------------------------
  *
  * ClockScanCommit --
@@ -4781,6 +5080,7 @@ ClockFinalize(
     TCL_UNUSED(void *))
 {
     ClockFrmScnFinalize();
+    ClockTzDbFinalize();
 
     if (tz.was && tz.was != TZ_INIT_MARKER) {
 	Tcl_Free(tz.was);
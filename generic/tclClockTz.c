@@ -0,0 +1,673 @@
+/*
+ * tclClockTz.c --
+ *
+ *	Contains the packed time zone database of the clock command. The
+ *	database is one binary file written by tools/tclZIC.tcl. It is mapped
+ *	into memory once per process and searched in place, so loading a zone
+ *	evaluates no script and the transition tables are shared by all
+ *	interpreters and threads.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+#include "tclStrIdxTree.h"
+#include "tclDate.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif /* !_WIN32 */
+
+/*
+ * Layout of the database file. All numbers are big-endian. The header is
+ * followed by the zone index (sorted by name), the transition rows of all
+ * zones, and a pool of NUL-terminated names. A link shares the rows of the
+ * zone it refers to.
+ *
+ *	header:	"TCLTZDB1", numZones(4), numTrans(4), poolSize(4), 0(4)
+ *	zone:	nameOffset(4), firstTrans(4), numTrans(4), 0(4)
+ *	trans:	time(8), offset(4), dst(1), nameOffset(3)
+ */
+
+#define TZDB_MAGIC	"TCLTZDB1"
+#define TZDB_HDR_SIZE	24
+#define TZDB_ZONE_SIZE	16
+#define TZDB_TRANS_SIZE	16
+
+/*
+ * One database file, open for the life of the process. A file replaced
+ * since it was opened gets a new entry; the old one stays, as zones may
+ * still point into it.
+ */
+
+typedef struct TzDb {
+    struct TzDb *nextPtr;	/* Next open database. */
+    char *path;			/* Normalized name of the file. */
+    Tcl_WideUInt dev;		/* Device of the file when opened. */
+    Tcl_WideUInt ino;		/* Inode of the file when opened. */
+    Tcl_WideInt mtime;		/* Modification time of the file when
+				 * opened. */
+    const unsigned char *data;	/* Contents of the file. */
+    size_t length;		/* Size of the file. */
+    int isMapped;		/* Whether data is mapped or allocated. */
+#ifdef _WIN32
+    HANDLE mapHandle;		/* File mapping of data. */
+#endif /* _WIN32 */
+    size_t numZones;		/* Number of zones and links. */
+    const unsigned char *zones;	/* Zone index. */
+    size_t numTrans;		/* Number of transition rows. */
+    const unsigned char *trans;	/* Transition rows. */
+    const char *pool;		/* Names. */
+    size_t poolSize;		/* Size of the name pool. */
+} TzDb;
+
+static TzDb *tzDbList = NULL;
+TCL_DECLARE_MUTEX(tzDbMutex)
+
+/*
+ * Internal representation of a zone loaded from the database. The rows live
+ * in the database; each Tcl_Obj of a zone abbreviation is made on first use.
+ */
+
+typedef struct TzZone {
+    size_t refCount;		/* Number of objects sharing this rep. */
+    const unsigned char *trans;	/* First transition row of the zone. */
+    Tcl_Size numTrans;		/* Number of rows. */
+    const char *pool;		/* Name pool of the database. */
+    Tcl_Obj *names[TCLFLEXARRAY];
+				/* Abbreviation of each row, or NULL. */
+} TzZone;
+
+static void		DupTzZoneInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FreeTzZoneInternalRep(Tcl_Obj *objPtr);
+static void		UpdateStringOfTzZone(Tcl_Obj *objPtr);
+
+const Tcl_ObjType ClockTzZoneType = {
+    "clock-tzdata",			/* name */
+    FreeTzZoneInternalRep,		/* freeIntRepProc */
+    DupTzZoneInternalRep,		/* dupIntRepProc */
+    UpdateStringOfTzZone,		/* updateStringProc */
+    NULL,				/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+#define TzZoneRep(objPtr) \
+    ((TzZone *)(objPtr)->internalRep.twoPtrValue.ptr1)
+
+static inline unsigned int
+TzDbGetUInt(
+    const unsigned char *p)
+{
+    return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16)
+	    | ((unsigned int) p[2] << 8) | (unsigned int) p[3];
+}
+
+static inline Tcl_WideInt
+TzDbGetWide(
+    const unsigned char *p)
+{
+    return (Tcl_WideInt) (((Tcl_WideUInt) TzDbGetUInt(p) << 32)
+	    | TzDbGetUInt(p + 4));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzDbMap --
+ *
+ *	Maps the database file open on a channel into memory, or reads it if
+ *	it is not a native file.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Fills in the data, length and isMapped fields of the database.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TzDbMap(
+    Tcl_Interp *interp,		/* Interpreter for error reporting. */
+    Tcl_Channel chan,		/* Channel open on the file. */
+    TzDb *dbPtr)		/* Database to fill in. */
+{
+    void *handle;
+    Tcl_WideInt size = Tcl_Seek(chan, 0, SEEK_END);
+
+    if (size < TZDB_HDR_SIZE || size > TCL_SIZE_MAX) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"bad time zone database \"%s\": wrong size", dbPtr->path));
+	Tcl_SetErrorCode(interp, "CLOCK", "badTZDatabase", (char *)NULL);
+	return TCL_ERROR;
+    }
+    dbPtr->length = (size_t) size;
+
+    if (Tcl_GetChannelHandle(chan, TCL_READABLE, &handle) == TCL_OK) {
+#ifdef _WIN32
+	dbPtr->mapHandle = CreateFileMappingW((HANDLE) handle, 0,
+		PAGE_READONLY, 0, dbPtr->length, 0);
+	if (dbPtr->mapHandle != NULL) {
+	    dbPtr->data = (const unsigned char *) MapViewOfFile(
+		    dbPtr->mapHandle, FILE_MAP_READ, 0, 0, dbPtr->length);
+	    if (dbPtr->data != NULL) {
+		dbPtr->isMapped = 1;
+		return TCL_OK;
+	    }
+	    CloseHandle(dbPtr->mapHandle);
+	}
+#else /* !_WIN32 */
+	void *data = mmap(0, dbPtr->length, PROT_READ, MAP_FILE | MAP_PRIVATE,
+		PTR2INT(handle), 0);
+
+	if (data != MAP_FAILED) {
+	    dbPtr->data = (const unsigned char *) data;
+	    dbPtr->isMapped = 1;
+	    return TCL_OK;
+	}
+#endif /* _WIN32 */
+    }
+
+    /*
+     * Not a native file (e.g. in the zipfs holding the library), or it could
+     * not be mapped: read it.
+     */
+
+    dbPtr->data = (const unsigned char *) Tcl_AttemptAlloc(dbPtr->length);
+    if (dbPtr->data == NULL) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"not enough memory to load the time zone database",
+		TCL_AUTO_LENGTH));
+	Tcl_SetErrorCode(interp, "CLOCK", "badTZDatabase", (char *)NULL);
+	return TCL_ERROR;
+    }
+    if (Tcl_Seek(chan, 0, SEEK_SET) != 0 || Tcl_Read(chan,
+	    (char *) dbPtr->data, dbPtr->length) != (Tcl_Size) dbPtr->length) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"error reading \"%s\": %s", dbPtr->path, Tcl_PosixError(interp)));
+	Tcl_Free((void *) dbPtr->data);
+	dbPtr->data = NULL;
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzDbUnmap --
+ *
+ *	Releases the contents of a database.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unmaps or frees dbPtr->data.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TzDbUnmap(
+    TzDb *dbPtr)
+{
+    if (dbPtr->data == NULL) {
+	return;
+    }
+    if (!dbPtr->isMapped) {
+	Tcl_Free((void *) dbPtr->data);
+    } else {
+#ifdef _WIN32
+	UnmapViewOfFile(dbPtr->data);
+	CloseHandle(dbPtr->mapHandle);
+#else /* !_WIN32 */
+	munmap((void *) dbPtr->data, dbPtr->length);
+#endif /* _WIN32 */
+    }
+    dbPtr->data = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzDbCheck --
+ *
+ *	Checks the header, the zone index and the transition rows of a
+ *	database, so that lookups need no bounds checks later.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Fills in the table pointers of the database.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TzDbCheck(
+    Tcl_Interp *interp,		/* Interpreter for error reporting. */
+    TzDb *dbPtr)		/* Database to check. */
+{
+    const unsigned char *p = dbPtr->data;
+    size_t i, need;
+
+    if (memcmp(p, TZDB_MAGIC, 8) != 0) {
+	goto bad;
+    }
+    dbPtr->numZones = TzDbGetUInt(p + 8);
+    dbPtr->numTrans = TzDbGetUInt(p + 12);
+    dbPtr->poolSize = TzDbGetUInt(p + 16);
+    need = TZDB_HDR_SIZE + dbPtr->numZones * TZDB_ZONE_SIZE
+	    + dbPtr->numTrans * TZDB_TRANS_SIZE + dbPtr->poolSize;
+    if (need != dbPtr->length || dbPtr->poolSize == 0) {
+	goto bad;
+    }
+    dbPtr->zones = p + TZDB_HDR_SIZE;
+    dbPtr->trans = dbPtr->zones + dbPtr->numZones * TZDB_ZONE_SIZE;
+    dbPtr->pool = (const char *)
+	    (dbPtr->trans + dbPtr->numTrans * TZDB_TRANS_SIZE);
+    if (dbPtr->pool[dbPtr->poolSize - 1] != '\0') {
+	goto bad;
+    }
+
+    for (i = 0; i < dbPtr->numZones; i++) {
+	const unsigned char *z = dbPtr->zones + i * TZDB_ZONE_SIZE;
+	size_t first = TzDbGetUInt(z + 4), count = TzDbGetUInt(z + 8);
+
+	if (TzDbGetUInt(z) >= dbPtr->poolSize || count == 0
+		|| first > dbPtr->numTrans || count > dbPtr->numTrans - first
+		|| (i > 0 && strcmp(dbPtr->pool + TzDbGetUInt(z - TZDB_ZONE_SIZE),
+			dbPtr->pool + TzDbGetUInt(z)) >= 0)) {
+	    goto bad;
+	}
+    }
+    for (i = 0; i < dbPtr->numTrans; i++) {
+	const unsigned char *t = dbPtr->trans + i * TZDB_TRANS_SIZE;
+
+	if ((TzDbGetUInt(t + 12) & 0xFFFFFF) >= dbPtr->poolSize) {
+	    goto bad;
+	}
+    }
+    return TCL_OK;
+
+  bad:
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+	    "bad time zone database \"%s\"", dbPtr->path));
+    Tcl_SetErrorCode(interp, "CLOCK", "badTZDatabase", (char *)NULL);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzDbOpen --
+ *
+ *	Returns the database in the given file, opening it on first use.
+ *
+ * Results:
+ *	Returns the database, or NULL with an error in the interpreter.
+ *
+ * Side effects:
+ *	A database, once open, stays open until the process exits. A file
+ *	that no longer has the device, inode, size and modification time it
+ *	had when opened is opened again.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static TzDb *
+TzDbOpen(
+    Tcl_Interp *interp,		/* Interpreter for error reporting. */
+    Tcl_Obj *pathObj)		/* Name of the database file. */
+{
+    Tcl_Obj *normPathObj = Tcl_FSGetNormalizedPath(interp, pathObj);
+    const char *path;
+    Tcl_StatBuf statBuf;
+    Tcl_Channel chan;
+    TzDb *dbPtr;
+    int ok;
+
+    if (normPathObj == NULL) {
+	return NULL;
+    }
+    path = TclGetString(normPathObj);
+
+    /*
+     * Reuse a database only while its file is the same. One replaced since
+     * it was opened (tclZIC.tcl renames a new file into place) is opened
+     * again; the old mapping keeps the old file alive for its zones.
+     */
+
+    Tcl_MutexLock(&tzDbMutex);
+    if (Tcl_FSStat(normPathObj, &statBuf) == 0) {
+	for (dbPtr = tzDbList; dbPtr != NULL; dbPtr = dbPtr->nextPtr) {
+	    if (strcmp(dbPtr->path, path) == 0
+		    && dbPtr->dev == (Tcl_WideUInt) statBuf.st_dev
+		    && dbPtr->ino == (Tcl_WideUInt) statBuf.st_ino
+		    && dbPtr->length == (size_t) statBuf.st_size
+		    && dbPtr->mtime == (Tcl_WideInt) statBuf.st_mtime) {
+		Tcl_MutexUnlock(&tzDbMutex);
+		return dbPtr;
+	    }
+	}
+    } else {
+	memset(&statBuf, 0, sizeof(Tcl_StatBuf));
+    }
+
+    chan = Tcl_FSOpenFileChannel(interp, normPathObj, "rb", 0);
+    if (chan == NULL) {
+	Tcl_MutexUnlock(&tzDbMutex);
+	return NULL;
+    }
+    dbPtr = (TzDb *) Tcl_Alloc(sizeof(TzDb));
+    memset(dbPtr, 0, sizeof(TzDb));
+    dbPtr->path = (char *) Tcl_Alloc(normPathObj->length + 1);
+    memcpy(dbPtr->path, path, normPathObj->length + 1);
+    dbPtr->dev = (Tcl_WideUInt) statBuf.st_dev;
+    dbPtr->ino = (Tcl_WideUInt) statBuf.st_ino;
+    dbPtr->mtime = (Tcl_WideInt) statBuf.st_mtime;
+
+    ok = (TzDbMap(interp, chan, dbPtr) == TCL_OK
+	    && TzDbCheck(interp, dbPtr) == TCL_OK);
+    Tcl_Close(NULL, chan);
+    if (!ok) {
+	TzDbUnmap(dbPtr);
+	Tcl_Free(dbPtr->path);
+	Tcl_Free(dbPtr);
+	Tcl_MutexUnlock(&tzDbMutex);
+	return NULL;
+    }
+    dbPtr->nextPtr = tzDbList;
+    tzDbList = dbPtr;
+    Tcl_MutexUnlock(&tzDbMutex);
+    return dbPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TzDbFindZone --
+ *
+ *	Looks a zone up by name in the index of a database.
+ *
+ * Results:
+ *	Returns the index entry, or NULL if there is no such zone.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const unsigned char *
+TzDbFindZone(
+    const TzDb *dbPtr,		/* Database to search. */
+    const char *name)		/* Name of the zone, without ':'. */
+{
+    size_t l = 0, u = dbPtr->numZones;
+
+    while (l < u) {
+	size_t m = l + (u - l) / 2;
+	const unsigned char *z = dbPtr->zones + m * TZDB_ZONE_SIZE;
+	int cmp = strcmp(name, dbPtr->pool + TzDbGetUInt(z));
+
+	if (cmp == 0) {
+	    return z;
+	} else if (cmp < 0) {
+	    u = m;
+	} else {
+	    l = m + 1;
+	}
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockReadTZDatabaseObjCmd --
+ *
+ *	Implements "::tcl::clock::ReadTZDatabase file zone": returns the
+ *	time zone data of a zone from the database in the given file, for
+ *	storing in the TZData array.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Opens the database on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+ClockReadTZDatabaseObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter values */
+{
+    const unsigned char *z;
+    Tcl_ObjInternalRep ir;
+    Tcl_Obj *resultObj;
+    TzZone *zonePtr;
+    Tcl_Size count;
+    TzDb *dbPtr;
+
+    if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "file zone");
+	return TCL_ERROR;
+    }
+    dbPtr = TzDbOpen(interp, objv[1]);
+    if (dbPtr == NULL) {
+	return TCL_ERROR;
+    }
+    z = TzDbFindZone(dbPtr, TclGetString(objv[2]));
+    if (z == NULL) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"time zone \":%s\" not found", TclGetString(objv[2])));
+	Tcl_SetErrorCode(interp, "CLOCK", "badTimeZone",
+		TclGetString(objv[2]), (char *)NULL);
+	return TCL_ERROR;
+    }
+
+    count = TzDbGetUInt(z + 8);
+    zonePtr = (TzZone *) Tcl_Alloc(
+	    offsetof(TzZone, names) + count * sizeof(Tcl_Obj *));
+    zonePtr->refCount = 1;
+    zonePtr->trans = dbPtr->trans + TzDbGetUInt(z + 4) * TZDB_TRANS_SIZE;
+    zonePtr->numTrans = count;
+    zonePtr->pool = dbPtr->pool;
+    memset(zonePtr->names, 0, count * sizeof(Tcl_Obj *));
+
+    TclNewObj(resultObj);
+    Tcl_InvalidateStringRep(resultObj);
+    ir.twoPtrValue.ptr1 = zonePtr;
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(resultObj, &ClockTzZoneType, &ir);
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockTzZoneLookup --
+ *
+ *	Given a UTC time and the data of a zone from the database, looks up
+ *	the last transition on or before the given time; the counterpart of
+ *	LookupLastTransition.
+ *
+ * Results:
+ *	Returns the abbreviation of the zone at that time, and stores its
+ *	offset from UTC in *tzOffsetPtr and the bounds of the period of the
+ *	transition in rangesVal.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+ClockTzZoneLookup(
+    Tcl_Obj *tzdata,		/* Zone data of type ClockTzZoneType */
+    Tcl_WideInt tick,		/* Time from the epoch */
+    int *tzOffsetPtr,		/* Return offset from UTC */
+    Tcl_WideInt *rangesVal)	/* Return bounds for time period */
+{
+    TzZone *zonePtr = TzZoneRep(tzdata);
+    const unsigned char *row;
+    Tcl_WideInt compVal, fromVal = LLONG_MIN, toVal = LLONG_MAX;
+    Tcl_Size l, u;
+
+    compVal = TzDbGetWide(zonePtr->trans);
+    if (tick < compVal) {
+	/*
+	 * Bizarre case - first row doesn't begin at MIN_WIDE_INT. Return it
+	 * anyway.
+	 */
+
+	fromVal = compVal;
+	l = 0;
+    } else {
+	l = 0;
+	u = zonePtr->numTrans - 1;
+	while (l < u) {
+	    Tcl_Size m = (l + u + 1) / 2;
+
+	    compVal = TzDbGetWide(zonePtr->trans + m * TZDB_TRANS_SIZE);
+	    if (tick >= compVal) {
+		l = m;
+		fromVal = compVal;
+	    } else {
+		u = m - 1;
+		toVal = compVal;
+	    }
+	}
+    }
+    if (rangesVal) {
+	rangesVal[0] = fromVal;
+	rangesVal[1] = toVal;
+    }
+
+    row = zonePtr->trans + l * TZDB_TRANS_SIZE;
+    *tzOffsetPtr = (int) TzDbGetUInt(row + 8);
+    if (zonePtr->names[l] == NULL) {
+	TclInitObjRef(zonePtr->names[l], Tcl_NewStringObj(
+		zonePtr->pool + (TzDbGetUInt(row + 12) & 0xFFFFFF),
+		TCL_AUTO_LENGTH));
+    }
+    return zonePtr->names[l];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Object type procedures of ClockTzZoneType. The string rep is the list of
+ * {time offset dst name} rows, as found in the time zone scripts.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupTzZoneInternalRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *copyPtr)
+{
+    TzZone *zonePtr = TzZoneRep(srcPtr);
+    Tcl_ObjInternalRep ir;
+
+    zonePtr->refCount++;
+    ir.twoPtrValue.ptr1 = zonePtr;
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(copyPtr, &ClockTzZoneType, &ir);
+}
+
+static void
+FreeTzZoneInternalRep(
+    Tcl_Obj *objPtr)
+{
+    TzZone *zonePtr = TzZoneRep(objPtr);
+
+    if (zonePtr->refCount-- <= 1) {
+	Tcl_Size i;
+
+	for (i = 0; i < zonePtr->numTrans; i++) {
+	    TclUnsetObjRef(zonePtr->names[i]);
+	}
+	Tcl_Free(zonePtr);
+    }
+}
+
+static void
+UpdateStringOfTzZone(
+    Tcl_Obj *objPtr)
+{
+    TzZone *zonePtr = TzZoneRep(objPtr);
+    Tcl_DString ds;
+    Tcl_Size i;
+
+    Tcl_DStringInit(&ds);
+    for (i = 0; i < zonePtr->numTrans; i++) {
+	const unsigned char *row = zonePtr->trans + i * TZDB_TRANS_SIZE;
+	char buf[TCL_INTEGER_SPACE + 2];
+
+	Tcl_DStringStartSublist(&ds);
+	snprintf(buf, sizeof(buf), "%" TCL_LL_MODIFIER "d", TzDbGetWide(row));
+	Tcl_DStringAppendElement(&ds, buf);
+	snprintf(buf, sizeof(buf), "%d", (int) TzDbGetUInt(row + 8));
+	Tcl_DStringAppendElement(&ds, buf);
+	snprintf(buf, sizeof(buf), "%d", (int) (signed char) row[12]);
+	Tcl_DStringAppendElement(&ds, buf);
+	Tcl_DStringAppendElement(&ds,
+		zonePtr->pool + (TzDbGetUInt(row + 12) & 0xFFFFFF));
+	Tcl_DStringEndSublist(&ds);
+    }
+    Tcl_InitStringRep(objPtr, Tcl_DStringValue(&ds), Tcl_DStringLength(&ds));
+    Tcl_DStringFree(&ds);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockTzDbFinalize --
+ *
+ *	Closes all open time zone databases; called on exit.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Unmaps the database files.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+ClockTzDbFinalize(void)
+{
+    Tcl_MutexLock(&tzDbMutex);
+    while (tzDbList != NULL) {
+	TzDb *dbPtr = tzDbList;
+
+	tzDbList = dbPtr->nextPtr;
+	TzDbUnmap(dbPtr);
+	Tcl_Free(dbPtr->path);
+	Tcl_Free(dbPtr);
+    }
+    Tcl_MutexUnlock(&tzDbMutex);
+    Tcl_MutexFinalize(&tzDbMutex);
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
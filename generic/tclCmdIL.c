@@ -96,6 +96,26 @@ typedef struct {
 #define SORTMODE_DICTIONARY	4
 #define SORTMODE_ASCII_NC	8
 
+/*
+ * Lists with at least this many elements are sorted with ParallelSort when
+ * the comparison does not need the interpreter (i.e., everything except
+ * -command). Its array-based merges beat the linked-list merges even when
+ * only one processor is available.
+ */
+
+#ifndef TCL_LSORT_PARALLEL_MIN
+#   define TCL_LSORT_PARALLEL_MIN	65536
+#endif
+
+/*
+ * Lists with at least this many elements are sorted with RadixSort when
+ * sorting by -integer or -real keys.
+ */
+
+#ifndef TCL_LSORT_RADIX_MIN
+#   define TCL_LSORT_RADIX_MIN		256
+#endif
+
 /*
  * Definitions for [lseq] command
  */
@@ -137,8 +157,18 @@ static Tcl_ObjCmdProc	InfoScriptCmd;
 static Tcl_ObjCmdProc	InfoSharedlibCmd;
 static Tcl_ObjCmdProc	InfoCmdTypeCmd;
 static Tcl_ObjCmdProc	InfoTclVersionCmd;
+static int		ListSetOperation(Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[], int op);
 static SortElement *	MergeLists(SortElement *leftPtr, SortElement *rightPtr,
 			    SortInfo *infoPtr);
+static SortElement *	ParallelSort(SortElement *elementArray,
+			    SortElement *scratchArray, Tcl_Size length,
+			    int numThreads, SortInfo *infoPtr);
+static SortElement *	RadixSort(SortElement *elementArray,
+			    SortElement *scratchArray, Tcl_Size length,
+			    SortInfo *infoPtr);
+static SortElement *	LinkSortedArray(SortElement *array, Tcl_Size length,
+			    SortInfo *infoPtr);
 static int		SortCompare(SortElement *firstPtr, SortElement *second,
 			    SortInfo *infoPtr);
 static Tcl_Obj *	SelectObjFromSublist(Tcl_Obj *firstPtr,
@@ -3652,6 +3682,28 @@ Tcl_LsearchObjCmd(
 	if (bisect && index < 0) {
 	    index = lower;
 	}
+    } else if (mode == EXACT && dataType == ASCII && !noCase && !negatedMatch
+	    && sortInfo.indexc == 0 && groupSize == 1
+	    && TclListObjFindString(objv[objc - 2], patObj, start, &i)) {
+	/*
+	 * The list has a hash index of its elements, so only the matching
+	 * elements need to be visited.
+	 */
+
+	if (allMatches) {
+	    listPtr = Tcl_NewListObj(0, NULL);
+	}
+	while (i >= 0) {
+	    if (!allMatches) {
+		index = i;
+		break;
+	    } else if (inlineReturn) {
+		Tcl_ListObjAppendElement(interp, listPtr, listv[i]);
+	    } else {
+		Tcl_ListObjAppendElement(interp, listPtr, Tcl_NewWideIntObj(i));
+	    }
+	    TclListObjFindString(objv[objc - 2], patObj, i + 1, &i);
+	}
     } else {
 	/*
 	 * We need to do a linear search, because (at least one) of:
@@ -4364,7 +4416,8 @@ Tcl_LsortObjCmd(
     Tcl_WideInt wide, groupSize;
     Tcl_Obj *resultPtr, *cmdPtr, **listObjPtrs, *listObj, *indexPtr;
     Tcl_Size i, elmArrSize;
-    SortElement *elementArray = NULL, *elementPtr;
+    SortElement *elementArray = NULL, *elementPtr, *scratchArray = NULL;
+    int numThreads = 1, useRadix = 0;
     SortInfo sortInfo;		/* Information about this sort that needs to
 				 * be passed to the comparison function. */
 #   define MAXCALLOC 1024000
@@ -4709,6 +4762,23 @@ Tcl_LsortObjCmd(
 	goto done;
     }
 
+    /*
+     * Large sorts that do not call back into the interpreter are handed to
+     * RadixSort or ParallelSort once all the keys are extracted, which need
+     * a scratch array of the same size. If that cannot be had, fall back to
+     * merging lists as we go.
+     */
+
+    if ((sortMode == SORTMODE_INTEGER || sortMode == SORTMODE_REAL)
+	    && length >= TCL_LSORT_RADIX_MIN) {
+	useRadix = 1;
+	scratchArray = (SortElement *)malloc(elmArrSize);
+    } else if (length >= TCL_LSORT_PARALLEL_MIN
+	    && sortMode != SORTMODE_COMMAND) {
+	numThreads = TclpNumProcessors();
+	scratchArray = (SortElement *)malloc(elmArrSize);
+    }
+
     for (i=0; i < length; i++) {
 	idx = groupSize * i + groupOffset;
 	if (indexc) {
@@ -4760,6 +4830,10 @@ Tcl_LsortObjCmd(
 	    elementArray[i].payload.objPtr = listObjPtrs[idx];
 	}
 
+	if (scratchArray) {
+	    continue;
+	}
+
 	/*
 	 * Merge this element in the preexisting sublists (and merge together
 	 * sublists when we have two of the same size).
@@ -4781,9 +4855,16 @@ Tcl_LsortObjCmd(
      * Merge all sublists
      */
 
-    elementPtr = subList[0];
-    for (j=1 ; j<NUM_LISTS ; j++) {
-	elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
+    if (scratchArray && useRadix) {
+	elementPtr = RadixSort(elementArray, scratchArray, length, &sortInfo);
+    } else if (scratchArray) {
+	elementPtr = ParallelSort(elementArray, scratchArray, length,
+		numThreads, &sortInfo);
+    } else {
+	elementPtr = subList[0];
+	for (j=1 ; j<NUM_LISTS ; j++) {
+	    elementPtr = MergeLists(subList[j], elementPtr, &sortInfo);
+	}
     }
 
     /*
@@ -4849,6 +4930,9 @@ Tcl_LsortObjCmd(
 	    free((char *)elementArray);
 	}
     }
+    if (scratchArray) {
+	free((char *)scratchArray);
+    }
     return sortInfo.resultCode;
 }
 
@@ -4961,6 +5045,173 @@ Tcl_LeditObjCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_LunionObjCmd, Tcl_LintersectObjCmd, Tcl_LdiffObjCmd --
+ *
+ *	These procedures are invoked to process the "lunion", "lintersect"
+ *	and "ldiff" Tcl commands. See the user documentation for details on
+ *	what they do.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+enum ListSetOps {
+    LSETOP_UNION, LSETOP_INTERSECT, LSETOP_DIFF
+};
+
+int
+Tcl_LunionObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument values. */
+{
+    return ListSetOperation(interp, objc, objv, LSETOP_UNION);
+}
+
+int
+Tcl_LintersectObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument values. */
+{
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "list ?list ...?");
+	return TCL_ERROR;
+    }
+    return ListSetOperation(interp, objc, objv, LSETOP_INTERSECT);
+}
+
+int
+Tcl_LdiffObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument values. */
+{
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "list ?list ...?");
+	return TCL_ERROR;
+    }
+    return ListSetOperation(interp, objc, objv, LSETOP_DIFF);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ListSetOperation --
+ *
+ *	Shared implementation of "lunion", "lintersect" and "ldiff". Elements
+ *	are compared by their string values through a hash table, so the time
+ *	taken is linear in the total length of the lists.
+ *
+ * Results:
+ *	A standard Tcl result. On success the interpreter result is the list
+ *	of distinct elements selected, in order of first occurrence.
+ *
+ * Side effects:
+ *	The arguments are converted to lists.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ListSetOperation(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[],	/* Argument values; objv[1] onwards are the
+				 * lists to combine. */
+    int op)			/* One of the LSETOP_* values. */
+{
+    Tcl_HashTable table;
+    Tcl_HashEntry *hPtr;
+    Tcl_Obj *resultObj, **elemv;
+    Tcl_Size elemc, j, want;
+    int i, isNew;
+
+    /*
+     * Check that everything is a list before doing any work.
+     */
+
+    for (i = 1; i < objc; i++) {
+	if (TclListObjGetElements(interp, objv[i], &elemc, &elemv) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    TclNewObj(resultObj);
+    Tcl_InitObjHashTable(&table);
+
+    if (op == LSETOP_UNION) {
+	for (i = 1; i < objc; i++) {
+	    TclListObjGetElements(NULL, objv[i], &elemc, &elemv);
+	    for (j = 0; j < elemc; j++) {
+		Tcl_CreateHashEntry(&table, elemv[j], &isNew);
+		if (isNew) {
+		    Tcl_ListObjAppendElement(NULL, resultObj, elemv[j]);
+		}
+	    }
+	}
+	goto done;
+    }
+
+    /*
+     * Otherwise the hash value of each element of the first list records
+     * whether it has been seen in the other lists. For intersection it
+     * counts how many of them, in order, contained it; for difference it is
+     * just a flag.
+     */
+
+    TclListObjGetElements(NULL, objv[1], &elemc, &elemv);
+    for (j = 0; j < elemc; j++) {
+	hPtr = Tcl_CreateHashEntry(&table, elemv[j], &isNew);
+	Tcl_SetHashValue(hPtr, INT2PTR(0));
+    }
+    for (i = 2; i < objc; i++) {
+	TclListObjGetElements(NULL, objv[i], &elemc, &elemv);
+	for (j = 0; j < elemc; j++) {
+	    hPtr = Tcl_FindHashEntry(&table, elemv[j]);
+	    if (hPtr == NULL) {
+		continue;
+	    }
+	    if (op == LSETOP_DIFF) {
+		Tcl_SetHashValue(hPtr, INT2PTR(1));
+	    } else if (PTR2INT(Tcl_GetHashValue(hPtr)) == i - 2) {
+		Tcl_SetHashValue(hPtr, INT2PTR(i - 1));
+	    }
+	}
+    }
+
+    /*
+     * Collect the selected elements, marking each one as it is added so
+     * that duplicates in the first list are only reported once.
+     */
+
+    want = (op == LSETOP_INTERSECT) ? objc - 2 : 0;
+    TclListObjGetElements(NULL, objv[1], &elemc, &elemv);
+    for (j = 0; j < elemc; j++) {
+	hPtr = Tcl_FindHashEntry(&table, elemv[j]);
+	if (PTR2INT(Tcl_GetHashValue(hPtr)) == want) {
+	    Tcl_ListObjAppendElement(NULL, resultObj, elemv[j]);
+	    Tcl_SetHashValue(hPtr, INT2PTR(-1));
+	}
+    }
+
+  done:
+    Tcl_DeleteHashTable(&table);
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -5061,6 +5312,399 @@ MergeLists(
     return headPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelSort --
+ *
+ *	Sorts an array of SortElement structures with a stable merge sort
+ *	spread over several threads, then threads the result into a list the
+ *	same way the serial MergeLists-based sort would have. The array is cut
+ *	into one chunk per task, the chunks are sorted independently, and then
+ *	pairs of sorted runs are merged in rounds. Each merge is itself split
+ *	at evenly spaced output positions so that every round keeps all the
+ *	threads busy.
+ *
+ *	Only comparisons that do not involve the interpreter may be used here,
+ *	which rules out SORTMODE_COMMAND.
+ *
+ * Results:
+ *	The head of the sorted list of SortElement structures, which are
+ *	located in either elementArray or scratchArray.
+ *
+ * Side effects:
+ *	The contents of both arrays are overwritten. If infoPtr->unique is set
+ *	then infoPtr->numElements is updated; as with MergeLists, the last of
+ *	each run of equal elements is the one retained.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    SortInfo *infoPtr;		/* Comparison information. */
+    SortElement *srcArray;	/* Array holding the runs to sort or merge. */
+    SortElement *dstArray;	/* Array receiving the merged runs. */
+    Tcl_Size length;		/* Number of elements in both arrays. */
+    Tcl_Size runLength;		/* Length of the sorted runs in srcArray. */
+    Tcl_Size numTasks;		/* Number of tasks in each round. */
+    Tcl_Size tasksPerMerge;	/* Number of tasks sharing one merge. */
+} ParallelSortInfo;
+
+/*
+ * Chunks shorter than this are sorted by insertion before being merged.
+ */
+
+#define SORT_INSERTION_RUN	16
+
+static void
+MergeRuns(
+    const SortElement *leftPtr,	/* First sorted run. */
+    Tcl_Size numLeft,
+    const SortElement *rightPtr,/* Second sorted run; ties favour the first
+				 * so the merge is stable. */
+    Tcl_Size numRight,
+    SortElement *outPtr,	/* Where to put numLeft+numRight elements. */
+    SortInfo *infoPtr)
+{
+    const SortElement *leftEnd = leftPtr + numLeft;
+    const SortElement *rightEnd = rightPtr + numRight;
+
+    while (leftPtr < leftEnd && rightPtr < rightEnd) {
+	if (SortCompare((SortElement *)leftPtr, (SortElement *)rightPtr,
+		infoPtr) > 0) {
+	    *outPtr++ = *rightPtr++;
+	} else {
+	    *outPtr++ = *leftPtr++;
+	}
+    }
+    while (leftPtr < leftEnd) {
+	*outPtr++ = *leftPtr++;
+    }
+    while (rightPtr < rightEnd) {
+	*outPtr++ = *rightPtr++;
+    }
+}
+
+static void
+SortChunkTask(
+    void *clientData,
+    Tcl_Size taskIndex)
+{
+    ParallelSortInfo *psPtr = (ParallelSortInfo *)clientData;
+    Tcl_Size first = taskIndex * psPtr->runLength;
+    Tcl_Size length = psPtr->length - first;
+    SortElement *srcPtr, *dstPtr, *tmpPtr, value;
+    Tcl_Size i, j, width;
+
+    if (length <= 0) {
+	return;
+    }
+    if (length > psPtr->runLength) {
+	length = psPtr->runLength;
+    }
+    srcPtr = psPtr->srcArray + first;
+    dstPtr = psPtr->dstArray + first;
+
+    /*
+     * Insertion sort short runs, then merge them bottom-up, swapping the
+     * roles of the two arrays on each pass.
+     */
+
+    for (i = 0; i < length; i += SORT_INSERTION_RUN) {
+	Tcl_Size end = i + SORT_INSERTION_RUN;
+
+	if (end > length) {
+	    end = length;
+	}
+	for (j = i + 1; j < end; j++) {
+	    Tcl_Size k = j;
+
+	    value = srcPtr[j];
+	    while (k > i && SortCompare(&srcPtr[k-1], &value,
+		    psPtr->infoPtr) > 0) {
+		srcPtr[k] = srcPtr[k-1];
+		k--;
+	    }
+	    srcPtr[k] = value;
+	}
+    }
+    for (width = SORT_INSERTION_RUN; width < length; width *= 2) {
+	for (i = 0; i < length; i += 2 * width) {
+	    Tcl_Size mid = i + width, end = i + 2 * width;
+
+	    if (mid > length) {
+		mid = length;
+	    }
+	    if (end > length) {
+		end = length;
+	    }
+	    MergeRuns(srcPtr + i, mid - i, srcPtr + mid, end - mid,
+		    dstPtr + i, psPtr->infoPtr);
+	}
+	tmpPtr = srcPtr;
+	srcPtr = dstPtr;
+	dstPtr = tmpPtr;
+    }
+    if (srcPtr != psPtr->srcArray + first) {
+	memcpy(psPtr->srcArray + first, srcPtr, length * sizeof(SortElement));
+    }
+}
+
+/*
+ * Returns how many of the first 'rank' merged elements of two runs come from
+ * the left run, consistent with the tie-breaking in MergeRuns.
+ */
+
+static Tcl_Size
+MergeSplit(
+    const SortElement *leftPtr,
+    Tcl_Size numLeft,
+    const SortElement *rightPtr,
+    Tcl_Size numRight,
+    Tcl_Size rank,
+    SortInfo *infoPtr)
+{
+    Tcl_Size lo = (rank > numRight) ? rank - numRight : 0;
+    Tcl_Size hi = (rank < numLeft) ? rank : numLeft;
+
+    while (lo < hi) {
+	Tcl_Size mid = lo + (hi - lo) / 2;
+
+	if (SortCompare((SortElement *)&rightPtr[rank - mid - 1],
+		(SortElement *)&leftPtr[mid], infoPtr) < 0) {
+	    hi = mid;
+	} else {
+	    lo = mid + 1;
+	}
+    }
+    return lo;
+}
+
+static void
+MergeRunsTask(
+    void *clientData,
+    Tcl_Size taskIndex)
+{
+    ParallelSortInfo *psPtr = (ParallelSortInfo *)clientData;
+    Tcl_Size merge = taskIndex / psPtr->tasksPerMerge;
+    Tcl_Size part = taskIndex % psPtr->tasksPerMerge;
+    Tcl_Size first = merge * 2 * psPtr->runLength;
+    Tcl_Size numLeft, numRight, total, startRank, endRank, startLeft, endLeft;
+    const SortElement *leftPtr, *rightPtr;
+
+    if (first >= psPtr->length) {
+	return;
+    }
+    numLeft = psPtr->length - first;
+    if (numLeft > psPtr->runLength) {
+	numLeft = psPtr->runLength;
+    }
+    numRight = psPtr->length - first - numLeft;
+    if (numRight > psPtr->runLength) {
+	numRight = psPtr->runLength;
+    }
+    leftPtr = psPtr->srcArray + first;
+    rightPtr = leftPtr + numLeft;
+    total = numLeft + numRight;
+
+    startRank = total / psPtr->tasksPerMerge * part
+	    + (total % psPtr->tasksPerMerge) * part / psPtr->tasksPerMerge;
+    endRank = total / psPtr->tasksPerMerge * (part + 1)
+	    + (total % psPtr->tasksPerMerge) * (part + 1) / psPtr->tasksPerMerge;
+    startLeft = MergeSplit(leftPtr, numLeft, rightPtr, numRight, startRank,
+	    psPtr->infoPtr);
+    endLeft = MergeSplit(leftPtr, numLeft, rightPtr, numRight, endRank,
+	    psPtr->infoPtr);
+    MergeRuns(leftPtr + startLeft, endLeft - startLeft,
+	    rightPtr + (startRank - startLeft),
+	    (endRank - endLeft) - (startRank - startLeft),
+	    psPtr->dstArray + first + startRank, psPtr->infoPtr);
+}
+
+static SortElement *
+ParallelSort(
+    SortElement *elementArray,	/* Elements to sort. */
+    SortElement *scratchArray,	/* Scratch space of the same size. */
+    Tcl_Size length,		/* Number of elements in the arrays. */
+    int numThreads,		/* Number of threads to use. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    ParallelSortInfo ps;
+    SortElement *tmpPtr;
+
+    /*
+     * Use a power of two number of chunks so that every merge round pairs
+     * up all the runs.
+     */
+
+    ps.numTasks = 1;
+    while (ps.numTasks < numThreads
+	    && ps.numTasks < TCL_PARALLEL_MAX_THREADS) {
+	ps.numTasks *= 2;
+    }
+    ps.infoPtr = infoPtr;
+    ps.srcArray = elementArray;
+    ps.dstArray = scratchArray;
+    ps.length = length;
+    ps.runLength = (length + ps.numTasks - 1) / ps.numTasks;
+    TclRunParallel(ps.numTasks, numThreads, SortChunkTask, &ps);
+
+    for (ps.tasksPerMerge = 2; ps.tasksPerMerge <= ps.numTasks;
+	    ps.tasksPerMerge *= 2) {
+	TclRunParallel(ps.numTasks, numThreads, MergeRunsTask, &ps);
+	tmpPtr = ps.srcArray;
+	ps.srcArray = ps.dstArray;
+	ps.dstArray = tmpPtr;
+	ps.runLength *= 2;
+    }
+
+    return LinkSortedArray(ps.srcArray, length, infoPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RadixSort --
+ *
+ *	Sorts an array of SortElement structures whose collation keys are
+ *	integers or doubles with an LSD radix sort on the 64-bit key, one byte
+ *	per pass. Passes in which every key has the same byte are skipped, so
+ *	lists of small integers need only one or two passes. Each pass is
+ *	stable, which keeps equal elements in list order just like the merge
+ *	sorts do.
+ *
+ * Results:
+ *	The head of the sorted list of SortElement structures, which are
+ *	located in either elementArray or scratchArray.
+ *
+ * Side effects:
+ *	The contents of both arrays are overwritten. If infoPtr->unique is set
+ *	then infoPtr->numElements is updated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline Tcl_WideUInt
+RadixKey(
+    const SortElement *elemPtr,
+    const SortInfo *infoPtr)
+{
+    Tcl_WideUInt key;
+
+    if (infoPtr->sortMode == SORTMODE_INTEGER) {
+	key = (Tcl_WideUInt)elemPtr->collationKey.wideValue;
+	key ^= (Tcl_WideUInt)1 << 63;
+    } else {
+	double d = elemPtr->collationKey.doubleValue;
+
+	/*
+	 * Map the IEEE bit pattern onto an unsigned value with the same
+	 * ordering. Negative zero must compare equal to positive zero, as it
+	 * does in SortCompare.
+	 */
+
+	if (d == 0.0) {
+	    d = 0.0;
+	}
+	memcpy(&key, &d, sizeof(key));
+	if (key & ((Tcl_WideUInt)1 << 63)) {
+	    key = ~key;
+	} else {
+	    key ^= (Tcl_WideUInt)1 << 63;
+	}
+    }
+    return infoPtr->isIncreasing ? key : ~key;
+}
+
+static SortElement *
+RadixSort(
+    SortElement *elementArray,	/* Elements to sort. */
+    SortElement *scratchArray,	/* Scratch space of the same size. */
+    Tcl_Size length,		/* Number of elements in the arrays. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    Tcl_Size counts[8][256], offsets[256], i, total;
+    SortElement *srcPtr = elementArray, *dstPtr = scratchArray, *tmpPtr;
+    Tcl_WideUInt key;
+    int pass, digit;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < length; i++) {
+	key = RadixKey(&srcPtr[i], infoPtr);
+	for (pass = 0; pass < 8; pass++) {
+	    counts[pass][(key >> (8 * pass)) & 0xFF]++;
+	}
+    }
+
+    key = RadixKey(&srcPtr[0], infoPtr);
+    for (pass = 0; pass < 8; pass++) {
+	if (counts[pass][(key >> (8 * pass)) & 0xFF] == length) {
+	    continue;
+	}
+	for (total = 0, digit = 0; digit < 256; digit++) {
+	    offsets[digit] = total;
+	    total += counts[pass][digit];
+	}
+	for (i = 0; i < length; i++) {
+	    digit = (RadixKey(&srcPtr[i], infoPtr) >> (8 * pass)) & 0xFF;
+	    dstPtr[offsets[digit]++] = srcPtr[i];
+	}
+	tmpPtr = srcPtr;
+	srcPtr = dstPtr;
+	dstPtr = tmpPtr;
+    }
+
+    return LinkSortedArray(srcPtr, length, infoPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LinkSortedArray --
+ *
+ *	Threads a sorted array of SortElement structures into a list, the
+ *	form in which Tcl_LsortObjCmd consumes the result of a sort.
+ *
+ * Results:
+ *	The head of the list.
+ *
+ * Side effects:
+ *	If infoPtr->unique is set then all but the last of each run of equal
+ *	elements are left out, as MergeLists does, and infoPtr->numElements
+ *	is updated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SortElement *
+LinkSortedArray(
+    SortElement *array,		/* Sorted elements. */
+    Tcl_Size length,		/* Number of elements; at least 1. */
+    SortInfo *infoPtr)		/* Information needed by the comparison
+				 * operator. */
+{
+    SortElement *headPtr = NULL, *tailPtr = NULL;
+    Tcl_Size i;
+
+    for (i = 0; i < length; i++) {
+	if (infoPtr->unique && i + 1 < length
+		&& SortCompare(&array[i], &array[i+1], infoPtr) == 0) {
+	    infoPtr->numElements--;
+	    continue;
+	}
+	if (tailPtr) {
+	    tailPtr->nextPtr = &array[i];
+	} else {
+	    headPtr = &array[i];
+	}
+	tailPtr = &array[i];
+    }
+    tailPtr->nextPtr = NULL;
+    return headPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
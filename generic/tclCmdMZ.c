@@ -132,19 +132,21 @@ Tcl_RegexpObjCmd(
     Tcl_Obj *const objv[])	/* Argument objects. */
 {
     Tcl_Size offset, stringLength, matchLength, cflags, eflags;
-    int i, indices, match, about, all, doinline, numMatchesSaved;
+    int i, indices, match, about, all, doinline, doset, numMatchesSaved;
     Tcl_RegExp regExpr;
+    Tcl_RegExpSet regExprSet;
     Tcl_Obj *objPtr, *startIndex = NULL, *resultPtr = NULL;
     Tcl_RegExpInfo info;
     static const char *const options[] = {
 	"-all",		"-about",	"-indices",	"-inline",
 	"-expanded",	"-line",	"-linestop",	"-lineanchor",
-	"-nocase",	"-start",	"--",		NULL
+	"-nocase",	"-set",		"-start",	"--",
+	NULL
     };
     enum regexpoptions {
 	REGEXP_ALL,	REGEXP_ABOUT,	REGEXP_INDICES,	REGEXP_INLINE,
 	REGEXP_EXPANDED,REGEXP_LINE,	REGEXP_LINESTOP,REGEXP_LINEANCHOR,
-	REGEXP_NOCASE,	REGEXP_START,	REGEXP_LAST
+	REGEXP_NOCASE,	REGEXP_SET,	REGEXP_START,	REGEXP_LAST
     } index;
 
     indices = 0;
@@ -153,6 +155,7 @@ Tcl_RegexpObjCmd(
     offset = TCL_INDEX_START;
     all = 0;
     doinline = 0;
+    doset = 0;
 
     for (i = 1; i < objc; i++) {
 	const char *name;
@@ -181,6 +184,9 @@ Tcl_RegexpObjCmd(
 	case REGEXP_ABOUT:
 	    about = 1;
 	    break;
+	case REGEXP_SET:
+	    doset = 1;
+	    break;
 	case REGEXP_EXPANDED:
 	    cflags |= TCL_REG_EXPANDED;
 	    break;
@@ -238,6 +244,20 @@ Tcl_RegexpObjCmd(
 	goto optionError;
     }
 
+    /*
+     * With -set, the first argument is a list of patterns and the result is
+     * the list of indices of those that match.
+     */
+
+    if (doset && (about || all || indices || doinline || (objc - 2) != 0)) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"regexp -set cannot be used with -about, -all, -indices,"
+		" -inline or match variables", -1));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "REGEXP",
+		"MIX_SET", (char *)NULL);
+	goto optionError;
+    }
+
     /*
      * Handle the odd about case separately.
      */
@@ -271,6 +291,30 @@ Tcl_RegexpObjCmd(
 	}
     }
 
+    if (doset) {
+	if (offset == TCL_INDEX_START) {
+	    eflags = 0;
+	} else if (offset > stringLength) {
+	    eflags = TCL_REG_NOTBOL;
+	} else if (Tcl_GetUniChar(objPtr, offset-1) == '\n') {
+	    eflags = 0;
+	} else {
+	    eflags = TCL_REG_NOTBOL;
+	}
+	regExprSet = Tcl_GetRegExpSetFromObj(interp, objv[0], cflags);
+	if (regExprSet == NULL) {
+	    return TCL_ERROR;
+	}
+	resultPtr = Tcl_NewObj();
+	if (Tcl_RegExpSetExecObj(interp, regExprSet, objPtr, offset, eflags,
+		resultPtr) < 0) {
+	    Tcl_DecrRefCount(resultPtr);
+	    return TCL_ERROR;
+	}
+	Tcl_SetObjResult(interp, resultPtr);
+	return TCL_OK;
+    }
+
     regExpr = Tcl_GetRegExpFromObj(interp, objv[0], cflags);
     if (regExpr == NULL) {
 	return TCL_ERROR;
@@ -1501,6 +1545,39 @@ StringInsertCmd(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringInternCmd --
+ *
+ *	This procedure is invoked to process the "string intern" Tcl command.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+StringInternCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "string");
+	return TCL_ERROR;
+    }
+
+    Tcl_SetObjResult(interp, Tcl_InternObj(objv[1]));
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1937,6 +2014,390 @@ UniCharIsHexDigit(
     return (character >= 0) && (character < 0x80) && isxdigit(UCHAR(character));
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * The "stringmap" internal representation --
+ *
+ *	Mapping lists of [string map] with more than one pair are compiled
+ *	into a keyword trie over their keys, so that the input is scanned
+ *	once with all keys looked up together at each position, instead of
+ *	trying each key in turn. The trie is kept as the internal rep of the
+ *	mapping value, so that maps used repeatedly are compiled only once.
+ *
+ *	At each position the trie is walked as far as the input allows,
+ *	remembering the lowest pair index among the keys passed; this keeps
+ *	the documented rule that the first key in the list that matches
+ *	wins. Each node records the lowest pair index found below it, so the
+ *	walk stops as soon as no better key can be found. Sets of keys that
+ *	are single chars below 256 use a plain lookup table instead.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    int match;			/* Index of the first pair whose key ends at
+				 * this node, or -1. */
+    int minMatch;		/* Lowest pair index of all keys ending at
+				 * this node or below, or INT_MAX. */
+    Tcl_Size firstEdge;		/* Index in the edges array of the first
+				 * edge leaving this node. */
+    Tcl_Size numEdges;		/* Number of edges leaving this node, sorted
+				 * by char. */
+} StringMapNode;
+
+typedef struct {
+    Tcl_UniChar ch;		/* Char labelling the edge. */
+    int node;			/* Node the edge leads to. */
+} StringMapEdge;
+
+typedef struct {
+    size_t refCount;		/* Number of values sharing this map. */
+    int nocase;			/* Whether the map was built for -nocase. Keys
+				 * are stored in lower case then. */
+    int singleChar;		/* Whether all (non-empty) keys are single
+				 * chars below 256. */
+    Tcl_Size numPairs;		/* Number of key/value pairs. */
+    Tcl_Obj **values;		/* The replacement values, one per pair. */
+    int byteMap[256];		/* When singleChar, the index of the pair
+				 * each char maps to, else the node reached
+				 * from the root by each char. -1 if none. */
+    StringMapNode *nodes;	/* The trie. Node 0 is the root. */
+    StringMapEdge *edges;	/* All edges, grouped by source node. */
+} StringMap;
+
+static void		DupStringMapInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FreeStringMapInternalRep(Tcl_Obj *objPtr);
+
+static const Tcl_ObjType stringMapType = {
+    "stringmap",		/* name */
+    FreeStringMapInternalRep,	/* freeIntRepProc */
+    DupStringMapInternalRep,	/* dupIntRepProc */
+    NULL,			/* updateStringProc */
+    NULL,			/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+#define StringMapGet(objPtr) \
+    ((StringMap *) (objPtr)->internalRep.twoPtrValue.ptr1)
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewStringMap --
+ *
+ *	Compile the key/value list of [string map] into a StringMap.
+ *
+ * Results:
+ *	The new map, with a zero reference count.
+ *
+ * Side effects:
+ *	Converts the keys to the Unicode string type.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static StringMap *
+NewStringMap(
+    Tcl_Size mapElemc,		/* Number of keys and values; even. */
+    Tcl_Obj *const mapElemv[],	/* Keys and values. */
+    int nocase)			/* Whether keys match case-insensitively. */
+{
+    StringMap *mapPtr = (StringMap *)Tcl_Alloc(sizeof(StringMap));
+    Tcl_Size numNodes = 1, maxNodes = 32, pair, i, numEdges = 0;
+    int *children, *siblings, child;
+    Tcl_UniChar *chars;
+
+    mapPtr->refCount = 0;
+    mapPtr->nocase = nocase;
+    mapPtr->singleChar = 1;
+    mapPtr->numPairs = mapElemc / 2;
+    mapPtr->values = (Tcl_Obj **)Tcl_Alloc(mapPtr->numPairs * sizeof(Tcl_Obj *));
+    for (i = 0; i < 256; i++) {
+	mapPtr->byteMap[i] = -1;
+    }
+
+    /*
+     * Build the trie with first-child/next-sibling lists, siblings kept
+     * sorted by char, then lay the edges out in a flat array.
+     */
+
+    mapPtr->nodes = (StringMapNode *)Tcl_Alloc(maxNodes * sizeof(StringMapNode));
+    children = (int *)Tcl_Alloc(maxNodes * sizeof(int));
+    siblings = (int *)Tcl_Alloc(maxNodes * sizeof(int));
+    chars = (Tcl_UniChar *)Tcl_Alloc(maxNodes * sizeof(Tcl_UniChar));
+    mapPtr->nodes[0].match = -1;
+    children[0] = siblings[0] = -1;
+
+    for (pair = 0; pair < mapPtr->numPairs; pair++) {
+	Tcl_Size keyLen;
+	Tcl_UniChar *key = Tcl_GetUnicodeFromObj(mapElemv[2 * pair], &keyLen);
+	int node = 0;
+
+	mapPtr->values[pair] = mapElemv[2 * pair + 1];
+	Tcl_IncrRefCount(mapPtr->values[pair]);
+	if (keyLen == 0) {
+	    continue;
+	}
+	if (keyLen > 1 || (nocase ? Tcl_UniCharToLower(*key) : *key) > 255) {
+	    mapPtr->singleChar = 0;
+	}
+	for (i = 0; i < keyLen; i++) {
+	    Tcl_UniChar ch = nocase ? Tcl_UniCharToLower(key[i]) : key[i];
+	    int prev = -1;
+
+	    child = children[node];
+	    while (child >= 0 && chars[child] < ch) {
+		prev = child;
+		child = siblings[child];
+	    }
+	    if (child < 0 || chars[child] != ch) {
+		if (numNodes == maxNodes) {
+		    maxNodes *= 2;
+		    mapPtr->nodes = (StringMapNode *)Tcl_Realloc(mapPtr->nodes,
+			    maxNodes * sizeof(StringMapNode));
+		    children = (int *)Tcl_Realloc(children,
+			    maxNodes * sizeof(int));
+		    siblings = (int *)Tcl_Realloc(siblings,
+			    maxNodes * sizeof(int));
+		    chars = (Tcl_UniChar *)Tcl_Realloc(chars,
+			    maxNodes * sizeof(Tcl_UniChar));
+		}
+		mapPtr->nodes[numNodes].match = -1;
+		chars[numNodes] = ch;
+		children[numNodes] = -1;
+		siblings[numNodes] = child;
+		if (prev < 0) {
+		    children[node] = numNodes;
+		} else {
+		    siblings[prev] = numNodes;
+		}
+		child = numNodes++;
+	    }
+	    node = child;
+	}
+	if (mapPtr->nodes[node].match < 0) {
+	    mapPtr->nodes[node].match = pair;
+	}
+    }
+
+    mapPtr->edges = (StringMapEdge *)Tcl_Alloc(
+	    (numNodes > 1 ? numNodes - 1 : 1) * sizeof(StringMapEdge));
+    for (i = 0; i < numNodes; i++) {
+	mapPtr->nodes[i].firstEdge = numEdges;
+	for (child = children[i]; child >= 0; child = siblings[child]) {
+	    mapPtr->edges[numEdges].ch = chars[child];
+	    mapPtr->edges[numEdges].node = child;
+	    numEdges++;
+	}
+	mapPtr->nodes[i].numEdges = numEdges - mapPtr->nodes[i].firstEdge;
+    }
+
+    /*
+     * Children are always created after their parent, so a backwards sweep
+     * sees every node after all its children.
+     */
+
+    for (i = numNodes - 1; i >= 0; i--) {
+	StringMapNode *nodePtr = &mapPtr->nodes[i];
+	Tcl_Size e;
+
+	nodePtr->minMatch = (nodePtr->match >= 0) ? nodePtr->match : INT_MAX;
+	for (e = 0; e < nodePtr->numEdges; e++) {
+	    int m = mapPtr->nodes[mapPtr->edges[nodePtr->firstEdge + e].node]
+		    .minMatch;
+
+	    if (m < nodePtr->minMatch) {
+		nodePtr->minMatch = m;
+	    }
+	}
+    }
+
+    for (child = children[0]; child >= 0; child = siblings[child]) {
+	if (chars[child] < 256) {
+	    mapPtr->byteMap[chars[child]] = mapPtr->singleChar
+		    ? mapPtr->nodes[child].match : child;
+	}
+    }
+
+    Tcl_Free(children);
+    Tcl_Free(siblings);
+    Tcl_Free(chars);
+    return mapPtr;
+}
+
+static void
+StringMapRelease(
+    StringMap *mapPtr)
+{
+    Tcl_Size i;
+
+    if (mapPtr->refCount-- > 1) {
+	return;
+    }
+    for (i = 0; i < mapPtr->numPairs; i++) {
+	Tcl_DecrRefCount(mapPtr->values[i]);
+    }
+    Tcl_Free(mapPtr->values);
+    Tcl_Free(mapPtr->nodes);
+    Tcl_Free(mapPtr->edges);
+    Tcl_Free(mapPtr);
+}
+
+static void
+FreeStringMapInternalRep(
+    Tcl_Obj *objPtr)
+{
+    StringMapRelease(StringMapGet(objPtr));
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupStringMapInternalRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *copyPtr)
+{
+    StringMap *mapPtr = StringMapGet(srcPtr);
+
+    mapPtr->refCount++;
+    copyPtr->internalRep.twoPtrValue.ptr1 = mapPtr;
+    copyPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    copyPtr->typePtr = &stringMapType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringMapStep --
+ *
+ *	Follow the edge labelled ch out of a trie node.
+ *
+ * Results:
+ *	The node reached, or -1 if there is no such edge.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline int
+StringMapStep(
+    const StringMap *mapPtr,
+    int node,
+    Tcl_UniChar ch)
+{
+    const StringMapEdge *edges;
+    Tcl_Size lo, hi;
+
+    if (node == 0 && ch < 256) {
+	return mapPtr->byteMap[ch];
+    }
+    edges = mapPtr->edges + mapPtr->nodes[node].firstEdge;
+    lo = 0;
+    hi = mapPtr->nodes[node].numEdges;
+    while (lo < hi) {
+	Tcl_Size mid = (lo + hi) / 2;
+
+	if (edges[mid].ch < ch) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    if (lo < mapPtr->nodes[node].numEdges && edges[lo].ch == ch) {
+	return edges[lo].node;
+    }
+    return -1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StringMapApply --
+ *
+ *	Perform the substitutions of a compiled [string map] on a Unicode
+ *	string in a single pass.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Appends the mapped string to resultPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StringMapApply(
+    const StringMap *mapPtr,
+    const Tcl_UniChar *ustring,	/* String to map. */
+    Tcl_Size length,		/* Its length in chars. */
+    Tcl_Obj *resultPtr)		/* Unshared Unicode value to append to. */
+{
+    const Tcl_UniChar *end = ustring + length, *p = ustring, *s = ustring;
+    int nocase = mapPtr->nocase;
+
+    while (s < end) {
+	int best = -1;
+	Tcl_Size bestLen = 0;
+	Tcl_UniChar ch = nocase ? Tcl_UniCharToLower(*s) : *s;
+
+	if (mapPtr->singleChar) {
+	    if (ch < 256 && (best = mapPtr->byteMap[ch]) >= 0) {
+		bestLen = 1;
+	    }
+	} else {
+	    const Tcl_UniChar *t = s;
+	    int node = StringMapStep(mapPtr, 0, ch);
+
+	    while (node >= 0) {
+		const StringMapNode *nodePtr = &mapPtr->nodes[node];
+
+		if (best >= 0 && best < nodePtr->minMatch) {
+		    break;
+		}
+		t++;
+		if (nodePtr->match >= 0 && (best < 0 || nodePtr->match < best)) {
+		    best = nodePtr->match;
+		    bestLen = t - s;
+		}
+		if (t == end) {
+		    break;
+		}
+		ch = nocase ? Tcl_UniCharToLower(*t) : *t;
+		node = StringMapStep(mapPtr, node, ch);
+	    }
+	}
+
+	if (best < 0) {
+	    s++;
+	    continue;
+	}
+	if (p != s) {
+	    /*
+	     * Put the skipped chars onto the result first.
+	     */
+
+	    Tcl_AppendUnicodeToObj(resultPtr, p, s - p);
+	}
+	if (TclCheckEmptyString(mapPtr->values[best]) != TCL_EMPTYSTRING_YES) {
+	    Tcl_Size mapLen;
+	    Tcl_UniChar *mapString =
+		    Tcl_GetUnicodeFromObj(mapPtr->values[best], &mapLen);
+
+	    Tcl_AppendUnicodeToObj(resultPtr, mapString, mapLen);
+	}
+	s += bestLen;
+	p = s;
+    }
+    if (p != end) {
+	/*
+	 * Put the rest of the unmapped chars onto result.
+	 */
+
+	Tcl_AppendUnicodeToObj(resultPtr, p, end - p);
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1962,9 +2423,10 @@ StringMapCmd(
     int objc,			/* Number of arguments. */
     Tcl_Obj *const objv[])	/* Argument objects. */
 {
-    Tcl_Size length1, length2,  mapElemc, index;
+    Tcl_Size length1, length2,  mapElemc = 0, index;
     int nocase = 0, mapWithDict = 0, copySource = 0;
-    Tcl_Obj **mapElemv, *sourceObj, *resultPtr;
+    Tcl_Obj **mapElemv = NULL, *sourceObj, *resultPtr;
+    StringMap *mapPtr = NULL;
     Tcl_UniChar *ustring1, *ustring2, *p, *end;
     int (*strCmpFn)(const Tcl_UniChar*, const Tcl_UniChar*, size_t);
 
@@ -1993,7 +2455,15 @@ StringMapCmd(
      * inconsistencies (see test string-10.20.1 for illustration why!)
      */
 
-    if (!TclHasStringRep(objv[objc-2])
+    if (TclHasInternalRep(objv[objc-2], &stringMapType)
+	    && StringMapGet(objv[objc-2])->nocase == nocase) {
+	/*
+	 * The map was compiled by an earlier call.
+	 */
+
+	mapPtr = StringMapGet(objv[objc-2]);
+	mapPtr->refCount++;
+    } else if (!TclHasStringRep(objv[objc-2])
 	    && TclHasInternalRep(objv[objc-2], &tclDictType)) {
 	Tcl_Size i;
 	int done;
@@ -2056,6 +2526,23 @@ StringMapCmd(
 	}
     }
 
+    /*
+     * Compile maps with more than one pair. Keep the result with the map
+     * value when it can be regenerated from its string rep.
+     */
+
+    if (mapPtr == NULL && mapElemc > 2) {
+	mapPtr = NewStringMap(mapElemc, mapElemv, nocase);
+	mapPtr->refCount++;
+	if (!mapWithDict && TclHasStringRep(objv[objc-2])) {
+	    TclFreeInternalRep(objv[objc-2]);
+	    mapPtr->refCount++;
+	    objv[objc-2]->internalRep.twoPtrValue.ptr1 = mapPtr;
+	    objv[objc-2]->internalRep.twoPtrValue.ptr2 = NULL;
+	    objv[objc-2]->typePtr = &stringMapType;
+	}
+    }
+
     /*
      * Take a copy of the source string object if it is the same as the map
      * string to cut out nasty sharing crashes. [Bug 1018562]
@@ -2085,12 +2572,10 @@ StringMapCmd(
 
     resultPtr = Tcl_NewUnicodeObj(ustring1, 0);
 
-    if (mapElemc == 2) {
+    if (mapPtr == NULL) {
 	/*
-	 * Special case for one map pair which avoids the extra for loop and
-	 * extra calls to get Unicode data. The algorithm is otherwise
-	 * identical to the multi-pair case. This will be >30% faster on
-	 * larger strings.
+	 * Special case for one map pair which avoids building a trie for the
+	 * keys. The algorithm is otherwise identical to the multi-pair case.
 	 */
 
 	Tcl_Size mapLen;
@@ -2126,74 +2611,9 @@ StringMapCmd(
 	    }
 	}
     } else {
-	Tcl_UniChar **mapStrings;
-	Tcl_Size *mapLens;
-	int *u2lc = 0;
-
-	/*
-	 * Precompute pointers to the Unicode string and length. This saves us
-	 * repeated function calls later, significantly speeding up the
-	 * algorithm. We only need the lowercase first char in the nocase
-	 * case.
-	 */
-
-	mapStrings = (Tcl_UniChar **)TclStackAlloc(interp, mapElemc*sizeof(Tcl_UniChar *)*2);
-	mapLens = (Tcl_Size *)TclStackAlloc(interp, mapElemc * sizeof(Tcl_Size) * 2);
-	if (nocase) {
-	    u2lc = (int *)TclStackAlloc(interp, mapElemc * sizeof(int));
-	}
-	for (index = 0; index < mapElemc; index++) {
-	    mapStrings[index] = Tcl_GetUnicodeFromObj(mapElemv[index],
-		    mapLens+index);
-	    if (nocase && ((index % 2) == 0)) {
-		u2lc[index/2] = Tcl_UniCharToLower(*mapStrings[index]);
-	    }
-	}
-	for (p = ustring1; ustring1 < end; ustring1++) {
-	    for (index = 0; index < mapElemc; index += 2) {
-		/*
-		 * Get the key string to match on.
-		 */
-
-		ustring2 = mapStrings[index];
-		length2 = mapLens[index];
-		if ((length2 > 0) && ((*ustring1 == *ustring2) || (nocase &&
-			(Tcl_UniCharToLower(*ustring1) == u2lc[index/2]))) &&
-			/* Restrict max compare length. */
-			((end-ustring1) >= length2) && ((length2 == 1) ||
-			!strCmpFn(ustring2, ustring1, length2))) {
-		    if (p != ustring1) {
-			/*
-			 * Put the skipped chars onto the result first.
-			 */
-
-			Tcl_AppendUnicodeToObj(resultPtr, p, ustring1-p);
-			p = ustring1 + length2;
-		    } else {
-			p += length2;
-		    }
-
-		    /*
-		     * Adjust len to be full length of matched string.
-		     */
-
-		    ustring1 = p - 1;
-
-		    /*
-		     * Append the map value to the Unicode string.
-		     */
-
-		    Tcl_AppendUnicodeToObj(resultPtr,
-			    mapStrings[index+1], mapLens[index+1]);
-		    break;
-		}
-	    }
-	}
-	if (nocase) {
-	    TclStackFree(interp, u2lc);
-	}
-	TclStackFree(interp, mapLens);
-	TclStackFree(interp, mapStrings);
+	StringMapApply(mapPtr, ustring1, length1, resultPtr);
+	Tcl_SetObjResult(interp, resultPtr);
+	goto done;
     }
     if (p != ustring1) {
 	/*
@@ -2204,6 +2624,9 @@ StringMapCmd(
     }
     Tcl_SetObjResult(interp, resultPtr);
   done:
+    if (mapPtr != NULL) {
+	StringMapRelease(mapPtr);
+    }
     if (mapWithDict) {
 	TclStackFree(interp, mapElemv);
     }
@@ -3296,6 +3719,7 @@ TclInitStringCmd(
 	{"first",	StringFirstCmd,	TclCompileStringFirstCmd, NULL, NULL, 0},
 	{"index",	StringIndexCmd,	TclCompileStringIndexCmd, NULL, NULL, 0},
 	{"insert",	StringInsertCmd, TclCompileStringInsertCmd, NULL, NULL, 0},
+	{"intern",	StringInternCmd, TclCompileBasic1ArgCmd, NULL, NULL, 0},
 	{"is",		StringIsCmd,	TclCompileStringIsCmd, NULL, NULL, 0},
 	{"last",	StringLastCmd,	TclCompileStringLastCmd, NULL, NULL, 0},
 	{"length",	StringLenCmd,	TclCompileStringLenCmd, NULL, NULL, 0},
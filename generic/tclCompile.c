@@ -1345,6 +1345,44 @@ TclReleaseByteCode(
     CleanupByteCode(codePtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclMoveByteCodeSource --
+ *
+ *	Called when the string rep of a bytecode or exprcode object is about
+ *	to be copied to newBytes, see TclPromoteArenaValues. The ByteCode
+ *	points into the string rep for its source.
+ *
+ * Results:
+ *	1 if the ByteCode now points into newBytes, 0 if its code is being
+ *	executed and the string rep has to stay where it is.
+ *
+ * Side effects:
+ *	Updates the source pointer of the ByteCode.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclMoveByteCodeSource(
+    Tcl_Obj *objPtr,
+    const char *newBytes)
+{
+    ByteCode *codePtr;
+
+    ByteCodeGetInternalRep(objPtr, (objPtr->typePtr == &tclExprCodeType
+	    ? &tclExprCodeType : &tclByteCodeType), codePtr);
+    if (codePtr == NULL || codePtr->refCount > 1) {
+	return 0;
+    }
+    if (codePtr->source >= objPtr->bytes
+	    && codePtr->source <= objPtr->bytes + objPtr->length) {
+	codePtr->source = newBytes + (codePtr->source - objPtr->bytes);
+    }
+    return 1;
+}
+
 static void
 CleanupByteCode(
     ByteCode *codePtr)		/* Points to the ByteCode to free. */
@@ -286,6 +286,7 @@ enum ClockFmtScnCmdArgsFlags {
     CLF_VALIDATE_S2 = (1 << 1),
     CLF_VALIDATE = (CLF_VALIDATE_S1|CLF_VALIDATE_S2),
     CLF_EXTENDED = (1 << 4),
+    CLF_LIST = (1 << 5),
     CLF_STRICT = (1 << 8),
     CLF_LOCALE_USED = (1 << 15)
 };
@@ -563,4 +564,12 @@ MODULE_SCOPE int	ClockFormat(DateFormat *dateFmt,
 MODULE_SCOPE void	ClockFrmScnClearCaches(void);
 MODULE_SCOPE void	ClockFrmScnFinalize();
 
+/* tclClockTz.c module declarations */
+
+MODULE_SCOPE const Tcl_ObjType ClockTzZoneType;
+MODULE_SCOPE Tcl_ObjCmdProc ClockReadTZDatabaseObjCmd;
+MODULE_SCOPE Tcl_Obj *	ClockTzZoneLookup(Tcl_Obj *tzdata, Tcl_WideInt tick,
+			    int *tzOffsetPtr, Tcl_WideInt *rangesVal);
+MODULE_SCOPE void	ClockTzDbFinalize(void);
+
 #endif /* _TCLCLOCK_H */
@@ -1875,6 +1875,19 @@ EXTERN int		Tcl_IsEmpty(Tcl_Obj *obj);
 /* 691 */
 EXTERN const char *	Tcl_GetEncodingNameForUser(Tcl_DString *bufPtr);
 /* 692 */
+EXTERN Tcl_Obj *	Tcl_InternObj(Tcl_Obj *objPtr);
+/* 693 */
+EXTERN Tcl_Obj *	Tcl_InternString(const char *bytes, Tcl_Size length);
+/* 694 */
+EXTERN Tcl_Obj *	Tcl_FreezeObj(Tcl_Obj *objPtr);
+/* 695 */
+EXTERN Tcl_RegExpSet	Tcl_GetRegExpSetFromObj(Tcl_Interp *interp,
+				Tcl_Obj *patternsObj, int flags);
+/* 696 */
+EXTERN Tcl_Size		Tcl_RegExpSetExecObj(Tcl_Interp *interp,
+				Tcl_RegExpSet set, Tcl_Obj *textObj,
+				Tcl_Size offset, int flags, Tcl_Obj *listObj);
+/* 697 */
 EXTERN void		TclUnusedStubEntry(void);
 
 typedef struct {
@@ -2579,7 +2592,12 @@ typedef struct TclStubs {
     void (*tcl_SetWideUIntObj) (Tcl_Obj *objPtr, Tcl_WideUInt uwideValue); /* 689 */
     int (*tcl_IsEmpty) (Tcl_Obj *obj); /* 690 */
     const char * (*tcl_GetEncodingNameForUser) (Tcl_DString *bufPtr); /* 691 */
-    void (*tclUnusedStubEntry) (void); /* 692 */
+    Tcl_Obj * (*tcl_InternObj) (Tcl_Obj *objPtr); /* 692 */
+    Tcl_Obj * (*tcl_InternString) (const char *bytes, Tcl_Size length); /* 693 */
+    Tcl_Obj * (*tcl_FreezeObj) (Tcl_Obj *objPtr); /* 694 */
+    Tcl_RegExpSet (*tcl_GetRegExpSetFromObj) (Tcl_Interp *interp, Tcl_Obj *patternsObj, int flags); /* 695 */
+    Tcl_Size (*tcl_RegExpSetExecObj) (Tcl_Interp *interp, Tcl_RegExpSet set, Tcl_Obj *textObj, Tcl_Size offset, int flags, Tcl_Obj *listObj); /* 696 */
+    void (*tclUnusedStubEntry) (void); /* 697 */
 } TclStubs;
 
 extern const TclStubs *tclStubsPtr;
@@ -3913,8 +3931,18 @@ extern const TclStubs *tclStubsPtr;
 	(tclStubsPtr->tcl_IsEmpty) /* 690 */
 #define Tcl_GetEncodingNameForUser \
 	(tclStubsPtr->tcl_GetEncodingNameForUser) /* 691 */
+#define Tcl_InternObj \
+	(tclStubsPtr->tcl_InternObj) /* 692 */
+#define Tcl_InternString \
+	(tclStubsPtr->tcl_InternString) /* 693 */
+#define Tcl_FreezeObj \
+	(tclStubsPtr->tcl_FreezeObj) /* 694 */
+#define Tcl_GetRegExpSetFromObj \
+	(tclStubsPtr->tcl_GetRegExpSetFromObj) /* 695 */
+#define Tcl_RegExpSetExecObj \
+	(tclStubsPtr->tcl_RegExpSetExecObj) /* 696 */
 #define TclUnusedStubEntry \
-	(tclStubsPtr->tclUnusedStubEntry) /* 692 */
+	(tclStubsPtr->tclUnusedStubEntry) /* 697 */
 
 #endif /* defined(USE_TCL_STUBS) */
 
@@ -223,13 +223,22 @@ typedef struct {
 
 static Tcl_HashEntry *
 AllocChainEntry(
-    TCL_UNUSED(Tcl_HashTable *),
+    Tcl_HashTable *tablePtr,
     void *keyPtr)
 {
     Tcl_Obj *objPtr = (Tcl_Obj *)keyPtr;
     ChainEntry *cPtr;
 
-    cPtr = (ChainEntry *)Tcl_Alloc(sizeof(ChainEntry));
+    /*
+     * The table is the start of its Dict. The entries of a Dict taken from
+     * an arena come from the arena too, and are copied out with it.
+     */
+
+    if (TclIsArenaBlock(tablePtr)) {
+	cPtr = (ChainEntry *)TclArenaAlloc(NULL, sizeof(ChainEntry));
+    } else {
+	cPtr = (ChainEntry *)Tcl_Alloc(sizeof(ChainEntry));
+    }
     cPtr->entry.key.objPtr = objPtr;
     Tcl_IncrRefCount(objPtr);
     Tcl_SetHashValue(&cPtr->entry, NULL);
@@ -360,7 +369,7 @@ DupDictInternalRep(
     Tcl_Obj *srcPtr,
     Tcl_Obj *copyPtr)
 {
-    Dict *oldDict, *newDict = (Dict *)Tcl_Alloc(sizeof(Dict));
+    Dict *oldDict, *newDict = (Dict *)TclArenaAlloc(copyPtr, sizeof(Dict));
     ChainEntry *cPtr;
 
     DictGetInternalRep(srcPtr, oldDict);
@@ -430,6 +439,42 @@ FreeDictInternalRep(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclPromoteArenaDict --
+ *
+ *	Copies the dictionary rep of a value out of an arena being closed, see
+ *	TclPromoteArenaValues.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The value gets a copy of its dictionary rep, unless the rep is shared
+ *	or being iterated over, and the original is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclPromoteArenaDict(
+    Tcl_Obj *dictPtr)
+{
+    Dict *dict;
+    Tcl_Obj copy;
+
+    DictGetInternalRep(dictPtr, dict);
+    if (dict == NULL || dict->refCount > 1 || dict->chain != NULL
+	    || !TclArenaOwns(dict)) {
+	return;
+    }
+    copy.typePtr = NULL;
+    DupDictInternalRep(dictPtr, &copy);
+    DeleteDict(dict);
+    dictPtr->internalRep = copy.internalRep;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -595,21 +640,23 @@ SetDictFromAny(
 {
     Tcl_HashEntry *hPtr;
     int isNew;
-    Dict *dict = (Dict *)Tcl_Alloc(sizeof(Dict));
+    Dict *dict = (Dict *)TclArenaAlloc(objPtr, sizeof(Dict));
 
     InitChainTable(dict);
 
     /*
      * Since lists and dictionaries have very closely-related string
      * representations (i.e. the same parsing code) we can safely special-case
-     * the conversion from lists to dictionaries.
+     * the conversion from lists to dictionaries. The same goes for abstract
+     * lists, such as frozen values, which are converted to lists first.
      */
 
-    if (TclHasInternalRep(objPtr, &tclListType)) {
+    if (TclHasInternalRep(objPtr, &tclListType)
+	    || TclObjTypeHasProc(objPtr, indexProc)) {
 	Tcl_Size objc, i;
 	Tcl_Obj **objv;
 
-	/* Cannot fail, we already know the Tcl_ObjType is "list". */
+	/* Cannot fail, we already know the value is a list. */
 	TclListObjGetElements(NULL, objPtr, &objc, &objv);
 	if (objc & 1) {
 	    goto missingValue;
@@ -1424,7 +1471,7 @@ Tcl_NewDictObj(void)
 
     TclNewObj(dictPtr);
     TclInvalidateStringRep(dictPtr);
-    dict = (Dict *)Tcl_Alloc(sizeof(Dict));
+    dict = (Dict *)TclArenaAlloc(dictPtr, sizeof(Dict));
     InitChainTable(dict);
     dict->epoch = 1;
     dict->chain = NULL;
@@ -1140,6 +1140,8 @@ Tcl_InitSubsystems(void)
 
 	TclpInitLock();
 	if (subsystemsInitialized == 0) {
+	    TclInitHashSeed();		/* Key of the string hash, needed
+					 * before any table is made. */
 
 		/*
 	     * Initialize locks used by the memory allocators before anything
@@ -1149,6 +1151,8 @@ Tcl_InitSubsystems(void)
 
 	    TclInitThreadStorage();     /* Creates hash table for
 					 * thread local storage */
+	    TclInitAtomics();		/* Mutex for TclAtomic* if the
+					 * compiler has no builtins. */
 #if defined(USE_TCLALLOC) && USE_TCLALLOC
 	    TclInitAlloc();		/* Process wide mutex init */
 #endif
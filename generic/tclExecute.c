@@ -5394,7 +5394,18 @@ TEBCresume(
 		 * An empty list doesn't match anything.
 		 */
 
-		do {
+		if (!isAbstractList
+			&& TclListObjFindString(value2Ptr, valuePtr, 0, &i)) {
+		    /*
+		     * The list has a hash index of its elements.
+		     */
+
+		    match = (i >= 0);
+		    i = length;
+		} else {
+		    i = 0;
+		}
+		while (i < length && match == 0) {
 		    Tcl_Obj *o;
 		    if (isAbstractList) {
 			DECACHE_STACK_INFO();
@@ -5421,7 +5432,7 @@ TEBCresume(
 		    Tcl_BounceRefCount(o);
 
 		    i++;
-		} while (i < length && match == 0);
+		}
 	    }
 	}
 
@@ -0,0 +1,592 @@
+/*
+ * tclFrozenObj.c --
+ *
+ *	This file implements frozen values: deep-immutable copies of lists,
+ *	dictionaries and strings that interpreters in different threads can
+ *	share without serializing them.
+ *
+ * Copyright © 2026 The Tcl Core Team.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+
+/*
+ * The reference count of a Tcl_Obj is not atomic, so no Tcl_Obj may ever be
+ * seen by two threads at once. A frozen value therefore keeps its data
+ * outside of any Tcl_Obj, in a graph of FrozenNodes that nothing modifies
+ * once it is built. The graph is owned by a FrozenRoot whose reference count
+ * is changed atomically. Threads see the graph only through handles: Tcl_Objs
+ * of one of the types below, each belonging to a single thread, whose
+ * internal representation holds a reference to the root and points at a
+ * node in its graph.
+ *
+ * A handle on a list (or dictionary) is an abstract list, so element access
+ * and [llength] read the graph directly. An element that is itself a list
+ * comes back as another handle; one that is a string comes back as a new
+ * string value. Anything that modifies a handle's value first converts it
+ * to an ordinary list or dictionary of the same elements, which belongs to
+ * the thread alone; the graph itself is never modified. The string
+ * representation of a list node is generated at most once and then shared by
+ * all threads.
+ */
+
+typedef struct FrozenString {
+    Tcl_Size length;		/* Number of bytes, not counting the
+				 * terminating NUL. */
+    char bytes[TCLFLEXARRAY];	/* The string, NUL-terminated. */
+} FrozenString;
+
+typedef struct FrozenNode {
+    FrozenString *stringPtr;	/* String representation. Always set for a
+				 * string; for a list, NULL until it is first
+				 * needed, then set once and never changed.
+				 * Access with TclAtomicLoadPtr. */
+    Tcl_Size numElements;	/* Number of elements of a list, or
+				 * TCL_INDEX_NONE for a string. */
+    struct FrozenNode *elements[TCLFLEXARRAY];
+				/* The elements of a list. The string of a
+				 * string node follows the fields above. */
+} FrozenNode;
+
+typedef struct FrozenRoot {
+    size_t refCount;		/* Number of handles on the graph, across all
+				 * threads. Changed atomically. */
+    FrozenNode *nodePtr;	/* Top of the graph. */
+} FrozenRoot;
+
+#define NODE_IS_LIST(nodePtr)	((nodePtr)->numElements != TCL_INDEX_NONE)
+#define STRING_SIZE(length) \
+    (offsetof(FrozenString, bytes) + (length) + 1)
+
+/*
+ * Handles keep the root in ptr1 and their node in ptr2.
+ */
+
+#define HANDLE_ROOT(objPtr) \
+    ((FrozenRoot *) (objPtr)->internalRep.twoPtrValue.ptr1)
+#define HANDLE_NODE(objPtr) \
+    ((FrozenNode *) (objPtr)->internalRep.twoPtrValue.ptr2)
+
+/*
+ * Prototypes for functions defined later in this file:
+ */
+
+static FrozenNode *	CopyNode(FrozenNode *nodePtr);
+static void		DupFrozenInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr);
+static FrozenNode *	FreezeNode(Tcl_Obj *objPtr);
+static void		FreeFrozenInternalRep(Tcl_Obj *objPtr);
+static void		FreeNode(FrozenNode *nodePtr);
+static Tcl_Size		FrozenListLength(Tcl_Obj *objPtr);
+static int		FrozenListIndex(Tcl_Interp *interp, Tcl_Obj *objPtr,
+			    Tcl_Size index, Tcl_Obj **elemPtrPtr);
+static FrozenString *	GetNodeString(FrozenNode *nodePtr);
+static Tcl_Obj *	NewHandle(FrozenRoot *rootPtr, FrozenNode *nodePtr);
+static FrozenNode *	NewListNode(Tcl_Size numElements);
+static FrozenNode *	NewStringNode(const char *bytes, Tcl_Size length);
+static void		UpdateStringOfFrozen(Tcl_Obj *objPtr);
+
+/*
+ * The types of handles on strings and on lists. Neither can be converted to
+ * from another type; handles are only made by Tcl_FreezeObj and by copying
+ * other handles.
+ */
+
+static const Tcl_ObjType frozenStringType = {
+    "frozenstring",			/* name */
+    FreeFrozenInternalRep,		/* freeIntRepProc */
+    DupFrozenInternalRep,		/* dupIntRepProc */
+    UpdateStringOfFrozen,		/* updateStringProc */
+    NULL,				/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+static const Tcl_ObjType frozenListType = {
+    "frozenlist",			/* name */
+    FreeFrozenInternalRep,		/* freeIntRepProc */
+    DupFrozenInternalRep,		/* dupIntRepProc */
+    UpdateStringOfFrozen,		/* updateStringProc */
+    NULL,				/* setFromAnyProc */
+    TCL_OBJTYPE_V2(FrozenListLength,	/* lengthProc */
+		   FrozenListIndex,	/* indexProc */
+		   NULL,		/* sliceProc */
+		   NULL,		/* reverseProc */
+		   NULL,		/* getElementsProc */
+		   NULL,		/* setElementProc */
+		   NULL,		/* replaceProc */
+		   NULL)		/* inOperProc */
+};
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_FreezeObj --
+ *
+ *	Makes a frozen copy of a value, which interpreters in other threads
+ *	can use without the value being copied again.
+ *
+ * Results:
+ *	A new object with a reference count of zero that refers to the frozen
+ *	copy. If objPtr already refers to a frozen value, the new object
+ *	refers to the same one.
+ *
+ * Side effects:
+ *	Copies the value. A dictionary with a string representation, which
+ *	might name a key more than once, is converted to a list to find its
+ *	elements.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+Tcl_FreezeObj(
+    Tcl_Obj *objPtr)		/* The value to freeze. */
+{
+    FrozenRoot *rootPtr;
+
+    if (TclHasInternalRep(objPtr, &frozenListType)
+	    || TclHasInternalRep(objPtr, &frozenStringType)) {
+	return NewHandle(HANDLE_ROOT(objPtr), HANDLE_NODE(objPtr));
+    }
+
+    rootPtr = (FrozenRoot *)Tcl_Alloc(sizeof(FrozenRoot));
+    rootPtr->refCount = 0;
+    rootPtr->nodePtr = FreezeNode(objPtr);
+    return NewHandle(rootPtr, rootPtr->nodePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreezeNode --
+ *
+ *	Builds the frozen copy of a value and, recursively, of its elements.
+ *	Values that have a list, dictionary or abstract list representation
+ *	become list nodes, unless they have a string representation that is
+ *	not the canonical one; all others become strings.
+ *
+ * Results:
+ *	The new node.
+ *
+ * Side effects:
+ *	Allocates memory. See Tcl_FreezeObj.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FrozenNode *
+FreezeNode(
+    Tcl_Obj *objPtr)
+{
+    FrozenNode *nodePtr;
+    Tcl_Size i, objc, length;
+    Tcl_Obj **objv, *elemPtr;
+    const char *bytes;
+
+    if (TclHasInternalRep(objPtr, &frozenListType)
+	    || TclHasInternalRep(objPtr, &frozenStringType)) {
+	return CopyNode(HANDLE_NODE(objPtr));
+    }
+
+    if (TclHasInternalRep(objPtr, &tclDictType) && !TclHasStringRep(objPtr)) {
+	Tcl_DictSearch search;
+	Tcl_Obj *keyPtr, *valuePtr;
+	int done;
+
+	Tcl_DictObjSize(NULL, objPtr, &objc);
+	nodePtr = NewListNode(2 * objc);
+	i = 0;
+	Tcl_DictObjFirst(NULL, objPtr, &search, &keyPtr, &valuePtr, &done);
+	while (!done) {
+	    nodePtr->elements[i++] = FreezeNode(keyPtr);
+	    nodePtr->elements[i++] = FreezeNode(valuePtr);
+	    Tcl_DictObjNext(&search, &keyPtr, &valuePtr, &done);
+	}
+	return nodePtr;
+    }
+
+    if (TclHasInternalRep(objPtr, &tclListType)
+	    || TclHasInternalRep(objPtr, &tclDictType)) {
+	TclListObjGetElements(NULL, objPtr, &objc, &objv);
+	nodePtr = NewListNode(objc);
+	for (i = 0; i < objc; i++) {
+	    nodePtr->elements[i] = FreezeNode(objv[i]);
+	}
+    } else if (TclObjTypeHasProc(objPtr, indexProc)) {
+	objc = TclObjTypeLength(objPtr);
+	nodePtr = NewListNode(objc);
+	for (i = 0; i < objc; i++) {
+	    if (TclObjTypeIndex(NULL, objPtr, i, &elemPtr) != TCL_OK
+		    || elemPtr == NULL) {
+		elemPtr = Tcl_NewObj();
+	    }
+	    nodePtr->elements[i] = FreezeNode(elemPtr);
+	    Tcl_BounceRefCount(elemPtr);
+	}
+    } else {
+	bytes = TclGetStringFromObj(objPtr, &length);
+	return NewStringNode(bytes, length);
+    }
+
+    /*
+     * A list is only frozen as one if its string representation, if it has
+     * one, is the canonical one that would be generated from its elements.
+     * Otherwise it is frozen as the string, so that its value doesn't change
+     * when a handle on it is converted to a list.
+     */
+
+    if (TclHasStringRep(objPtr)) {
+	FrozenString *stringPtr = GetNodeString(nodePtr);
+
+	if (stringPtr->length != objPtr->length || memcmp(stringPtr->bytes,
+		objPtr->bytes, objPtr->length) != 0) {
+	    FreeNode(nodePtr);
+	    return NewStringNode(objPtr->bytes, objPtr->length);
+	}
+    }
+    return nodePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CopyNode --
+ *
+ *	Copies a node of another frozen value and, recursively, its elements,
+ *	so that the graph being built owns all of its nodes.
+ *
+ * Results:
+ *	The new node.
+ *
+ * Side effects:
+ *	Allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FrozenNode *
+CopyNode(
+    FrozenNode *nodePtr)
+{
+    FrozenNode *copyPtr;
+    FrozenString *stringPtr = (FrozenString *)
+	    TclAtomicLoadPtr(&nodePtr->stringPtr);
+    Tcl_Size i;
+
+    if (!NODE_IS_LIST(nodePtr)) {
+	return NewStringNode(stringPtr->bytes, stringPtr->length);
+    }
+    copyPtr = NewListNode(nodePtr->numElements);
+    for (i = 0; i < nodePtr->numElements; i++) {
+	copyPtr->elements[i] = CopyNode(nodePtr->elements[i]);
+    }
+    if (stringPtr != NULL) {
+	copyPtr->stringPtr = (FrozenString *)Tcl_Alloc(
+		STRING_SIZE(stringPtr->length));
+	memcpy(copyPtr->stringPtr, stringPtr, STRING_SIZE(stringPtr->length));
+    }
+    return copyPtr;
+}
+
+/*
+ * Allocate a string node, whose string is stored right after it, and a list
+ * node without a string representation and with room for its elements.
+ */
+
+static FrozenNode *
+NewStringNode(
+    const char *bytes,
+    Tcl_Size length)
+{
+    FrozenNode *nodePtr = (FrozenNode *)Tcl_Alloc(
+	    offsetof(FrozenNode, elements) + STRING_SIZE(length));
+
+    nodePtr->stringPtr = (FrozenString *) nodePtr->elements;
+    nodePtr->stringPtr->length = length;
+    memcpy(nodePtr->stringPtr->bytes, bytes, length);
+    nodePtr->stringPtr->bytes[length] = '\0';
+    nodePtr->numElements = TCL_INDEX_NONE;
+    return nodePtr;
+}
+
+static FrozenNode *
+NewListNode(
+    Tcl_Size numElements)
+{
+    FrozenNode *nodePtr = (FrozenNode *)Tcl_Alloc(
+	    offsetof(FrozenNode, elements)
+	    + numElements * sizeof(FrozenNode *));
+
+    nodePtr->stringPtr = NULL;
+    nodePtr->numElements = numElements;
+    return nodePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeNode --
+ *
+ *	Frees a node and, recursively, its elements.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeNode(
+    FrozenNode *nodePtr)
+{
+    Tcl_Size i;
+
+    if (NODE_IS_LIST(nodePtr)) {
+	for (i = 0; i < nodePtr->numElements; i++) {
+	    FreeNode(nodePtr->elements[i]);
+	}
+	if (nodePtr->stringPtr != NULL) {
+	    Tcl_Free(nodePtr->stringPtr);
+	}
+    }
+    Tcl_Free(nodePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewHandle --
+ *
+ *	Makes a handle on a node of a frozen value for the current thread.
+ *
+ * Results:
+ *	A new object with a reference count of zero.
+ *
+ * Side effects:
+ *	Adds a reference to the root.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+NewHandle(
+    FrozenRoot *rootPtr,
+    FrozenNode *nodePtr)
+{
+    Tcl_Obj *objPtr;
+
+    TclNewObj(objPtr);
+    TclInvalidateStringRep(objPtr);
+    TclAtomicAddSize(&rootPtr->refCount, 1);
+    objPtr->internalRep.twoPtrValue.ptr1 = rootPtr;
+    objPtr->internalRep.twoPtrValue.ptr2 = nodePtr;
+    objPtr->typePtr = NODE_IS_LIST(nodePtr)
+	    ? &frozenListType : &frozenStringType;
+    return objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeFrozenInternalRep, DupFrozenInternalRep --
+ *
+ *	Release and copy the internal representation of a handle. The thread
+ *	that releases the last handle on a frozen value, whichever it is,
+ *	frees the value.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Change the reference count of the root and may free the graph.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeFrozenInternalRep(
+    Tcl_Obj *objPtr)
+{
+    FrozenRoot *rootPtr = HANDLE_ROOT(objPtr);
+
+    if (TclAtomicAddFetchSize(&rootPtr->refCount, -1) == 0) {
+	FreeNode(rootPtr->nodePtr);
+	Tcl_Free(rootPtr);
+    }
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupFrozenInternalRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *copyPtr)
+{
+    TclAtomicAddSize(&HANDLE_ROOT(srcPtr)->refCount, 1);
+    copyPtr->internalRep.twoPtrValue = srcPtr->internalRep.twoPtrValue;
+    copyPtr->typePtr = srcPtr->typePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UpdateStringOfFrozen --
+ *
+ *	Gives a handle a copy of its node's string representation.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May generate and publish the string representation of a list node.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UpdateStringOfFrozen(
+    Tcl_Obj *objPtr)
+{
+    FrozenString *stringPtr = GetNodeString(HANDLE_NODE(objPtr));
+
+    memcpy(Tcl_InitStringRep(objPtr, NULL, stringPtr->length),
+	    stringPtr->bytes, stringPtr->length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetNodeString --
+ *
+ *	Returns the string representation of a node, generating that of a list
+ *	node from the strings of its elements the first time it is needed.
+ *	Threads that do so at the same time each generate a copy and all but
+ *	one of the copies are discarded.
+ *
+ * Results:
+ *	The string representation, which lives as long as the node.
+ *
+ * Side effects:
+ *	May allocate the string representation of the node and its elements.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static FrozenString *
+GetNodeString(
+    FrozenNode *nodePtr)
+{
+#define LOCAL_SIZE 64
+    char localFlags[LOCAL_SIZE], *flagPtr;
+    FrozenString *stringPtr = (FrozenString *)
+	    TclAtomicLoadPtr(&nodePtr->stringPtr);
+    FrozenString *elemPtr;
+    size_t bytesNeeded = 0;
+    Tcl_Size i, numElements = nodePtr->numElements;
+    char *dst;
+
+    if (stringPtr != NULL) {
+	return stringPtr;
+    }
+
+    flagPtr = (numElements <= LOCAL_SIZE) ? localFlags
+	    : (char *)Tcl_Alloc(numElements);
+    for (i = 0; i < numElements; i++) {
+	elemPtr = GetNodeString(nodePtr->elements[i]);
+	flagPtr[i] = (i ? TCL_DONT_QUOTE_HASH : 0);
+	bytesNeeded += TclScanElement(elemPtr->bytes, elemPtr->length,
+		flagPtr + i);
+	if (bytesNeeded > SIZE_MAX - numElements) {
+	    Tcl_Panic("max size for a Tcl value (%" TCL_Z_MODIFIER
+		    "u bytes) exceeded", SIZE_MAX);
+	}
+    }
+    bytesNeeded += (numElements ? numElements - 1 : 0);
+
+    stringPtr = (FrozenString *)Tcl_Alloc(STRING_SIZE(bytesNeeded));
+    dst = stringPtr->bytes;
+    for (i = 0; i < numElements; i++) {
+	elemPtr = (FrozenString *)TclAtomicLoadPtr(
+		&nodePtr->elements[i]->stringPtr);
+	flagPtr[i] |= (i ? TCL_DONT_QUOTE_HASH : 0);
+	if (i) {
+	    *dst++ = ' ';
+	}
+	dst += TclConvertElement(elemPtr->bytes, elemPtr->length, dst,
+		flagPtr[i]);
+    }
+    *dst = '\0';
+    stringPtr->length = dst - stringPtr->bytes;
+    if (flagPtr != localFlags) {
+	Tcl_Free(flagPtr);
+    }
+
+    if (!TclAtomicCasPtr(&nodePtr->stringPtr, NULL, stringPtr)) {
+	Tcl_Free(stringPtr);
+	stringPtr = (FrozenString *)TclAtomicLoadPtr(&nodePtr->stringPtr);
+    }
+    return stringPtr;
+#undef LOCAL_SIZE
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FrozenListLength, FrozenListIndex --
+ *
+ *	The abstract list operations of a handle on a list. An element that is
+ *	a list is returned as a handle on it, and one that is a string as a
+ *	new string object.
+ *
+ * Results:
+ *	The number of elements, and a standard Tcl result and the element,
+ *	which is NULL if the index is out of range.
+ *
+ * Side effects:
+ *	FrozenListIndex creates a new object.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Size
+FrozenListLength(
+    Tcl_Obj *objPtr)
+{
+    return HANDLE_NODE(objPtr)->numElements;
+}
+
+static int
+FrozenListIndex(
+    TCL_UNUSED(Tcl_Interp *),
+    Tcl_Obj *objPtr,		/* Handle on a list. */
+    Tcl_Size index,		/* Index of the element. */
+    Tcl_Obj **elemPtrPtr)	/* Where to store the element. */
+{
+    FrozenNode *nodePtr = HANDLE_NODE(objPtr);
+    FrozenNode *elemPtr;
+
+    if (index < 0 || index >= nodePtr->numElements) {
+	*elemPtrPtr = NULL;
+	return TCL_OK;
+    }
+    elemPtr = nodePtr->elements[index];
+    if (NODE_IS_LIST(elemPtr)) {
+	*elemPtrPtr = NewHandle(HANDLE_ROOT(objPtr), elemPtr);
+    } else {
+	*elemPtrPtr = Tcl_NewStringObj(elemPtr->stringPtr->bytes,
+		elemPtr->stringPtr->length);
+    }
+    return TCL_OK;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
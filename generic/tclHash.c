@@ -36,6 +36,36 @@
 #define RANDOM_INDEX(tablePtr, i) \
     ((((i)*(size_t)1103515245) >> (tablePtr)->downShift) & (tablePtr)->mask)
 
+/*
+ * Tables whose key type has TCL_HASH_KEY_INCREMENTAL_REHASH set are not
+ * rebuilt in one go once they have at least REHASH_INCREMENTAL_MIN buckets.
+ * Instead the old bucket array is kept alongside the new one, and each time
+ * an entry is created the next REHASH_STEP old buckets are moved across.
+ * While this goes on the staticBuckets array, which is otherwise unused in a
+ * table that large, holds the old array, its size, the index of the next old
+ * bucket to move and the old downShift.
+ */
+
+#ifndef REHASH_INCREMENTAL_MIN
+#define REHASH_INCREMENTAL_MIN	1024
+#endif
+#ifndef REHASH_STEP
+#define REHASH_STEP		4
+#endif
+
+#define REHASHING(tablePtr) \
+    ((tablePtr)->buckets != (tablePtr)->staticBuckets \
+	    && (tablePtr)->staticBuckets[0] != NULL)
+#define OLD_BUCKETS(tablePtr) \
+    ((Tcl_HashEntry **)(void *)(tablePtr)->staticBuckets[0])
+#define OLD_NUM_BUCKETS(tablePtr) \
+    ((size_t)PTR2UINT((tablePtr)->staticBuckets[1]))
+#define OLD_NEXT_BUCKET(tablePtr) \
+    ((size_t)PTR2UINT((tablePtr)->staticBuckets[2]))
+#define OLD_INDEX(typePtr, tablePtr, hash) \
+    BucketIndex((typePtr), (hash), OLD_NUM_BUCKETS(tablePtr) - 1, \
+	    (int)PTR2UINT((tablePtr)->staticBuckets[3]))
+
 /*
  * Prototypes for the array hash key methods.
  */
@@ -63,6 +93,8 @@ static Tcl_HashEntry *	CreateHashEntry(Tcl_HashTable *tablePtr, const char *key,
 static Tcl_HashEntry *	FindHashEntry(Tcl_HashTable *tablePtr, const char *key);
 #endif
 static void		RebuildTable(Tcl_HashTable *tablePtr);
+static void		RehashBuckets(Tcl_HashTable *tablePtr,
+			    const Tcl_HashKeyType *typePtr, size_t count);
 
 const Tcl_HashKeyType tclArrayHashKeyType = {
     TCL_HASH_KEY_TYPE_VERSION,		/* version */
@@ -90,6 +122,46 @@ const Tcl_HashKeyType tclStringHashKeyType = {
     AllocStringEntry,			/* allocEntryProc */
     NULL				/* freeEntryProc */
 };
+
+const Tcl_HashKeyType tclIncrementalStringHashKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    TCL_HASH_KEY_INCREMENTAL_REHASH,	/* flags */
+    TclHashStringKey,			/* hashKeyProc */
+    TclCompareStringKeys,		/* compareKeysProc */
+    AllocStringEntry,			/* allocEntryProc */
+    NULL				/* freeEntryProc */
+};
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * BucketIndex --
+ *
+ *	Computes the bucket a hash value belongs in, for a bucket array with
+ *	the given mask and downShift.
+ *
+ * Results:
+ *	The bucket index.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline size_t
+BucketIndex(
+    const Tcl_HashKeyType *typePtr,
+    size_t hash,
+    size_t mask,
+    int downShift)
+{
+    if (typePtr->hashKeyProc == NULL
+	    || typePtr->flags & TCL_HASH_KEY_RANDOMIZE_HASH) {
+	return ((hash * (size_t)1103515245) >> downShift) & mask;
+    }
+    return hash & mask;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -274,6 +346,68 @@ Tcl_DbCreateHashEntry(
     }
     return entry;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SearchBucket --
+ *
+ *	Looks for an entry with a matching key in a single bucket chain.
+ *
+ * Results:
+ *	The matching entry, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline Tcl_HashEntry *
+SearchBucket(
+    const Tcl_HashKeyType *typePtr,
+    Tcl_HashEntry *hPtr,	/* First entry of the bucket chain. */
+    const char *key,
+    size_t hash)
+{
+    if (typePtr->compareKeysProc) {
+	Tcl_CompareHashKeysProc *compareKeysProc = typePtr->compareKeysProc;
+	if (typePtr->flags & TCL_HASH_KEY_DIRECT_COMPARE) {
+	    for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+		if (hash != hPtr->hash) {
+		    continue;
+		}
+		/* if keys pointers or values are equal */
+		if ((key == hPtr->key.oneWordValue)
+		    || compareKeysProc((void *) key, hPtr)) {
+		    return hPtr;
+		}
+	    }
+	} else { /* no direct compare - compare key addresses only */
+	    for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+		if (hash != hPtr->hash) {
+		    continue;
+		}
+		/* if needle pointer equals content pointer or values equal */
+		if ((key == hPtr->key.string)
+			|| compareKeysProc((void *) key, hPtr)) {
+		    return hPtr;
+		}
+	    }
+	}
+    } else {
+	for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
+	    if (hash != hPtr->hash) {
+		continue;
+	    }
+	    if (key == hPtr->key.oneWordValue) {
+		return hPtr;
+	    }
+	}
+    }
+
+    return NULL;
+}
 
 static Tcl_HashEntry *
 CreateHashEntry(
@@ -311,55 +445,25 @@ CreateHashEntry(
     }
 
     /*
-     * Search all of the entries in the appropriate bucket.
+     * Search all of the entries in the appropriate bucket, and in the
+     * corresponding bucket of the old bucket array if that has not been
+     * moved across yet.
      */
 
-    if (typePtr->compareKeysProc) {
-	Tcl_CompareHashKeysProc *compareKeysProc = typePtr->compareKeysProc;
-	if (typePtr->flags & TCL_HASH_KEY_DIRECT_COMPARE) {
-	    for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		    hPtr = hPtr->nextPtr) {
-		if (hash != hPtr->hash) {
-		    continue;
-		}
-		/* if keys pointers or values are equal */
-		if ((key == hPtr->key.oneWordValue)
-		    || compareKeysProc((void *) key, hPtr)) {
-		    if (newPtr && (newPtr != TCL_HASH_FIND)) {
-			*newPtr = 0;
-		    }
-		    return hPtr;
-		}
-	    }
-	} else { /* no direct compare - compare key addresses only */
-	    for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		    hPtr = hPtr->nextPtr) {
-		if (hash != hPtr->hash) {
-		    continue;
-		}
-		/* if needle pointer equals content pointer or values equal */
-		if ((key == hPtr->key.string)
-			|| compareKeysProc((void *) key, hPtr)) {
-		    if (newPtr && (newPtr != TCL_HASH_FIND)) {
-			*newPtr = 0;
-		    }
-		    return hPtr;
-		}
-	    }
+    hPtr = SearchBucket(typePtr, tablePtr->buckets[index], key, hash);
+    if (hPtr == NULL && REHASHING(tablePtr)) {
+	size_t oldIndex = OLD_INDEX(typePtr, tablePtr, hash);
+
+	if (oldIndex >= OLD_NEXT_BUCKET(tablePtr)) {
+	    hPtr = SearchBucket(typePtr, OLD_BUCKETS(tablePtr)[oldIndex], key,
+		    hash);
 	}
-    } else {
-	for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
-		hPtr = hPtr->nextPtr) {
-	    if (hash != hPtr->hash) {
-		continue;
-	    }
-	    if (key == hPtr->key.oneWordValue) {
-		if (newPtr && (newPtr != TCL_HASH_FIND)) {
-		    *newPtr = 0;
-		}
-		return hPtr;
-	    }
+    }
+    if (hPtr != NULL) {
+	if (newPtr && (newPtr != TCL_HASH_FIND)) {
+	    *newPtr = 0;
 	}
+	return hPtr;
     }
 
     if (newPtr == TCL_HASH_FIND) {
@@ -393,9 +497,12 @@ CreateHashEntry(
 
     /*
      * If the table has exceeded a decent size, rebuild it with many more
-     * buckets.
+     * buckets. If a rebuild is already under way, do the next step of it.
      */
 
+    if (REHASHING(tablePtr)) {
+	RehashBuckets(tablePtr, typePtr, REHASH_STEP);
+    }
     if (tablePtr->numEntries >= tablePtr->rebuildSize) {
 	RebuildTable(tablePtr);
     }
@@ -452,6 +559,22 @@ Tcl_DeleteHashEntry(
 
     bucketPtr = &tablePtr->buckets[index];
 
+    /*
+     * While the table is being rebuilt, the entry may still be in the old
+     * bucket array.
+     */
+
+    if (REHASHING(tablePtr)) {
+	for (prevPtr = *bucketPtr; prevPtr != NULL && prevPtr != entryPtr;
+		prevPtr = prevPtr->nextPtr) {
+	    /* Empty loop body. */
+	}
+	if (prevPtr == NULL) {
+	    bucketPtr = &OLD_BUCKETS(tablePtr)[
+		    OLD_INDEX(typePtr, tablePtr, entryPtr->hash)];
+	}
+    }
+
     if (*bucketPtr == entryPtr) {
 	*bucketPtr = entryPtr->nextPtr;
     } else {
@@ -511,9 +634,13 @@ Tcl_DeleteHashTable(
     }
 
     /*
-     * Free up all the entries in the table.
+     * Free up all the entries in the table, after gathering them all into
+     * the current bucket array.
      */
 
+    if (REHASHING(tablePtr)) {
+	RehashBuckets(tablePtr, typePtr, SIZE_MAX);
+    }
     for (i = 0; i < tablePtr->numBuckets; i++) {
 	hPtr = tablePtr->buckets[i];
 	while (hPtr != NULL) {
@@ -611,12 +738,24 @@ Tcl_NextHashEntry(
     Tcl_HashEntry *hPtr;
     Tcl_HashTable *tablePtr = searchPtr->tablePtr;
 
+    /*
+     * While the table is being rebuilt, the buckets of the old bucket array
+     * that have not been moved across yet are visited after all the current
+     * ones. Entries only move when new ones are created, which is not
+     * allowed during a search, so each entry is still returned once.
+     */
+
     while (searchPtr->nextEntryPtr == NULL) {
-	if (searchPtr->nextIndex >= tablePtr->numBuckets) {
+	if (searchPtr->nextIndex < tablePtr->numBuckets) {
+	    searchPtr->nextEntryPtr =
+		    tablePtr->buckets[searchPtr->nextIndex];
+	} else if (REHASHING(tablePtr) && (size_t)(searchPtr->nextIndex
+		- tablePtr->numBuckets) < OLD_NUM_BUCKETS(tablePtr)) {
+	    searchPtr->nextEntryPtr = OLD_BUCKETS(tablePtr)[
+		    searchPtr->nextIndex - tablePtr->numBuckets];
+	} else {
 	    return NULL;
 	}
-	searchPtr->nextEntryPtr =
-		tablePtr->buckets[searchPtr->nextIndex];
 	searchPtr->nextIndex++;
     }
     hPtr = searchPtr->nextEntryPtr;
@@ -648,13 +787,14 @@ Tcl_HashStats(
 {
 #define NUM_COUNTERS 10
     Tcl_Size i;
-    size_t count[NUM_COUNTERS], overflow, j;
+    size_t count[NUM_COUNTERS], overflow, j, numChains;
     double average, tmp;
     Tcl_HashEntry *hPtr;
     char *result, *p;
 
     /*
-     * Compute a histogram of bucket usage.
+     * Compute a histogram of bucket usage. While the table is being rebuilt
+     * this includes the buckets of the old array that still hold entries.
      */
 
     for (i = 0; i < NUM_COUNTERS; i++) {
@@ -662,9 +802,19 @@ Tcl_HashStats(
     }
     overflow = 0;
     average = 0.0;
-    for (i = 0; i < tablePtr->numBuckets; i++) {
+    numChains = tablePtr->numBuckets;
+    if (REHASHING(tablePtr)) {
+	numChains += OLD_NUM_BUCKETS(tablePtr) - OLD_NEXT_BUCKET(tablePtr);
+    }
+    for (i = 0; i < (Tcl_Size)numChains; i++) {
 	j = 0;
-	for (hPtr = tablePtr->buckets[i]; hPtr != NULL; hPtr = hPtr->nextPtr) {
+	if (i < tablePtr->numBuckets) {
+	    hPtr = tablePtr->buckets[i];
+	} else {
+	    hPtr = OLD_BUCKETS(tablePtr)[OLD_NEXT_BUCKET(tablePtr)
+		    + (i - tablePtr->numBuckets)];
+	}
+	for (; hPtr != NULL; hPtr = hPtr->nextPtr) {
 	    j++;
 	}
 	if (j < NUM_COUNTERS) {
@@ -883,47 +1033,171 @@ TclHashStringKey(
     void *keyPtr)		/* Key from which to compute hash value. */
 {
     const char *string = (const char *)keyPtr;
-    size_t result;
-    char c;
 
-    /*
-     * I tried a zillion different hash functions and asked many other people
-     * for advice. Many people had their own favorite functions, all
-     * different, but no-one had much idea why they were good ones. I chose
-     * the one below (multiply by 9 and add new character) because of the
-     * following reasons:
-     *
-     * 1. Multiplying by 10 is perfect for keys that are decimal strings, and
-     *    multiplying by 9 is just about as good.
-     * 2. Times-9 is (shift-left-3) plus (old). This means that each
-     *    character's bits hang around in the low-order bits of the hash value
-     *    for ever, plus they spread fairly rapidly up to the high-order bits
-     *    to fill out the hash value. This seems works well both for decimal
-     *    and non-decimal strings, but isn't strong against maliciously-chosen
-     *    keys.
-     *
-     * Note that this function is very weak against malicious strings; it's
-     * very easy to generate multiple keys that have the same hashcode. On the
-     * other hand, that hardly ever actually occurs and this function *is*
-     * very cheap, even by comparison with industry-standard hashes like FNV.
-     * If real strength of hash is required though, use a custom hash based on
-     * Bob Jenkins's lookup3(), but be aware that it's significantly slower.
-     * Since Tcl command and namespace names are usually reasonably-named (the
-     * main use for string hashes in modern Tcl) speed is far more important
-     * than strength.
-     *
-     * See also HashString in tclLiteral.c.
-     * See also TclObjHashKey in tclObj.c.
-     *
-     * See [tcl-Feature Request #2958832]
-     */
+    return TclHashBytes(string, strlen(string));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitHashSeed --
+ *
+ *	Chooses the key used by TclHashBytes. This is taken from the
+ *	TCL_HASH_SEED environment variable if that is set to an integer
+ *	(which is useful for reproducing problems that depend on the order
+ *	of hash tables), and otherwise from the random number generator of
+ *	the operating system. If that cannot be used, the time, the process
+ *	id and some addresses that address space layout randomisation makes
+ *	different in every process are mixed instead.
+ *
+ *	Called from Tcl_InitSubsystems with TclpInitLock held, before any
+ *	hash table is made. The key is chosen only once per process, as hash
+ *	tables may outlive Tcl_Finalize.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets hashSeed.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    if ((result = UCHAR(*string)) != 0) {
-	while ((c = *++string) != 0) {
-	    result += (result << 3) + UCHAR(c);
-	}
+static Tcl_WideUInt hashSeed[2];
+
+static inline Tcl_WideUInt
+SplitMix64(
+    Tcl_WideUInt *statePtr)
+{
+    Tcl_WideUInt z = (*statePtr += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void
+TclInitHashSeed(void)
+{
+    const char *env;
+    Tcl_WideUInt state, key[2];
+
+    if (hashSeed[0] != 0) {
+	return;
     }
-    return result;
+    env = getenv("TCL_HASH_SEED");
+    if (env != NULL && *env != '\0') {
+	state = (Tcl_WideUInt) strtoull(env, NULL, 0);
+	key[0] = SplitMix64(&state);
+	key[1] = SplitMix64(&state);
+    } else if (!TclpRandomBytes(key, sizeof(key))) {
+	state = (Tcl_WideUInt) PTR2UINT(hashSeed);
+	state = SplitMix64(&state) ^ (Tcl_WideUInt) PTR2UINT(getenv("PATH"));
+	state = SplitMix64(&state) ^ (Tcl_WideUInt) PTR2UINT(&TclHashBytes);
+	state = SplitMix64(&state) ^ (Tcl_WideUInt) time(NULL);
+	state = SplitMix64(&state) ^ (Tcl_WideUInt) TclpGetClicks();
+	state = SplitMix64(&state) ^ (Tcl_WideUInt) getpid();
+	key[0] = SplitMix64(&state);
+	key[1] = SplitMix64(&state);
+    }
+    hashSeed[0] = key[0] | 1;
+    hashSeed[1] = key[1] | 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclHashBytes --
+ *
+ *	Compute a one-word summary of a byte sequence, which can be used to
+ *	generate a hash index. This is the hash of all string-keyed tables in
+ *	Tcl (see also TclHashObjKey in tclObj.c and the literal tables in
+ *	tclLiteral.c).
+ *
+ *	It used to multiply by 9 and add each byte, which is cheap for short
+ *	keys but slow for long ones, and made it trivial to construct many
+ *	keys with the same hash. As arrays and dicts are often keyed by data
+ *	from outside, that allowed a script to be slowed to a crawl by feeding
+ *	it such keys. SipHash-1-3 with a per-process key (see TclInitHashSeed)
+ *	takes eight bytes at a time and gives no way of choosing colliding
+ *	keys without knowing the key.
+ *
+ * Results:
+ *	The return value is a one-word summary of the bytes.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND(v0, v1, v2, v3) \
+    do {								\
+	(v0) += (v1); (v1) = ROTL64((v1), 13); (v1) ^= (v0);		\
+	(v0) = ROTL64((v0), 32);					\
+	(v2) += (v3); (v3) = ROTL64((v3), 16); (v3) ^= (v2);		\
+	(v0) += (v3); (v3) = ROTL64((v3), 21); (v3) ^= (v0);		\
+	(v2) += (v1); (v1) = ROTL64((v1), 17); (v1) ^= (v2);		\
+	(v2) = ROTL64((v2), 32);					\
+    } while (0)
+
+size_t
+TclHashBytes(
+    const char *bytes,		/* Bytes for which to compute hash value. */
+    Tcl_Size length)		/* Number of bytes. */
+{
+    const unsigned char *p = (const unsigned char *) bytes;
+    const unsigned char *end = p + (length & ~(Tcl_Size)7);
+    Tcl_WideUInt v0, v1, v2, v3, m;
+
+    v0 = hashSeed[0] ^ 0x736F6D6570736575ULL;
+    v1 = hashSeed[1] ^ 0x646F72616E646F6DULL;
+    v2 = hashSeed[0] ^ 0x6C7967656E657261ULL;
+    v3 = hashSeed[1] ^ 0x7465646279746573ULL;
+
+    for (; p < end; p += 8) {
+	memcpy(&m, p, 8);
+	v3 ^= m;
+	SIPROUND(v0, v1, v2, v3);
+	v0 ^= m;
+    }
+
+    m = ((Tcl_WideUInt) length) << 56;
+    switch (length & 7) {
+    case 7:
+	m |= ((Tcl_WideUInt) p[6]) << 48;
+	TCL_FALLTHROUGH();
+    case 6:
+	m |= ((Tcl_WideUInt) p[5]) << 40;
+	TCL_FALLTHROUGH();
+    case 5:
+	m |= ((Tcl_WideUInt) p[4]) << 32;
+	TCL_FALLTHROUGH();
+    case 4:
+	m |= ((Tcl_WideUInt) p[3]) << 24;
+	TCL_FALLTHROUGH();
+    case 3:
+	m |= ((Tcl_WideUInt) p[2]) << 16;
+	TCL_FALLTHROUGH();
+    case 2:
+	m |= ((Tcl_WideUInt) p[1]) << 8;
+	TCL_FALLTHROUGH();
+    case 1:
+	m |= (Tcl_WideUInt) p[0];
+	break;
+    default:
+	break;
+    }
+    v3 ^= m;
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xFF;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    return (size_t) (v0 ^ v1 ^ v2 ^ v3);
 }
 
 /*
@@ -981,12 +1255,7 @@ RebuildTable(
     Tcl_HashEntry **oldChainPtr, **newChainPtr;
     Tcl_HashEntry *hPtr;
     const Tcl_HashKeyType *typePtr;
-
-    /* Avoid outgrowing capability of the memory allocators */
-    if (oldSize > UINT_MAX / (4 * sizeof(Tcl_HashEntry *))) {
-	tablePtr->rebuildSize = INT_MAX;
-	return;
-    }
+    int oldDownShift = tablePtr->downShift;
 
     if (tablePtr->keyType == TCL_STRING_KEYS) {
 	typePtr = &tclStringHashKeyType;
@@ -999,6 +1268,21 @@ RebuildTable(
 	typePtr = &tclArrayHashKeyType;
     }
 
+    /*
+     * Finish any incremental rebuild still under way. This only happens if
+     * many entries were deleted and created again while it was in progress.
+     */
+
+    if (REHASHING(tablePtr)) {
+	RehashBuckets(tablePtr, typePtr, SIZE_MAX);
+    }
+
+    /* Avoid outgrowing capability of the memory allocators */
+    if (oldSize > UINT_MAX / (4 * sizeof(Tcl_HashEntry *))) {
+	tablePtr->rebuildSize = INT_MAX;
+	return;
+    }
+
     /*
      * Allocate and initialize the new bucket array, and set up hashing
      * constants for new array size.
@@ -1022,6 +1306,21 @@ RebuildTable(
     }
     tablePtr->mask = (tablePtr->mask << 2) + 3;
 
+    /*
+     * For a large table that allows it, leave the old bucket array in place
+     * and move its entries across a few buckets at a time.
+     */
+
+    if ((typePtr->flags & TCL_HASH_KEY_INCREMENTAL_REHASH)
+	    && oldSize >= REHASH_INCREMENTAL_MIN) {
+	tablePtr->staticBuckets[0] = (Tcl_HashEntry *)(void *)oldBuckets;
+	tablePtr->staticBuckets[1] = (Tcl_HashEntry *)UINT2PTR(oldSize);
+	tablePtr->staticBuckets[2] = NULL;
+	tablePtr->staticBuckets[3] = (Tcl_HashEntry *)UINT2PTR(oldDownShift);
+	RehashBuckets(tablePtr, typePtr, REHASH_STEP);
+	return;
+    }
+
     /*
      * Rehash all of the existing entries into the new bucket array.
      */
@@ -1053,6 +1352,511 @@ RebuildTable(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * RehashBuckets --
+ *
+ *	Does a step of an incremental rebuild of a hash table, moving the
+ *	entries of the next few buckets of the old bucket array into the
+ *	current one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Entries get re-hashed to new buckets. When the last old bucket has
+ *	been emptied, the old bucket array is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RehashBuckets(
+    Tcl_HashTable *tablePtr,	/* Table being rebuilt. */
+    const Tcl_HashKeyType *typePtr,
+    size_t count)		/* Maximum number of old buckets to move. */
+{
+    Tcl_HashEntry **oldBuckets = OLD_BUCKETS(tablePtr);
+    size_t oldSize = OLD_NUM_BUCKETS(tablePtr);
+    size_t next = OLD_NEXT_BUCKET(tablePtr), index;
+    Tcl_HashEntry *hPtr;
+
+    for (; count > 0 && next < oldSize; count--, next++) {
+	for (hPtr = oldBuckets[next]; hPtr != NULL; hPtr = oldBuckets[next]) {
+	    oldBuckets[next] = hPtr->nextPtr;
+	    index = BucketIndex(typePtr, hPtr->hash, tablePtr->mask,
+		    tablePtr->downShift);
+	    hPtr->nextPtr = tablePtr->buckets[index];
+	    tablePtr->buckets[index] = hPtr;
+	}
+    }
+    if (next < oldSize) {
+	tablePtr->staticBuckets[2] = (Tcl_HashEntry *)UINT2PTR(next);
+	return;
+    }
+
+    if (typePtr->flags & TCL_HASH_KEY_SYSTEM_HASH) {
+	TclpSysFree((char *) oldBuckets);
+    } else {
+	Tcl_Free(oldBuckets);
+    }
+    tablePtr->staticBuckets[0] = tablePtr->staticBuckets[1] = NULL;
+    tablePtr->staticBuckets[2] = tablePtr->staticBuckets[3] = NULL;
+}
+
+
+/*
+ * Shared hash tables, for process-wide registries that many threads read and
+ * few change. A reader loads the bucket array, a chain head and each
+ * entry's successor with acquire semantics and takes no lock. A writer holds
+ * the table's mutex and makes every change visible with a single release
+ * store: new entries are fully built before they are linked in, a removed
+ * entry keeps its successor pointer, and growing the table builds a new
+ * bucket array with copies of the entries before switching to it. Memory a
+ * reader might still be looking at is put on the table's retired list
+ * instead of being freed. Compilers without suitable builtins fall back to
+ * taking the mutex for lookups too.
+ */
+
+#ifndef TCL_ATOMIC_BUILTINS
+#   define SHARED_HASH_LOCKED_READS 1
+#endif
+
+#define SHARED_MIN_BUCKETS	16
+
+typedef struct SharedEntry {
+    struct SharedEntry *nextPtr;
+				/* Next entry in the same bucket. */
+    size_t hash;		/* Hash value of the key. */
+    void *value;		/* Value stored under the key. */
+    union {
+	const void *oneWordValue;
+				/* One-word key. */
+	char string[1];		/* String key. The actual size will be as
+				 * large as needed to hold the key. */
+    } key;
+} SharedEntry;
+
+typedef struct SharedBuckets {
+    size_t mask;		/* Number of buckets minus one. */
+    SharedEntry *chains[TCLFLEXARRAY];
+				/* Heads of the bucket chains. */
+} SharedBuckets;
+
+typedef struct SharedRetired {
+    struct SharedRetired *nextPtr;
+    void *memPtr;		/* Unlinked entry or bucket array. */
+} SharedRetired;
+
+static size_t		SharedHashKey(int keyType, const void *key);
+static SharedEntry *	NewSharedEntry(int keyType, const void *key,
+			    size_t hash, void *value);
+static void		RetireShared(TclSharedHashTable *tablePtr,
+			    void *memPtr);
+static SharedBuckets *	GrowSharedTable(TclSharedHashTable *tablePtr,
+			    SharedBuckets *oldPtr);
+
+#define SHARED_KEYS_EQUAL(keyType, key, entryPtr) \
+    ((keyType) == TCL_ONE_WORD_KEYS \
+	    ? (key) == (entryPtr)->key.oneWordValue \
+	    : !strcmp((const char *) (key), (entryPtr)->key.string))
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitSharedHashTable --
+ *
+ *	Initializes a shared hash table. Static tables that are all zeros
+ *	need this only to get keys other than strings.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The table is made empty, without a bucket array.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclInitSharedHashTable(
+    TclSharedHashTable *tablePtr,
+				/* Table to initialize. */
+    int keyType)		/* TCL_STRING_KEYS or TCL_ONE_WORD_KEYS. */
+{
+    tablePtr->bucketsPtr = NULL;
+    tablePtr->retiredPtr = NULL;
+    tablePtr->numEntries = 0;
+    tablePtr->keyType = keyType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSharedHashGet --
+ *
+ *	Looks up a key in a shared hash table, without locking.
+ *
+ * Results:
+ *	The value stored under the key, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclSharedHashGet(
+    TclSharedHashTable *tablePtr,
+				/* Table to search. */
+    const void *key)		/* String or one-word key to look for. */
+{
+    size_t hash = SharedHashKey(tablePtr->keyType, key);
+    SharedBuckets *bucketsPtr;
+    SharedEntry *entryPtr;
+    void *value = NULL;
+
+#ifdef SHARED_HASH_LOCKED_READS
+    Tcl_MutexLock(&tablePtr->mutex);
+#endif
+    bucketsPtr = (SharedBuckets *) TclAtomicLoadPtr(&tablePtr->bucketsPtr);
+    if (bucketsPtr != NULL) {
+	for (entryPtr = (SharedEntry *)
+		TclAtomicLoadPtr(&bucketsPtr->chains[hash & bucketsPtr->mask]);
+		entryPtr != NULL;
+		entryPtr = (SharedEntry *) TclAtomicLoadPtr(&entryPtr->nextPtr)) {
+	    if (entryPtr->hash == hash
+		    && SHARED_KEYS_EQUAL(tablePtr->keyType, key, entryPtr)) {
+		value = TclAtomicLoadPtr(&entryPtr->value);
+		break;
+	    }
+	}
+    }
+#ifdef SHARED_HASH_LOCKED_READS
+    Tcl_MutexUnlock(&tablePtr->mutex);
+#endif
+    return value;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSharedHashSet --
+ *
+ *	Stores a value under a key in a shared hash table, or removes the key
+ *	if the value is NULL.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Entries may be created, replaced or retired, and the bucket array may
+ *	be replaced by a larger one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclSharedHashSet(
+    TclSharedHashTable *tablePtr,
+				/* Table to change. */
+    const void *key,		/* String or one-word key. */
+    void *value)		/* New value, or NULL to remove the key. */
+{
+    size_t hash = SharedHashKey(tablePtr->keyType, key);
+    SharedBuckets *bucketsPtr;
+    SharedEntry **linkPtr, *entryPtr = NULL;
+
+    Tcl_MutexLock(&tablePtr->mutex);
+    bucketsPtr = (SharedBuckets *) tablePtr->bucketsPtr;
+    if (bucketsPtr != NULL) {
+	for (linkPtr = &bucketsPtr->chains[hash & bucketsPtr->mask];
+		(entryPtr = *linkPtr) != NULL; linkPtr = &entryPtr->nextPtr) {
+	    if (entryPtr->hash == hash
+		    && SHARED_KEYS_EQUAL(tablePtr->keyType, key, entryPtr)) {
+		break;
+	    }
+	}
+    }
+
+    if (entryPtr != NULL) {
+	if (value != NULL) {
+	    TclAtomicStorePtr(&entryPtr->value, value);
+	} else {
+	    /*
+	     * Readers already on the entry can still follow its nextPtr.
+	     */
+
+	    TclAtomicStorePtr(linkPtr, entryPtr->nextPtr);
+	    RetireShared(tablePtr, entryPtr);
+	    tablePtr->numEntries--;
+	}
+    } else if (value != NULL) {
+	if (bucketsPtr == NULL || tablePtr->numEntries
+		>= REBUILD_MULTIPLIER * (bucketsPtr->mask + 1)) {
+	    bucketsPtr = GrowSharedTable(tablePtr, bucketsPtr);
+	}
+	linkPtr = &bucketsPtr->chains[hash & bucketsPtr->mask];
+	entryPtr = NewSharedEntry(tablePtr->keyType, key, hash, value);
+	entryPtr->nextPtr = *linkPtr;
+	TclAtomicStorePtr(linkPtr, entryPtr);
+	tablePtr->numEntries++;
+    }
+    Tcl_MutexUnlock(&tablePtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSharedHashForeach --
+ *
+ *	Calls a procedure for each key and value in a shared hash table. The
+ *	table is locked meanwhile, so the procedure must not change it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever proc does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclSharedHashForeach(
+    TclSharedHashTable *tablePtr,
+				/* Table to walk. */
+    TclSharedHashProc *proc,	/* Procedure to call for each entry. */
+    void *clientData)		/* First argument to pass to proc. */
+{
+    SharedBuckets *bucketsPtr;
+    SharedEntry *entryPtr;
+    size_t i;
+
+    Tcl_MutexLock(&tablePtr->mutex);
+    bucketsPtr = (SharedBuckets *) tablePtr->bucketsPtr;
+    for (i = 0; bucketsPtr != NULL && i <= bucketsPtr->mask; i++) {
+	for (entryPtr = bucketsPtr->chains[i]; entryPtr != NULL;
+		entryPtr = entryPtr->nextPtr) {
+	    proc(clientData, (tablePtr->keyType == TCL_ONE_WORD_KEYS)
+		    ? entryPtr->key.oneWordValue : entryPtr->key.string,
+		    entryPtr->value);
+	}
+    }
+    Tcl_MutexUnlock(&tablePtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteSharedHashTable --
+ *
+ *	Frees all memory of a shared hash table. No other thread may use the
+ *	table any more.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The table is left empty, and may be used again.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDeleteSharedHashTable(
+    TclSharedHashTable *tablePtr)
+				/* Table to delete. */
+{
+    SharedBuckets *bucketsPtr;
+    SharedEntry *entryPtr, *nextPtr;
+    SharedRetired *retiredPtr, *nextRetiredPtr;
+    size_t i;
+
+    Tcl_MutexLock(&tablePtr->mutex);
+    bucketsPtr = (SharedBuckets *) tablePtr->bucketsPtr;
+    for (i = 0; bucketsPtr != NULL && i <= bucketsPtr->mask; i++) {
+	for (entryPtr = bucketsPtr->chains[i]; entryPtr != NULL;
+		entryPtr = nextPtr) {
+	    nextPtr = entryPtr->nextPtr;
+	    Tcl_Free(entryPtr);
+	}
+    }
+    if (bucketsPtr != NULL) {
+	Tcl_Free(bucketsPtr);
+    }
+    for (retiredPtr = (SharedRetired *) tablePtr->retiredPtr;
+	    retiredPtr != NULL; retiredPtr = nextRetiredPtr) {
+	nextRetiredPtr = retiredPtr->nextPtr;
+	Tcl_Free(retiredPtr->memPtr);
+	Tcl_Free(retiredPtr);
+    }
+    tablePtr->bucketsPtr = NULL;
+    tablePtr->retiredPtr = NULL;
+    tablePtr->numEntries = 0;
+    Tcl_MutexUnlock(&tablePtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SharedHashKey --
+ *
+ *	Computes the hash value of a shared hash table key.
+ *
+ * Results:
+ *	The hash value. Its low bits select the bucket.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static size_t
+SharedHashKey(
+    int keyType,
+    const void *key)
+{
+    size_t hash;
+
+    if (keyType != TCL_ONE_WORD_KEYS) {
+	return TclHashBytes((const char *) key, strlen((const char *) key));
+    }
+
+    /*
+     * Multiplying keeps the low bits of aligned pointers zero, so fold the
+     * high half onto them.
+     */
+
+    hash = (size_t) PTR2UINT(key) * (size_t) 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> (sizeof(size_t) * 4));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewSharedEntry --
+ *
+ *	Allocates and fills in an entry for a shared hash table.
+ *
+ * Results:
+ *	The entry, not yet linked into any bucket.
+ *
+ * Side effects:
+ *	Memory is allocated; string keys are copied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SharedEntry *
+NewSharedEntry(
+    int keyType,
+    const void *key,
+    size_t hash,
+    void *value)
+{
+    SharedEntry *entryPtr;
+    size_t size = sizeof(entryPtr->key);
+
+    if (keyType != TCL_ONE_WORD_KEYS && strlen((const char *) key) + 1 > size) {
+	size = strlen((const char *) key) + 1;
+    }
+    entryPtr = (SharedEntry *) Tcl_Alloc(offsetof(SharedEntry, key) + size);
+    entryPtr->nextPtr = NULL;
+    entryPtr->hash = hash;
+    entryPtr->value = value;
+    if (keyType == TCL_ONE_WORD_KEYS) {
+	entryPtr->key.oneWordValue = key;
+    } else {
+	strcpy(entryPtr->key.string, (const char *) key);
+    }
+    return entryPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RetireShared --
+ *
+ *	Records memory that has been unlinked from a shared hash table but
+ *	may still be in use by readers, to be freed with the table.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is allocated. The caller must hold the table's mutex.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RetireShared(
+    TclSharedHashTable *tablePtr,
+    void *memPtr)
+{
+    SharedRetired *retiredPtr = (SharedRetired *)
+	    Tcl_Alloc(sizeof(SharedRetired));
+
+    retiredPtr->memPtr = memPtr;
+    retiredPtr->nextPtr = (SharedRetired *) tablePtr->retiredPtr;
+    tablePtr->retiredPtr = retiredPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GrowSharedTable --
+ *
+ *	Replaces the bucket array of a shared hash table by one four times as
+ *	large, holding copies of the entries so that readers still walking
+ *	the old chains are not disturbed.
+ *
+ * Results:
+ *	The new bucket array, already published.
+ *
+ * Side effects:
+ *	The old bucket array and entries are retired. The caller must hold
+ *	the table's mutex.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SharedBuckets *
+GrowSharedTable(
+    TclSharedHashTable *tablePtr,
+    SharedBuckets *oldPtr)	/* Current bucket array, or NULL. */
+{
+    size_t i, numBuckets = oldPtr ? (oldPtr->mask + 1) * 4 : SHARED_MIN_BUCKETS;
+    SharedBuckets *newPtr = (SharedBuckets *) Tcl_Alloc(
+	    offsetof(SharedBuckets, chains) + numBuckets * sizeof(SharedEntry *));
+    SharedEntry *entryPtr, *copyPtr;
+    const void *key;
+
+    newPtr->mask = numBuckets - 1;
+    memset(newPtr->chains, 0, numBuckets * sizeof(SharedEntry *));
+    for (i = 0; oldPtr != NULL && i <= oldPtr->mask; i++) {
+	for (entryPtr = oldPtr->chains[i]; entryPtr != NULL;
+		entryPtr = entryPtr->nextPtr) {
+	    key = (tablePtr->keyType == TCL_ONE_WORD_KEYS)
+		    ? entryPtr->key.oneWordValue : entryPtr->key.string;
+	    copyPtr = NewSharedEntry(tablePtr->keyType, key, entryPtr->hash,
+		    entryPtr->value);
+	    copyPtr->nextPtr = newPtr->chains[entryPtr->hash & newPtr->mask];
+	    newPtr->chains[entryPtr->hash & newPtr->mask] = copyPtr;
+	    RetireShared(tablePtr, entryPtr);
+	}
+    }
+    TclAtomicStorePtr(&tablePtr->bucketsPtr, newPtr);
+    if (oldPtr != NULL) {
+	RetireShared(tablePtr, oldPtr);
+    }
+    return newPtr;
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -239,6 +239,17 @@ static void		SpliceChannel(Tcl_Channel chan);
 static void		CutChannel(Tcl_Channel chan);
 static int	      WillRead(Channel *chanPtr);
 
+static TclRopeLeafProc	WriteRopeLeaf;
+
+/*
+ * State of Tcl_WriteObj while streaming the leaves of a rope.
+ */
+
+typedef struct {
+    Channel *chanPtr;		/* Channel written to. */
+    Tcl_Size total;		/* Bytes written so far. */
+} RopeWriteState;
+
 #define WriteChars(chanPtr, src, srcLen) \
 			Write(chanPtr, src, srcLen, chanPtr->state->encoding)
 #define WriteBytes(chanPtr, src, srcLen) \
@@ -4286,11 +4297,57 @@ Tcl_WriteObj(
 	    result = WriteBytes(chanPtr, src, srcLen);
 	}
 	return result;
+    } else if (TclHasInternalRep(objPtr, &tclRopeType)
+	    && objPtr->bytes == NULL) {
+	/*
+	 * Stream the leaves of a rope rather than flattening it first.
+	 */
+
+	RopeWriteState state;
+
+	state.chanPtr = chanPtr;
+	state.total = 0;
+	if (TclRopeForeachLeaf(objPtr, WriteRopeLeaf, &state) != TCL_OK) {
+	    return TCL_INDEX_NONE;
+	}
+	return state.total;
     } else {
 	src = TclGetStringFromObj(objPtr, &srcLen);
 	return WriteChars(chanPtr, src, srcLen);
     }
 }
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * WriteRopeLeaf --
+ *
+ *	Callback of Tcl_WriteObj for each leaf of a rope value.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the write failed.
+ *
+ * Side effects:
+ *	As for WriteChars.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static int
+WriteRopeLeaf(
+    void *clientData,
+    const char *bytes,
+    Tcl_Size numBytes)
+{
+    RopeWriteState *statePtr = (RopeWriteState *)clientData;
+    Tcl_Size written = WriteChars(statePtr->chanPtr, bytes, numBytes);
+
+    if (written < 0) {
+	return TCL_ERROR;
+    }
+    statePtr->total += written;
+    return TCL_OK;
+}
 
 static void
 WillWrite(
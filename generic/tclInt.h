@@ -1966,6 +1966,10 @@ typedef struct AllocCache {
     Tcl_ThreadId owner;		/* Which thread's cache is this? */
     Tcl_Obj *firstObjPtr;	/* List of free objects for thread. */
     size_t numObjects;		/* Number of objects for thread. */
+    size_t objsToSample;	/* Objects to allocate before the next check
+				 * by the heap profiler. */
+    Tcl_Interp *evalInterp;	/* Interp running callbacks in the thread,
+				 * see TclNRRunCallbacks. */
 } AllocCache;
 
 /*
@@ -2586,13 +2590,19 @@ typedef struct ListStore {
     Tcl_Size numAllocated;	/* Total number of slots[] array slots. */
     size_t refCount;		/* Number of references to this instance. */
     int flags;			/* LISTSTORE_* flags */
+    int numSearches;		/* Number of searches done without an index,
+				 * see TclListObjFindString. */
+    struct ListIndex *indexPtr;	/* Hash index of the in-use slots by string
+				 * value, or NULL. */
     Tcl_Obj *slots[TCLFLEXARRAY];
 				/* Variable size array. Grown as needed */
 } ListStore;
 enum ListStoreFlags {
-    LISTSTORE_CANONICAL = 1	/* All Tcl_Obj's referencing this
+    LISTSTORE_CANONICAL = 1,	/* All Tcl_Obj's referencing this
 				 * store have their string representation
 				 * derived from the list representation */
+    LISTSTORE_ARENA = 2		/* The store was allocated from an arena,
+				 * see TclAttemptArenaAlloc */
 };
 
 /* Max number of elements that can be contained in a list */
@@ -2914,6 +2924,41 @@ typedef void (TclInitProcessGlobalValueProc)(char **valuePtr,
 	size_t *lengthPtr,
 	Tcl_Encoding *encodingPtr);
 
+/*
+ *----------------------------------------------------------------
+ * Procedure type for tasks run by TclRunParallel. The second argument is the
+ * index of the task within its batch.
+ *----------------------------------------------------------------
+ */
+
+typedef void (TclParallelProc)(void *clientData, Tcl_Size taskIndex);
+
+#ifndef TCL_PARALLEL_MAX_THREADS
+#   define TCL_PARALLEL_MAX_THREADS 16
+#endif
+
+/*
+ *----------------------------------------------------------------
+ * Process-wide hash table for read-mostly registries, in tclHash.c. Lookups
+ * take no lock; changes are serialized by the table's mutex and publish new
+ * entries atomically, so concurrent readers see either the old or the new
+ * state. Memory unlinked by changes is only freed when the table is
+ * deleted. A table that is all zeros is an empty table with string keys.
+ *----------------------------------------------------------------
+ */
+
+typedef struct TclSharedHashTable {
+    void *bucketsPtr;		/* Current bucket array, or NULL. */
+    void *retiredPtr;		/* Memory unlinked while readers may still
+				 * use it. */
+    size_t numEntries;		/* Number of entries in the table. */
+    int keyType;		/* TCL_STRING_KEYS or TCL_ONE_WORD_KEYS. */
+    Tcl_Mutex mutex;		/* Serializes changes to the table. */
+} TclSharedHashTable;
+
+typedef void (TclSharedHashProc)(void *clientData, const void *key,
+	void *value);
+
 #ifdef _WIN32
 /* On Windows, all Unicode (except surrogates) are valid. */
 #   define TCLFSENCODING tclUtf8Encoding
@@ -3133,12 +3178,16 @@ MODULE_SCOPE const Tcl_ObjType tclDoubleType;
 MODULE_SCOPE const Tcl_ObjType tclExprCodeType;
 MODULE_SCOPE const Tcl_ObjType tclIntType;
 MODULE_SCOPE const Tcl_ObjType tclIndexType;
+MODULE_SCOPE const Tcl_ObjType tclInternType;
 MODULE_SCOPE const Tcl_ObjType tclListType;
+MODULE_SCOPE const Tcl_ObjType tclLocalVarNameType;
 MODULE_SCOPE const Tcl_ObjType tclDictType;
+MODULE_SCOPE const Tcl_ObjType tclParsedVarNameType;
 MODULE_SCOPE const Tcl_ObjType tclProcBodyType;
 MODULE_SCOPE const Tcl_ObjType tclStringType;
 MODULE_SCOPE const Tcl_ObjType tclEnsembleCmdType;
 MODULE_SCOPE const Tcl_ObjType tclRegexpType;
+MODULE_SCOPE const Tcl_ObjType tclRopeType;
 MODULE_SCOPE Tcl_ObjType tclCmdNameType;
 
 /*
@@ -3148,6 +3197,7 @@ MODULE_SCOPE Tcl_ObjType tclCmdNameType;
 MODULE_SCOPE const Tcl_HashKeyType tclArrayHashKeyType;
 MODULE_SCOPE const Tcl_HashKeyType tclOneWordHashKeyType;
 MODULE_SCOPE const Tcl_HashKeyType tclStringHashKeyType;
+MODULE_SCOPE const Tcl_HashKeyType tclIncrementalStringHashKeyType;
 MODULE_SCOPE const Tcl_HashKeyType tclObjHashKeyType;
 
 /*
@@ -3406,6 +3456,22 @@ MODULE_SCOPE void	TclFinalizeSynchronization(void);
 MODULE_SCOPE void	TclInitThreadAlloc(void);
 MODULE_SCOPE void	TclFinalizeThreadAlloc(void);
 MODULE_SCOPE void	TclFinalizeThreadAllocThread(void);
+MODULE_SCOPE void	TclPushAllocArena(void);
+MODULE_SCOPE void	TclPopAllocArena(void);
+MODULE_SCOPE void *	TclArenaAlloc(Tcl_Obj *objPtr, size_t reqSize);
+MODULE_SCOPE void *	TclAttemptArenaAlloc(Tcl_Obj *objPtr, size_t reqSize);
+MODULE_SCOPE void	TclArenaTrackObj(Tcl_Obj *objPtr);
+MODULE_SCOPE int	TclIsArenaBlock(void *ptr);
+MODULE_SCOPE int	TclArenaOwns(const void *ptr);
+MODULE_SCOPE void	TclPinAllocArenas(void);
+MODULE_SCOPE size_t	TclPromoteArenaValues(Tcl_Obj **objv, size_t objc);
+MODULE_SCOPE void	TclPromoteArenaLists(Tcl_Obj **objv, size_t objc);
+MODULE_SCOPE void	TclPromoteArenaDict(Tcl_Obj *dictPtr);
+MODULE_SCOPE int	TclMoveByteCodeSource(Tcl_Obj *objPtr,
+			    const char *newBytes);
+MODULE_SCOPE int	TclSetAllocProfileRate(size_t rate);
+MODULE_SCOPE Tcl_Obj *	TclGetAllocProfile(void);
+MODULE_SCOPE void	TclResetAllocProfile(void);
 MODULE_SCOPE void	TclFinalizeThreadData(int quick);
 MODULE_SCOPE void	TclFinalizeThreadObjects(void);
 MODULE_SCOPE double	TclFloor(const void *a);
@@ -3433,13 +3499,25 @@ MODULE_SCOPE Tcl_Obj *	TclGetSourceFromFrame(CmdFrame *cfPtr, Tcl_Size objc,
 			    Tcl_Obj *const objv[]);
 MODULE_SCOPE char *	TclGetStringStorage(Tcl_Obj *objPtr,
 			    Tcl_Size *sizePtr);
+MODULE_SCOPE int	TclHasUnicodeRep(Tcl_Obj *objPtr);
 MODULE_SCOPE int	TclGetLoadedLibraries(Tcl_Interp *interp,
 				const char *targetName,
 				const char *prefix);
 MODULE_SCOPE int	TclGetWideBitsFromObj(Tcl_Interp *, Tcl_Obj *,
 				Tcl_WideInt *);
 MODULE_SCOPE int	TclCompareStringKeys(void *keyPtr, Tcl_HashEntry *hPtr);
+MODULE_SCOPE size_t	TclHashBytes(const char *bytes, Tcl_Size length);
+MODULE_SCOPE void	TclInitHashSeed(void);
 MODULE_SCOPE size_t	TclHashStringKey(Tcl_HashTable *tablePtr, void *keyPtr);
+MODULE_SCOPE void	TclInitSharedHashTable(TclSharedHashTable *tablePtr,
+			    int keyType);
+MODULE_SCOPE void	TclDeleteSharedHashTable(TclSharedHashTable *tablePtr);
+MODULE_SCOPE void *	TclSharedHashGet(TclSharedHashTable *tablePtr,
+			    const void *key);
+MODULE_SCOPE void	TclSharedHashSet(TclSharedHashTable *tablePtr,
+			    const void *key, void *value);
+MODULE_SCOPE void	TclSharedHashForeach(TclSharedHashTable *tablePtr,
+			    TclSharedHashProc *proc, void *clientData);
 MODULE_SCOPE int	TclIncrObj(Tcl_Interp *interp, Tcl_Obj *valuePtr,
 			    Tcl_Obj *incrPtr);
 MODULE_SCOPE Tcl_Obj *	TclIncrObjVar2(Tcl_Interp *interp, Tcl_Obj *part1Ptr,
@@ -3482,6 +3560,9 @@ MODULE_SCOPE Tcl_Obj *	TclListObjGetElement(Tcl_Obj *listObj, Tcl_Size index);
 MODULE_SCOPE void	TclListLines(Tcl_Obj *listObj, int line, Tcl_Size n,
 			    int *lines, Tcl_Obj *const *elems);
 MODULE_SCOPE Tcl_Obj *	TclListObjCopy(Tcl_Interp *interp, Tcl_Obj *listPtr);
+MODULE_SCOPE int	TclListObjFindString(Tcl_Obj *listObj,
+			    Tcl_Obj *valueObj, Tcl_Size start,
+			    Tcl_Size *indexPtr);
 MODULE_SCOPE int	TclListObjAppendElements(Tcl_Interp *interp,
 			    Tcl_Obj *toObj, Tcl_Size elemCount,
 			    Tcl_Obj *const elemObjv[]);
@@ -3566,6 +3647,8 @@ MODULE_SCOPE void	TclpInitLock(void);
 MODULE_SCOPE void *	TclpInitNotifier(void);
 MODULE_SCOPE void	TclpInitPlatform(void);
 MODULE_SCOPE void	TclpInitUnlock(void);
+MODULE_SCOPE int	TclpRandomBytes(void *buffer, size_t length);
+MODULE_SCOPE int	TclpNumProcessors(void);
 MODULE_SCOPE Tcl_Obj *	TclpObjListVolumes(void);
 MODULE_SCOPE void	TclpGlobalLock(void);
 MODULE_SCOPE void	TclpGlobalUnlock(void);
@@ -3603,6 +3686,8 @@ MODULE_SCOPE TCL_NORETURN void TclpThreadExit(int status);
 MODULE_SCOPE void	TclRememberCondition(Tcl_Condition *mutex);
 MODULE_SCOPE void	TclRememberJoinableThread(Tcl_ThreadId id);
 MODULE_SCOPE void	TclRememberMutex(Tcl_Mutex *mutex);
+MODULE_SCOPE void	TclRunParallel(Tcl_Size numTasks, int maxThreads,
+			    TclParallelProc *proc, void *clientData);
 MODULE_SCOPE void	TclRemoveScriptLimitCallbacks(Tcl_Interp *interp);
 MODULE_SCOPE int	TclReToGlob(Tcl_Interp *interp, const char *reStr,
 			    Tcl_Size reStrLen, Tcl_DString *dsPtr, int *flagsPtr,
@@ -3752,6 +3837,8 @@ MODULE_SCOPE Tcl_Obj *	TclDictWithInit(Tcl_Interp *interp, Tcl_Obj *dictPtr,
 			    Tcl_Size pathc, Tcl_Obj *const pathv[]);
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_DisassembleObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc TclLoadIcuObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclMemoryProfileObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclRegexpCacheObjCmd;
 
 /* Assemble command function */
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_AssembleObjCmd;
@@ -3782,9 +3869,11 @@ MODULE_SCOPE Tcl_ObjCmdProc Tcl_InterpObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_JoinObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LappendObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LassignObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc Tcl_LdiffObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LeditObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LindexObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LinsertObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc Tcl_LintersectObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LlengthObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_ListObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LmapObjCmd;
@@ -3799,6 +3888,7 @@ MODULE_SCOPE Tcl_ObjCmdProc Tcl_LsearchObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LseqObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LsetObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_LsortObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc Tcl_LunionObjCmd;
 MODULE_SCOPE Tcl_Command TclInitNamespaceCmd(Tcl_Interp *interp);
 MODULE_SCOPE Tcl_ObjCmdProc TclNamespaceEnsembleCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_OpenObjCmd;
@@ -4021,6 +4111,25 @@ MODULE_SCOPE Tcl_Obj *	TclStringReplace(Tcl_Interp *interp, Tcl_Obj *objPtr,
 			    int flags);
 MODULE_SCOPE Tcl_Obj *	TclStringReverse(Tcl_Obj *objPtr, int flags);
 
+/*
+ * Functions defined in generic/tclStringRope.c, implementing the rope
+ * internal rep of large concatenated strings.
+ */
+
+typedef int (TclRopeLeafProc)(void *clientData, const char *bytes,
+			    Tcl_Size numBytes);
+
+MODULE_SCOPE int	TclRopeAppend(Tcl_Obj *objPtr, Tcl_Obj *appendObjPtr);
+MODULE_SCOPE Tcl_Obj *	TclRopeCat(Tcl_Size objc, Tcl_Obj *const objv[],
+			    int flags);
+MODULE_SCOPE Tcl_Size	TclRopeCharLength(Tcl_Obj *objPtr);
+MODULE_SCOPE int	TclRopeForeachLeaf(Tcl_Obj *objPtr,
+			    TclRopeLeafProc *proc, void *clientData);
+MODULE_SCOPE Tcl_Obj *	TclRopeRange(Tcl_Obj *objPtr, Tcl_Size first,
+			    Tcl_Size last);
+MODULE_SCOPE Tcl_Obj *	TclRopeReplace(Tcl_Obj *objPtr, Tcl_Size first,
+			    Tcl_Size count, Tcl_Obj *insertPtr);
+
 /* Flag values for the [string] ensemble functions. */
 enum StringOpFlags {
     TCL_STRING_MATCH_NOCASE = TCL_MATCH_NOCASE, /* (1<<0) in tcl.h */
@@ -4226,6 +4335,34 @@ TclScaleTime(
 #define	TCL_DTRACE_OBJ_FREE(objPtr)	{}
 #endif /* USE_DTRACE */
 
+/*
+ * When built with TCL_INLINE_STRINGS, each Tcl_Obj handed out by
+ * TclAllocObjStorage is followed by TCL_INLINE_STRING_MAX+1 bytes of inline
+ * storage, making the slot 64 bytes on 64-bit platforms. The Tcl_Obj layout
+ * itself is unchanged. Values created by the core with a string rep of at
+ * most TCL_INLINE_STRING_MAX bytes keep it there instead of in a separate
+ * allocation, and the bytes stay put until the string rep is invalidated
+ * just as heap bytes would. Values that are not short strings pay for the
+ * unused tail, so this trades memory on numeric values for memory and
+ * allocations on short strings.
+ *
+ * Only objects known to come from TclAllocObjStorage may use the tail, so
+ * TclInitNewStringRep is used in place of TclInitStringRep on objects that
+ * were just created. Tcl_Obj structs declared by extensions or on the stack
+ * never have one.
+ */
+
+#ifdef TCL_INLINE_STRINGS
+#   define TCL_INLINE_STRING_MAX 15
+#   define TCL_OBJ_SIZE (sizeof(Tcl_Obj) + TCL_INLINE_STRING_MAX + 1)
+#   define TclInlineBytes(objPtr) ((char *)((Tcl_Obj *)(objPtr) + 1))
+#   define TclHasInlineBytes(objPtr) \
+	((objPtr)->bytes == TclInlineBytes(objPtr))
+#else
+#   define TCL_OBJ_SIZE sizeof(Tcl_Obj)
+#   define TclHasInlineBytes(objPtr) 0
+#endif
+
 #ifdef TCL_COMPILE_STATS
 #  define TclIncrObjsAllocated() \
     tclObjsAlloced++
@@ -4264,7 +4401,8 @@ TclScaleTime(
 	if (!(objPtr)->typePtr || !(objPtr)->typePtr->freeIntRepProc) {	\
 	    TCL_DTRACE_OBJ_FREE(objPtr);				\
 	    if ((objPtr)->bytes						\
-		    && ((objPtr)->bytes != &tclEmptyString)) {		\
+		    && ((objPtr)->bytes != &tclEmptyString)		\
+		    && !TclHasInlineBytes(objPtr)) {			\
 		Tcl_Free((objPtr)->bytes);				\
 	    }								\
 	    (objPtr)->length = TCL_INDEX_NONE;				\
@@ -4275,6 +4413,105 @@ TclScaleTime(
 	}								\
     }
 
+/*
+ *----------------------------------------------------------------
+ * Atomic operations, for data that threads share without holding a mutex.
+ * Pointer and size loads have acquire and stores release semantics;
+ * TclAtomicAddSize is only atomic, the other read-modify-write operations
+ * are also barriers. The int operations are sequentially consistent.
+ *
+ * With gcc, clang and MSVC these are compiler builtins, and
+ * TCL_ATOMIC_BUILTINS is defined. Otherwise they are functions in
+ * tclThread.c that take a mutex, so code that wants to be lock-free should
+ * check TCL_ATOMIC_BUILTINS and simply lock instead.
+ *----------------------------------------------------------------
+ */
+
+#if defined(__GNUC__)
+#   define TCL_ATOMIC_BUILTINS 1
+#   define TclAtomicLoadPtr(ptrPtr) \
+	__atomic_load_n((void **) (ptrPtr), __ATOMIC_ACQUIRE)
+#   define TclAtomicStorePtr(ptrPtr, value) \
+	__atomic_store_n((void **) (ptrPtr), (void *) (value), __ATOMIC_RELEASE)
+#   define TclAtomicExchangePtr(ptrPtr, value) \
+	__atomic_exchange_n((void **) (ptrPtr), (void *) (value), \
+		__ATOMIC_ACQ_REL)
+#   define TclAtomicCasPtr(ptrPtr, oldValue, newValue) \
+	__sync_bool_compare_and_swap((void **) (ptrPtr), (void *) (oldValue), \
+		(void *) (newValue))
+#   define TclAtomicLoadSize(sizePtr) \
+	__atomic_load_n((sizePtr), __ATOMIC_ACQUIRE)
+#   define TclAtomicStoreSize(sizePtr, value) \
+	__atomic_store_n((sizePtr), (size_t) (value), __ATOMIC_RELEASE)
+#   define TclAtomicAddSize(sizePtr, delta) \
+	((void) __atomic_fetch_add((sizePtr), (size_t) (delta), \
+		__ATOMIC_RELAXED))
+#   define TclAtomicAddFetchSize(sizePtr, delta) \
+	__atomic_add_fetch((sizePtr), (size_t) (delta), __ATOMIC_ACQ_REL)
+#   define TclAtomicLoadInt(intPtr) \
+	__atomic_load_n((intPtr), __ATOMIC_SEQ_CST)
+#   define TclAtomicStoreInt(intPtr, value) \
+	__atomic_store_n((intPtr), (value), __ATOMIC_SEQ_CST)
+#   define TclAtomicAddInt(intPtr, delta) \
+	((void) __atomic_fetch_add((intPtr), (delta), __ATOMIC_SEQ_CST))
+#elif defined(_MSC_VER)
+#   define TCL_ATOMIC_BUILTINS 1
+#   define TclAtomicLoadPtr(ptrPtr) \
+	InterlockedCompareExchangePointer((PVOID volatile *) (ptrPtr), NULL, NULL)
+#   define TclAtomicStorePtr(ptrPtr, value) \
+	((void) InterlockedExchangePointer((PVOID volatile *) (ptrPtr), \
+		(PVOID) (value)))
+#   define TclAtomicExchangePtr(ptrPtr, value) \
+	InterlockedExchangePointer((PVOID volatile *) (ptrPtr), (PVOID) (value))
+#   define TclAtomicCasPtr(ptrPtr, oldValue, newValue) \
+	(InterlockedCompareExchangePointer((PVOID volatile *) (ptrPtr), \
+		(PVOID) (newValue), (PVOID) (oldValue)) == (PVOID) (oldValue))
+#   ifdef _WIN64
+#	define TclAtomicLoadSize(sizePtr) \
+	((size_t) InterlockedCompareExchange64((LONG64 volatile *) (sizePtr), \
+		0, 0))
+#	define TclAtomicStoreSize(sizePtr, value) \
+	((void) InterlockedExchange64((LONG64 volatile *) (sizePtr), \
+		(LONG64) (value)))
+#	define TclAtomicAddSize(sizePtr, delta) \
+	((void) InterlockedExchangeAdd64((LONG64 volatile *) (sizePtr), \
+		(LONG64) (delta)))
+#	define TclAtomicAddFetchSize(sizePtr, delta) \
+	((size_t) InterlockedAdd64((LONG64 volatile *) (sizePtr), \
+		(LONG64) (delta)))
+#   else
+#	define TclAtomicLoadSize(sizePtr) \
+	((size_t) InterlockedCompareExchange((LONG volatile *) (sizePtr), 0, 0))
+#	define TclAtomicStoreSize(sizePtr, value) \
+	((void) InterlockedExchange((LONG volatile *) (sizePtr), (LONG) (value)))
+#	define TclAtomicAddSize(sizePtr, delta) \
+	((void) InterlockedExchangeAdd((LONG volatile *) (sizePtr), \
+		(LONG) (delta)))
+#	define TclAtomicAddFetchSize(sizePtr, delta) \
+	((size_t) InterlockedAdd((LONG volatile *) (sizePtr), (LONG) (delta)))
+#   endif
+#   define TclAtomicLoadInt(intPtr) \
+	((int) InterlockedCompareExchange((LONG volatile *) (intPtr), 0, 0))
+#   define TclAtomicStoreInt(intPtr, value) \
+	((void) InterlockedExchange((LONG volatile *) (intPtr), (value)))
+#   define TclAtomicAddInt(intPtr, delta) \
+	((void) InterlockedExchangeAdd((LONG volatile *) (intPtr), (delta)))
+#else
+MODULE_SCOPE void *	TclAtomicLoadPtr(void *ptrPtr);
+MODULE_SCOPE void	TclAtomicStorePtr(void *ptrPtr, void *value);
+MODULE_SCOPE void *	TclAtomicExchangePtr(void *ptrPtr, void *value);
+MODULE_SCOPE int	TclAtomicCasPtr(void *ptrPtr, void *oldValue,
+			    void *newValue);
+MODULE_SCOPE size_t	TclAtomicLoadSize(size_t *sizePtr);
+MODULE_SCOPE void	TclAtomicStoreSize(size_t *sizePtr, size_t value);
+MODULE_SCOPE void	TclAtomicAddSize(size_t *sizePtr, size_t delta);
+MODULE_SCOPE size_t	TclAtomicAddFetchSize(size_t *sizePtr, size_t delta);
+MODULE_SCOPE int	TclAtomicLoadInt(int *intPtr);
+MODULE_SCOPE void	TclAtomicStoreInt(int *intPtr, int value);
+MODULE_SCOPE void	TclAtomicAddInt(int *intPtr, int delta);
+#endif
+MODULE_SCOPE void	TclInitAtomics(void);
+
 #if TCL_THREADS && !defined(USE_THREAD_ALLOC)
 #   define USE_THREAD_ALLOC 1
 #endif
@@ -4289,7 +4526,7 @@ TclScaleTime(
  */
 
 #  define TclAllocObjStorageEx(interp, objPtr) \
-	(objPtr) = (Tcl_Obj *)Tcl_Alloc(sizeof(Tcl_Obj))
+	(objPtr) = (Tcl_Obj *)Tcl_Alloc(TCL_OBJ_SIZE)
 
 #  define TclFreeObjStorageEx(interp, objPtr) \
 	Tcl_Free(objPtr)
@@ -4305,6 +4542,11 @@ TclScaleTime(
 
 MODULE_SCOPE Tcl_Obj *	TclThreadAllocObj(void);
 MODULE_SCOPE void	TclThreadFreeObj(Tcl_Obj *);
+MODULE_SCOPE void *	TclpAllocFrom(size_t size, void *caller);
+MODULE_SCOPE void *	TclpReallocFrom(void *ptr, size_t size,
+			    void *caller);
+MODULE_SCOPE size_t	tclNumSampledObjs;
+MODULE_SCOPE void	TclThreadAllocIdle(void);
 MODULE_SCOPE Tcl_Mutex *TclpNewAllocMutex(void);
 MODULE_SCOPE void	TclFreeAllocCache(void *);
 MODULE_SCOPE void *	TclpGetAllocCache(void);
@@ -4328,19 +4570,21 @@ MODULE_SCOPE void	TclpFreeAllocCache(void *);
 	AllocCache *cachePtr;						\
 	if (((interp) == NULL) ||					\
 		((cachePtr = ((Interp *)(interp))->allocCache),		\
-			(cachePtr->numObjects == 0))) {			\
+			((cachePtr->numObjects == 0) ||			\
+			(cachePtr->objsToSample <= 1)))) {		\
 	    (objPtr) = TclThreadAllocObj();				\
 	} else {							\
 	    (objPtr) = cachePtr->firstObjPtr;				\
 	    cachePtr->firstObjPtr = (Tcl_Obj *)(objPtr)->internalRep.twoPtrValue.ptr1; \
 	    --cachePtr->numObjects;					\
+	    --cachePtr->objsToSample;					\
 	}								\
     } while (0)
 
 #  define TclFreeObjStorageEx(interp, objPtr)				\
     do {								\
 	AllocCache *cachePtr;						\
-	if (((interp) == NULL) ||					\
+	if (((interp) == NULL) || (tclNumSampledObjs != 0) ||		\
 		((cachePtr = ((Interp *)(interp))->allocCache),		\
 			((cachePtr->numObjects == 0) ||			\
 			(cachePtr->numObjects >= ALLOC_NOBJHIGH)))) {	\
@@ -4395,7 +4639,7 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
     do { \
 	TclIncrObjsAllocated();						\
 	(objPtr) = (Tcl_Obj *)						\
-		Tcl_DbCkalloc(sizeof(Tcl_Obj), (file), (line));		\
+		Tcl_DbCkalloc(TCL_OBJ_SIZE, (file), (line));		\
 	TclDbInitNewObj((objPtr), (file), (line));			\
 	TCL_DTRACE_OBJ_CREATE(objPtr);					\
     } while (0)
@@ -4409,6 +4653,28 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
 #undef USE_THREAD_ALLOC
 #endif /* TCL_MEM_DEBUG */
 
+/*
+ * The threaded allocator attributes the memory it hands out to the C code
+ * that asked for it when the heap profiler samples it, which the wrappers
+ * around it pass on.
+ */
+
+#if defined(__GNUC__)
+#   define TclCallerAddress()	__builtin_return_address(0)
+#elif defined(_MSC_VER)
+#   include <intrin.h>
+#   define TclCallerAddress()	_ReturnAddress()
+#else
+#   define TclCallerAddress()	NULL
+#endif
+
+#if !TCL_THREADS || !defined(USE_THREAD_ALLOC)
+#   define TclpAllocFrom(size, caller) \
+	TclpAlloc(size)
+#   define TclpReallocFrom(ptr, size, caller) \
+	TclpRealloc((ptr), (size))
+#endif
+
 /*
  *----------------------------------------------------------------
  * Macros used by the Tcl core to set a Tcl_Obj's string representation to a
@@ -4429,6 +4695,11 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
  * MODULE_SCOPE void TclInitEmptyStringRep(Tcl_Obj *objPtr);
  * MODULE_SCOPE void TclInitStringRep(Tcl_Obj *objPtr, char *bytePtr, size_t len);
  * MODULE_SCOPE const char *TclAttemptInitStringRep(Tcl_Obj *objPtr, char *bytePtr, size_t len);
+ * MODULE_SCOPE void TclInitNewStringRep(Tcl_Obj *objPtr, char *bytePtr, size_t len);
+ * MODULE_SCOPE const char *TclAttemptInitNewStringRep(Tcl_Obj *objPtr, char *bytePtr, size_t len);
+ *
+ * The "New" forms may only be used on an object just created by TclNewObj
+ * and friends; they may place the bytes in its inline storage.
  *
  *----------------------------------------------------------------
  */
@@ -4440,7 +4711,7 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
     if ((len) == 0) {							\
 	TclInitEmptyStringRep(objPtr);					\
     } else {								\
-	(objPtr)->bytes = (char *)Tcl_Alloc((len) + 1U);		\
+	(objPtr)->bytes = (char *)TclArenaAlloc((objPtr), (len) + 1U);	\
 	memcpy((objPtr)->bytes, (bytePtr) ? (bytePtr) : &tclEmptyString, (len)); \
 	(objPtr)->bytes[len] = '\0';					\
 	(objPtr)->length = (len);					\
@@ -4450,12 +4721,40 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
     ((((len) == 0) ? (							\
 	TclInitEmptyStringRep(objPtr)					\
     ) : (								\
-	(objPtr)->bytes = (char *)Tcl_AttemptAlloc((len) + 1U),		\
+	(objPtr)->bytes = (char *)TclAttemptArenaAlloc((objPtr), (len) + 1U), \
 	(objPtr)->length = ((objPtr)->bytes) ?				\
 		(memcpy((objPtr)->bytes, (bytePtr) ? (bytePtr) : &tclEmptyString, (len)), \
 		(objPtr)->bytes[len] = '\0', (Tcl_Size)(len)) : (-1)		\
     )), (objPtr)->bytes)
 
+#ifdef TCL_INLINE_STRINGS
+#define TclInitNewStringRep(objPtr, bytePtr, len) \
+    if ((len) == 0 || (size_t)(len) > TCL_INLINE_STRING_MAX) {		\
+	TclInitStringRep((objPtr), (bytePtr), (len));			\
+    } else {								\
+	(objPtr)->bytes = TclInlineBytes(objPtr);			\
+	memcpy((objPtr)->bytes, (bytePtr), (len));			\
+	(objPtr)->bytes[len] = '\0';					\
+	(objPtr)->length = (len);					\
+    }
+
+#define TclAttemptInitNewStringRep(objPtr, bytePtr, len) \
+    (((len) == 0 || (size_t)(len) > TCL_INLINE_STRING_MAX) ? (		\
+	TclAttemptInitStringRep((objPtr), (bytePtr), (len))		\
+    ) : (								\
+	(objPtr)->bytes = TclInlineBytes(objPtr),			\
+	memcpy((objPtr)->bytes, (bytePtr), (len)),			\
+	(objPtr)->bytes[len] = '\0',					\
+	(objPtr)->length = (len),					\
+	(objPtr)->bytes							\
+    ))
+#else
+#define TclInitNewStringRep(objPtr, bytePtr, len) \
+    TclInitStringRep((objPtr), (bytePtr), (len))
+#define TclAttemptInitNewStringRep(objPtr, bytePtr, len) \
+    TclAttemptInitStringRep((objPtr), (bytePtr), (len))
+#endif
+
 /*
  *----------------------------------------------------------------
  * Macro used by the Tcl core to get the string representation's byte array
@@ -4507,7 +4806,8 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
     do {								\
 	Tcl_Obj *_isobjPtr = (Tcl_Obj *)(objPtr);			\
 	if (_isobjPtr->bytes != NULL) {					\
-	    if (_isobjPtr->bytes != &tclEmptyString) {			\
+	    if (_isobjPtr->bytes != &tclEmptyString			\
+		    && !TclHasInlineBytes(_isobjPtr)) {			\
 		Tcl_Free((void *)_isobjPtr->bytes);			\
 	    }								\
 	    _isobjPtr->bytes = NULL;					\
@@ -4842,7 +5142,7 @@ MODULE_SCOPE Tcl_LibraryInitProc Tcl_ABSListTest_Init;
 	TclIncrObjsAllocated();						\
 	TclAllocObjStorage(objPtr);					\
 	(objPtr)->refCount = 0;						\
-	TclInitStringRep((objPtr), (s), (len));				\
+	TclInitNewStringRep((objPtr), (s), (len));			\
 	(objPtr)->typePtr = NULL;					\
 	TCL_DTRACE_OBJ_CREATE(objPtr);					\
     } while (0)
@@ -244,6 +244,8 @@ static Tcl_Interp *	ChildCreate(Tcl_Interp *interp, Tcl_Obj *pathPtr,
 static int		ChildDebugCmd(Tcl_Interp *interp,
 			    Tcl_Interp *childInterp,
 			    Tcl_Size objc, Tcl_Obj *const objv[]);
+static int		ChildArena(Tcl_Interp *interp, Tcl_Interp *childInterp,
+			    Tcl_Size objc, Tcl_Obj *const objv[]);
 static int		ChildEval(Tcl_Interp *interp, Tcl_Interp *childInterp,
 			    Tcl_Size objc, Tcl_Obj *const objv[]);
 static int		ChildExpose(Tcl_Interp *interp,
@@ -634,10 +636,10 @@ NRInterpCmd(
 {
     Tcl_Interp *childInterp;
     static const char *const options[] = {
-	"alias",	"aliases",	"bgerror",	"cancel",
-	"children",	"create",	"debug",	"delete",
-	"eval",		"exists",	"expose",	"hide",
-	"hidden",	"issafe",	"invokehidden",
+	"alias",	"aliases",	"arena",	"bgerror",
+	"cancel",	"children",	"create",	"debug",
+	"delete",	"eval",		"exists",	"expose",
+	"hide",		"hidden",	"issafe",	"invokehidden",
 	"limit",	"marktrusted",	"recursionlimit",
 	"share",
 #ifndef TCL_NO_DEPRECATED
@@ -646,16 +648,16 @@ NRInterpCmd(
 	"target",	"transfer",	NULL
     };
     static const char *const optionsNoSlaves[] = {
-	"alias",	"aliases",	"bgerror",	"cancel",
-	"children",	"create",	"debug",	"delete",
-	"eval",		"exists",	"expose",
+	"alias",	"aliases",	"arena",	"bgerror",
+	"cancel",	"children",	"create",	"debug",
+	"delete",	"eval",		"exists",	"expose",
 	"hide",		"hidden",	"issafe",
 	"invokehidden",	"limit",	"marktrusted",	"recursionlimit",
 	"share",	"target",	"transfer",
 	NULL
     };
     enum interpOptionEnum {
-	OPT_ALIAS,	OPT_ALIASES,	OPT_BGERROR,	OPT_CANCEL,
+	OPT_ALIAS,	OPT_ALIASES,	OPT_ARENA,	OPT_BGERROR,	OPT_CANCEL,
 	OPT_CHILDREN,	OPT_CREATE,	OPT_DEBUG,	OPT_DELETE,
 	OPT_EVAL,	OPT_EXISTS,	OPT_EXPOSE,	OPT_HIDE,
 	OPT_HIDDEN,	OPT_ISSAFE,	OPT_INVOKEHID,
@@ -897,6 +899,7 @@ NRInterpCmd(
 	}
 	return TCL_OK;
     }
+    case OPT_ARENA:
     case OPT_EVAL:
 	if (objc < 4) {
 	    Tcl_WrongNumArgs(interp, 2, objv, "path arg ?arg ...?");
@@ -906,6 +909,9 @@ NRInterpCmd(
 	if (childInterp == NULL) {
 	    return TCL_ERROR;
 	}
+	if (index == OPT_ARENA) {
+	    return ChildArena(interp, childInterp, objc - 3, objv + 3);
+	}
 	return ChildEval(interp, childInterp, objc - 3, objv + 3);
     case OPT_EXISTS: {
 	int exists = 1;
@@ -2522,13 +2528,13 @@ NRChildCmd(
 {
     Tcl_Interp *childInterp = (Tcl_Interp *) clientData;
     static const char *const options[] = {
-	"alias",	"aliases",	"bgerror",	"debug",
-	"eval",		"expose",	"hide",		"hidden",
-	"issafe",	"invokehidden",	"limit",	"marktrusted",
-	"recursionlimit", NULL
+	"alias",	"aliases",	"arena",	"bgerror",
+	"debug",	"eval",		"expose",	"hide",
+	"hidden",	"issafe",	"invokehidden",	"limit",
+	"marktrusted",	"recursionlimit", NULL
     };
     enum childCmdOptionsEnum {
-	OPT_ALIAS,	OPT_ALIASES,	OPT_BGERROR,	OPT_DEBUG,
+	OPT_ALIAS,	OPT_ALIASES,	OPT_ARENA,	OPT_BGERROR,	OPT_DEBUG,
 	OPT_EVAL,	OPT_EXPOSE,	OPT_HIDE,	OPT_HIDDEN,
 	OPT_ISSAFE,	OPT_INVOKEHIDDEN, OPT_LIMIT,	OPT_MARKTRUSTED,
 	OPT_RECLIMIT
@@ -2586,6 +2592,12 @@ NRChildCmd(
 	    return TCL_ERROR;
 	}
 	return ChildDebugCmd(interp, childInterp, objc - 2, objv + 2);
+    case OPT_ARENA:
+	if (objc < 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "arg ?arg ...?");
+	    return TCL_ERROR;
+	}
+	return ChildArena(interp, childInterp, objc - 2, objv + 2);
     case OPT_EVAL:
 	if (objc < 3) {
 	    Tcl_WrongNumArgs(interp, 2, objv, "arg ?arg ...?");
@@ -2819,6 +2831,40 @@ ChildDebugCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChildArena --
+ *
+ *	Helper function to evaluate a command in a child interpreter with the
+ *	storage of the values it creates served from an arena; see
+ *	TclPushAllocArena.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Whatever the command does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ChildArena(
+    Tcl_Interp *interp,		/* Interp for error return. */
+    Tcl_Interp *childInterp,	/* The child interpreter in which command
+				 * will be evaluated. */
+    Tcl_Size objc,		/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    int result;
+
+    TclPushAllocArena();
+    result = ChildEval(interp, childInterp, objc, objv);
+    TclPopAllocArena();
+    return result;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -116,6 +116,56 @@ enum ListRepresentationFlags {
     (LISTREP_SPACE_FAVOR_FRONT | LISTREP_SPACE_FAVOR_BACK \
      | LISTREP_SPACE_ONLY_BACK)
 
+/*
+ * ListIndex --
+ *
+ * A hash index of the in-use slots of a ListStore by element string value,
+ * built by TclListObjFindString once a long list has been searched a few
+ * times. Slots holding equal strings are linked in ascending order into a
+ * circular chain through next[]; the hash table maps each distinct string to
+ * the last slot of its chain, whose successor is the first.
+ *
+ * Slots appended or prepended to the in-use area are added to the index
+ * lazily. Any other change to the store must drop the index through
+ * ListStoreDropIndex.
+ */
+
+typedef struct ListIndex {
+    Tcl_HashTable table;	/* Element string -> last slot of chain. Must
+				 * be the first field: the key procs below
+				 * find the index through the table. */
+    ListStore *storePtr;	/* Store being indexed. Updated whenever the
+				 * index is used, as the store may move. */
+    Tcl_Size newSlot;		/* Slot being added by ListIndexAddSlot. */
+    Tcl_Size firstSlot;		/* First slot covered by the index. */
+    Tcl_Size endSlot;		/* One past the last slot covered. */
+    Tcl_Size numNext;		/* Number of entries in next[]. */
+    Tcl_Size *next;		/* Next slot in each chain, indexed by slot. */
+} ListIndex;
+
+/*
+ * Lists shorter than TCL_LIST_INDEX_MIN or longer than TCL_LIST_INDEX_MAX
+ * are never indexed. Others are indexed on their TCL_LIST_INDEX_SEARCHES'th
+ * search. Defining TCL_LIST_INDEX_SEARCHES as 0 turns the index off.
+ */
+
+#ifndef TCL_LIST_INDEX_MIN
+#define TCL_LIST_INDEX_MIN 64
+#endif
+#ifndef TCL_LIST_INDEX_MAX
+#define TCL_LIST_INDEX_MAX (1 << 24)
+#endif
+#ifndef TCL_LIST_INDEX_SEARCHES
+#define TCL_LIST_INDEX_SEARCHES 4
+#endif
+
+#define ListStoreDropIndex(storePtr_) \
+    do {								\
+	if ((storePtr_)->indexPtr) {					\
+	    ListIndexFree(storePtr_);					\
+	}								\
+    } while (0)
+
 /*
  * Prototypes for non-inline static functions defined later in this file:
  */
@@ -143,6 +193,26 @@ static void	FreeListInternalRep(Tcl_Obj *listPtr);
 static int	SetListFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
 static void	UpdateStringOfList(Tcl_Obj *listPtr);
 static Tcl_Size ListLength(Tcl_Obj *listPtr);
+static void	ListIndexFree(ListStore *storePtr);
+static int	ListIndexUpdate(ListStore *storePtr);
+static Tcl_HashEntry *	ListIndexAllocEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static int	ListIndexCompareKeys(void *keyPtr, Tcl_HashEntry *hPtr);
+
+/*
+ * The hash key type of a ListIndex. Lookups are done with element Tcl_Obj's,
+ * but entries only record the slot of the first element added for their
+ * string, so the index holds no references to the elements of the list.
+ */
+
+static const Tcl_HashKeyType listIndexKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,	/* version */
+    0,				/* flags */
+    TclHashObjKey,		/* hashKeyProc */
+    ListIndexCompareKeys,	/* compareKeysProc */
+    ListIndexAllocEntry,	/* allocEntryProc */
+    NULL			/* freeEntryProc */
+};
 
 /*
  * The structure below defines the list Tcl object type by means of functions
@@ -189,7 +259,8 @@ const Tcl_ObjType tclListType = {
  * ListObjStompRep - assumes the Tcl_Obj internal representation can be
  * overwritten AND that the passed ListRep already has reference counts that
  * include the reference from the Tcl_Obj. Basically just copies the pointers
- * and sets the internal Tcl_Obj type to list
+ * and sets the internal Tcl_Obj type to list. If the store came from an
+ * arena, the arena also has to know about the Tcl_Obj, see TclArenaTrackObj.
  *
  * ListObjOverwriteRep - like ListObjOverwriteRep but additionally
  * increments reference counts on the passed ListRep. Generally used when
@@ -205,6 +276,9 @@ const Tcl_ObjType tclListType = {
 	(objPtr_)->internalRep.twoPtrValue.ptr1 = (repPtr_)->storePtr;	\
 	(objPtr_)->internalRep.twoPtrValue.ptr2 = (repPtr_)->spanPtr;	\
 	(objPtr_)->typePtr = &tclListType;				\
+	if ((repPtr_)->storePtr->flags & LISTSTORE_ARENA) {		\
+	    TclArenaTrackObj(objPtr_);					\
+	}								\
     } while (0)
 
 #define ListObjOverwriteRep(objPtr_, repPtr_) \
@@ -540,6 +614,7 @@ ListRepUnsharedShiftDown(
     LIST_COUNT_ASSERT(shiftCount);
     LIST_ASSERT(storePtr->firstUsed >= shiftCount);
 
+    ListStoreDropIndex(storePtr);
     memmove(&storePtr->slots[storePtr->firstUsed - shiftCount],
 	    &storePtr->slots[storePtr->firstUsed],
 	    storePtr->numUsed * sizeof(Tcl_Obj *));
@@ -759,9 +834,9 @@ ListStoreNew(
 	storePtr = (ListStore *)TclAttemptAllocElemsEx(
 	    objc, sizeof(Tcl_Obj *), offsetof(ListStore, slots), &capacity);
     } else {
-	/* Exact allocation */
+	/* Exact allocation, from the arena if one is open */
 	capacity = objc;
-	storePtr = (ListStore *)Tcl_AttemptAlloc(LIST_SIZE(capacity));
+	storePtr = (ListStore *)TclAttemptArenaAlloc(NULL, LIST_SIZE(capacity));
     }
     if (storePtr == NULL) {
 	if (flags & LISTREP_PANIC_ON_FAIL) {
@@ -773,7 +848,9 @@ ListStoreNew(
     }
 
     storePtr->refCount = 0;
-    storePtr->flags = 0;
+    storePtr->flags = TclIsArenaBlock(storePtr) ? LISTSTORE_ARENA : 0;
+    storePtr->numSearches = 0;
+    storePtr->indexPtr = NULL;
     storePtr->numAllocated = capacity;
     if (capacity == objc) {
 	storePtr->firstUsed = 0;
@@ -1025,6 +1102,7 @@ ListRepUnsharedFreeUnreferenced(
     LIST_COUNT_ASSERT(count);
     if (count > 0) {
 	/* T:listrep-1.5.1,6.{1:8} */
+	ListStoreDropIndex(storePtr);
 	ObjArrayDecrRefs(storePtr->slots, storePtr->firstUsed, count);
 	storePtr->firstUsed = spanPtr->spanStart;
 	LIST_ASSERT(storePtr->numUsed >= count);
@@ -1037,6 +1115,7 @@ ListRepUnsharedFreeUnreferenced(
     LIST_COUNT_ASSERT(count);
     if (count > 0) {
 	/* T:listrep-6.{1:8} */
+	ListStoreDropIndex(storePtr);
 	ObjArrayDecrRefs(
 	    storePtr->slots, spanPtr->spanStart + spanPtr->spanLength, count);
 	LIST_ASSERT(storePtr->numUsed >= count);
@@ -1462,6 +1541,7 @@ ListRepRange(
 	    && (!ListRepIsShared(srcRepPtr) && srcRepPtr->spanPtr == NULL)) {
 	/* Option 1 - Special case unshared, exclude end elements, no span */
 	LIST_ASSERT(srcRepPtr->storePtr->firstUsed == 0); /* If no span */
+	ListStoreDropIndex(srcRepPtr->storePtr);
 	ListRepElements(srcRepPtr, numSrcElems, srcElems);
 	numAfterRangeEnd = numSrcElems - (rangeEnd + 1);
 	/* Assert: Because numSrcElems > rangeEnd earlier */
@@ -1471,7 +1551,7 @@ ListRepRange(
 	}
 	/* srcRepPtr->storePtr->firstUsed,numAllocated unchanged */
 	srcRepPtr->storePtr->numUsed = rangeLen;
-	srcRepPtr->storePtr->flags = 0;
+	srcRepPtr->storePtr->flags &= ~LISTSTORE_CANONICAL;
 	rangeRepPtr->storePtr = srcRepPtr->storePtr; /* Note no incr ref */
 	rangeRepPtr->spanPtr = NULL;
     } else if (ListSpanMerited(rangeLen, srcRepPtr->storePtr->numUsed,
@@ -1525,6 +1605,7 @@ ListRepRange(
 	LIST_ASSERT(ListRepLength(srcRepPtr) == srcRepPtr->storePtr->numUsed);
 
 	ListRepElements(srcRepPtr, numSrcElems, srcElems);
+	ListStoreDropIndex(srcRepPtr->storePtr);
 
 	/* Free leading elements outside range */
 	if (rangeStart != 0) {
@@ -1544,7 +1625,7 @@ ListRepRange(
 		rangeLen * sizeof(Tcl_Obj *));
 	srcRepPtr->storePtr->firstUsed = 0;
 	srcRepPtr->storePtr->numUsed = rangeLen;
-	srcRepPtr->storePtr->flags = 0;
+	srcRepPtr->storePtr->flags &= ~LISTSTORE_CANONICAL;
 	if (srcRepPtr->spanPtr) {
 	    /* In case the source has a span, update it for consistency */
 	    /* T:listrep-3.{15,17} */
@@ -2485,6 +2566,8 @@ Tcl_ListObjReplace(
 	}
     }
 
+    ListStoreDropIndex(listRep.storePtr);
+
     /* Careful about order of moves! */
     if (leadShift > 0) {
 	/* Will happen when we have to make room at bottom */
@@ -2526,7 +2609,7 @@ Tcl_ListObjReplace(
 
     listRep.storePtr->firstUsed += leadShift;
     listRep.storePtr->numUsed = origListLen + lenChange;
-    listRep.storePtr->flags = 0;
+    listRep.storePtr->flags &= ~LISTSTORE_CANONICAL;
 
     if (listRep.spanPtr && listRep.spanPtr->refCount <= 1) {
 	/* An unshared span record, re-use it, even if not required */
@@ -3085,6 +3168,13 @@ TclLsetFlat(
 		 */
 		ListRep objInternalRep;
 		TclListObjGetRep(NULL, objPtr, &objInternalRep);
+
+		/*
+		 * An element of this list was modified in place, so any index
+		 * of its store is stale.
+		 */
+
+		ListStoreDropIndex(objInternalRep.storePtr);
 		ListObjReplaceRepAndInvalidate(objPtr, &objInternalRep);
 	    }
 	}
@@ -3212,6 +3302,7 @@ TclListObjSetElement(
      * Add a reference to the new list element and remove from old before
      * replacing it. Order is important!
      */
+    ListStoreDropIndex(listRep.storePtr);
     Tcl_IncrRefCount(valueObj);
     Tcl_DecrRefCount(elemPtrs[index]);
     elemPtrs[index] = valueObj;
@@ -3247,6 +3338,7 @@ FreeListInternalRep(
 
     ListObjGetRep(listObj, &listRep);
     if (listRep.storePtr->refCount-- <= 1) {
+	ListStoreDropIndex(listRep.storePtr);
 	ObjArrayDecrRefs(
 	    listRep.storePtr->slots,
 	    listRep.storePtr->firstUsed, listRep.storePtr->numUsed);
@@ -3460,9 +3552,7 @@ SetListFromAny(
      */
     ListRepIncrRefs(&listRep);
     TclFreeInternalRep(objPtr);
-    objPtr->internalRep.twoPtrValue.ptr1 = listRep.storePtr;
-    objPtr->internalRep.twoPtrValue.ptr2 = listRep.spanPtr;
-    objPtr->typePtr = &tclListType;
+    ListObjStompRep(objPtr, &listRep);
 
     return TCL_OK;
 }
@@ -3575,6 +3665,390 @@ UpdateStringOfList(
     }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TclPromoteArenaLists --
+ *
+ *    Copies the list stores that the given values took from an arena being
+ *    closed out of it (see TclPromoteArenaValues). A store shared by
+ *    several of the values is copied once. Values not given know nothing
+ *    about the copy, so if some other value refers to the store as well,
+ *    that one keeps the original.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The internal reps of list values in objv are changed to the copies,
+ *    and the originals are freed unless still referenced.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+TclPromoteArenaLists(
+    Tcl_Obj **objv,		/* Live values, possibly repeated. */
+    size_t objc)
+{
+    Tcl_HashTable copies;	/* Store in the arena -> its copy. */
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    ListStore *storePtr, *copyPtr;
+    size_t i;
+    int isNew;
+
+    Tcl_InitHashTable(&copies, TCL_ONE_WORD_KEYS);
+    for (i = 0; i < objc; i++) {
+	Tcl_Obj *objPtr = objv[i];
+
+	if (objPtr->typePtr != &tclListType) {
+	    continue;
+	}
+	storePtr = (ListStore *)objPtr->internalRep.twoPtrValue.ptr1;
+	if (!TclArenaOwns(storePtr)) {
+	    continue;
+	}
+	hPtr = Tcl_CreateHashEntry(&copies, storePtr, &isNew);
+	if (isNew) {
+	    copyPtr = (ListStore *)Tcl_AttemptAlloc(
+		    LIST_SIZE(storePtr->numAllocated));
+	    if (copyPtr == NULL) {
+		Tcl_DeleteHashEntry(hPtr);
+		continue;
+	    }
+	    memcpy(copyPtr, storePtr, LIST_SIZE(storePtr->numAllocated));
+	    copyPtr->refCount = 0;
+	    copyPtr->flags &= ~LISTSTORE_ARENA;
+	    copyPtr->numSearches = 0;
+	    copyPtr->indexPtr = NULL;
+	    Tcl_SetHashValue(hPtr, copyPtr);
+	} else {
+	    copyPtr = (ListStore *)Tcl_GetHashValue(hPtr);
+	}
+	objPtr->internalRep.twoPtrValue.ptr1 = copyPtr;
+	copyPtr->refCount++;
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(&copies, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	storePtr = (ListStore *)Tcl_GetHashKey(&copies, hPtr);
+	copyPtr = (ListStore *)Tcl_GetHashValue(hPtr);
+	if (storePtr->refCount == copyPtr->refCount) {
+	    /* All references moved, and the element references with them */
+	    ListStoreDropIndex(storePtr);
+	    Tcl_Free(storePtr);
+	} else {
+	    storePtr->refCount -= copyPtr->refCount;
+	    ObjArrayIncrRefs(copyPtr->slots, copyPtr->firstUsed,
+		    copyPtr->numUsed);
+	}
+    }
+    Tcl_DeleteHashTable(&copies);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * ListIndexFree --
+ *
+ *    Discards the hash index of a ListStore.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The index memory is freed and the search count of the store reset.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+ListIndexFree(
+    ListStore *storePtr)
+{
+    ListIndex *indexPtr = storePtr->indexPtr;
+
+    Tcl_DeleteHashTable(&indexPtr->table);
+    Tcl_Free(indexPtr->next);
+    Tcl_Free(indexPtr);
+    storePtr->indexPtr = NULL;
+    storePtr->numSearches = 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * ListIndexAllocEntry, ListIndexCompareKeys --
+ *
+ *    Key procedures of listIndexKeyType. An entry is created for the slot
+ *    being added to the index, and compared through the element currently
+ *    held in that slot.
+ *
+ * Results:
+ *    The new entry, or whether keyPtr has the same string as the entry.
+ *
+ * Side effects:
+ *    None; in particular no reference is taken on the key.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_HashEntry *
+ListIndexAllocEntry(
+    Tcl_HashTable *tablePtr,
+    TCL_UNUSED(void *))
+{
+    ListIndex *indexPtr = (ListIndex *)tablePtr;
+    Tcl_HashEntry *hPtr = (Tcl_HashEntry *)Tcl_AttemptAlloc(sizeof(Tcl_HashEntry));
+
+    if (hPtr) {
+	hPtr->key.oneWordValue = (char *)INT2PTR(indexPtr->newSlot);
+	hPtr->clientData = NULL;
+    }
+    return hPtr;
+}
+
+static int
+ListIndexCompareKeys(
+    void *keyPtr,
+    Tcl_HashEntry *hPtr)
+{
+    ListIndex *indexPtr = (ListIndex *)hPtr->tablePtr;
+    Tcl_Obj *keyObj = (Tcl_Obj *)keyPtr;
+    Tcl_Obj *slotObj =
+	    indexPtr->storePtr->slots[PTR2INT(hPtr->key.oneWordValue)];
+    const char *p1, *p2;
+    Tcl_Size l1, l2;
+
+    if (keyObj == slotObj) {
+	return 1;
+    }
+    p1 = TclGetStringFromObj(keyObj, &l1);
+    p2 = TclGetStringFromObj(slotObj, &l2);
+    return (l1 == l2) && (memcmp(p1, p2, l1) == 0);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * ListIndexAddSlot --
+ *
+ *    Links a slot into the chain for its string value, either at the head
+ *    (for slots prepended to the in-use area) or at the tail (for slots
+ *    appended to it).
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The index is updated.
+ *
+ *------------------------------------------------------------------------
+ */
+static inline void
+ListIndexAddSlot(
+    ListIndex *indexPtr,
+    Tcl_Obj *elemObj,
+    Tcl_Size slot,
+    int atHead)
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_Size tail;
+    int isNew;
+
+    indexPtr->newSlot = slot;
+    hPtr = Tcl_CreateHashEntry(&indexPtr->table, elemObj, &isNew);
+    if (isNew) {
+	indexPtr->next[slot] = slot;
+	Tcl_SetHashValue(hPtr, INT2PTR(slot));
+	return;
+    }
+    tail = PTR2INT(Tcl_GetHashValue(hPtr));
+    indexPtr->next[slot] = indexPtr->next[tail];
+    indexPtr->next[tail] = slot;
+    if (!atHead) {
+	Tcl_SetHashValue(hPtr, INT2PTR(slot));
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * ListIndexUpdate --
+ *
+ *    Builds the hash index of a ListStore, or extends an existing one to
+ *    cover slots added at either end of the in-use area since it was last
+ *    brought up to date.
+ *
+ * Results:
+ *    1 if the index covers exactly the in-use area, 0 if it could not be
+ *    made to (in which case it has been dropped).
+ *
+ * Side effects:
+ *    Generates string representations of the elements being indexed.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+ListIndexUpdate(
+    ListStore *storePtr)
+{
+    ListIndex *indexPtr = storePtr->indexPtr;
+    Tcl_Size first = storePtr->firstUsed;
+    Tcl_Size end = first + storePtr->numUsed;
+    Tcl_Size slot;
+
+    if (indexPtr == NULL) {
+	indexPtr = (ListIndex *)Tcl_AttemptAlloc(sizeof(ListIndex));
+	if (indexPtr == NULL) {
+	    return 0;
+	}
+	indexPtr->next = (Tcl_Size *)Tcl_AttemptAlloc(
+		storePtr->numAllocated * sizeof(Tcl_Size));
+	if (indexPtr->next == NULL) {
+	    Tcl_Free(indexPtr);
+	    return 0;
+	}
+	indexPtr->numNext = storePtr->numAllocated;
+	Tcl_InitCustomHashTable(&indexPtr->table, TCL_CUSTOM_PTR_KEYS,
+		&listIndexKeyType);
+	indexPtr->firstSlot = indexPtr->endSlot = first;
+	storePtr->indexPtr = indexPtr;
+    }
+    indexPtr->storePtr = storePtr;
+
+    if (first == indexPtr->firstSlot && end == indexPtr->endSlot) {
+	return 1;
+    }
+    if (first > indexPtr->firstSlot || end < indexPtr->endSlot) {
+	/*
+	 * Something was removed without dropping the index. Should not
+	 * happen, but rebuilding later is always safe.
+	 */
+
+	ListIndexFree(storePtr);
+	return 0;
+    }
+    if (indexPtr->numNext < storePtr->numAllocated) {
+	Tcl_Size *next = (Tcl_Size *)Tcl_AttemptRealloc(indexPtr->next,
+		storePtr->numAllocated * sizeof(Tcl_Size));
+
+	if (next == NULL) {
+	    ListIndexFree(storePtr);
+	    return 0;
+	}
+	indexPtr->next = next;
+	indexPtr->numNext = storePtr->numAllocated;
+    }
+    for (slot = indexPtr->firstSlot - 1; slot >= first; slot--) {
+	ListIndexAddSlot(indexPtr, storePtr->slots[slot], slot, 1);
+    }
+    for (slot = indexPtr->endSlot; slot < end; slot++) {
+	ListIndexAddSlot(indexPtr, storePtr->slots[slot], slot, 0);
+    }
+    indexPtr->firstSlot = first;
+    indexPtr->endSlot = end;
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TclListObjFindString --
+ *
+ *    Looks for the first element of a list, at or after position start,
+ *    whose string is equal to that of valueObj. Long lists that are
+ *    searched repeatedly get a hash index attached to their ListStore so
+ *    this takes constant time; for other lists the caller is left to do a
+ *    linear search.
+ *
+ *    If the element just before start is itself equal to valueObj (as when
+ *    collecting all matches), the search continues directly from it.
+ *
+ * Results:
+ *    1 if the search was done, with *indexPtr set to the position found or
+ *    to -1 if there is none. 0 if the caller should search linearly, with
+ *    *indexPtr set to -1.
+ *
+ * Side effects:
+ *    May build or extend the index, generating string representations for
+ *    all elements of the list.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+TclListObjFindString(
+    Tcl_Obj *listObj,		/* List to search. */
+    Tcl_Obj *valueObj,		/* Value to look for. */
+    Tcl_Size start,		/* Position to start the search at. */
+    Tcl_Size *indexPtr)		/* Where to store the position found. */
+{
+    ListRep listRep;
+    ListStore *storePtr;
+    ListIndex *listIndexPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_Size listStart, length, slot, tail;
+
+    *indexPtr = TCL_INDEX_NONE;
+    if (!TclHasInternalRep(listObj, &tclListType)) {
+	return 0;
+    }
+    ListObjGetRep(listObj, &listRep);
+    storePtr = listRep.storePtr;
+    length = ListRepLength(&listRep);
+    if (TCL_LIST_INDEX_SEARCHES <= 0 || length < TCL_LIST_INDEX_MIN) {
+	return 0;
+    }
+    if (storePtr->numUsed > TCL_LIST_INDEX_MAX) {
+	ListStoreDropIndex(storePtr);
+	return 0;
+    }
+    if (storePtr->indexPtr == NULL
+	    && ++storePtr->numSearches < TCL_LIST_INDEX_SEARCHES) {
+	return 0;
+    }
+    if (!ListIndexUpdate(storePtr)) {
+	return 0;
+    }
+    listIndexPtr = storePtr->indexPtr;
+
+    if (start < 0) {
+	start = 0;
+    }
+    if (start >= length) {
+	return 1;
+    }
+    hPtr = Tcl_FindHashEntry(&listIndexPtr->table, valueObj);
+    if (hPtr == NULL) {
+	return 1;
+    }
+    tail = PTR2INT(Tcl_GetHashValue(hPtr));
+    listStart = ListRepStart(&listRep);
+
+    slot = listStart + start - 1;
+    if (start > 0 && Tcl_FindHashEntry(&listIndexPtr->table,
+	    storePtr->slots[slot]) == hPtr) {
+	/*
+	 * Continue from the previous match.
+	 */
+
+	if (slot == tail) {
+	    return 1;
+	}
+	slot = listIndexPtr->next[slot];
+    } else {
+	slot = listIndexPtr->next[tail];
+	while (slot < listStart + start) {
+	    if (slot == tail) {
+		return 1;
+	    }
+	    slot = listIndexPtr->next[slot];
+	}
+    }
+    if (slot < listStart + length) {
+	*indexPtr = slot - listStart;
+    }
+    return 1;
+}
+
 /*
  *------------------------------------------------------------------------
  *
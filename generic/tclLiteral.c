@@ -31,12 +31,52 @@
 static size_t		AddLocalLiteralEntry(CompileEnv *envPtr,
 			    Tcl_Obj *objPtr, size_t localHash);
 static void		ExpandLocalLiteralArray(CompileEnv *envPtr);
-static size_t		HashString(const char *string, Tcl_Size length);
 #ifdef TCL_COMPILE_DEBUG
 static LiteralEntry *	LookupLiteralEntry(Tcl_Interp *interp,
 			    Tcl_Obj *objPtr);
 #endif
 static void		RebuildLiteralTable(LiteralTable *tablePtr);
+static Tcl_HashEntry *	AllocInternEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static void		DupInternInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
+static void		FinalizeInternTable(void *clientData);
+static void		FreeInternInternalRep(Tcl_Obj *objPtr);
+static Tcl_HashTable *	GetInternTable(void);
+
+/*
+ * Values interned with Tcl_InternObj are kept in a per-thread table keyed on
+ * their strings, so that equal strings share one Tcl_Obj. The table holds no
+ * reference: an interned value leaves it when it is freed or takes on
+ * another internal rep. The "interned" internal rep points at the value's
+ * hash entry, which also gives TclHashObjKey its cached hash.
+ */
+
+static const Tcl_HashKeyType internHashKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,	/* version */
+    TCL_HASH_KEY_DIRECT_COMPARE,/* allows compare keys by pointers */
+    TclHashObjKey,		/* hashKeyProc */
+    TclCompareObjKeys,		/* compareKeysProc */
+    AllocInternEntry,		/* allocEntryProc */
+    NULL			/* freeEntryProc */
+};
+
+const Tcl_ObjType tclInternType = {
+    "interned",			/* name */
+    FreeInternInternalRep,	/* freeIntRepProc */
+    DupInternInternalRep,	/* dupIntRepProc */
+    NULL,			/* updateStringProc */
+    NULL,			/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+typedef struct {
+    Tcl_HashTable *internTablePtr;
+				/* Table of interned values, created on first
+				 * use. Keys are the values themselves. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
 
 /*
  *----------------------------------------------------------------------
@@ -195,7 +235,7 @@ TclCreateLiteral(
      */
 
     if (hash == (size_t) TCL_INDEX_NONE) {
-	hash = HashString(bytes, length);
+	hash = TclHashBytes(bytes, length);
     }
     globalHash = (hash & globalTablePtr->mask);
     for (globalPtr=globalTablePtr->buckets[globalHash] ; globalPtr!=NULL;
@@ -250,7 +290,7 @@ TclCreateLiteral(
     if ((flags & LITERAL_ON_HEAP)) {
 	objPtr->bytes = (char *) bytes;
 	objPtr->length = length;
-    } else if (!TclAttemptInitStringRep(objPtr, bytes, length)) {
+    } else if (!TclAttemptInitNewStringRep(objPtr, bytes, length)) {
 	Tcl_DecrRefCount(objPtr);
 	return NULL;
     }
@@ -415,7 +455,7 @@ TclRegisterLiteral(
     if (length < 0) {
 	length = (bytes ? strlen(bytes) : 0);
     }
-    hash = HashString(bytes, length);
+    hash = TclHashBytes(bytes, length);
 
     /*
      * Is the literal already in the CompileEnv's local literal array? If so,
@@ -518,7 +558,7 @@ LookupLiteralEntry(
     Tcl_Size globalHash, length;
 
     bytes = TclGetStringFromObj(objPtr, &length);
-    globalHash = (HashString(bytes, length) & globalTablePtr->mask);
+    globalHash = (TclHashBytes(bytes, length) & globalTablePtr->mask);
     for (entryPtr=globalTablePtr->buckets[globalHash] ; entryPtr!=NULL;
 	    entryPtr=entryPtr->nextPtr) {
 	if (entryPtr->objPtr == objPtr) {
@@ -580,7 +620,7 @@ TclHideLiteral(
     lPtr->objPtr = newObjPtr;
 
     bytes = TclGetStringFromObj(newObjPtr, &length);
-    localHash = HashString(bytes, length) & localTablePtr->mask;
+    localHash = TclHashBytes(bytes, length) & localTablePtr->mask;
     nextPtrPtr = &localTablePtr->buckets[localHash];
 
     for (entryPtr=*nextPtrPtr ; entryPtr!=NULL ; entryPtr=*nextPtrPtr) {
@@ -890,7 +930,7 @@ TclReleaseLiteral(
 
     globalTablePtr = &iPtr->literalTable;
     bytes = TclGetStringFromObj(objPtr, &length);
-    index = HashString(bytes, length) & globalTablePtr->mask;
+    index = TclHashBytes(bytes, length) & globalTablePtr->mask;
 
     /*
      * Check to see if the object is in the global literal table and remove
@@ -934,69 +974,6 @@ TclReleaseLiteral(
     Tcl_DecrRefCount(objPtr);
 }
 
-/*
- *----------------------------------------------------------------------
- *
- * HashString --
- *
- *	Compute a one-word summary of a text string, which can be used to
- *	generate a hash index.
- *
- * Results:
- *	The return value is a one-word summary of the information in string.
- *
- * Side effects:
- *	None.
- *
- *----------------------------------------------------------------------
- */
-
-static size_t
-HashString(
-    const char *string,		/* String for which to compute hash value. */
-    Tcl_Size length)		/* Number of bytes in the string. */
-{
-    size_t result = 0;
-
-    /*
-     * I tried a zillion different hash functions and asked many other people
-     * for advice. Many people had their own favorite functions, all
-     * different, but no-one had much idea why they were good ones. I chose
-     * the one below (multiply by 9 and add new character) because of the
-     * following reasons:
-     *
-     * 1. Multiplying by 10 is perfect for keys that are decimal strings, and
-     *    multiplying by 9 is just about as good.
-     * 2. Times-9 is (shift-left-3) plus (old). This means that each
-     *    character's bits hang around in the low-order bits of the hash value
-     *    for ever, plus they spread fairly rapidly up to the high-order bits
-     *    to fill out the hash value. This seems works well both for decimal
-     *    and non-decimal strings.
-     *
-     * Note that this function is very weak against malicious strings; it's
-     * very easy to generate multiple keys that have the same hashcode. On the
-     * other hand, that hardly ever actually occurs and this function *is*
-     * very cheap, even by comparison with industry-standard hashes like FNV.
-     * If real strength of hash is required though, use a custom hash based on
-     * Bob Jenkins's lookup3(), but be aware that it's significantly slower.
-     * Tcl scripts tend to not have a big issue in this area, and literals
-     * mostly aren't looked up by name anyway.
-     *
-     * See also HashStringKey in tclHash.c.
-     * See also TclObjHashKey in tclObj.c.
-     *
-     * See [tcl-Feature Request #2958832]
-     */
-
-    if (length > 0) {
-	result = UCHAR(*string);
-	while (--length) {
-	    result += (result << 3) + UCHAR(*++string);
-	}
-    }
-    return result;
-}
-
 /*
  *----------------------------------------------------------------------
  *
@@ -1062,7 +1039,7 @@ RebuildLiteralTable(
     for (oldChainPtr=oldBuckets ; oldSize>0 ; oldSize--,oldChainPtr++) {
 	for (entryPtr=*oldChainPtr ; entryPtr!=NULL ; entryPtr=*oldChainPtr) {
 	    bytes = TclGetStringFromObj(entryPtr->objPtr, &length);
-	    index = (HashString(bytes, length) & tablePtr->mask);
+	    index = (TclHashBytes(bytes, length) & tablePtr->mask);
 
 	    *oldChainPtr = entryPtr->nextPtr;
 	    bucketPtr = &tablePtr->buckets[index];
@@ -1125,6 +1102,222 @@ TclInvalidateCmdLiteral(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_InternObj, Tcl_InternString --
+ *
+ *	Return the interned value with the same string as objPtr, or as the
+ *	length bytes at bytes, interning it first if needed. Equal strings
+ *	interned in the same thread give the same Tcl_Obj. If length is
+ *	TCL_INDEX_NONE, bytes up to the first NUL byte are used.
+ *
+ * Results:
+ *	The interned value. Its reference count is not changed, so a value
+ *	created here has a reference count of zero.
+ *
+ * Side effects:
+ *	A pure string objPtr becomes the interned value itself. Otherwise a
+ *	new pure string value is interned, leaving objPtr's internal rep
+ *	alone.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+Tcl_InternObj(
+    Tcl_Obj *objPtr)		/* Value to intern. */
+{
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (TclHasInternalRep(objPtr, &tclInternType)) {
+	return objPtr;
+    }
+    hPtr = Tcl_CreateHashEntry(GetInternTable(), objPtr, &isNew);
+    if (!isNew) {
+	return hPtr->key.objPtr;
+    }
+    if (objPtr->typePtr != NULL) {
+	Tcl_Obj *internPtr;
+
+	/*
+	 * Hashing the key above generated the string rep.
+	 */
+
+	TclNewStringObj(internPtr, objPtr->bytes, objPtr->length);
+	hPtr->key.objPtr = objPtr = internPtr;
+    }
+    objPtr->internalRep.twoPtrValue.ptr1 = hPtr;
+    objPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    objPtr->typePtr = &tclInternType;
+    return objPtr;
+}
+
+Tcl_Obj *
+Tcl_InternString(
+    const char *bytes,		/* Points to the first of the length bytes
+				 * of the string to intern. */
+    Tcl_Size length)		/* Number of bytes, or TCL_INDEX_NONE to use
+				 * bytes up to the first NUL byte. */
+{
+    Tcl_Obj key, *objPtr;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (length < 0) {
+	length = (bytes ? strlen(bytes) : 0);
+    }
+
+    /*
+     * Look up with a key on the stack so that no value is created when the
+     * string is already interned.
+     */
+
+    key.refCount = 1;
+    key.bytes = (char *)(bytes ? bytes : "");
+    key.length = length;
+    key.typePtr = NULL;
+    hPtr = Tcl_CreateHashEntry(GetInternTable(), &key, &isNew);
+    if (!isNew) {
+	return hPtr->key.objPtr;
+    }
+    TclNewStringObj(objPtr, key.bytes, length);
+    hPtr->key.objPtr = objPtr;
+    objPtr->internalRep.twoPtrValue.ptr1 = hPtr;
+    objPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    objPtr->typePtr = &tclInternType;
+    return objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetInternTable --
+ *
+ *	Return this thread's table of interned values.
+ *
+ * Results:
+ *	The table.
+ *
+ * Side effects:
+ *	Creates the table and registers its cleanup on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashTable *
+GetInternTable(void)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (tsdPtr->internTablePtr == NULL) {
+	tsdPtr->internTablePtr = (Tcl_HashTable *)
+		Tcl_Alloc(sizeof(Tcl_HashTable));
+	Tcl_InitCustomHashTable(tsdPtr->internTablePtr, TCL_CUSTOM_PTR_KEYS,
+		&internHashKeyType);
+	Tcl_CreateThreadExitHandler(FinalizeInternTable, NULL);
+    }
+    return tsdPtr->internTablePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FinalizeInternTable --
+ *
+ *	Thread exit handler that deletes the table of interned values. Values
+ *	still alive become pure strings.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FinalizeInternTable(
+    TCL_UNUSED(void *))
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    Tcl_HashTable *tablePtr = tsdPtr->internTablePtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	hPtr->key.objPtr->typePtr = NULL;
+    }
+    Tcl_DeleteHashTable(tablePtr);
+    Tcl_Free(tablePtr);
+    tsdPtr->internTablePtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocInternEntry --
+ *
+ *	Allocate a hash entry for an interned value. Unlike the entries of
+ *	tables with Tcl_Obj keys, it holds no reference to the key.
+ *
+ * Results:
+ *	The new entry.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+AllocInternEntry(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)		/* Key to store in the hash table entry. */
+{
+    Tcl_HashEntry *hPtr = (Tcl_HashEntry *)Tcl_Alloc(sizeof(Tcl_HashEntry));
+
+    hPtr->key.objPtr = (Tcl_Obj *)keyPtr;
+    hPtr->clientData = NULL;
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeInternInternalRep, DupInternInternalRep --
+ *
+ *	Internal rep procedures of interned values. Freeing the rep drops the
+ *	value from the intern table; a copy is a plain string that is not
+ *	interned.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	See above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeInternInternalRep(
+    Tcl_Obj *objPtr)
+{
+    Tcl_DeleteHashEntry((Tcl_HashEntry *)objPtr->internalRep.twoPtrValue.ptr1);
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupInternInternalRep(
+    TCL_UNUSED(Tcl_Obj *) /*srcPtr*/,
+    TCL_UNUSED(Tcl_Obj *) /*copyPtr*/)
+{
+}
+
 #ifdef TCL_COMPILE_STATS
 /*
  *----------------------------------------------------------------------
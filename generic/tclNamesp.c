@@ -895,7 +895,8 @@ Tcl_CreateNamespace(
     nsPtr->flags = 0;
     nsPtr->activationCount = 0;
     nsPtr->refCount = 0;
-    Tcl_InitHashTable(&nsPtr->cmdTable, TCL_STRING_KEYS);
+    Tcl_InitCustomHashTable(&nsPtr->cmdTable, TCL_CUSTOM_TYPE_KEYS,
+	    &tclIncrementalStringHashKeyType);
     TclInitVarHashTable(&nsPtr->varTable, nsPtr);
     nsPtr->exportArrayPtr = NULL;
     nsPtr->numExportPatterns = 0;
@@ -1300,7 +1301,8 @@ TclTeardownNamespace(
 	TclStackFree(interp, cmds);
     }
     Tcl_DeleteHashTable(&nsPtr->cmdTable);
-    Tcl_InitHashTable(&nsPtr->cmdTable, TCL_STRING_KEYS);
+    Tcl_InitCustomHashTable(&nsPtr->cmdTable, TCL_CUSTOM_TYPE_KEYS,
+	    &tclIncrementalStringHashKeyType);
 
     /*
      * Remove the namespace from its parent's child hashtable.
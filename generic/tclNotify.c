@@ -995,6 +995,17 @@ Tcl_DoOneEvent(
 	    timePtr = NULL;
 	}
 
+#if TCL_THREADS && defined(USE_THREAD_ALLOC)
+	/*
+	 * A thread about to wait is a good one to give memory freed since
+	 * the last such occasion back to the system.
+	 */
+
+	if (!(flags & TCL_DONT_WAIT)) {
+	    TclThreadAllocIdle();
+	}
+#endif
+
 	/*
 	 * Wait for a new event or a timeout. If Tcl_WaitForEvent returns -1,
 	 * we should abort Tcl_DoOneEvent.
@@ -15,17 +15,16 @@
  */
 
 #include "tclInt.h"
+#include "tclStringRep.h"
 #include "tclTomMath.h"
 #include <math.h>
 #include <assert.h>
 
 /*
- * Table of all object types.
+ * Table of all object types. Tcl_GetObjType reads it without locking.
  */
 
-static Tcl_HashTable typeTable;
-static int typeTableInitialized = 0;	/* 0 means not yet initialized. */
-TCL_DECLARE_MUTEX(tableMutex)
+static TclSharedHashTable typeTable;
 
 /*
  * Head of the list of free Tcl_Obj structs we maintain.
@@ -192,6 +191,7 @@ static Tcl_ThreadDataKey pendingObjDataKey;
  * Prototypes for functions defined later in this file:
  */
 
+static TclSharedHashProc	AppendObjTypeName;
 static int		ParseBoolean(Tcl_Obj *objPtr);
 static int		SetDoubleFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
 static int		SetIntFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
@@ -371,10 +371,7 @@ typedef struct ResolvedCmdName {
 void
 TclInitObjSubsystem(void)
 {
-    Tcl_MutexLock(&tableMutex);
-    typeTableInitialized = 1;
-    Tcl_InitHashTable(&typeTable, TCL_STRING_KEYS);
-    Tcl_MutexUnlock(&tableMutex);
+    TclInitSharedHashTable(&typeTable, TCL_STRING_KEYS);
 
     Tcl_RegisterObjType(&tclByteCodeType);
     Tcl_RegisterObjType(&tclCmdNameType);
@@ -463,12 +460,7 @@ TclFinalizeThreadObjects(void)
 void
 TclFinalizeObjects(void)
 {
-    Tcl_MutexLock(&tableMutex);
-    if (typeTableInitialized) {
-	Tcl_DeleteHashTable(&typeTable);
-	typeTableInitialized = 0;
-    }
-    Tcl_MutexUnlock(&tableMutex);
+    TclDeleteSharedHashTable(&typeTable);
 
     /*
      * All we do here is reset the head pointer of the linked list of free
@@ -811,10 +803,7 @@ Tcl_RegisterObjType(
 				 * be statically allocated (must live
 				 * forever). */
 {
-    Tcl_MutexLock(&tableMutex);
-    Tcl_SetHashValue(
-	    Tcl_CreateHashEntry(&typeTable, typePtr->name, NULL), typePtr);
-    Tcl_MutexUnlock(&tableMutex);
+    TclSharedHashSet(&typeTable, typePtr->name, (void *) typePtr);
 }
 
 /*
@@ -848,8 +837,6 @@ Tcl_AppendAllObjTypes(
 				 * name of each registered type is appended as
 				 * a list element. */
 {
-    Tcl_HashEntry *hPtr;
-    Tcl_HashSearch search;
     Tcl_Size numElems;
 
     /*
@@ -865,15 +852,35 @@ Tcl_AppendAllObjTypes(
      * that.
      */
 
-    Tcl_MutexLock(&tableMutex);
-    for (hPtr = Tcl_FirstHashEntry(&typeTable, &search);
-	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
-	Tcl_ListObjAppendElement(NULL, objPtr,
-		Tcl_NewStringObj((char *)Tcl_GetHashKey(&typeTable, hPtr), -1));
-    }
-    Tcl_MutexUnlock(&tableMutex);
+    TclSharedHashForeach(&typeTable, AppendObjTypeName, objPtr);
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendObjTypeName --
+ *
+ *	Callback for Tcl_AppendAllObjTypes, called for each registered type.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Appends the type name to the list in clientData.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendObjTypeName(
+    void *clientData,		/* List to append to. */
+    const void *key,		/* Name of the type. */
+    TCL_UNUSED(void *))
+{
+    Tcl_ListObjAppendElement(NULL, (Tcl_Obj *) clientData,
+	    Tcl_NewStringObj((const char *) key, -1));
+}
 
 /*
  *----------------------------------------------------------------------
@@ -896,16 +903,7 @@ const Tcl_ObjType *
 Tcl_GetObjType(
     const char *typeName)	/* Name of Tcl object type to look up. */
 {
-    Tcl_HashEntry *hPtr;
-    const Tcl_ObjType *typePtr = NULL;
-
-    Tcl_MutexLock(&tableMutex);
-    hPtr = Tcl_FindHashEntry(&typeTable, typeName);
-    if (hPtr != NULL) {
-	typePtr = (const Tcl_ObjType *)Tcl_GetHashValue(hPtr);
-    }
-    Tcl_MutexUnlock(&tableMutex);
-    return typePtr;
+    return (const Tcl_ObjType *) TclSharedHashGet(&typeTable, typeName);
 }
 
 /*
@@ -1214,7 +1212,7 @@ Tcl_DbNewObj(
 void
 TclAllocateFreeObjects(void)
 {
-    size_t bytesToAlloc = (OBJS_TO_ALLOC_EACH_TIME * sizeof(Tcl_Obj));
+    size_t bytesToAlloc = (OBJS_TO_ALLOC_EACH_TIME * TCL_OBJ_SIZE);
     char *basePtr;
     Tcl_Obj *prevPtr, *objPtr;
     int i;
@@ -1235,7 +1233,7 @@ TclAllocateFreeObjects(void)
     for (i = 0; i < OBJS_TO_ALLOC_EACH_TIME; i++) {
 	objPtr->internalRep.twoPtrValue.ptr1 = prevPtr;
 	prevPtr = objPtr;
-	objPtr++;
+	objPtr = (Tcl_Obj *)((char *)objPtr + TCL_OBJ_SIZE);
     }
     tclFreeObjList = prevPtr;
 }
@@ -1536,12 +1534,12 @@ TclObjBeingDeleted(
  *----------------------------------------------------------------------
  */
 
-#define SetDuplicateObj(dupPtr, objPtr)					\
+#define SetDuplicateObj(dupPtr, objPtr, InitStringRep)			\
     {									\
 	const Tcl_ObjType *typePtr = (objPtr)->typePtr;			\
 	const char *bytes = (objPtr)->bytes;				\
 	if (bytes) {							\
-	    TclInitStringRep((dupPtr), bytes, (objPtr)->length);	\
+	    InitStringRep((dupPtr), bytes, (objPtr)->length);		\
 	} else {							\
 	    (dupPtr)->bytes = NULL;					\
 	}								\
@@ -1562,7 +1560,7 @@ Tcl_DuplicateObj(
     Tcl_Obj *dupPtr;
 
     TclNewObj(dupPtr);
-    SetDuplicateObj(dupPtr, objPtr);
+    SetDuplicateObj(dupPtr, objPtr, TclInitNewStringRep);
     return dupPtr;
 }
 
@@ -1576,7 +1574,7 @@ TclSetDuplicateObj(
     }
     TclInvalidateStringRep(dupPtr);
     TclFreeInternalRep(dupPtr);
-    SetDuplicateObj(dupPtr, objPtr);
+    SetDuplicateObj(dupPtr, objPtr, TclInitStringRep);
 }
 
 /*
@@ -1746,7 +1744,7 @@ Tcl_InitStringRep(
 	    TclInitEmptyStringRep(objPtr);
 	    return objPtr->bytes;
 	} else {
-	    objPtr->bytes = (char *)Tcl_AttemptAlloc(numBytes + 1);
+	    objPtr->bytes = (char *)TclAttemptArenaAlloc(objPtr, numBytes + 1);
 	    if (objPtr->bytes) {
 		objPtr->length = numBytes;
 		if (bytes) {
@@ -1760,21 +1758,31 @@ Tcl_InitStringRep(
 	if (numBytes == 0) {
 	    return objPtr->bytes;
 	} else {
-	    objPtr->bytes = (char *)Tcl_AttemptAlloc(numBytes + 1);
+	    objPtr->bytes = (char *)TclAttemptArenaAlloc(objPtr, numBytes + 1);
 	    if (objPtr->bytes) {
 		objPtr->length = numBytes;
 		objPtr->bytes[objPtr->length] = '\0';
 	    }
 	}
     } else {
-	/* Start with non-empty string rep (allocated) */
+	/* Start with non-empty string rep (allocated or inline) */
 	if (numBytes == 0) {
-	    Tcl_Free(objPtr->bytes);
+	    TclInvalidateStringRep(objPtr);
 	    TclInitEmptyStringRep(objPtr);
 	    return objPtr->bytes;
 	} else {
-	    objPtr->bytes = (char *)Tcl_AttemptRealloc(objPtr->bytes,
-		    numBytes + 1);
+	    if (!TclHasInlineBytes(objPtr)) {
+		objPtr->bytes = (char *)Tcl_AttemptRealloc(objPtr->bytes,
+			numBytes + 1);
+	    } else if (numBytes > (size_t)objPtr->length) {
+		char *newBytes = (char *)TclAttemptArenaAlloc(objPtr,
+			numBytes + 1);
+
+		if (newBytes) {
+		    memcpy(newBytes, objPtr->bytes, objPtr->length);
+		}
+		objPtr->bytes = newBytes;
+	    }
 	    if (objPtr->bytes) {
 		objPtr->length = numBytes;
 		objPtr->bytes[objPtr->length] = '\0';
@@ -1784,6 +1792,90 @@ Tcl_InitStringRep(
 
     return objPtr->bytes;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclPromoteArenaValues --
+ *
+ *	Copies the storage that values took from an arena being closed (see
+ *	TclArenaAlloc) out of it: string reps, list stores and dicts. Each
+ *	value stays the same Tcl_Obj, so references to it remain valid. A
+ *	string rep is only moved if nothing else points into it, that is if
+ *	the value has no internal rep or one of the types below, or byte code
+ *	not being executed. Any other arena storage stays where it is until
+ *	it is freed.
+ *
+ * Results:
+ *	The number of values in objv that are still alive, which are moved to
+ *	its front.
+ *
+ * Side effects:
+ *	The arena storage copied out is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const Tcl_ObjType *const plainTypes[] = {
+    &tclBignumType, &tclBooleanType, &tclCmdNameType, &tclDictType,
+    &tclDoubleType, &tclIndexType, &tclIntType, &tclInternType,
+    &tclListType, &tclLocalVarNameType, &tclParsedVarNameType,
+    &tclRegexpType, &tclRopeType, &tclStringType, NULL
+};
+
+size_t
+TclPromoteArenaValues(
+    Tcl_Obj **objv,		/* Values given arena storage, possibly freed
+				 * or repeated since. */
+    size_t objc)
+{
+    size_t i, numLive = 0;
+    int j;
+
+    for (i = 0; i < objc; i++) {
+	Tcl_Obj *objPtr = objv[i];
+	const Tcl_ObjType *typePtr = objPtr->typePtr;
+
+	if (objPtr->bytes == NULL && objPtr->length == TCL_INDEX_NONE) {
+	    /* Freed, see TclFreeObj. */
+	    continue;
+	}
+	objv[numLive++] = objPtr;
+
+	if (objPtr->bytes != NULL && TclArenaOwns(objPtr->bytes)) {
+	    for (j = 0; plainTypes[j] != NULL && typePtr != NULL; j++) {
+		if (typePtr == plainTypes[j]) {
+		    typePtr = NULL;
+		    break;
+		}
+	    }
+	    if (typePtr == NULL || typePtr == &tclByteCodeType
+		    || typePtr == &tclExprCodeType) {
+		char *bytes = (char *)Tcl_AttemptAlloc(objPtr->length + 1);
+
+		if (bytes == NULL) {
+		    /* Leave it. */
+		} else if (typePtr == NULL
+			|| TclMoveByteCodeSource(objPtr, bytes)) {
+		    memcpy(bytes, objPtr->bytes, objPtr->length + 1);
+		    Tcl_Free(objPtr->bytes);
+		    objPtr->bytes = bytes;
+		    if (objPtr->typePtr == &tclStringType) {
+			/* No room to grow in place any more. */
+			GET_STRING(objPtr)->allocated = objPtr->length;
+		    }
+		} else {
+		    Tcl_Free(bytes);
+		}
+	    }
+	}
+	if (objPtr->typePtr == &tclDictType) {
+	    TclPromoteArenaDict(objPtr);
+	}
+    }
+    TclPromoteArenaLists(objv, numLive);
+    return numLive;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -4182,6 +4274,15 @@ TclCompareObjKeys(
 	}
      */
 
+    /*
+     * Distinct interned values never have equal strings.
+     */
+
+    if (TclHasInternalRep(objPtr1, &tclInternType)
+	    && TclHasInternalRep(objPtr2, &tclInternType)) {
+	return objPtr1 == objPtr2;
+    }
+
     /*
      * Don't use Tcl_GetStringFromObj as it would prevent l1 and l2 being
      * in a register.
@@ -4261,50 +4362,17 @@ TclHashObjKey(
 {
     Tcl_Obj *objPtr = (Tcl_Obj *)keyPtr;
     Tcl_Size length;
-    const char *string = Tcl_GetStringFromObj(objPtr, &length);
-    size_t result = 0;
+    const char *string;
 
     /*
-     * I tried a zillion different hash functions and asked many other people
-     * for advice. Many people had their own favorite functions, all
-     * different, but no-one had much idea why they were good ones. I chose
-     * the one below (multiply by 9 and add new character) because of the
-     * following reasons:
-     *
-     * 1. Multiplying by 10 is perfect for keys that are decimal strings, and
-     *    multiplying by 9 is just about as good.
-     * 2. Times-9 is (shift-left-3) plus (old). This means that each
-     *    character's bits hang around in the low-order bits of the hash value
-     *    for ever, plus they spread fairly rapidly up to the high-order bits
-     *    to fill out the hash value. This seems works well both for decimal
-     *    and non-decimal strings.
-     *
-     * Note that this function is very weak against malicious strings; it's
-     * very easy to generate multiple keys that have the same hashcode. On the
-     * other hand, that hardly ever actually occurs and this function *is*
-     * very cheap, even by comparison with industry-standard hashes like FNV.
-     * If real strength of hash is required though, use a custom hash based on
-     * Bob Jenkins's lookup3(), but be aware that it's significantly slower.
-     * Tcl does not use that level of strength because it typically does not
-     * need it (and some of the aspects of that strength are genuinely
-     * unnecessary given the rest of Tcl's hash machinery, and the fact that
-     * we do not either transfer hashes to another machine, use them as a true
-     * substitute for equality, or attempt to minimize work in rebuilding the
-     * hash table).
-     *
-     * See also HashStringKey in tclHash.c.
-     * See also HashString in tclLiteral.c.
-     *
-     * See [tcl-Feature Request #2958832]
+     * An interned value already has its hash in its intern table entry.
      */
 
-    if (length > 0) {
-	result = UCHAR(*string);
-	while (--length) {
-	    result += (result << 3) + UCHAR(*++string);
-	}
+    if (TclHasInternalRep(objPtr, &tclInternType)) {
+	return ((Tcl_HashEntry *)objPtr->internalRep.twoPtrValue.ptr1)->hash;
     }
-    return result;
+    string = Tcl_GetStringFromObj(objPtr, &length);
+    return TclHashBytes(string, length);
 }
 
 /*
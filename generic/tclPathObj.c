@@ -2366,10 +2366,15 @@ UpdateStringOfFsPath(
     }
 
     Tcl_IncrRefCount(copy);
-    /* Steal copy's string rep */
+    /* Steal copy's string rep, unless it lives inside copy itself */
     pathPtr->bytes = TclGetStringFromObj(copy, &cwdLen);
-    pathPtr->length = cwdLen;
-    TclInitEmptyStringRep(copy);
+    if (TclHasInlineBytes(copy)) {
+	pathPtr->bytes = NULL;
+	TclInitStringRep(pathPtr, copy->bytes, cwdLen);
+    } else {
+	pathPtr->length = cwdLen;
+	TclInitEmptyStringRep(copy);
+    }
     TclDecrRefCount(copy);
 }
 
@@ -60,38 +60,116 @@
  */
 
 /*
- * Thread local storage used to maintain a per-thread cache of compiled
- * regular expressions.
+ * Compiled patterns are cached at two levels. Each thread keeps the TclRegexps
+ * it used most recently in a hash table, limited to a configurable number of
+ * entries and evicted in least recently used order. The compiled programs
+ * behind them (the regex_t, which the matcher only reads apart from the lazy
+ * DFAs it keeps, which are claimed atomically) are shared by all threads
+ * through a process-wide table, so a pattern is compiled once no matter how
+ * many threads use it. A program stays in that table for as long
+ * as some TclRegexp refers to it.
+ *
+ * Both tables are keyed on the compilation flags and the pattern.
  */
 
-#define NUM_REGEXPS 30
+typedef struct RegexpKey {
+    int flags;			/* Compilation flags. */
+    size_t length;		/* Length of the pattern in bytes. */
+    const char *bytes;		/* The pattern (UTF-8). */
+} RegexpKey;
+
+typedef struct RegexpProgram {
+    regex_t re;			/* Compiled re, shared by the TclRegexps of
+				 * all threads. */
+    size_t refCount;		/* Number of TclRegexps using the program.
+				 * Guarded by programMutex. */
+    char *glob;			/* Glob pattern equivalent of the RE, or NULL
+				 * if there is none. */
+    Tcl_Size globLength;	/* Length of the glob pattern in bytes. */
+    Tcl_HashEntry *hPtr;	/* Entry in programTable. */
+} RegexpProgram;
+
+/*
+ * An entry of a thread's cache, linked into its LRU list.
+ */
+
+typedef struct CacheEntry {
+    TclRegexp *regexpPtr;	/* The cached regexp, holding one reference
+				 * for the cache. */
+    Tcl_HashEntry *hPtr;	/* Entry in the thread's table. */
+    struct CacheEntry *prevPtr;	/* Next more recently used entry. */
+    struct CacheEntry *nextPtr;	/* Next less recently used entry. */
+} CacheEntry;
+
+/*
+ * A set of patterns matched together, as built by Tcl_GetRegExpSetFromObj.
+ * The patterns go into one search program that finds all of them in a
+ * single pass. That program only approximates back references, so patterns
+ * using them are left out of it and matched as ordinary regexps.
+ */
+
+typedef struct RegexpSet {
+    int flags;			/* Compilation flags. */
+    Tcl_Size refCount;		/* Number of objects and calls using it. */
+    Tcl_Size numPatterns;	/* Number of patterns in the set. */
+    Tcl_Size numCombined;	/* Number of them compiled into re. */
+    regex_t re;			/* The combined program, if numCombined is
+				 * not 0. */
+    Tcl_Size *slots;		/* For each pattern, its index in re, or
+				 * TCL_INDEX_NONE if matched on its own. */
+    TclRegexp **regexps;	/* For each pattern matched on its own, its
+				 * regexp (holding a reference), else NULL. */
+} RegexpSet;
+
+#define DEFAULT_CACHE_SIZE	256
 
 typedef struct {
     int initialized;		/* Set to 1 when the module is initialized. */
-    char *patterns[NUM_REGEXPS];/* Strings corresponding to compiled regular
-				 * expression patterns. NULL means that this
-				 * slot isn't used. Malloc-ed. */
-    size_t patLengths[NUM_REGEXPS];/* Number of non-null characters in
-				 * corresponding entry in patterns. -1 means
-				 * entry isn't used. */
-    struct TclRegexp *regexps[NUM_REGEXPS];
-				/* Compiled forms of above strings. Also
-				 * malloc-ed, or NULL if not in use yet. */
+    Tcl_HashTable cache;	/* Maps RegexpKeys to CacheEntries. */
+    CacheEntry *firstPtr;	/* Most recently used entry. */
+    CacheEntry *lastPtr;	/* Least recently used entry. */
+    Tcl_Size cacheSize;		/* Maximum number of entries. */
+    Tcl_WideUInt hits;		/* Lookups found in the thread's cache. */
+    Tcl_WideUInt misses;	/* Lookups not found there. */
+    Tcl_WideUInt sharedHits;	/* Misses whose program another thread had
+				 * already compiled. */
 } ThreadSpecificData;
 
 static Tcl_ThreadDataKey dataKey;
 
+static Tcl_HashTable programTable;
+static int programTableInitialized = 0;
+static Tcl_Size defaultCacheSize = DEFAULT_CACHE_SIZE;
+TCL_DECLARE_MUTEX(programMutex)	/* Guards the variables above and the
+				 * reference counts of programs. */
+
 /*
  * Declarations for functions used only in this file.
  */
 
+static Tcl_HashEntry *	AllocRegexpEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static int		CompareRegexpKeys(void *keyPtr, Tcl_HashEntry *hPtr);
 static TclRegexp *	CompileRegexp(Tcl_Interp *interp, const char *pattern,
 			    size_t length, int flags);
+static RegexpProgram *	CompileProgram(Tcl_Interp *interp,
+			    const RegexpKey *keyPtr);
 static void		DupRegexpInternalRep(Tcl_Obj *srcPtr,
 			    Tcl_Obj *copyPtr);
+static void		DupRegexpSetInternalRep(Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr);
 static void		FinalizeRegexp(void *clientData);
 static void		FreeRegexp(TclRegexp *regexpPtr);
 static void		FreeRegexpInternalRep(Tcl_Obj *objPtr);
+static void		FreeRegexpSet(RegexpSet *setPtr);
+static void		FreeRegexpSetInternalRep(Tcl_Obj *objPtr);
+static TCL_HASH_TYPE	HashRegexpKey(Tcl_HashTable *tablePtr, void *keyPtr);
+static void		ReleaseProgram(RegexpProgram *programPtr);
+static void		RemoveCacheEntry(ThreadSpecificData *tsdPtr,
+			    CacheEntry *entryPtr);
+static int		RegExpExecBytes(Tcl_Interp *interp, Tcl_RegExp re,
+			    const char *bytes, size_t numBytes,
+			    size_t nmatches, int flags);
 static int		RegExpExecUniChar(Tcl_Interp *interp, Tcl_RegExp re,
 			    const Tcl_UniChar *uniString, size_t numChars,
 			    size_t nmatches, int flags);
@@ -111,6 +189,29 @@ const Tcl_ObjType tclRegexpType = {
     TCL_OBJTYPE_V0
 };
 
+/*
+ * The regular expression set Tcl object type, caching the compiled form of a
+ * list of patterns.
+ */
+
+static const Tcl_ObjType regexpSetType = {
+    "regexpset",		/* name */
+    FreeRegexpSetInternalRep,	/* freeIntRepProc */
+    DupRegexpSetInternalRep,	/* dupIntRepProc */
+    NULL,			/* updateStringProc */
+    NULL,			/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+static const Tcl_HashKeyType regexpKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,	/* version */
+    0,				/* flags */
+    HashRegexpKey,		/* hashKeyProc */
+    CompareRegexpKeys,		/* compareKeysProc */
+    AllocRegexpEntry,		/* allocEntryProc */
+    NULL			/* freeEntryProc */
+};
+
 #define RegexpSetInternalRep(objPtr, rePtr) \
     do {								\
 	Tcl_ObjInternalRep ir;						\
@@ -126,6 +227,22 @@ const Tcl_ObjType tclRegexpType = {
 	irPtr = TclFetchInternalRep((objPtr), &tclRegexpType);		\
 	(rePtr) = irPtr ? (TclRegexp *)irPtr->twoPtrValue.ptr1 : NULL;	\
     } while (0)
+
+#define RegexpSetSetInternalRep(objPtr, setPtr) \
+    do {								\
+	Tcl_ObjInternalRep ir;						\
+	(setPtr)->refCount++;						\
+	ir.twoPtrValue.ptr1 = (setPtr);					\
+	ir.twoPtrValue.ptr2 = NULL;					\
+	Tcl_StoreInternalRep((objPtr), &regexpSetType, &ir);		\
+    } while (0)
+
+#define RegexpSetGetInternalRep(objPtr, setPtr) \
+    do {								\
+	const Tcl_ObjInternalRep *irPtr;				\
+	irPtr = TclFetchInternalRep((objPtr), &regexpSetType);		\
+	(setPtr) = irPtr ? (RegexpSet *)irPtr->twoPtrValue.ptr1 : NULL;	\
+    } while (0)
 
 /*
  *----------------------------------------------------------------------
@@ -338,6 +455,64 @@ RegExpExecUniChar(
     return 1;
 }
 
+/*
+ *---------------------------------------------------------------------------
+ *
+ * RegExpExecBytes --
+ *
+ *	Like RegExpExecUniChar, but matches the UTF-8 form of a string. The
+ *	result is the same as matching its characters when all of them are
+ *	ASCII, or when the regular expression only matches ASCII characters
+ *	(REG_UASCII); match offsets are byte offsets.
+ *
+ * Results:
+ *	If an error occurs during the matching operation then -1 is returned
+ *	and an error message is left in interp's result. Otherwise the return
+ *	value is 1 if a matching range was found or 0 if there was no matching
+ *	range.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RegExpExecBytes(
+    Tcl_Interp *interp,		/* Interpreter to use for error reporting. */
+    Tcl_RegExp re,		/* Compiled regular expression; returned by a
+				 * previous call to Tcl_GetRegExpFromObj */
+    const char *bytes,		/* String against which to match re. */
+    size_t numBytes,		/* Length of the string in bytes. */
+    size_t nm,			/* How many subexpression matches (counting
+				 * the whole match as subexpression 0) are of
+				 * interest. -1 means "don't know". */
+    int flags)			/* Regular expression flags. */
+{
+    int status;
+    TclRegexp *regexpPtr = (TclRegexp *) re;
+    size_t last = regexpPtr->re.re_nsub + 1;
+
+    if (nm >= last) {
+	nm = last;
+    }
+
+    status = TclReExecBytes(&regexpPtr->re, (const unsigned char *) bytes,
+	    numBytes, &regexpPtr->details, nm, regexpPtr->matches, flags);
+
+    if (status != REG_OKAY) {
+	if (status == REG_NOMATCH) {
+	    return 0;
+	}
+	if (interp != NULL) {
+	    TclRegError(interp, "error while matching regular expression: ",
+		    status);
+	}
+	return -1;
+    }
+    return 1;
+}
+
 /*
  *---------------------------------------------------------------------------
  *
@@ -482,6 +657,46 @@ Tcl_RegExpExecObj(
     regexpPtr->string = NULL;
     regexpPtr->objPtr = textObj;
 
+    /*
+     * Unless the text already has a Unicode rep, match its UTF-8 form
+     * directly where that gives the same result: always when the text is
+     * all ASCII, as byte and character offsets then agree, and for a plain
+     * yes or no when the expression only ever matches ASCII characters.
+     */
+
+    if (!TclHasUnicodeRep(textObj)) {
+	Tcl_Size numChars = Tcl_GetCharLength(textObj);
+	const char *bytes = TclGetStringFromObj(textObj, &length);
+	int isAscii = (numChars == length);
+	Tcl_Size i;
+
+	/*
+	 * Equal lengths are not enough: a lone byte from 0x80 to 0xFF also
+	 * counts as one character, and not the one of the same code.
+	 */
+
+	for (i = 0; isAscii && (i < length); i++) {
+	    if (UCHAR(bytes[i]) >= 0x80) {
+		isAscii = 0;
+	    }
+	}
+	if (isAscii) {
+	    if (offset > length) {
+		offset = length;
+	    }
+	    return RegExpExecBytes(interp, re, bytes + offset,
+		    length - offset, nmatches, flags);
+	}
+	if ((regexpPtr->re.re_info & REG_UASCII) && (nmatches == 0)
+		&& !(reflags & TCL_REG_CANMATCH)) {
+	    const char *start = (offset >= numChars) ? bytes + length
+		    : Tcl_UtfAtIndex(bytes, offset);
+
+	    return RegExpExecBytes(interp, re, start,
+		    length - (start - bytes), 0, flags);
+	}
+    }
+
     udata = Tcl_GetUnicodeFromObj(textObj, &length);
 
     if (offset > length) {
@@ -613,6 +828,229 @@ Tcl_GetRegExpFromObj(
     return (Tcl_RegExp) regexpPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_GetRegExpSetFromObj --
+ *
+ *	Compile a list of regular expressions into a set that can be matched
+ *	in a single pass over a string. This function caches the result in a
+ *	Tcl_Obj.
+ *
+ * Results:
+ *	The return value is a pointer to the compiled set, suitable for
+ *	passing to Tcl_RegExpSetExecObj. If an error occurred while compiling
+ *	any of the patterns, then NULL is returned and an error message is
+ *	left in the interp's result.
+ *
+ * Side effects:
+ *	Updates the native rep of the Tcl_Obj.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_RegExpSet
+Tcl_GetRegExpSetFromObj(
+    Tcl_Interp *interp,		/* For use in error reporting. */
+    Tcl_Obj *objPtr,		/* Object whose string rep is a list of
+				 * regular expression patterns. Internal rep
+				 * will be changed to the compiled set. */
+    int flags)			/* Regular expression compilation flags. */
+{
+    RegexpSet *setPtr;
+    TclRegexp *regexpPtr;
+    Tcl_Obj **objv;
+    Tcl_Size objc, i, length, numCombined;
+    const char *pattern;
+    const Tcl_UniChar **uniStrings;
+    size_t *uniLengths;
+    Tcl_DString *buffers;
+    int status;
+
+    flags &= ~TCL_REG_CANMATCH;
+    RegexpSetGetInternalRep(objPtr, setPtr);
+    if ((setPtr != NULL) && (setPtr->flags == flags)) {
+	return (Tcl_RegExpSet) setPtr;
+    }
+
+    if (TclListObjGetElements(interp, objPtr, &objc, &objv) != TCL_OK) {
+	return NULL;
+    }
+
+    setPtr = (RegexpSet *)Tcl_Alloc(sizeof(RegexpSet));
+    setPtr->flags = flags;
+    setPtr->refCount = 0;
+    setPtr->numPatterns = objc;
+    setPtr->numCombined = 0;
+    setPtr->slots = (Tcl_Size *)Tcl_Alloc((objc + 1) * sizeof(Tcl_Size));
+    setPtr->regexps = (TclRegexp **)
+	    Tcl_Alloc((objc + 1) * sizeof(TclRegexp *));
+
+    /*
+     * Compile each pattern on its own first. That reports errors against the
+     * offending pattern and tells which patterns use back references. The
+     * regexps of the others are not kept; they stay in the cache.
+     */
+
+    numCombined = 0;
+    for (i = 0; i < objc; i++) {
+	pattern = TclGetStringFromObj(objv[i], &length);
+	regexpPtr = CompileRegexp(interp, pattern, length, flags);
+	if (regexpPtr == NULL) {
+	    setPtr->numPatterns = i;
+	    FreeRegexpSet(setPtr);
+	    return NULL;
+	}
+	if (regexpPtr->re.re_info & REG_UBACKREF) {
+	    regexpPtr->refCount++;
+	    setPtr->regexps[i] = regexpPtr;
+	    setPtr->slots[i] = TCL_INDEX_NONE;
+	} else {
+	    setPtr->regexps[i] = NULL;
+	    setPtr->slots[i] = numCombined++;
+	}
+    }
+
+    if (numCombined > 0) {
+	uniStrings = (const Tcl_UniChar **)
+		Tcl_Alloc(numCombined * sizeof(Tcl_UniChar *));
+	uniLengths = (size_t *)Tcl_Alloc(numCombined * sizeof(size_t));
+	buffers = (Tcl_DString *)Tcl_Alloc(numCombined * sizeof(Tcl_DString));
+	for (i = 0; i < objc; i++) {
+	    Tcl_Size slot = setPtr->slots[i];
+
+	    if (slot == TCL_INDEX_NONE) {
+		continue;
+	    }
+	    pattern = TclGetStringFromObj(objv[i], &length);
+	    Tcl_DStringInit(&buffers[slot]);
+	    uniStrings[slot] = Tcl_UtfToUniCharDString(pattern, length,
+		    &buffers[slot]);
+	    uniLengths[slot] =
+		    Tcl_DStringLength(&buffers[slot]) / sizeof(Tcl_UniChar);
+	}
+	status = TclReCompSet(&setPtr->re, uniStrings, uniLengths,
+		(size_t) numCombined, flags);
+	for (i = 0; i < numCombined; i++) {
+	    Tcl_DStringFree(&buffers[i]);
+	}
+	Tcl_Free(buffers);
+	Tcl_Free(uniLengths);
+	Tcl_Free((void *)uniStrings);
+	if (status != REG_OKAY) {
+	    FreeRegexpSet(setPtr);
+	    if (interp) {
+		TclRegError(interp,
+			"cannot compile regular expression pattern: ", status);
+	    }
+	    return NULL;
+	}
+	setPtr->numCombined = numCombined;
+    }
+
+    /*
+     * The set type cannot regenerate the string of the list, so make sure
+     * there is one before the list rep goes away.
+     */
+
+    (void) TclGetString(objPtr);
+    RegexpSetSetInternalRep(objPtr, setPtr);
+    return (Tcl_RegExpSet) setPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_RegExpSetExecObj --
+ *
+ *	Find which patterns of a set match somewhere in an object.
+ *
+ * Results:
+ *	If an error occurs during the matching operation then -1 is returned
+ *	and the interp's result contains an error message. Otherwise the
+ *	return value is the number of patterns that matched, and if listObj
+ *	is not NULL the index of each of them is appended to it, in order.
+ *
+ * Side effects:
+ *	Converts the object to a Unicode object.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Size
+Tcl_RegExpSetExecObj(
+    Tcl_Interp *interp,		/* Interpreter to use for error reporting. */
+    Tcl_RegExpSet set,		/* Compiled set; must have been returned by
+				 * previous call to Tcl_GetRegExpSetFromObj. */
+    Tcl_Obj *textObj,		/* Text against which to match the set. */
+    Tcl_Size offset,		/* Character index that marks where matching
+				 * should begin. */
+    int flags,			/* Regular expression execution flags. */
+    Tcl_Obj *listObj)		/* If not NULL, list to append the indices of
+				 * the matching patterns to. */
+{
+    RegexpSet *setPtr = (RegexpSet *) set;
+    Tcl_UniChar *udata;
+    Tcl_Size length, i, count = 0;
+    char *matched = NULL;
+    int status, match;
+
+    /*
+     * Hold on to the set in case getting the text shimmers it away.
+     */
+
+    setPtr->refCount++;
+    udata = Tcl_GetUnicodeFromObj(textObj, &length);
+    if (offset > length) {
+	offset = length;
+    }
+    udata += offset;
+    length -= offset;
+
+    if (setPtr->numCombined > 0) {
+	matched = (char *)Tcl_Alloc(setPtr->numCombined);
+	status = TclReExecSet(&setPtr->re, udata, (size_t) length,
+		(size_t) setPtr->numCombined, matched, flags);
+	if (status != REG_OKAY && status != REG_NOMATCH) {
+	    if (interp != NULL) {
+		TclRegError(interp,
+			"error while matching regular expression: ", status);
+	    }
+	    count = -1;
+	    goto done;
+	}
+    }
+
+    for (i = 0; i < setPtr->numPatterns; i++) {
+	if (setPtr->slots[i] != TCL_INDEX_NONE) {
+	    match = matched[setPtr->slots[i]];
+	} else {
+	    match = RegExpExecUniChar(interp,
+		    (Tcl_RegExp) setPtr->regexps[i], udata, (size_t) length,
+		    0, flags);
+	    if (match < 0) {
+		count = -1;
+		goto done;
+	    }
+	}
+	if (match) {
+	    count++;
+	    if (listObj != NULL) {
+		Tcl_ListObjAppendElement(NULL, listObj, Tcl_NewWideIntObj(i));
+	    }
+	}
+    }
+
+  done:
+    if (matched != NULL) {
+	Tcl_Free(matched);
+    }
+    if (setPtr->refCount-- <= 1) {
+	FreeRegexpSet(setPtr);
+    }
+    return count;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -801,6 +1239,106 @@ DupRegexpInternalRep(
     RegexpSetInternalRep(copyPtr, regexpPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeRegexpSetInternalRep --
+ *
+ *	Deallocate the storage associated with a regexp set object's internal
+ *	representation.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the compiled set if this was its last reference.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeRegexpSetInternalRep(
+    Tcl_Obj *objPtr)		/* Set object with internal rep to free. */
+{
+    RegexpSet *setPtr;
+
+    RegexpSetGetInternalRep(objPtr, setPtr);
+
+    assert(setPtr != NULL);
+
+    if (setPtr->refCount-- <= 1) {
+	FreeRegexpSet(setPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupRegexpSetInternalRep --
+ *
+ *	We copy the reference to the compiled set and bump its reference
+ *	count.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Increments the reference count of the set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupRegexpSetInternalRep(
+    Tcl_Obj *srcPtr,		/* Object with internal rep to copy. */
+    Tcl_Obj *copyPtr)		/* Object with internal rep to set. */
+{
+    RegexpSet *setPtr;
+
+    RegexpSetGetInternalRep(srcPtr, setPtr);
+
+    assert(setPtr != NULL);
+
+    RegexpSetSetInternalRep(copyPtr, setPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeRegexpSet --
+ *
+ *	Release the storage associated with a compiled regexp set.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Releases the regexps of the patterns matched on their own.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeRegexpSet(
+    RegexpSet *setPtr)		/* Compiled set to free. */
+{
+    Tcl_Size i;
+    TclRegexp *regexpPtr;
+
+    if (setPtr->numCombined > 0) {
+	TclReFree(&setPtr->re);
+    }
+    for (i = 0; i < setPtr->numPatterns; i++) {
+	regexpPtr = setPtr->regexps[i];
+	if (regexpPtr != NULL && regexpPtr->refCount-- <= 1) {
+	    FreeRegexp(regexpPtr);
+	}
+    }
+    Tcl_Free(setPtr->slots);
+    Tcl_Free(setPtr->regexps);
+    Tcl_Free(setPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -839,17 +1377,16 @@ SetRegexpFromAny(
  *
  *	Attempt to compile the given regexp pattern. If the compiled regular
  *	expression can be found in the per-thread cache, it will be used
- *	instead of compiling a new copy.
+ *	instead of compiling a new copy. Otherwise, if another thread has
+ *	compiled the same pattern, its program is shared.
  *
  * Results:
- *	The return value is a pointer to a newly allocated TclRegexp that
- *	represents the compiled pattern, or NULL if the pattern could not be
- *	compiled. If NULL is returned, an error message is left in the
- *	interp's result.
+ *	The return value is a pointer to a TclRegexp that represents the
+ *	compiled pattern, or NULL if the pattern could not be compiled. If
+ *	NULL is returned, an error message is left in the interp's result.
  *
  * Side effects:
- *	The thread-local regexp cache is updated and a new TclRegexp may be
- *	allocated.
+ *	The regexp caches are updated and a new TclRegexp may be allocated.
  *
  *----------------------------------------------------------------------
  */
@@ -862,14 +1399,20 @@ CompileRegexp(
     int flags)			/* Compilation flags. */
 {
     TclRegexp *regexpPtr;
-    const Tcl_UniChar *uniString;
-    int status, i, exact;
-    Tcl_Size numChars;
-    Tcl_DString stringBuf;
+    RegexpProgram *programPtr = NULL, *otherPtr;
+    CacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    RegexpKey key;
+    int isNew;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     if (!tsdPtr->initialized) {
 	tsdPtr->initialized = 1;
+	Tcl_InitCustomHashTable(&tsdPtr->cache, TCL_CUSTOM_PTR_KEYS,
+		&regexpKeyType);
+	Tcl_MutexLock(&programMutex);
+	tsdPtr->cacheSize = defaultCacheSize;
+	Tcl_MutexUnlock(&programMutex);
 	Tcl_CreateThreadExitHandler(FinalizeRegexp, NULL);
     }
 
@@ -878,65 +1421,199 @@ CompileRegexp(
      * addition to the per-object regexp cache. The per-thread cache is needed
      * to handle the case where for various reasons the object is lost between
      * invocations of the regexp command, but the literal pattern is the same.
+     * We can only reuse a regexp if it has the same pattern and the same
+     * flags.
      */
 
+    key.flags = flags;
+    key.length = length;
+    key.bytes = string;
+    hPtr = Tcl_FindHashEntry(&tsdPtr->cache, &key);
+    if (hPtr != NULL) {
+	entryPtr = (CacheEntry *)Tcl_GetHashValue(hPtr);
+	tsdPtr->hits++;
+
+	/*
+	 * Move the entry to the front of the LRU list.
+	 */
+
+	if (entryPtr != tsdPtr->firstPtr) {
+	    entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+	    if (entryPtr->nextPtr) {
+		entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+	    } else {
+		tsdPtr->lastPtr = entryPtr->prevPtr;
+	    }
+	    entryPtr->prevPtr = NULL;
+	    entryPtr->nextPtr = tsdPtr->firstPtr;
+	    tsdPtr->firstPtr->prevPtr = entryPtr;
+	    tsdPtr->firstPtr = entryPtr;
+	}
+	return entryPtr->regexpPtr;
+    }
+    tsdPtr->misses++;
+
     /*
-     * Check the per-thread compiled regexp cache. We can only reuse a regexp
-     * if it has the same pattern and the same flags.
+     * Share the program of another thread if there is one; otherwise compile
+     * it, outside of the lock, and publish it. If another thread published
+     * the same pattern meanwhile, use that program and discard ours.
      */
 
-    for (i = 0; (i < NUM_REGEXPS) && (tsdPtr->patterns[i] != NULL); i++) {
-	if ((length == tsdPtr->patLengths[i])
-		&& (tsdPtr->regexps[i]->flags == flags)
-		&& (strcmp(string, tsdPtr->patterns[i]) == 0)) {
-	    /*
-	     * Move the matched pattern to the first slot in the cache and
-	     * shift the other patterns down one position.
-	     */
-
-	    if (i != 0) {
-		int j;
-		char *cachedString;
-
-		cachedString = tsdPtr->patterns[i];
-		regexpPtr = tsdPtr->regexps[i];
-		for (j = i-1; j >= 0; j--) {
-		    tsdPtr->patterns[j+1] = tsdPtr->patterns[j];
-		    tsdPtr->patLengths[j+1] = tsdPtr->patLengths[j];
-		    tsdPtr->regexps[j+1] = tsdPtr->regexps[j];
-		}
-		tsdPtr->patterns[0] = cachedString;
-		tsdPtr->patLengths[0] = length;
-		tsdPtr->regexps[0] = regexpPtr;
+    Tcl_MutexLock(&programMutex);
+    if (programTableInitialized) {
+	hPtr = Tcl_FindHashEntry(&programTable, &key);
+	if (hPtr != NULL) {
+	    programPtr = (RegexpProgram *)Tcl_GetHashValue(hPtr);
+	    programPtr->refCount++;
+	    tsdPtr->sharedHits++;
+	}
+    }
+    Tcl_MutexUnlock(&programMutex);
+
+    if (programPtr == NULL) {
+	programPtr = CompileProgram(interp, &key);
+	if (programPtr == NULL) {
+	    return NULL;
+	}
+
+	Tcl_MutexLock(&programMutex);
+	if (!programTableInitialized) {
+	    Tcl_InitCustomHashTable(&programTable, TCL_CUSTOM_PTR_KEYS,
+		    &regexpKeyType);
+	    programTableInitialized = 1;
+	}
+	hPtr = Tcl_CreateHashEntry(&programTable, &key, &isNew);
+	if (isNew) {
+	    programPtr->hPtr = hPtr;
+	    Tcl_SetHashValue(hPtr, programPtr);
+	    otherPtr = NULL;
+	} else {
+	    otherPtr = programPtr;
+	    programPtr = (RegexpProgram *)Tcl_GetHashValue(hPtr);
+	    programPtr->refCount++;
+	}
+	Tcl_MutexUnlock(&programMutex);
+
+	if (otherPtr != NULL) {
+	    TclReFree(&otherPtr->re);
+	    if (otherPtr->glob) {
+		Tcl_Free(otherPtr->glob);
 	    }
-	    return tsdPtr->regexps[0];
+	    Tcl_Free(otherPtr);
 	}
     }
 
     /*
-     * This is a new expression, so compile it and add it to the cache.
+     * Make this thread's regexp around the program.
      */
 
-    regexpPtr = (TclRegexp*)Tcl_Alloc(sizeof(TclRegexp));
+    regexpPtr = (TclRegexp *)Tcl_Alloc(sizeof(TclRegexp));
+    regexpPtr->flags = flags;
+    regexpPtr->re = programPtr->re;
+    regexpPtr->programPtr = programPtr;
     regexpPtr->objPtr = NULL;
     regexpPtr->string = NULL;
     regexpPtr->details.rm_extend.rm_so = TCL_INDEX_NONE;
     regexpPtr->details.rm_extend.rm_eo = TCL_INDEX_NONE;
 
+    /*
+     * The glob pattern equivalent, if any, is used by Tcl_RegExpExecObj to
+     * optionally do a fast match (avoids RE engine).
+     */
+
+    if (programPtr->glob) {
+	regexpPtr->globObjPtr = Tcl_NewStringObj(programPtr->glob,
+		programPtr->globLength);
+	Tcl_IncrRefCount(regexpPtr->globObjPtr);
+    } else {
+	regexpPtr->globObjPtr = NULL;
+    }
+
+    /*
+     * Allocate enough space for all of the subexpressions, plus one extra for
+     * the entire pattern.
+     */
+
+    regexpPtr->matches =
+	    (regmatch_t*)Tcl_Alloc(sizeof(regmatch_t) * (regexpPtr->re.re_nsub + 1));
+
+    /*
+     * Initialize the refcount to one initially, since it is in the cache.
+     */
+
+    regexpPtr->refCount = 1;
+
+    /*
+     * Add the regexp at the head of the LRU list and evict the least
+     * recently used one if the cache is full.
+     */
+
+    entryPtr = (CacheEntry *)Tcl_Alloc(sizeof(CacheEntry));
+    entryPtr->regexpPtr = regexpPtr;
+    entryPtr->hPtr = Tcl_CreateHashEntry(&tsdPtr->cache, &key, &isNew);
+    Tcl_SetHashValue(entryPtr->hPtr, entryPtr);
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = tsdPtr->firstPtr;
+    if (tsdPtr->firstPtr) {
+	tsdPtr->firstPtr->prevPtr = entryPtr;
+    } else {
+	tsdPtr->lastPtr = entryPtr;
+    }
+    tsdPtr->firstPtr = entryPtr;
+
+    while (tsdPtr->cache.numEntries > tsdPtr->cacheSize) {
+	RemoveCacheEntry(tsdPtr, tsdPtr->lastPtr);
+    }
+
+    return regexpPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileProgram --
+ *
+ *	Compiles a pattern into a program that threads can share.
+ *
+ * Results:
+ *	The new program, with a reference count of one, or NULL if the pattern
+ *	could not be compiled. If NULL is returned, an error message is left
+ *	in the interp's result.
+ *
+ * Side effects:
+ *	Allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RegexpProgram *
+CompileProgram(
+    Tcl_Interp *interp,		/* Used for error reporting if not NULL. */
+    const RegexpKey *keyPtr)	/* The pattern and flags. */
+{
+    RegexpProgram *programPtr;
+    const Tcl_UniChar *uniString;
+    int status, exact;
+    Tcl_Size numChars;
+    Tcl_DString stringBuf;
+
+    programPtr = (RegexpProgram *)Tcl_Alloc(sizeof(RegexpProgram));
+
     /*
      * Get the up-to-date string representation and map to unicode.
      */
 
     Tcl_DStringInit(&stringBuf);
-    uniString = Tcl_UtfToUniCharDString(string, length, &stringBuf);
+    uniString = Tcl_UtfToUniCharDString(keyPtr->bytes, keyPtr->length,
+	    &stringBuf);
     numChars = Tcl_DStringLength(&stringBuf) / sizeof(Tcl_UniChar);
 
     /*
      * Compile the string and check for errors.
      */
 
-    regexpPtr->flags = flags;
-    status = TclReComp(&regexpPtr->re, uniString, (size_t) numChars, flags);
+    status = TclReComp(&programPtr->re, uniString, (size_t) numChars,
+	    keyPtr->flags);
     Tcl_DStringFree(&stringBuf);
 
     if (status != REG_OKAY) {
@@ -944,7 +1621,7 @@ CompileRegexp(
 	 * Clean up and report errors in the interpreter, if possible.
 	 */
 
-	Tcl_Free(regexpPtr);
+	Tcl_Free(programPtr);
 	if (interp) {
 	    TclRegError(interp,
 		    "cannot compile regular expression pattern: ", status);
@@ -953,59 +1630,176 @@ CompileRegexp(
     }
 
     /*
-     * Convert RE to a glob pattern equivalent, if any, and cache it.  If this
-     * is not possible, then globObjPtr will be NULL.  This is used by
-     * Tcl_RegExpExecObj to optionally do a fast match (avoids RE engine).
+     * Convert RE to a glob pattern equivalent, if any. If this is not
+     * possible, then glob will be NULL.
      */
 
-    if (TclReToGlob(NULL, string, length, &stringBuf, &exact,
+    if (TclReToGlob(NULL, keyPtr->bytes, keyPtr->length, &stringBuf, &exact,
 	    NULL) == TCL_OK) {
-	regexpPtr->globObjPtr = Tcl_DStringToObj(&stringBuf);
-	Tcl_IncrRefCount(regexpPtr->globObjPtr);
+	programPtr->globLength = Tcl_DStringLength(&stringBuf);
+	programPtr->glob = (char *)Tcl_Alloc(programPtr->globLength + 1);
+	memcpy(programPtr->glob, Tcl_DStringValue(&stringBuf),
+		programPtr->globLength + 1);
+	Tcl_DStringFree(&stringBuf);
     } else {
-	regexpPtr->globObjPtr = NULL;
+	programPtr->glob = NULL;
+	programPtr->globLength = 0;
     }
 
-    /*
-     * Allocate enough space for all of the subexpressions, plus one extra for
-     * the entire pattern.
-     */
+    programPtr->refCount = 1;
+    programPtr->hPtr = NULL;
+    return programPtr;
+}
 
-    regexpPtr->matches =
-	    (regmatch_t*)Tcl_Alloc(sizeof(regmatch_t) * (regexpPtr->re.re_nsub + 1));
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseProgram --
+ *
+ *	Drops a reference to a shared program, freeing it and removing it from
+ *	the program table when no regexp in any thread uses it any more.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free memory.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    /*
-     * Initialize the refcount to one initially, since it is in the cache.
-     */
+static void
+ReleaseProgram(
+    RegexpProgram *programPtr)	/* Program to release. */
+{
+    Tcl_MutexLock(&programMutex);
+    if (programPtr->refCount-- > 1) {
+	Tcl_MutexUnlock(&programMutex);
+	return;
+    }
+    Tcl_DeleteHashEntry(programPtr->hPtr);
+    if (programTable.numEntries == 0) {
+	Tcl_DeleteHashTable(&programTable);
+	programTableInitialized = 0;
+    }
+    Tcl_MutexUnlock(&programMutex);
 
-    regexpPtr->refCount = 1;
+    TclReFree(&programPtr->re);
+    if (programPtr->glob) {
+	Tcl_Free(programPtr->glob);
+    }
+    Tcl_Free(programPtr);
+}
 
-    /*
-     * Free the last regexp, if necessary, and make room at the head of the
-     * list for the new regexp.
-     */
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveCacheEntry --
+ *
+ *	Removes an entry from a thread's regexp cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Drops the cache's reference to the regexp, which may free it.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    if (tsdPtr->patterns[NUM_REGEXPS-1] != NULL) {
-	TclRegexp *oldRegexpPtr = tsdPtr->regexps[NUM_REGEXPS-1];
+static void
+RemoveCacheEntry(
+    ThreadSpecificData *tsdPtr,	/* The thread's cache. */
+    CacheEntry *entryPtr)	/* Entry to remove. */
+{
+    TclRegexp *regexpPtr = entryPtr->regexpPtr;
 
-	if (oldRegexpPtr->refCount-- <= 1) {
-	    FreeRegexp(oldRegexpPtr);
-	}
-	Tcl_Free(tsdPtr->patterns[NUM_REGEXPS-1]);
+    if (entryPtr->prevPtr) {
+	entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    } else {
+	tsdPtr->firstPtr = entryPtr->nextPtr;
     }
-    for (i = NUM_REGEXPS - 2; i >= 0; i--) {
-	tsdPtr->patterns[i+1] = tsdPtr->patterns[i];
-	tsdPtr->patLengths[i+1] = tsdPtr->patLengths[i];
-	tsdPtr->regexps[i+1] = tsdPtr->regexps[i];
+    if (entryPtr->nextPtr) {
+	entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    } else {
+	tsdPtr->lastPtr = entryPtr->prevPtr;
     }
-    tsdPtr->patterns[0] = (char *)Tcl_Alloc(length + 1);
-    memcpy(tsdPtr->patterns[0], string, length + 1);
-    tsdPtr->patLengths[0] = length;
-    tsdPtr->regexps[0] = regexpPtr;
+    Tcl_DeleteHashEntry(entryPtr->hPtr);
+    Tcl_Free(entryPtr);
 
-    return regexpPtr;
+    if (regexpPtr->refCount-- <= 1) {
+	FreeRegexp(regexpPtr);
+    }
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashRegexpKey, CompareRegexpKeys, AllocRegexpEntry --
+ *
+ *	The key type of the regexp caches, which are keyed on the flags and
+ *	the pattern. An entry holds a copy of its key.
+ *
+ * Results:
+ *	The hash value of a key, whether a key matches an entry, and a new
+ *	entry.
+ *
+ * Side effects:
+ *	AllocRegexpEntry allocates memory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static TCL_HASH_TYPE
+HashRegexpKey(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)
+{
+    const RegexpKey *key = (const RegexpKey *) keyPtr;
+
+    /*
+     * Use the keyed string hash, so that patterns cannot be chosen to
+     * collide in the process-wide program table, and spread the flags over
+     * the whole word so patterns compiled with different flags still land
+     * in different buckets.
+     */
+
+    return (TCL_HASH_TYPE) (TclHashBytes(key->bytes, (Tcl_Size) key->length)
+	    ^ ((size_t) (unsigned) key->flags * 0x9E3779B9U));
+}
+
+static int
+CompareRegexpKeys(
+    void *keyPtr,
+    Tcl_HashEntry *hPtr)
+{
+    const RegexpKey *key = (const RegexpKey *) keyPtr;
+    const RegexpKey *entryKey = (const RegexpKey *) &hPtr->key;
+
+    return key->flags == entryKey->flags && key->length == entryKey->length
+	    && memcmp(key->bytes, entryKey->bytes, key->length) == 0;
+}
+
+static Tcl_HashEntry *
+AllocRegexpEntry(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)
+{
+    const RegexpKey *key = (const RegexpKey *) keyPtr;
+    Tcl_HashEntry *hPtr = (Tcl_HashEntry *)Tcl_Alloc(
+	    offsetof(Tcl_HashEntry, key) + sizeof(RegexpKey) + key->length + 1);
+    RegexpKey *entryKey = (RegexpKey *) &hPtr->key;
+    char *bytes = (char *) (entryKey + 1);
+
+    memcpy(bytes, key->bytes, key->length);
+    bytes[key->length] = '\0';
+    entryKey->flags = key->flags;
+    entryKey->length = key->length;
+    entryKey->bytes = bytes;
+    Tcl_SetHashValue(hPtr, NULL);
+    return hPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1017,7 +1811,7 @@ CompileRegexp(
  *	None.
  *
  * Side effects:
- *	None.
+ *	Releases the regexp's program, which may free it.
  *
  *----------------------------------------------------------------------
  */
@@ -1026,7 +1820,7 @@ static void
 FreeRegexp(
     TclRegexp *regexpPtr)	/* Compiled regular expression to free. */
 {
-    TclReFree(&regexpPtr->re);
+    ReleaseProgram(regexpPtr->programPtr);
     if (regexpPtr->globObjPtr) {
 	TclDecrRefCount(regexpPtr->globObjPtr);
     }
@@ -1035,7 +1829,7 @@ FreeRegexp(
     }
     Tcl_Free(regexpPtr);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1056,18 +1850,12 @@ static void
 FinalizeRegexp(
     TCL_UNUSED(void *))
 {
-    int i;
-    TclRegexp *regexpPtr;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
-    for (i = 0; (i < NUM_REGEXPS) && (tsdPtr->patterns[i] != NULL); i++) {
-	regexpPtr = tsdPtr->regexps[i];
-	if (regexpPtr->refCount-- <= 1) {
-	    FreeRegexp(regexpPtr);
-	}
-	Tcl_Free(tsdPtr->patterns[i]);
-	tsdPtr->patterns[i] = NULL;
+    while (tsdPtr->firstPtr != NULL) {
+	RemoveCacheEntry(tsdPtr, tsdPtr->firstPtr);
     }
+    Tcl_DeleteHashTable(&tsdPtr->cache);
 
     /*
      * We may find ourselves reinitialized if another finalization routine
@@ -1076,7 +1864,116 @@ FinalizeRegexp(
 
     tsdPtr->initialized = 0;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRegexpCacheObjCmd --
+ *
+ *	This is the command procedure for "::tcl::unsupported::regexpcache",
+ *	which reports on and tunes the compiled regexp caches.
+ *
+ *	    regexpcache size ?numEntries?
+ *	    regexpcache stats
+ *
+ * Results:
+ *	Returns a standard Tcl completion code.
+ *
+ * Side effects:
+ *	Setting the size applies to the current thread and to threads that
+ *	have not used a regexp yet, and may evict entries.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclRegexpCacheObjCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Obj values of arguments. */
+{
+    static const char *const subcommands[] = {
+	"size", "stats", NULL
+    };
+    enum CacheSubcommands {
+	CACHE_SIZE, CACHE_STATS
+    };
+    int index;
+    Tcl_WideInt size;
+    Tcl_Size numPrograms;
+    Tcl_Obj *statsPtr;
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcommands, "subcommand", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (objc > ((index == CACHE_SIZE) ? 3 : 2)) {
+	Tcl_WrongNumArgs(interp, 2, objv,
+		(index == CACHE_SIZE) ? "?numEntries?" : NULL);
+	return TCL_ERROR;
+    }
+
+    switch ((enum CacheSubcommands) index) {
+    case CACHE_SIZE:
+	if (objc == 3) {
+	    if (TclGetWideIntFromObj(interp, objv[2], &size) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (size < 1 || size > TCL_SIZE_MAX) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"expected positive number of entries but got \"%s\"",
+			TclGetString(objv[2])));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "NUMBER",
+			(char *)NULL);
+		return TCL_ERROR;
+	    }
+	    Tcl_MutexLock(&programMutex);
+	    defaultCacheSize = (Tcl_Size) size;
+	    Tcl_MutexUnlock(&programMutex);
+	    if (tsdPtr->initialized) {
+		tsdPtr->cacheSize = (Tcl_Size) size;
+		while (tsdPtr->cache.numEntries > tsdPtr->cacheSize) {
+		    RemoveCacheEntry(tsdPtr, tsdPtr->lastPtr);
+		}
+	    }
+	} else if (tsdPtr->initialized) {
+	    size = tsdPtr->cacheSize;
+	} else {
+	    Tcl_MutexLock(&programMutex);
+	    size = defaultCacheSize;
+	    Tcl_MutexUnlock(&programMutex);
+	}
+	Tcl_SetObjResult(interp, Tcl_NewWideIntObj(size));
+	break;
+    case CACHE_STATS:
+	Tcl_MutexLock(&programMutex);
+	numPrograms = programTableInitialized ? programTable.numEntries : 0;
+	size = tsdPtr->initialized ? tsdPtr->cacheSize : defaultCacheSize;
+	Tcl_MutexUnlock(&programMutex);
+
+	TclNewObj(statsPtr);
+	TclDictPut(NULL, statsPtr, "size", Tcl_NewWideIntObj(size));
+	TclDictPut(NULL, statsPtr, "entries", Tcl_NewWideIntObj(
+		tsdPtr->initialized ? tsdPtr->cache.numEntries : 0));
+	TclDictPut(NULL, statsPtr, "hits", Tcl_NewWideIntObj(
+		(Tcl_WideInt) tsdPtr->hits));
+	TclDictPut(NULL, statsPtr, "misses", Tcl_NewWideIntObj(
+		(Tcl_WideInt) tsdPtr->misses));
+	TclDictPut(NULL, statsPtr, "shared", Tcl_NewWideIntObj(
+		(Tcl_WideInt) tsdPtr->sharedHits));
+	TclDictPut(NULL, statsPtr, "programs", Tcl_NewWideIntObj(numPrograms));
+	Tcl_SetObjResult(interp, statsPtr);
+	break;
+    }
+    return TCL_OK;
+}
+
 /*
  * Local Variables:
  * mode: c
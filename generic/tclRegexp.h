@@ -27,7 +27,11 @@
 typedef struct TclRegexp {
     int flags;			/* Regexp compile flags. */
     regex_t re;			/* Compiled re, includes number of
-				 * subexpressions. */
+				 * subexpressions. A copy of the one in
+				 * programPtr. */
+    struct RegexpProgram *programPtr;
+				/* Compiled program, shared with the regexps
+				 * of other threads for the same pattern. */
     const char *string;		/* Last string passed to Tcl_RegExpExec. */
     Tcl_Obj *objPtr;		/* Last object passed to Tcl_RegExpExecObj. */
     Tcl_Obj *globObjPtr;	/* Glob pattern rep of RE or NULL if none. */
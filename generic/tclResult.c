@@ -453,11 +453,8 @@ ResetObjResult(
 	iPtr->objResultPtr = objResultPtr;
     } else {
 	if (objResultPtr->bytes != &tclEmptyString) {
-	    if (objResultPtr->bytes) {
-		Tcl_Free(objResultPtr->bytes);
-	    }
-	    objResultPtr->bytes = &tclEmptyString;
-	    objResultPtr->length = 0;
+	    TclInvalidateStringRep(objResultPtr);
+	    TclInitEmptyStringRep(objResultPtr);
 	}
 	TclFreeInternalRep(objResultPtr);
     }
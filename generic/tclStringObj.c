@@ -143,6 +143,14 @@ GrowStringBuffer(
 
     if (objPtr->bytes == &tclEmptyString) {
 	objPtr->bytes = NULL;
+    } else if (TclHasInlineBytes(objPtr)) {
+	/*
+	 * Move the inline bytes to the heap first so they can be grown.
+	 */
+
+	ptr = (char *)Tcl_Alloc(objPtr->length + 1);
+	memcpy(ptr, objPtr->bytes, objPtr->length + 1);
+	objPtr->bytes = ptr;
     }
     /*
      * In code below, note 'capacity' and 'needed' include terminating nul,
@@ -302,7 +310,7 @@ Tcl_DbNewStringObj(
 	length = (bytes? strlen(bytes) : 0);
     }
     TclDbNewObj(objPtr, file, line);
-    if (!TclAttemptInitStringRep(objPtr, bytes, length)) {
+    if (!TclAttemptInitNewStringRep(objPtr, bytes, length)) {
 	Tcl_Panic("Failed to allocate %" TCL_SIZE_MODIFIER
 		"d bytes. %s:%d", length, file, line);
     }
@@ -390,6 +398,14 @@ Tcl_GetCharLength(
 	return objPtr->length;
     }
 
+    /*
+     * Ropes know their length without being flattened.
+     */
+
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return TclRopeCharLength(objPtr);
+    }
+
     /*
      * Optimize the case where we're really dealing with a byte-array object;
      * we don't need to convert to a string to perform the get-length operation.
@@ -441,6 +457,14 @@ TclGetCharLength(
 	return objPtr->length;
     }
 
+    /*
+     * Ropes know their length without being flattened.
+     */
+
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return TclRopeCharLength(objPtr);
+    }
+
     /*
      * Optimize the case where we're really dealing with a byte-array object;
      * we don't need to convert to a string to perform the get-length operation.
@@ -503,6 +527,11 @@ TclCheckEmptyString(
 	return length == 0;
     }
 
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	/* Ropes are never empty. */
+	return TCL_EMPTYSTRING_NO;
+    }
+
     if (objPtr->bytes == NULL) {
 	return TCL_EMPTYSTRING_UNKNOWN;
     }
@@ -698,6 +727,31 @@ Tcl_GetUnicodeFromObj(
     return stringPtr->unicode;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclHasUnicodeRep --
+ *
+ *	Tells whether a value already holds the Unicode form of its string,
+ *	so that Tcl_GetUnicodeFromObj would not have to build it.
+ *
+ * Results:
+ *	1 if the value has a Unicode rep, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclHasUnicodeRep(
+    Tcl_Obj *objPtr)
+{
+    return TclHasInternalRep(objPtr, &tclStringType)
+	    && GET_STRING(objPtr)->hasUnicode;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -753,6 +807,14 @@ Tcl_GetRange(
 	return Tcl_NewByteArrayObj(bytes + first, last - first + 1);
     }
 
+    /*
+     * Substrings of ropes share the leaves of the rope.
+     */
+
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return TclRopeRange(objPtr, first, last);
+    }
+
     /*
      * OK, need to work with the object as a string.
      */
@@ -832,6 +894,10 @@ TclGetRange(
 	return Tcl_NewByteArrayObj(bytes + first, last - first + 1);
     }
 
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return TclRopeRange(objPtr, first, last);
+    }
+
     Tcl_Size numChars = TclNumUtfChars(objPtr->bytes, objPtr->length);
 
     if (last < 0 || last >= numChars) {
@@ -955,6 +1021,11 @@ Tcl_SetObjLength(
 	     */
 	    if (objPtr->bytes == &tclEmptyString) {
 		objPtr->bytes = (char *)Tcl_Alloc(length + 1);
+	    } else if (TclHasInlineBytes(objPtr)) {
+		char *newBytes = (char *)Tcl_Alloc(length + 1);
+
+		memcpy(newBytes, objPtr->bytes, objPtr->length);
+		objPtr->bytes = newBytes;
 	    } else {
 		objPtr->bytes = (char *)Tcl_Realloc(objPtr->bytes, length + 1);
 	    }
@@ -1053,6 +1124,11 @@ Tcl_AttemptSetObjLength(
 
 	    if (objPtr->bytes == &tclEmptyString) {
 		newBytes = (char *)Tcl_AttemptAlloc(length + 1U);
+	    } else if (TclHasInlineBytes(objPtr)) {
+		newBytes = (char *)Tcl_AttemptAlloc(length + 1U);
+		if (newBytes) {
+		    memcpy(newBytes, objPtr->bytes, objPtr->length);
+		}
 	    } else {
 		newBytes = (char *)Tcl_AttemptRealloc(objPtr->bytes, length + 1U);
 	    }
@@ -1250,6 +1326,22 @@ Tcl_AppendLimitedToObj(
 	Tcl_Panic("%s called with shared object", "Tcl_AppendLimitedToObj");
     }
 
+    /*
+     * Keep ropes as ropes when nothing needs to be trimmed.
+     */
+
+    if (TclHasInternalRep(objPtr, &tclRopeType) && (length <= limit)) {
+	Tcl_Obj *appendObjPtr = Tcl_NewStringObj(bytes, toCopy);
+	int appended;
+
+	Tcl_IncrRefCount(appendObjPtr);
+	appended = TclRopeAppend(objPtr, appendObjPtr);
+	Tcl_DecrRefCount(appendObjPtr);
+	if (appended) {
+	    return;
+	}
+    }
+
     SetStringFromAny(NULL, objPtr);
     stringPtr = GET_STRING(objPtr);
 
@@ -1396,6 +1488,15 @@ Tcl_AppendObjToObj(
 	return;
     }
 
+    /*
+     * Appending to a rope adds a leaf to it rather than flattening it.
+     */
+
+    if (TclHasInternalRep(objPtr, &tclRopeType)
+	    && TclRopeAppend(objPtr, appendObjPtr)) {
+	return;
+    }
+
     if (TclIsPureByteArray(appendObjPtr)
 	    && (TclIsPureByteArray(objPtr) || objPtr->bytes == &tclEmptyString)) {
 	/*
@@ -3173,6 +3274,16 @@ TclStringCat(
 	return objv[0];
     }
 
+    /*
+     * Large results are built as ropes sharing the bytes of the values
+     * rather than as copies. See tclStringRope.c.
+     */
+
+    objResultPtr = TclRopeCat(objc, objv, flags);
+    if (objResultPtr != NULL) {
+	return objResultPtr;
+    }
+
     /*
      * Analyze to determine what representation result should be.
      * GOALS:	Avoid shimmering & string rep generation.
@@ -3661,6 +3772,14 @@ TclStringCmp(
 	 * Note: as documented reqlength negative means it is ignored
 	 */
 	match = 0;
+    } else if (checkEq && !nocase && (reqlength < 0)
+	    && TclHasInternalRep(value1Ptr, &tclInternType)
+	    && TclHasInternalRep(value2Ptr, &tclInternType)) {
+	/*
+	 * Distinct interned values never have equal strings.
+	 */
+
+	match = 1;
     } else {
 	if (!nocase && TclIsPureByteArray(value1Ptr)
 		&& TclIsPureByteArray(value2Ptr)) {
@@ -4276,6 +4395,10 @@ TclStringReplace(
 	/* Flow through to try other approaches below */
     }
 
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return TclRopeReplace(objPtr, first, count, insertPtr);
+    }
+
     /*
      * TODO: Figure out how not to generate a Tcl_UniChar array rep
      * when it can be determined objPtr->bytes points to a string of
@@ -0,0 +1,955 @@
+/*
+ * tclStringRope.c --
+ *
+ *	This file implements the "rope" internal representation of large
+ *	string values built by concatenation. A rope is a binary tree whose
+ *	leaves refer to (slices of) the string representations of other Tcl
+ *	values. Concatenation, appending, substring and replacement of a rope
+ *	share the leaves instead of copying bytes around, and the string
+ *	representation of the whole value is only generated (flattened) when
+ *	somebody asks for it through Tcl_GetString() or similar.
+ *
+ *	Ropes are never created for small values, where a plain copy is both
+ *	cheaper and friendlier to the rest of the core. See TCL_ROPE_MIN_LENGTH
+ *	below.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+#include "tclStringRep.h"
+#include <assert.h>
+
+/*
+ * Tuning parameters:
+ *
+ * TCL_ROPE_MIN_LENGTH	Number of bytes a concatenation result must reach
+ *			before it is produced as a rope rather than as a
+ *			flat copy. Range results shorter than this are
+ *			always flattened.
+ * TCL_ROPE_LEAF_MERGE	Adjacent leaves whose combined size does not
+ *			exceed this are copied into a single leaf. This
+ *			keeps the number of nodes bounded when many small
+ *			pieces are appended one at a time.
+ * TCL_ROPE_MAX_DEPTH	Ropes deeper than this are rebuilt as a balanced
+ *			tree.
+ */
+
+#ifndef TCL_ROPE_MIN_LENGTH
+#define TCL_ROPE_MIN_LENGTH	32768
+#endif
+#ifndef TCL_ROPE_LEAF_MERGE
+#define TCL_ROPE_LEAF_MERGE	1024
+#endif
+#ifndef TCL_ROPE_MAX_DEPTH
+#define TCL_ROPE_MAX_DEPTH	48
+#endif
+
+/*
+ * A node of a rope. Nodes are immutable once built (except for the lazily
+ * computed numChars field) and reference counted, so any number of ropes
+ * may share them.
+ */
+
+typedef struct RopeNode {
+    size_t refCount;		/* Number of ropes and nodes referring to
+				 * this node. */
+    Tcl_Size numBytes;		/* Number of UTF-8 bytes covered. */
+    Tcl_Size numChars;		/* Number of chars covered, or TCL_INDEX_NONE
+				 * when not computed yet. */
+    Tcl_Size numLeaves;		/* Number of leaves below this node. */
+    int depth;			/* Height of the subtree, 0 for a leaf. */
+    struct RopeNode *left;	/* Children of an interior node. NULL for a
+				 * leaf. */
+    struct RopeNode *right;
+    Tcl_Obj *objPtr;		/* Leaf only: the value holding the bytes. */
+    Tcl_Size offset;		/* Leaf only: byte offset of the slice in the
+				 * string rep of objPtr. */
+} RopeNode;
+
+#define ROPE(objPtr) \
+    ((RopeNode *) (objPtr)->internalRep.twoPtrValue.ptr1)
+
+#define ISCONTINUATION(bytes) (\
+	((bytes)[0] & 0xC0) == 0x80)
+
+/*
+ * Prototypes for functions defined later in this file:
+ */
+
+static RopeNode *	AppendLeaf(RopeNode *ropePtr, RopeNode *leafPtr);
+static void		BuildBalanced(RopeNode **leaves, Tcl_Size numLeaves,
+			    RopeNode **resultPtr);
+static Tcl_Size		CharToByte(RopeNode *ropePtr, Tcl_Size charIndex);
+static void		CollectLeaves(RopeNode *ropePtr, RopeNode **leaves,
+			    Tcl_Size *indexPtr);
+static RopeNode *	ConcatNodes(RopeNode *leftPtr, RopeNode *rightPtr);
+static void		CopyBytes(RopeNode *ropePtr, Tcl_Size start,
+			    Tcl_Size numBytes, char *dst);
+static void		DupRopeInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr);
+static void		FreeRopeInternalRep(Tcl_Obj *objPtr);
+static Tcl_Obj *	NewRopeObj(RopeNode *ropePtr);
+static RopeNode *	NewInteriorNode(RopeNode *leftPtr, RopeNode *rightPtr);
+static RopeNode *	NewLeafNode(Tcl_Obj *objPtr, Tcl_Size offset,
+			    Tcl_Size numBytes);
+static Tcl_Size		RopeNumChars(RopeNode *ropePtr);
+static void		RopeRelease(RopeNode *ropePtr);
+static RopeNode *	Substring(RopeNode *ropePtr, Tcl_Size start,
+			    Tcl_Size numBytes);
+static void		UpdateStringOfRope(Tcl_Obj *objPtr);
+
+/*
+ * The rope Tcl object type. There is no setFromAnyProc: ropes are only ever
+ * made by the functions in this file.
+ */
+
+const Tcl_ObjType tclRopeType = {
+    "rope",			/* name */
+    FreeRopeInternalRep,	/* freeIntRepProc */
+    DupRopeInternalRep,		/* dupIntRepProc */
+    UpdateStringOfRope,		/* updateStringProc */
+    NULL,			/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
+#define LeafBytes(leafPtr) \
+    (TclGetString((leafPtr)->objPtr) + (leafPtr)->offset)
+
+static inline RopeNode *
+RopeRetain(
+    RopeNode *ropePtr)
+{
+    ropePtr->refCount++;
+    return ropePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewLeafNode, NewInteriorNode --
+ *
+ *	Allocate rope nodes. The new node has a zero reference count; the
+ *	children of an interior node have their reference count incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RopeNode *
+NewLeafNode(
+    Tcl_Obj *objPtr,		/* Value holding the bytes. */
+    Tcl_Size offset,		/* Start of the slice in its string rep. */
+    Tcl_Size numBytes)		/* Length of the slice. */
+{
+    RopeNode *leafPtr = (RopeNode *)Tcl_Alloc(sizeof(RopeNode));
+    const char *bytes = TclGetString(objPtr);
+
+    if (numBytes <= TCL_ROPE_LEAF_MERGE && numBytes < objPtr->length) {
+	/*
+	 * Don't keep a large value alive for the sake of a small slice.
+	 */
+
+	objPtr = Tcl_NewStringObj(bytes + offset, numBytes);
+	offset = 0;
+    }
+
+    leafPtr->refCount = 0;
+    leafPtr->numBytes = numBytes;
+    leafPtr->numChars = TCL_INDEX_NONE;
+    leafPtr->numLeaves = 1;
+    leafPtr->depth = 0;
+    leafPtr->left = leafPtr->right = NULL;
+    leafPtr->objPtr = objPtr;
+    leafPtr->offset = offset;
+    Tcl_IncrRefCount(objPtr);
+
+    /*
+     * Borrow the char count of a whole string value when it is known.
+     */
+
+    if (offset == 0 && numBytes == objPtr->length
+	    && TclHasInternalRep(objPtr, &tclStringType)
+	    && GET_STRING(objPtr)->numChars >= 0) {
+	leafPtr->numChars = GET_STRING(objPtr)->numChars;
+    }
+    return leafPtr;
+}
+
+static RopeNode *
+NewInteriorNode(
+    RopeNode *leftPtr,
+    RopeNode *rightPtr)
+{
+    RopeNode *nodePtr = (RopeNode *)Tcl_Alloc(sizeof(RopeNode));
+
+    nodePtr->refCount = 0;
+    nodePtr->numBytes = leftPtr->numBytes + rightPtr->numBytes;
+    nodePtr->numChars = TCL_INDEX_NONE;
+    if (leftPtr->numChars >= 0 && rightPtr->numChars >= 0) {
+	nodePtr->numChars = leftPtr->numChars + rightPtr->numChars;
+    }
+    nodePtr->numLeaves = leftPtr->numLeaves + rightPtr->numLeaves;
+    nodePtr->depth = 1 + (leftPtr->depth > rightPtr->depth
+	    ? leftPtr->depth : rightPtr->depth);
+    nodePtr->left = RopeRetain(leftPtr);
+    nodePtr->right = RopeRetain(rightPtr);
+    nodePtr->objPtr = NULL;
+    nodePtr->offset = 0;
+    return nodePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RopeRelease --
+ *
+ *	Drop a reference to a rope node, freeing it (and whatever it alone
+ *	refers to) when no references remain. Also used to dispose of freshly
+ *	built nodes that were never retained.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RopeRelease(
+    RopeNode *ropePtr)
+{
+    if (ropePtr->refCount > 1) {
+	ropePtr->refCount--;
+	return;
+    }
+    if (ropePtr->depth == 0) {
+	Tcl_DecrRefCount(ropePtr->objPtr);
+    } else {
+	RopeRelease(ropePtr->left);
+	RopeRelease(ropePtr->right);
+    }
+    Tcl_Free(ropePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RopeNumChars --
+ *
+ *	Number of chars covered by a rope node, computed on first use and
+ *	cached in the node.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Size
+RopeNumChars(
+    RopeNode *ropePtr)
+{
+    if (ropePtr->numChars < 0) {
+	if (ropePtr->depth == 0) {
+	    ropePtr->numChars = TclNumUtfChars(LeafBytes(ropePtr),
+		    ropePtr->numBytes);
+	} else {
+	    ropePtr->numChars = RopeNumChars(ropePtr->left)
+		    + RopeNumChars(ropePtr->right);
+	}
+    }
+    return ropePtr->numChars;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CharToByte --
+ *
+ *	Translate a char index into a byte offset within a rope. The index
+ *	may be equal to the number of chars, denoting the end of the rope.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Size
+CharToByte(
+    RopeNode *ropePtr,
+    Tcl_Size charIndex)
+{
+    Tcl_Size byteOffset = 0;
+    const char *bytes;
+
+    while (1) {
+	if (RopeNumChars(ropePtr) == ropePtr->numBytes) {
+	    /* Single byte chars only, nothing to search. */
+	    return byteOffset + charIndex;
+	}
+	if (ropePtr->depth == 0) {
+	    break;
+	}
+	if (charIndex < RopeNumChars(ropePtr->left)) {
+	    ropePtr = ropePtr->left;
+	} else {
+	    charIndex -= RopeNumChars(ropePtr->left);
+	    byteOffset += ropePtr->left->numBytes;
+	    ropePtr = ropePtr->right;
+	}
+    }
+    bytes = LeafBytes(ropePtr);
+    return byteOffset + (TclUtfAtIndex(bytes, charIndex) - bytes);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CopyBytes --
+ *
+ *	Copy numBytes bytes of a rope starting at byte offset start to dst.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CopyBytes(
+    RopeNode *ropePtr,
+    Tcl_Size start,
+    Tcl_Size numBytes,
+    char *dst)
+{
+    while (numBytes > 0) {
+	if (ropePtr->depth == 0) {
+	    memcpy(dst, LeafBytes(ropePtr) + start, numBytes);
+	    return;
+	}
+	if (start < ropePtr->left->numBytes) {
+	    Tcl_Size n = ropePtr->left->numBytes - start;
+
+	    if (n > numBytes) {
+		n = numBytes;
+	    }
+	    CopyBytes(ropePtr->left, start, n, dst);
+	    dst += n;
+	    numBytes -= n;
+	    start = 0;
+	} else {
+	    start -= ropePtr->left->numBytes;
+	}
+	ropePtr = ropePtr->right;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendLeaf --
+ *
+ *	Append a leaf to a rope. The rope is filled like a binary counter: the
+ *	leaf goes into the right subtree for as long as that is not a perfect
+ *	tree as deep as the left one, so that a rope built by repeated
+ *	appends stays balanced. The path to the insertion point is copied;
+ *	the original rope is left untouched. Small adjacent leaves are merged.
+ *
+ * Results:
+ *	A new node with zero reference count.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RopeNode *
+AppendLeaf(
+    RopeNode *ropePtr,
+    RopeNode *leafPtr)
+{
+    RopeNode *rightPtr;
+
+    if (ropePtr->depth == 0) {
+	if (ropePtr->numBytes + leafPtr->numBytes <= TCL_ROPE_LEAF_MERGE) {
+	    Tcl_Obj *objPtr;
+	    char *dst;
+
+	    TclNewObj(objPtr);
+	    dst = Tcl_InitStringRep(objPtr, NULL,
+		    ropePtr->numBytes + leafPtr->numBytes);
+	    memcpy(dst, LeafBytes(ropePtr), ropePtr->numBytes);
+	    memcpy(dst + ropePtr->numBytes, LeafBytes(leafPtr),
+		    leafPtr->numBytes);
+	    return NewLeafNode(objPtr, 0, objPtr->length);
+	}
+	return NewInteriorNode(ropePtr, leafPtr);
+    }
+
+    rightPtr = ropePtr->right;
+    if (rightPtr->depth < ropePtr->left->depth
+	    || rightPtr->numLeaves != ((Tcl_Size) 1 << rightPtr->depth)) {
+	return NewInteriorNode(ropePtr->left, AppendLeaf(rightPtr, leafPtr));
+    }
+    return NewInteriorNode(ropePtr, leafPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CollectLeaves, BuildBalanced --
+ *
+ *	Rebuild a rope that got too deep as a balanced tree over the same
+ *	leaves.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CollectLeaves(
+    RopeNode *ropePtr,
+    RopeNode **leaves,
+    Tcl_Size *indexPtr)
+{
+    while (ropePtr->depth) {
+	CollectLeaves(ropePtr->left, leaves, indexPtr);
+	ropePtr = ropePtr->right;
+    }
+    leaves[(*indexPtr)++] = ropePtr;
+}
+
+static void
+BuildBalanced(
+    RopeNode **leaves,
+    Tcl_Size numLeaves,
+    RopeNode **resultPtr)
+{
+    RopeNode *leftPtr, *rightPtr;
+    Tcl_Size half;
+
+    if (numLeaves == 1) {
+	*resultPtr = leaves[0];
+	return;
+    }
+    half = numLeaves / 2;
+    BuildBalanced(leaves, half, &leftPtr);
+    BuildBalanced(leaves + half, numLeaves - half, &rightPtr);
+    *resultPtr = NewInteriorNode(leftPtr, rightPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ConcatNodes --
+ *
+ *	Concatenate two non-empty ropes.
+ *
+ * Results:
+ *	A node for the concatenation. It may have a zero reference count, in
+ *	which case the caller must retain or release it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RopeNode *
+ConcatNodes(
+    RopeNode *leftPtr,
+    RopeNode *rightPtr)
+{
+    RopeNode *nodePtr, **leaves;
+    Tcl_Size i = 0;
+
+    if (rightPtr->depth == 0) {
+	return AppendLeaf(leftPtr, rightPtr);
+    }
+    nodePtr = NewInteriorNode(leftPtr, rightPtr);
+    if (nodePtr->depth <= TCL_ROPE_MAX_DEPTH) {
+	return nodePtr;
+    }
+
+    leaves = (RopeNode **)Tcl_Alloc(nodePtr->numLeaves * sizeof(RopeNode *));
+    CollectLeaves(nodePtr, leaves, &i);
+    RopeRetain(nodePtr);
+    BuildBalanced(leaves, i, &leftPtr);
+    RopeRelease(nodePtr);
+    Tcl_Free(leaves);
+    return leftPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Substring --
+ *
+ *	Extract the bytes [start, start+numBytes) of a rope, sharing the
+ *	leaves. numBytes must be positive and the range must lie on char
+ *	boundaries.
+ *
+ * Results:
+ *	A node for the substring, possibly one of the existing nodes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RopeNode *
+Substring(
+    RopeNode *ropePtr,
+    Tcl_Size start,
+    Tcl_Size numBytes)
+{
+    Tcl_Size leftBytes;
+
+    if (start == 0 && numBytes == ropePtr->numBytes) {
+	return ropePtr;
+    }
+    if (ropePtr->depth == 0) {
+	return NewLeafNode(ropePtr->objPtr, ropePtr->offset + start,
+		numBytes);
+    }
+    leftBytes = ropePtr->left->numBytes;
+    if (start + numBytes <= leftBytes) {
+	return Substring(ropePtr->left, start, numBytes);
+    }
+    if (start >= leftBytes) {
+	return Substring(ropePtr->right, start - leftBytes, numBytes);
+    }
+    return NewInteriorNode(Substring(ropePtr->left, start, leftBytes - start),
+	    Substring(ropePtr->right, 0, start + numBytes - leftBytes));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewRopeObj --
+ *
+ *	Make a new value with no string rep whose internal rep is the given
+ *	rope.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+NewRopeObj(
+    RopeNode *ropePtr)
+{
+    Tcl_Obj *objPtr;
+
+    TclNewObj(objPtr);
+    TclInvalidateStringRep(objPtr);
+    objPtr->internalRep.twoPtrValue.ptr1 = RopeRetain(ropePtr);
+    objPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    objPtr->typePtr = &tclRopeType;
+    return objPtr;
+}
+
+/*
+ * Rope of the value of an object: its own rope, or a single leaf covering
+ * its string rep.
+ */
+
+static inline RopeNode *
+RopeOfObj(
+    Tcl_Obj *objPtr)
+{
+    if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	return ROPE(objPtr);
+    }
+    TclGetString(objPtr);
+    return NewLeafNode(objPtr, 0, objPtr->length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeCat --
+ *
+ *	Try to perform [string cat] by building a rope. This is done when one
+ *	of the values is a rope already, or when the result is large and all
+ *	values already have their string reps.
+ *
+ * Results:
+ *	The concatenation, or NULL when a rope is not appropriate, in which
+ *	case the caller should fall back to making a copy.
+ *
+ * Side effects:
+ *	May generate string reps for the values.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclRopeCat(
+    Tcl_Size objc,
+    Tcl_Obj *const objv[],
+    int flags)			/* TCL_STRING_IN_PLACE => objv[0] could be
+				 * appended to in place by the caller. */
+{
+    Tcl_Size i, numBytes = 0;
+    int haveRope = 0;
+    RopeNode *ropePtr = NULL;
+    Tcl_Obj *objPtr;
+
+    for (i = 0; i < objc; i++) {
+	if (TclHasInternalRep(objv[i], &tclRopeType)) {
+	    haveRope = 1;
+	    break;
+	}
+    }
+    if (!haveRope) {
+	if ((flags & TCL_STRING_IN_PLACE) && !Tcl_IsShared(objv[0])) {
+	    /* Growing the buffer in place is cheaper still. */
+	    return NULL;
+	}
+	for (i = 0; i < objc; i++) {
+	    if (TclIsPureByteArray(objv[i]) || (objv[i]->bytes == NULL
+		    && TclHasInternalRep(objv[i], &tclStringType))) {
+		/*
+		 * Leave pure byte arrays and pure Unicode values to
+		 * TclStringCat, which knows how to keep them that way.
+		 */
+
+		return NULL;
+	    }
+	    if (objv[i]->bytes) {
+		numBytes += objv[i]->length;
+	    }
+	}
+	if (numBytes < TCL_ROPE_MIN_LENGTH) {
+	    /*
+	     * Don't generate any string reps unless the result is known to
+	     * be large.
+	     */
+
+	    return NULL;
+	}
+	numBytes = 0;
+    }
+
+    for (i = 0; i < objc; i++) {
+	objPtr = objv[i];
+	if (TclHasInternalRep(objPtr, &tclRopeType)) {
+	    numBytes += ROPE(objPtr)->numBytes;
+	} else if (TclCheckEmptyString(objPtr) != TCL_EMPTYSTRING_YES) {
+	    TclGetString(objPtr);
+	    if (i > 0 && objPtr->length && ISCONTINUATION(objPtr->bytes)) {
+		return NULL;
+	    }
+	    numBytes += objPtr->length;
+	}
+	if (numBytes < 0) {
+	    /* Overflow, let TclStringCat report it. */
+	    return NULL;
+	}
+    }
+    if (numBytes < TCL_ROPE_MIN_LENGTH) {
+	return NULL;
+    }
+
+    for (i = 0; i < objc; i++) {
+	RopeNode *piecePtr, *newPtr;
+
+	objPtr = objv[i];
+	if (!TclHasInternalRep(objPtr, &tclRopeType)
+		&& (objPtr->bytes == NULL || objPtr->length == 0)) {
+	    /* Known to be empty */
+	    continue;
+	}
+	piecePtr = RopeRetain(RopeOfObj(objPtr));
+	if (ropePtr == NULL) {
+	    ropePtr = piecePtr;
+	    continue;
+	}
+	newPtr = RopeRetain(ConcatNodes(ropePtr, piecePtr));
+	RopeRelease(piecePtr);
+	RopeRelease(ropePtr);
+	ropePtr = newPtr;
+    }
+
+    objPtr = NewRopeObj(ropePtr);
+    RopeRelease(ropePtr);
+    return objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeAppend --
+ *
+ *	Append the string value of appendObjPtr to the unshared rope objPtr,
+ *	keeping it a rope.
+ *
+ * Results:
+ *	1 if the value was appended, 0 if it could not be done this way, in
+ *	which case the caller must take the general route.
+ *
+ * Side effects:
+ *	Invalidates the string rep of objPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclRopeAppend(
+    Tcl_Obj *objPtr,
+    Tcl_Obj *appendObjPtr)
+{
+    RopeNode *piecePtr, *ropePtr = ROPE(objPtr);
+
+    assert(TclHasInternalRep(objPtr, &tclRopeType));
+    if (!TclHasInternalRep(appendObjPtr, &tclRopeType)
+	    && TclGetString(appendObjPtr)[0] != '\0'
+	    && ISCONTINUATION(appendObjPtr->bytes)) {
+	return 0;
+    }
+    piecePtr = RopeRetain(RopeOfObj(appendObjPtr));
+    if (piecePtr->numBytes > 0) {
+	objPtr->internalRep.twoPtrValue.ptr1 =
+		RopeRetain(ConcatNodes(ropePtr, piecePtr));
+	RopeRelease(ropePtr);
+	TclInvalidateStringRep(objPtr);
+    }
+    RopeRelease(piecePtr);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeCharLength --
+ *
+ *	Number of chars in a rope value, without flattening it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Size
+TclRopeCharLength(
+    Tcl_Obj *objPtr)
+{
+    return RopeNumChars(ROPE(objPtr));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeRange --
+ *
+ *	Implements Tcl_GetRange() for rope values. Large results share the
+ *	leaves of the rope, small ones are copied out.
+ *
+ * Results:
+ *	A new value holding chars first through last.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclRopeRange(
+    Tcl_Obj *objPtr,
+    Tcl_Size first,
+    Tcl_Size last)
+{
+    RopeNode *ropePtr = ROPE(objPtr), *subPtr;
+    Tcl_Size numChars = RopeNumChars(ropePtr), start, end;
+    Tcl_Obj *newObjPtr;
+
+    if (first < 0) {
+	first = 0;
+    }
+    if (last < 0 || last >= numChars) {
+	last = numChars - 1;
+    }
+    if (last < first) {
+	TclNewObj(newObjPtr);
+	return newObjPtr;
+    }
+    start = CharToByte(ropePtr, first);
+    end = CharToByte(ropePtr, last + 1);
+
+    if (end - start < TCL_ROPE_MIN_LENGTH) {
+	TclNewObj(newObjPtr);
+	CopyBytes(ropePtr, start, end - start,
+		Tcl_InitStringRep(newObjPtr, NULL, end - start));
+	return newObjPtr;
+    }
+
+    subPtr = RopeRetain(Substring(ropePtr, start, end - start));
+    newObjPtr = NewRopeObj(subPtr);
+    RopeRelease(subPtr);
+    return newObjPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeReplace --
+ *
+ *	Implements TclStringReplace() for rope values: the result is a rope
+ *	made of the prefix, the insertion and the suffix.
+ *
+ * Results:
+ *	A new value.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclRopeReplace(
+    Tcl_Obj *objPtr,		/* Rope to act upon */
+    Tcl_Size first,		/* First char index to replace */
+    Tcl_Size count,		/* How many chars to replace */
+    Tcl_Obj *insertPtr)		/* Replacement string, may be NULL */
+{
+    RopeNode *ropePtr = ROPE(objPtr), *resultPtr = NULL, *piecePtr, *newPtr;
+    Tcl_Size numChars = RopeNumChars(ropePtr), start, end;
+    Tcl_Obj *newObjPtr;
+
+    if (first < 0) {
+	first = 0;
+    }
+    if (first > numChars) {
+	first = numChars;
+    }
+    if (count < 0) {
+	count = 0;
+    }
+    if (count > numChars - first) {
+	count = numChars - first;
+    }
+    start = CharToByte(ropePtr, first);
+    end = CharToByte(ropePtr, first + count);
+
+    if (start > 0) {
+	resultPtr = RopeRetain(Substring(ropePtr, 0, start));
+    }
+    if (insertPtr != NULL) {
+	piecePtr = RopeRetain(RopeOfObj(insertPtr));
+	if (piecePtr->numBytes == 0) {
+	    RopeRelease(piecePtr);
+	} else if (resultPtr == NULL) {
+	    resultPtr = piecePtr;
+	} else {
+	    newPtr = RopeRetain(ConcatNodes(resultPtr, piecePtr));
+	    RopeRelease(piecePtr);
+	    RopeRelease(resultPtr);
+	    resultPtr = newPtr;
+	}
+    }
+    if (end < ropePtr->numBytes) {
+	piecePtr = RopeRetain(Substring(ropePtr, end, ropePtr->numBytes - end));
+	if (resultPtr == NULL) {
+	    resultPtr = piecePtr;
+	} else {
+	    newPtr = RopeRetain(ConcatNodes(resultPtr, piecePtr));
+	    RopeRelease(piecePtr);
+	    RopeRelease(resultPtr);
+	    resultPtr = newPtr;
+	}
+    }
+
+    if (resultPtr == NULL) {
+	TclNewObj(newObjPtr);
+	return newObjPtr;
+    }
+    if (resultPtr->numBytes < TCL_ROPE_MIN_LENGTH) {
+	TclNewObj(newObjPtr);
+	CopyBytes(resultPtr, 0, resultPtr->numBytes,
+		Tcl_InitStringRep(newObjPtr, NULL, resultPtr->numBytes));
+	RopeRelease(resultPtr);
+	return newObjPtr;
+    }
+    newObjPtr = NewRopeObj(resultPtr);
+    RopeRelease(resultPtr);
+    return newObjPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRopeForeachLeaf --
+ *
+ *	Call proc on each leaf of a rope value, in order, so that callers such
+ *	as the channel code can stream a rope without flattening it.
+ *	Iteration stops at the first call not returning TCL_OK.
+ *
+ * Results:
+ *	TCL_OK, or the result of the call that stopped the iteration.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ForeachLeaf(
+    RopeNode *ropePtr,
+    TclRopeLeafProc *proc,
+    void *clientData)
+{
+    int code;
+
+    while (ropePtr->depth) {
+	code = ForeachLeaf(ropePtr->left, proc, clientData);
+	if (code != TCL_OK) {
+	    return code;
+	}
+	ropePtr = ropePtr->right;
+    }
+    return proc(clientData, LeafBytes(ropePtr), ropePtr->numBytes);
+}
+
+int
+TclRopeForeachLeaf(
+    Tcl_Obj *objPtr,
+    TclRopeLeafProc *proc,
+    void *clientData)
+{
+    RopeNode *ropePtr = RopeRetain(ROPE(objPtr));
+    int code;
+
+    /* Hold the rope in case proc causes objPtr to shimmer. */
+    code = ForeachLeaf(ropePtr, proc, clientData);
+    RopeRelease(ropePtr);
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeRopeInternalRep, DupRopeInternalRep --
+ *
+ *	Standard internal rep management for ropes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeRopeInternalRep(
+    Tcl_Obj *objPtr)
+{
+    RopeRelease(ROPE(objPtr));
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupRopeInternalRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *copyPtr)
+{
+    copyPtr->internalRep.twoPtrValue.ptr1 = RopeRetain(ROPE(srcPtr));
+    copyPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    copyPtr->typePtr = &tclRopeType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UpdateStringOfRope --
+ *
+ *	Flatten a rope into the string rep of its value.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UpdateStringOfRope(
+    Tcl_Obj *objPtr)
+{
+    RopeNode *ropePtr = ROPE(objPtr);
+    char *dst = Tcl_InitStringRep(objPtr, NULL, ropePtr->numBytes);
+
+    TclOOM(dst, ropePtr->numBytes + 1);
+    CopyBytes(ropePtr, 0, ropePtr->numBytes, dst);
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
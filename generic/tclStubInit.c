@@ -1499,7 +1499,12 @@ const TclStubs tclStubs = {
     Tcl_SetWideUIntObj, /* 689 */
     Tcl_IsEmpty, /* 690 */
     Tcl_GetEncodingNameForUser, /* 691 */
-    TclUnusedStubEntry, /* 692 */
+    Tcl_InternObj, /* 692 */
+    Tcl_InternString, /* 693 */
+    Tcl_FreezeObj, /* 694 */
+    Tcl_GetRegExpSetFromObj, /* 695 */
+    Tcl_RegExpSetExecObj, /* 696 */
+    TclUnusedStubEntry, /* 697 */
 };
 
 /* !END!: Do not edit above this line. */
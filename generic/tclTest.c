@@ -251,6 +251,9 @@ static Tcl_ObjCmdProc	TestlinkarrayCmd;
 static Tcl_ObjCmdProc	TestlistrepCmd;
 static Tcl_ObjCmdProc	TestlocaleCmd;
 static Tcl_ObjCmdProc	TestmainthreadCmd;
+#if TCL_THREADS && defined(USE_THREAD_ALLOC)
+static Tcl_ObjCmdProc	TestmeminfoCmd;
+#endif
 static Tcl_ObjCmdProc	TestmsbObjCmd;
 static Tcl_ObjCmdProc	TestsetmainloopCmd;
 static Tcl_ObjCmdProc	TestexitmainloopCmd;
@@ -324,6 +327,7 @@ static Tcl_ObjCmdProc	TestGetUniCharCmd;
 static Tcl_ObjCmdProc	TestFindFirstCmd;
 static Tcl_ObjCmdProc	TestFindLastCmd;
 static Tcl_ObjCmdProc	TestHashSystemHashCmd;
+static Tcl_ObjCmdProc	TestHashIncrementalCmd;
 static Tcl_ObjCmdProc	TestGetIntForIndexCmd;
 static Tcl_ObjCmdProc	TestLutilCmd;
 static Tcl_NRPostProc	NREUnwind_callback;
@@ -635,6 +639,8 @@ Tcltest_Init(
 	    NULL, NULL);
     Tcl_CreateObjCommand(interp, "testhashsystemhash",
 	    TestHashSystemHashCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "testhashincremental",
+	    TestHashIncrementalCmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, "testgetassocdata", TestgetassocdataCmd,
 	    NULL, NULL);
     Tcl_CreateObjCommand(interp, "testgetint", TestgetintCmd,
@@ -711,6 +717,9 @@ Tcltest_Init(
     Tcl_CreateObjCommand(interp, "testupvar", TestupvarCmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, "testmainthread", TestmainthreadCmd, NULL,
 	    NULL);
+#if TCL_THREADS && defined(USE_THREAD_ALLOC)
+    Tcl_CreateObjCommand(interp, "testmeminfo", TestmeminfoCmd, NULL, NULL);
+#endif
     Tcl_CreateObjCommand(interp, "testsetmainloop", TestsetmainloopCmd,
 	    NULL, NULL);
     Tcl_CreateObjCommand(interp, "testexitmainloop", TestexitmainloopCmd,
@@ -5982,6 +5991,52 @@ TestmainthreadCmd(
     }
 }
 
+#if TCL_THREADS && defined(USE_THREAD_ALLOC)
+/*
+ * Tcl_GetMemoryInfo is not in the stubs table, and the stub wrapper refuses
+ * calls from inside the process that loaded the core. This file is always
+ * linked with the core library, so call it directly.
+ */
+
+#undef Tcl_GetMemoryInfo
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestmeminfoCmd  --
+ *
+ *	Implements the "testmeminfo" cmd that is used to test the
+ *	'Tcl_GetMemoryInfo' API.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestmeminfoCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const *objv)
+{
+    Tcl_DString ds;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, "");
+	return TCL_ERROR;
+    }
+    Tcl_DStringInit(&ds);
+    Tcl_GetMemoryInfo(&ds);
+    Tcl_DStringResult(interp, &ds);
+    return TCL_OK;
+}
+#endif
+
 /*
  *----------------------------------------------------------------------
  *
@@ -7910,6 +7965,124 @@ TestHashSystemHashCmd(
     Tcl_AppendResult(interp, "OK", (char *)NULL);
     return TCL_OK;
 }
+
+/*
+ * Used to check that searches, lookups and deletions work while a table with
+ * the TCL_HASH_KEY_INCREMENTAL_REHASH flag is part way through a rebuild.
+ */
+
+static int
+CheckHashSearch(
+    Tcl_Interp *interp,
+    Tcl_HashTable *tablePtr,
+    int limit)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    char *seen = (char *)Tcl_Alloc(limit);
+    Tcl_Size count = 0;
+    int i;
+
+    memset(seen, 0, limit);
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	i = PTR2INT(Tcl_GetHashKey(tablePtr, hPtr));
+	if (i < 0 || i >= limit || seen[i]++) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "%d returned twice by search", i));
+	    Tcl_Free(seen);
+	    return TCL_ERROR;
+	}
+	count++;
+    }
+    Tcl_Free(seen);
+    if (count != tablePtr->numEntries) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"search found %" TCL_SIZE_MODIFIER "d of %"
+		TCL_SIZE_MODIFIER "d entries", count, tablePtr->numEntries));
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+static int
+TestHashIncrementalCmd(
+    TCL_UNUSED(void *),
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    static const Tcl_HashKeyType hkType = {
+	TCL_HASH_KEY_TYPE_VERSION, TCL_HASH_KEY_INCREMENTAL_REHASH,
+	NULL, NULL, NULL, NULL
+    };
+    Tcl_HashTable hash;
+    Tcl_HashEntry *hPtr;
+    int i, isNew, limit = 100;
+
+    if (objc>1 && Tcl_GetIntFromObj(interp, objv[1], &limit)!=TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    Tcl_InitCustomHashTable(&hash, TCL_CUSTOM_PTR_KEYS, &hkType);
+
+    /*
+     * Create the entries, deleting every third one again, and check that a
+     * search sees everything left at regular intervals.
+     */
+
+    for (i=0 ; i<limit ; i++) {
+	hPtr = Tcl_CreateHashEntry(&hash, INT2PTR(i), &isNew);
+	if (!isNew) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d creation problem", i));
+	    goto error;
+	}
+	Tcl_SetHashValue(hPtr, INT2PTR(i+42));
+	if (i % 3 == 2) {
+	    hPtr = Tcl_FindHashEntry(&hash, INT2PTR(i-1));
+	    if (hPtr == NULL) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d lookup problem", i-1));
+		goto error;
+	    }
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+	if (i % 997 == 0 && CheckHashSearch(interp, &hash, limit) != TCL_OK) {
+	    goto error;
+	}
+    }
+    if (CheckHashSearch(interp, &hash, limit) != TCL_OK) {
+	goto error;
+    }
+
+    for (i=0 ; i<limit ; i++) {
+	hPtr = Tcl_FindHashEntry(&hash, INT2PTR(i));
+	if ((hPtr == NULL) != (i % 3 == 1 && i+1 < limit)) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d lookup problem", i));
+	    goto error;
+	}
+	if (hPtr == NULL) {
+	    continue;
+	}
+	if (PTR2INT(Tcl_GetHashValue(hPtr)) != i+42) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d value problem", i));
+	    goto error;
+	}
+	Tcl_DeleteHashEntry(hPtr);
+    }
+
+    if (hash.numEntries != 0) {
+	Tcl_AppendResult(interp, "non-zero final size", (char *)NULL);
+	goto error;
+    }
+
+    Tcl_DeleteHashTable(&hash);
+    Tcl_AppendResult(interp, "OK", (char *)NULL);
+    return TCL_OK;
+
+  error:
+    Tcl_DeleteHashTable(&hash);
+    return TCL_ERROR;
+}
 
 /*
  * Used for testing Tcl_GetInt which is no longer used directly by the
@@ -463,6 +463,310 @@ Tcl_ExitThread(
     TclpThreadExit(status);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclRunParallel --
+ *
+ *	Runs a batch of independent tasks, spreading them over a set of
+ *	short-lived worker threads plus the calling thread. Each task is
+ *	identified by its index in [0, numTasks); tasks are handed out in
+ *	index order to whichever thread is free. The task procedure must not
+ *	use any interpreter, nor anything else that is bound to a thread.
+ *
+ * Results:
+ *	None. Returns once every task has completed.
+ *
+ * Side effects:
+ *	Whatever the task procedure does. If no worker thread can be started,
+ *	all tasks run in the calling thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    Tcl_Mutex mutex;		/* Guards nextTask. */
+    Tcl_Size nextTask;		/* Index of next task to hand out. */
+    Tcl_Size numTasks;		/* Total number of tasks. */
+    TclParallelProc *proc;	/* Procedure to run each task. */
+    void *clientData;		/* Argument passed to proc. */
+} ParallelBatch;
+
+static void
+RunParallelTasks(
+    ParallelBatch *batchPtr)
+{
+    Tcl_Size task;
+
+    while (1) {
+	Tcl_MutexLock(&batchPtr->mutex);
+	task = batchPtr->nextTask;
+	if (task < batchPtr->numTasks) {
+	    batchPtr->nextTask++;
+	}
+	Tcl_MutexUnlock(&batchPtr->mutex);
+	if (task >= batchPtr->numTasks) {
+	    break;
+	}
+	batchPtr->proc(batchPtr->clientData, task);
+    }
+}
+
+#if TCL_THREADS
+static Tcl_ThreadCreateType
+ParallelWorkerProc(
+    void *clientData)
+{
+    RunParallelTasks((ParallelBatch *)clientData);
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
+
+void
+TclRunParallel(
+    Tcl_Size numTasks,		/* Number of tasks to run. */
+    int maxThreads,		/* Upper bound on the number of threads
+				 * (including the caller) to use. */
+    TclParallelProc *proc,	/* Procedure to run each task. */
+    void *clientData)		/* Argument passed to proc. */
+{
+    ParallelBatch batch;
+#if TCL_THREADS
+    Tcl_ThreadId ids[TCL_PARALLEL_MAX_THREADS];
+    int i, numWorkers = 0, numThreads = TclpNumProcessors();
+
+    if (numThreads > maxThreads) {
+	numThreads = maxThreads;
+    }
+    if (numThreads > TCL_PARALLEL_MAX_THREADS) {
+	numThreads = TCL_PARALLEL_MAX_THREADS;
+    }
+    if (numThreads > numTasks) {
+	numThreads = (int) numTasks;
+    }
+#endif /* TCL_THREADS */
+
+    batch.mutex = NULL;
+    batch.nextTask = 0;
+    batch.numTasks = numTasks;
+    batch.proc = proc;
+    batch.clientData = clientData;
+
+#if TCL_THREADS
+    /*
+     * Make sure the mutex is created by this thread before any worker can
+     * race to do so.
+     */
+
+    Tcl_MutexLock(&batch.mutex);
+    Tcl_MutexUnlock(&batch.mutex);
+    for (i = 1; i < numThreads; i++) {
+	if (Tcl_CreateThread(&ids[numWorkers], ParallelWorkerProc, &batch,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+	    break;
+	}
+	numWorkers++;
+    }
+#endif /* TCL_THREADS */
+
+    RunParallelTasks(&batch);
+
+#if TCL_THREADS
+    for (i = 0; i < numWorkers; i++) {
+	Tcl_JoinThread(ids[i], NULL);
+    }
+#endif /* TCL_THREADS */
+    Tcl_MutexFinalize(&batch.mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitAtomics --
+ *
+ *	Sets up the mutex behind the TclAtomic* operations, for compilers
+ *	without atomic builtins. Called from Tcl_InitSubsystems before the
+ *	memory allocator is set up, as the allocator itself uses these: a
+ *	plain Tcl_Mutex would be allocated by it on first use.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May allocate a mutex, which is kept for the life of the process.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#ifndef TCL_ATOMIC_BUILTINS
+#if TCL_THREADS && defined(USE_THREAD_ALLOC)
+static Tcl_Mutex *atomicLockPtr;
+#else
+TCL_DECLARE_MUTEX(atomicMutex)
+#define atomicLockPtr (&atomicMutex)
+#endif
+#endif /* !TCL_ATOMIC_BUILTINS */
+
+void
+TclInitAtomics(void)
+{
+#if !defined(TCL_ATOMIC_BUILTINS) && TCL_THREADS && defined(USE_THREAD_ALLOC)
+    if (atomicLockPtr == NULL) {
+	atomicLockPtr = TclpNewAllocMutex();
+    }
+#endif
+}
+
+#ifndef TCL_ATOMIC_BUILTINS
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclAtomicLoadPtr, TclAtomicStorePtr, ... --
+ *
+ *	The TclAtomic* operations of tclInt.h for compilers without atomic
+ *	builtins. Each takes a single process-wide mutex.
+ *
+ * Results:
+ *	As described in tclInt.h.
+ *
+ * Side effects:
+ *	As described in tclInt.h.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclAtomicLoadPtr(
+    void *ptrPtr)
+{
+    void *value;
+
+    Tcl_MutexLock(atomicLockPtr);
+    value = *(void **) ptrPtr;
+    Tcl_MutexUnlock(atomicLockPtr);
+    return value;
+}
+
+void
+TclAtomicStorePtr(
+    void *ptrPtr,
+    void *value)
+{
+    Tcl_MutexLock(atomicLockPtr);
+    *(void **) ptrPtr = value;
+    Tcl_MutexUnlock(atomicLockPtr);
+}
+
+void *
+TclAtomicExchangePtr(
+    void *ptrPtr,
+    void *value)
+{
+    void *oldValue;
+
+    Tcl_MutexLock(atomicLockPtr);
+    oldValue = *(void **) ptrPtr;
+    *(void **) ptrPtr = value;
+    Tcl_MutexUnlock(atomicLockPtr);
+    return oldValue;
+}
+
+int
+TclAtomicCasPtr(
+    void *ptrPtr,
+    void *oldValue,
+    void *newValue)
+{
+    int result;
+
+    Tcl_MutexLock(atomicLockPtr);
+    result = (*(void **) ptrPtr == oldValue);
+    if (result) {
+	*(void **) ptrPtr = newValue;
+    }
+    Tcl_MutexUnlock(atomicLockPtr);
+    return result;
+}
+
+size_t
+TclAtomicLoadSize(
+    size_t *sizePtr)
+{
+    size_t value;
+
+    Tcl_MutexLock(atomicLockPtr);
+    value = *sizePtr;
+    Tcl_MutexUnlock(atomicLockPtr);
+    return value;
+}
+
+void
+TclAtomicStoreSize(
+    size_t *sizePtr,
+    size_t value)
+{
+    Tcl_MutexLock(atomicLockPtr);
+    *sizePtr = value;
+    Tcl_MutexUnlock(atomicLockPtr);
+}
+
+void
+TclAtomicAddSize(
+    size_t *sizePtr,
+    size_t delta)
+{
+    Tcl_MutexLock(atomicLockPtr);
+    *sizePtr += delta;
+    Tcl_MutexUnlock(atomicLockPtr);
+}
+
+size_t
+TclAtomicAddFetchSize(
+    size_t *sizePtr,
+    size_t delta)
+{
+    size_t value;
+
+    Tcl_MutexLock(atomicLockPtr);
+    value = *sizePtr += delta;
+    Tcl_MutexUnlock(atomicLockPtr);
+    return value;
+}
+
+int
+TclAtomicLoadInt(
+    int *intPtr)
+{
+    int value;
+
+    Tcl_MutexLock(atomicLockPtr);
+    value = *intPtr;
+    Tcl_MutexUnlock(atomicLockPtr);
+    return value;
+}
+
+void
+TclAtomicStoreInt(
+    int *intPtr,
+    int value)
+{
+    Tcl_MutexLock(atomicLockPtr);
+    *intPtr = value;
+    Tcl_MutexUnlock(atomicLockPtr);
+}
+
+void
+TclAtomicAddInt(
+    int *intPtr,
+    int delta)
+{
+    Tcl_MutexLock(atomicLockPtr);
+    *intPtr += delta;
+    Tcl_MutexUnlock(atomicLockPtr);
+}
+#endif /* !TCL_ATOMIC_BUILTINS */
+
 #if !TCL_THREADS
 
 /*
@@ -15,6 +15,13 @@
 #include "tclInt.h"
 #if TCL_THREADS && defined(USE_THREAD_ALLOC)
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+#endif
+
 /*
  * If range checking is enabled, an additional byte will be allocated to store
  * the magic number at the end of the requested memory.
@@ -53,7 +60,7 @@ typedef union Block {
 	    struct {
 		unsigned char magic1;	/* First magic number. */
 		unsigned char bucket;	/* Bucket block allocated from. */
-		unsigned char unused;	/* Padding. */
+		unsigned char sampled;	/* Sampled by the profiler? */
 		unsigned char magic2;	/* Second magic number. */
 	    } s;
 	} u;
@@ -65,17 +72,116 @@ typedef union Block {
 #define sourceBucket	b.u.s.bucket
 #define magicNum1	b.u.s.magic1
 #define magicNum2	b.u.s.magic2
+#define blockSampled	b.u.s.sampled
 #define MAGIC		0xEF
 #define blockReqSize	b.reqSize
 
 /*
  * The following defines the minimum and maximum block sizes and the number
- * of buckets in the bucket cache.
+ * of buckets in the bucket cache. Between each power of two there is one
+ * intermediate size class, 1.5 times the one below it, so that a request
+ * wastes at most a third of its block rather than half of it.
  */
 
 #define MINALLOC	((sizeof(Block) + 8 + (TCL_ALLOCALIGN-1)) & ~(TCL_ALLOCALIGN-1))
-#define NBUCKETS	(11 - (MINALLOC >> 5))
-#define MAXALLOC	(MINALLOC << (NBUCKETS - 1))
+#define NPOWERS		(11 - (MINALLOC >> 5))
+#define NBUCKETS	(2 * NPOWERS - 1)
+#define MAXALLOC	(MINALLOC << (NPOWERS - 1))
+
+/*
+ * Blocks are carved out of slabs: SLAB_SIZE-aligned runs of memory which
+ * each serve a single bucket. Slabs are handed out from segments, large
+ * aligned regions mapped directly from the system, whose first slab holds
+ * the descriptors of the others. Finding the descriptor of a block is thus
+ * only a matter of masking its address. When every block of a slab has
+ * found its way back to the shared cache, the trimmer (see
+ * TclThreadAllocIdle) takes them out of circulation and returns the pages
+ * of the slab to the system, which keeps the address range for reuse.
+ */
+
+#ifndef ALLOC_SLAB_SIZE
+#define ALLOC_SLAB_SIZE		((size_t) 1 << 16)
+#endif
+#ifndef ALLOC_SEGMENT_SIZE
+#define ALLOC_SEGMENT_SIZE	((size_t) 1 << 22)
+#endif
+#define SLAB_SIZE		ALLOC_SLAB_SIZE
+#define SEGMENT_SIZE		ALLOC_SEGMENT_SIZE
+#define NSLABS			(SEGMENT_SIZE / SLAB_SIZE)
+
+/*
+ * Trimming walks the free lists of the shared cache, so it only happens once
+ * this many bytes have been moved there since the last time.
+ */
+
+#ifndef ALLOC_TRIM_THRESHOLD
+#define ALLOC_TRIM_THRESHOLD	((size_t) 1 << 22)
+#endif
+
+typedef struct Slab {
+    struct Slab *nextPtr;	/* Next slab on the empty list. */
+    size_t numBlocks;		/* Number of blocks in the slab, 0 while it
+				 * is empty or used by an arena. */
+    size_t numFound;		/* Free blocks counted by the trimmer. */
+    size_t numLive;		/* For arena slabs: blocks allocated once the
+				 * arena let go of the slab, less blocks
+				 * freed. See ArenaFree. */
+    int released;		/* Have the pages been returned to the
+				 * system? */
+} Slab;
+
+typedef struct Segment {
+    struct Segment *nextPtr;	/* Next segment mapped. */
+    Slab slabs[NSLABS];		/* Descriptors of the slabs; the first one
+				 * is taken by this header. */
+} Segment;
+
+#define BLOCK_SEGMENT(ptr) \
+    ((Segment *) ((uintptr_t) (ptr) & ~(uintptr_t) (SEGMENT_SIZE - 1)))
+#define BLOCK_SLAB(ptr) \
+    (&BLOCK_SEGMENT(ptr)->slabs[ \
+	    ((char *) (ptr) - (char *) BLOCK_SEGMENT(ptr)) / SLAB_SIZE])
+#define SLAB_MEMORY(slabPtr) \
+    ((char *) BLOCK_SEGMENT(slabPtr) \
+	    + ((slabPtr) - BLOCK_SEGMENT(slabPtr)->slabs) * SLAB_SIZE)
+
+/*
+ * An arena serves the storage of the values a thread creates during a scoped
+ * evaluation (see TclPushAllocArena and TclArenaAlloc) by bumping a pointer
+ * through a slab of its own; every other allocation still goes to the
+ * buckets. Freeing a block does not make its space reusable, it only counts
+ * the block as gone; once the arena has moved on from a slab and all of its
+ * blocks are gone, the whole slab is recycled at once. The values given arena
+ * storage are remembered, and when the arena is closed the storage of those
+ * still alive is copied out to the buckets (see TclPromoteArenaValues), which
+ * frees the last blocks of its slabs. Arena blocks are marked with a bucket
+ * number of ARENA_BUCKET.
+ */
+
+typedef struct Arena {
+    struct Arena *parentPtr;	/* Arena this one is nested in. */
+    Slab *slabPtr;		/* Slab being carved, or NULL. */
+    char *freePtr;		/* Next free byte in it. */
+    char *endPtr;		/* End of it. */
+    size_t numAllocs;		/* Blocks carved from it, less blocks freed
+				 * by this thread while it is carved. */
+    Slab **slabs;		/* Every slab carved by the arena, see
+				 * TclArenaOwns. */
+    size_t numSlabs;		/* Number of them. */
+    size_t maxSlabs;		/* Room in slabs. */
+    Tcl_Obj **values;		/* Values given arena storage, possibly freed
+				 * or repeated since. */
+    size_t numValues;		/* Number of them. */
+    size_t maxValues;		/* Room in values. */
+    int pinned;			/* Must the blocks stay where they are when
+				 * the arena is closed? See
+				 * TclPinAllocArenas. */
+} Arena;
+
+#define ARENA_BUCKET	(NBUCKETS + 1)
+#define ARENA_SIZE(reqSize) \
+    (((reqSize) + sizeof(Block) + RCHECK + (TCL_ALLOCALIGN-1)) \
+	    & ~(size_t) (TCL_ALLOCALIGN-1))
 
 /*
  * The following structure defines a bucket of blocks with various accounting
@@ -86,6 +192,8 @@ typedef struct {
     Block *firstPtr;		/* First block available */
     Block *lastPtr;		/* End of block list */
     size_t numFree;		/* Number of blocks available */
+    Block *carvePtr;		/* Next block of the slab being carved */
+    size_t numUncarved;		/* Number of blocks left in that slab */
 
     /* All fields below for accounting only */
 
@@ -107,11 +215,43 @@ typedef struct Cache {
     Tcl_ThreadId owner;		/* Which thread's cache is this? */
     Tcl_Obj *firstObjPtr;	/* List of free objects for thread */
     size_t numObjects;		/* Number of objects for thread */
+    size_t objsToSample;	/* Objects before the next profiler check */
+    Tcl_Interp *evalInterp;	/* Interp running callbacks, or NULL */
     Tcl_Obj *lastPtr;		/* Last object in this cache */
     size_t totalAssigned;	/* Total space assigned to thread */
+    Arena *arenaPtr;		/* Innermost arena of the thread, or NULL */
+    Arena *closingPtr;		/* Arena whose values are being copied out,
+				 * or NULL */
+    size_t bytesToSample;	/* Bytes before the next profiler check */
+    unsigned int profileSeed;	/* State of the sampling jitter */
+    int inProfiler;		/* Is the thread taking a sample? */
     Bucket buckets[NBUCKETS];	/* The buckets for this thread */
 } Cache;
 
+/*
+ * Free objects and blocks leave a thread cache for the shared cache in
+ * batches: chains of items released together. The shared object list and
+ * each shared bucket are stacks of such batches. Releasing a batch is a
+ * single atomic compare-and-swap, so a thread freeing memory that another
+ * thread allocated (the consumer of a producer/consumer pair) never waits on
+ * a lock. Taking a batch is serialized by the object or bucket lock, which
+ * only allocating threads contend for; with a single popper the top of the
+ * stack cannot be taken and pushed back behind its back, which keeps the
+ * pop safe from ABA problems without double-width atomics.
+ *
+ * The first item of a batch holds the following header, and its size field
+ * (length for objects, reqSize for blocks) holds the number of items.
+ */
+
+typedef struct {
+    void *nextBatch;		/* Next batch on the shared stack. */
+    void *lastPtr;		/* Last item of this batch. */
+} Batch;
+
+#define OBJ_BATCH(objPtr)	((Batch *) (objPtr))
+#define OBJ_AT(objsPtr, i)	((Tcl_Obj *) ((char *) (objsPtr) + (i) * TCL_OBJ_SIZE))
+#define BLOCK_BATCH(blockPtr)	((Batch *) ((blockPtr) + 1))
+
 /*
  * The following array specifies various per-bucket limits and locks. The
  * values are statically initialized to avoid calculating them repeatedly.
@@ -135,8 +275,38 @@ static void	PutBlocks(Cache *cachePtr, int bucket, size_t numMove);
 static int	GetBlocks(Cache *cachePtr, int bucket);
 static Block *	Ptr2Block(void *ptr);
 static void *	Block2Ptr(Block *blockPtr, int bucket, size_t reqSize);
-static void	MoveObjs(Cache *fromPtr, Cache *toPtr, size_t numMove);
 static void	PutObjs(Cache *fromPtr, size_t numMove);
+static void	PushBatch(void **stackPtr, void *firstPtr,
+			    Batch *batchPtr);
+static void *	PopBatch(void **stackPtr, size_t batchOffset);
+static Slab *	TakeSlab(void);
+static void	RecycleSlab(Slab *slabPtr);
+static Block *	NewSlab(int bucket, size_t *numBlocksPtr);
+static Block *	ArenaAlloc(Arena *arenaPtr, size_t size);
+static void	ArenaFree(Cache *cachePtr, Block *blockPtr);
+static void	ArenaRetireSlab(Arena *arenaPtr);
+static void	ArenaTrackValue(Arena *arenaPtr, Tcl_Obj *objPtr);
+static int	CompareAddresses(const void *first, const void *second);
+static void	PopArena(Cache *cachePtr, int promote);
+static void	CarveBlocks(Cache *cachePtr, int bucket, size_t n);
+static Slab *	TrimBucket(Cache *cachePtr, int bucket, Slab *emptyPtr);
+static void *	MapSegment(void);
+static void	ReleaseSlab(void *memPtr);
+static int	ReuseSlab(void *memPtr);
+static void *	AllocFrom(size_t reqSize, int fromArena, void *caller);
+static size_t	NextSample(Cache *cachePtr, size_t rate, size_t unit);
+static void	TakeSample(Cache *cachePtr, void *memPtr, size_t size,
+			    int isObj, void *caller);
+static void	ReleaseSample(void *memPtr, int isObj);
+static void	GetSiteKey(Cache *cachePtr, void *caller, char *buf,
+			    size_t bufSize);
+static Tcl_HashEntry *	AllocSiteEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static int	CompareSiteKeys(void *keyPtr, Tcl_HashEntry *hPtr);
+static Tcl_HashEntry *	AllocSampleEntry(Tcl_HashTable *tablePtr,
+			    void *keyPtr);
+static void	FreeProfileEntry(Tcl_HashEntry *hPtr);
+static int	CompareSites(const void *first, const void *second);
 
 /*
  * Local variables defined in this file and initialized at startup.
@@ -148,6 +318,97 @@ static Cache sharedCache;
 static Cache *sharedPtr = &sharedCache;
 static Cache *firstCachePtr = &sharedCache;
 
+/*
+ * Slab bookkeeping, protected by slabLockPtr except for trimCredit. Only one
+ * thread trims at a time, under trimLockPtr.
+ */
+
+static Tcl_Mutex *slabLockPtr;
+static Tcl_Mutex *trimLockPtr;
+static Segment *firstSegmentPtr;	/* Most recently mapped segment. */
+static size_t nextSlab = NSLABS;	/* Next never used slab in it. */
+static Slab *emptySlabPtr;		/* Slabs free for any bucket. */
+static size_t trimCredit;		/* Bytes moved to the shared cache
+					 * since the last trim. */
+static struct {
+    size_t numSegments;		/* Segments mapped. */
+    size_t numSlabs;		/* Slabs carved for a bucket or arena. */
+    size_t numArenaSlabs;	/* Those of them used by arenas. */
+    size_t numEmpty;		/* Slabs on the empty list. */
+    size_t numTrims;		/* Times the trimmer ran. */
+    size_t numReleased;		/* Slabs returned to the system. */
+} slabStats;
+
+/*
+ * The sampling heap profiler (see TclSetAllocProfileRate). While it runs,
+ * every thread takes a sample about once per profileRate bytes it
+ * allocates, at intervals jittered so that allocation patterns cannot keep
+ * in step with them. A sample records the site of the allocation, the Tcl
+ * proc and line being evaluated and the C caller, and stands for
+ * profileRate bytes or the allocation itself if that is larger. Sampled
+ * blocks are flagged in their header. Objects have no header, so sampled
+ * ones are counted in a filter indexed by address, which only sends the
+ * rare object that may have been sampled to look up the table when freed.
+ * Whichever thread frees sampled memory releases the sample, so the live
+ * samples of a site estimate the memory it holds.
+ *
+ * Everything is protected by profileLockPtr, except that profileRate, the
+ * filter and tclNumSampledObjs are also read atomically without the lock: a
+ * thread freeing an object holds the only reference to it, so no other
+ * thread can be adding or releasing a sample for it meanwhile.
+ */
+
+typedef struct {
+    size_t liveBytes;		/* Bytes its live samples stand for. */
+    size_t numLive;		/* Number of live samples. */
+} AllocSite;
+
+typedef struct {
+    AllocSite *sitePtr;		/* Site the memory was allocated at. */
+    size_t weight;		/* Bytes the sample stands for. */
+} AllocSample;
+
+/*
+ * The tables of sites and samples must not allocate from the allocator they
+ * watch, so they use the system allocator throughout.
+ */
+
+static const Tcl_HashKeyType siteKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    TCL_HASH_KEY_SYSTEM_HASH,		/* flags */
+    TclHashStringKey,			/* hashKeyProc */
+    CompareSiteKeys,			/* compareKeysProc */
+    AllocSiteEntry,			/* allocEntryProc */
+    FreeProfileEntry			/* freeEntryProc */
+};
+
+static const Tcl_HashKeyType sampleKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,		/* version */
+    TCL_HASH_KEY_SYSTEM_HASH,		/* flags */
+    NULL,				/* hashKeyProc */
+    NULL,				/* compareKeysProc */
+    AllocSampleEntry,			/* allocEntryProc */
+    FreeProfileEntry			/* freeEntryProc */
+};
+
+#define PROFILE_IDLE_BYTES	((size_t) 1 << 16)
+#define PROFILE_IDLE_OBJS	((size_t) 1 << 10)
+#define PROFILE_SITE_SIZE	512
+#define OBJ_FILTER_SIZE		1024
+#define OBJ_FILTER(objPtr) \
+    objFilter[(((uintptr_t) (objPtr) >> 4) ^ ((uintptr_t) (objPtr) >> 14)) \
+	    & (OBJ_FILTER_SIZE - 1)]
+
+static Tcl_Mutex *profileLockPtr;
+static size_t profileRate;		/* Mean bytes between samples, 0 when
+					 * the profiler is stopped. */
+static int profileInitialized;		/* Are the tables below set up? */
+static Tcl_HashTable profileSites;	/* Site key -> AllocSite. */
+static Tcl_HashTable profileSamples;	/* Sampled memory -> AllocSample. */
+static size_t objFilter[OBJ_FILTER_SIZE];
+size_t tclNumSampledObjs;		/* Live samples of objects, checked
+					 * by TclFreeObjStorageEx. */
+
 #if defined(HAVE_FAST_TSD)
 static __thread Cache *tcachePtr;
 
@@ -249,11 +510,23 @@ TclFreeAllocCache(
     Cache **nextPtrPtr;
     unsigned int bucket;
 
+    /*
+     * Close arenas left open.
+     */
+
+    while (cachePtr->arenaPtr != NULL) {
+	PopArena(cachePtr, 0);
+    }
+
     /*
      * Flush blocks.
      */
 
     for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	if (cachePtr->buckets[bucket].numUncarved > 0) {
+	    CarveBlocks(cachePtr, bucket,
+		    cachePtr->buckets[bucket].numUncarved);
+	}
 	if (cachePtr->buckets[bucket].numFree > 0) {
 	    PutBlocks(cachePtr, bucket, cachePtr->buckets[bucket].numFree);
 	}
@@ -301,9 +574,29 @@ TclFreeAllocCache(
 void *
 TclpAlloc(
     size_t reqSize)
+{
+    return AllocFrom(reqSize, 0, TclCallerAddress());
+}
+
+void *
+TclpAllocFrom(
+    size_t reqSize,
+    void *caller)		/* Code the allocation is attributed to by
+				 * the profiler. */
+{
+    return AllocFrom(reqSize, 0, caller);
+}
+
+static inline void *
+AllocFrom(
+    size_t reqSize,
+    int fromArena,		/* Serve the request from the innermost arena
+				 * of the thread, if any? */
+    void *caller)
 {
     Cache *cachePtr;
     Block *blockPtr;
+    void *ptr;
     int bucket;
     size_t size;
 
@@ -327,6 +620,9 @@ TclpAlloc(
 	if (blockPtr != NULL) {
 	    cachePtr->totalAssigned += reqSize;
 	}
+    } else if (fromArena && cachePtr->arenaPtr != NULL) {
+	bucket = ARENA_BUCKET;
+	blockPtr = ArenaAlloc(cachePtr->arenaPtr, size);
     } else {
 	bucket = 0;
 	while (bucketInfo[bucket].blockSize < size) {
@@ -343,7 +639,18 @@ TclpAlloc(
     if (blockPtr == NULL) {
 	return NULL;
     }
-    return Block2Ptr(blockPtr, bucket, reqSize);
+    ptr = Block2Ptr(blockPtr, bucket, reqSize);
+
+    /*
+     * Count down to the next check by the profiler.
+     */
+
+    if (reqSize < cachePtr->bytesToSample) {
+	cachePtr->bytesToSample -= reqSize;
+    } else {
+	TakeSample(cachePtr, ptr, reqSize, 0, caller);
+    }
+    return ptr;
 }
 
 /*
@@ -383,12 +690,19 @@ TclpFree(
      */
 
     blockPtr = Ptr2Block(ptr);
+    if (blockPtr->blockSampled) {
+	ReleaseSample(ptr, 0);
+    }
     bucket = blockPtr->sourceBucket;
     if (bucket == NBUCKETS) {
 	cachePtr->totalAssigned -= blockPtr->blockReqSize;
 	TclpSysFree(blockPtr);
 	return;
     }
+    if (bucket == ARENA_BUCKET) {
+	ArenaFree(cachePtr, blockPtr);
+	return;
+    }
 
     cachePtr->buckets[bucket].totalAssigned -= blockPtr->blockReqSize;
     blockPtr->nextBlock = cachePtr->buckets[bucket].firstPtr;
@@ -425,6 +739,16 @@ void *
 TclpRealloc(
     void *ptr,
     size_t reqSize)
+{
+    return TclpReallocFrom(ptr, reqSize, TclCallerAddress());
+}
+
+void *
+TclpReallocFrom(
+    void *ptr,
+    size_t reqSize,
+    void *caller)		/* Code the allocation is attributed to by
+				 * the profiler. */
 {
     Cache *cachePtr;
     Block *blockPtr;
@@ -433,7 +757,7 @@ TclpRealloc(
     int bucket;
 
     if (ptr == NULL) {
-	return TclpAlloc(reqSize);
+	return AllocFrom(reqSize, 0, caller);
     }
 
     GETCACHE(cachePtr);
@@ -442,6 +766,7 @@ TclpRealloc(
      * If the block is not a system block and fits in place, simply return the
      * existing pointer. Otherwise, if the block is a system block and the new
      * size would also require a system block, call TclpSysRealloc() directly.
+     * Sampled blocks are always copied, which settles their sample.
      */
 
     blockPtr = Ptr2Block(ptr);
@@ -450,7 +775,28 @@ TclpRealloc(
     size++;
 #endif
     bucket = blockPtr->sourceBucket;
-    if (bucket != NBUCKETS) {
+    if (blockPtr->blockSampled) {
+	/* Copy below. */
+    } else if (bucket == ARENA_BUCKET) {
+	Arena *arenaPtr = cachePtr->arenaPtr;
+
+	/*
+	 * The last block carved from the current slab of the arena can grow
+	 * or shrink in place; any other arena block can shrink.
+	 */
+
+	if (arenaPtr != NULL && arenaPtr->slabPtr == BLOCK_SLAB(blockPtr)
+		&& (char *) blockPtr + ARENA_SIZE(blockPtr->blockReqSize)
+			== arenaPtr->freePtr
+		&& ARENA_SIZE(reqSize) <= (size_t)
+			(arenaPtr->endPtr - (char *) blockPtr)) {
+	    arenaPtr->freePtr = (char *) blockPtr + ARENA_SIZE(reqSize);
+	    return Block2Ptr(blockPtr, bucket, reqSize);
+	}
+	if (reqSize <= blockPtr->blockReqSize) {
+	    return Block2Ptr(blockPtr, bucket, reqSize);
+	}
+    } else if (bucket != NBUCKETS) {
 	if (bucket > 0) {
 	    min = bucketInfo[bucket-1].blockSize;
 	} else {
@@ -475,7 +821,7 @@ TclpRealloc(
      * Finally, perform an expensive malloc/copy/free.
      */
 
-    newPtr = TclpAlloc(reqSize);
+    newPtr = AllocFrom(reqSize, 0, caller);
     if (newPtr != NULL) {
 	if (reqSize > blockPtr->blockReqSize) {
 	    reqSize = blockPtr->blockReqSize;
@@ -523,28 +869,36 @@ TclThreadAllocObj(void)
     if (cachePtr->numObjects == 0) {
 	size_t numMove;
 
-	Tcl_MutexLock(objLockPtr);
-	numMove = sharedPtr->numObjects;
-	if (numMove > 0) {
-	    if (numMove > NOBJALLOC) {
-		numMove = NOBJALLOC;
+	/*
+	 * Note the dirty check for a shared batch before taking the lock that
+	 * serializes poppers; the pop itself rechecks.
+	 */
+
+	if (TclAtomicLoadPtr(&sharedPtr->firstObjPtr) != NULL) {
+	    Tcl_MutexLock(objLockPtr);
+	    objPtr = (Tcl_Obj *)PopBatch((void **) &sharedPtr->firstObjPtr, 0);
+	    Tcl_MutexUnlock(objLockPtr);
+	    if (objPtr != NULL) {
+		numMove = (size_t) objPtr->length;
+		cachePtr->firstObjPtr = objPtr;
+		cachePtr->lastPtr = (Tcl_Obj *)OBJ_BATCH(objPtr)->lastPtr;
+		cachePtr->numObjects = numMove;
+		TclAtomicAddSize(&sharedPtr->numObjects, -numMove);
 	    }
-	    MoveObjs(sharedPtr, cachePtr, numMove);
 	}
-	Tcl_MutexUnlock(objLockPtr);
 	if (cachePtr->numObjects == 0) {
 	    Tcl_Obj *newObjsPtr;
 
 	    cachePtr->numObjects = numMove = NOBJALLOC;
-	    newObjsPtr = (Tcl_Obj *)TclpSysAlloc(sizeof(Tcl_Obj) * numMove);
+	    newObjsPtr = (Tcl_Obj *)TclpSysAlloc(TCL_OBJ_SIZE * numMove);
 	    if (newObjsPtr == NULL) {
 		Tcl_Panic("alloc: could not allocate %" TCL_Z_MODIFIER "u new objects", numMove);
 	    }
-	    cachePtr->lastPtr = newObjsPtr + numMove - 1;
+	    cachePtr->lastPtr = OBJ_AT(newObjsPtr, numMove - 1);
 	    objPtr = cachePtr->firstObjPtr;	/* NULL */
 	    while (numMove-- > 0) {
-		newObjsPtr[numMove].internalRep.twoPtrValue.ptr1 = objPtr;
-		objPtr = newObjsPtr + numMove;
+		OBJ_AT(newObjsPtr, numMove)->internalRep.twoPtrValue.ptr1 = objPtr;
+		objPtr = OBJ_AT(newObjsPtr, numMove);
 	    }
 	    cachePtr->firstObjPtr = newObjsPtr;
 	}
@@ -557,6 +911,11 @@ TclThreadAllocObj(void)
     objPtr = cachePtr->firstObjPtr;
     cachePtr->firstObjPtr = (Tcl_Obj *)objPtr->internalRep.twoPtrValue.ptr1;
     cachePtr->numObjects--;
+    if (cachePtr->objsToSample > 1) {
+	cachePtr->objsToSample--;
+    } else {
+	TakeSample(cachePtr, objPtr, TCL_OBJ_SIZE, 1, TclCallerAddress());
+    }
     return objPtr;
 }
 
@@ -588,6 +947,11 @@ TclThreadFreeObj(
 
     GETCACHE(cachePtr);
 
+    if (TclAtomicLoadSize(&tclNumSampledObjs) != 0
+	    && TclAtomicLoadSize(&OBJ_FILTER(objPtr)) != 0) {
+	ReleaseSample(objPtr, 1);
+    }
+
     /*
      * Get this thread's list and push on the free Tcl_Obj.
      */
@@ -601,10 +965,13 @@ TclThreadFreeObj(
 
     /*
      * If the number of free objects has exceeded the high water mark, move
-     * some blocks to the shared list.
+     * some blocks to the shared list. Not while an arena is open or closing
+     * though: the values it remembers must stay with this thread even once
+     * freed.
      */
 
-    if (cachePtr->numObjects > NOBJHIGH) {
+    if (cachePtr->numObjects > NOBJHIGH && cachePtr->arenaPtr == NULL
+	    && cachePtr->closingPtr == NULL) {
 	PutObjs(cachePtr, NOBJALLOC);
     }
 }
@@ -658,14 +1025,27 @@ Tcl_GetMemoryInfo(
 	cachePtr = cachePtr->nextPtr;
     }
     Tcl_MutexUnlock(listLockPtr);
+
+    Tcl_DStringStartSublist(dsPtr);
+    Tcl_DStringAppendElement(dsPtr, "slabs");
+    Tcl_MutexLock(slabLockPtr);
+    snprintf(buf, sizeof(buf), "%" TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %"
+	    TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u %"
+	    TCL_Z_MODIFIER "u %" TCL_Z_MODIFIER "u",
+	    SLAB_SIZE, slabStats.numSegments, slabStats.numSlabs,
+	    slabStats.numEmpty, slabStats.numTrims, slabStats.numReleased,
+	    slabStats.numArenaSlabs);
+    Tcl_MutexUnlock(slabLockPtr);
+    Tcl_DStringAppendElement(dsPtr, buf);
+    Tcl_DStringEndSublist(dsPtr);
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * MoveObjs --
+ * PutObjs --
  *
- *	Move Tcl_Obj's between caches.
+ *	Move Tcl_Obj's from thread cache to shared cache as one batch.
  *
  * Results:
  *	None.
@@ -677,46 +1057,51 @@ Tcl_GetMemoryInfo(
  */
 
 static void
-MoveObjs(
+PutObjs(
     Cache *fromPtr,
-    Cache *toPtr,
     size_t numMove)
 {
-    Tcl_Obj *objPtr = fromPtr->firstObjPtr;
-    Tcl_Obj *fromFirstObjPtr = objPtr;
-
-    toPtr->numObjects += numMove;
-    fromPtr->numObjects -= numMove;
-
-    /*
-     * Find the last object to be moved; set the next one (the first one not
-     * to be moved) as the first object in the 'from' cache.
-     */
+    size_t keep = fromPtr->numObjects - numMove;
+    Tcl_Obj *firstPtr, *lastPtr = NULL;
 
-    while (numMove-- > 1) {
-	objPtr = (Tcl_Obj *)objPtr->internalRep.twoPtrValue.ptr1;
+    fromPtr->numObjects = keep;
+    firstPtr = fromPtr->firstObjPtr;
+    if (keep == 0) {
+	fromPtr->firstObjPtr = NULL;
+    } else {
+	do {
+	    lastPtr = firstPtr;
+	    firstPtr = (Tcl_Obj *)firstPtr->internalRep.twoPtrValue.ptr1;
+	} while (keep-- > 1);
+	lastPtr->internalRep.twoPtrValue.ptr1 = NULL;
     }
-    fromPtr->firstObjPtr = (Tcl_Obj *)objPtr->internalRep.twoPtrValue.ptr1;
 
     /*
-     * Move all objects as a block - they are already linked to each other, we
-     * just have to update the first and last.
+     * Move all objects as a batch - they are already linked to each other,
+     * we just have to record the last one and the count in the first.
      */
 
-    toPtr->lastPtr = objPtr;
-    objPtr->internalRep.twoPtrValue.ptr1 = toPtr->firstObjPtr; /* NULL */
-    toPtr->firstObjPtr = fromFirstObjPtr;
+    OBJ_BATCH(firstPtr)->lastPtr = fromPtr->lastPtr;
+    firstPtr->length = (Tcl_Size) numMove;
+    PushBatch((void **) &sharedPtr->firstObjPtr, firstPtr, OBJ_BATCH(firstPtr));
+    TclAtomicAddSize(&sharedPtr->numObjects, numMove);
+
+    fromPtr->lastPtr = lastPtr;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * PutObjs --
+ * PushBatch, PopBatch --
  *
- *	Move Tcl_Obj's from thread cache to shared cache.
+ *	Push a batch of free items onto a shared stack, or take the top batch
+ *	off it. Pushing is lock-free; callers of PopBatch must hold the lock
+ *	serializing poppers of that stack. The batch header lives batchOffset
+ *	bytes into the first item.
  *
  * Results:
- *	None.
+ *	PopBatch returns the first item of the batch, or NULL if the stack was
+ *	empty.
  *
  * Side effects:
  *	None.
@@ -725,40 +1110,34 @@ MoveObjs(
  */
 
 static void
-PutObjs(
-    Cache *fromPtr,
-    size_t numMove)
+PushBatch(
+    void **stackPtr,		/* Shared stack to push on. */
+    void *firstPtr,		/* First item of the batch. */
+    Batch *batchPtr)		/* Header of the batch, in firstPtr. */
 {
-    size_t keep = fromPtr->numObjects - numMove;
-    Tcl_Obj *firstPtr, *lastPtr = NULL;
-
-    fromPtr->numObjects = keep;
-    firstPtr = fromPtr->firstObjPtr;
-    if (keep == 0) {
-	fromPtr->firstObjPtr = NULL;
-    } else {
-	do {
-	    lastPtr = firstPtr;
-	    firstPtr = (Tcl_Obj *)firstPtr->internalRep.twoPtrValue.ptr1;
-	} while (keep-- > 1);
-	lastPtr->internalRep.twoPtrValue.ptr1 = NULL;
-    }
+    void *topPtr;
 
-    /*
-     * Move all objects as a block - they are already linked to each other, we
-     * just have to update the first and last.
-     */
+    do {
+	topPtr = TclAtomicLoadPtr(stackPtr);
+	batchPtr->nextBatch = topPtr;
+    } while (!TclAtomicCasPtr(stackPtr, topPtr, firstPtr));
+}
 
-    Tcl_MutexLock(objLockPtr);
-    fromPtr->lastPtr->internalRep.twoPtrValue.ptr1 = sharedPtr->firstObjPtr;
-    sharedPtr->firstObjPtr = firstPtr;
-    if (sharedPtr->numObjects == 0) {
-	sharedPtr->lastPtr = fromPtr->lastPtr;
-    }
-    sharedPtr->numObjects += numMove;
-    Tcl_MutexUnlock(objLockPtr);
+static void *
+PopBatch(
+    void **stackPtr,		/* Shared stack to pop from. */
+    size_t batchOffset)		/* Offset of the header in an item. */
+{
+    void *topPtr;
 
-    fromPtr->lastPtr = lastPtr;
+    do {
+	topPtr = TclAtomicLoadPtr(stackPtr);
+	if (topPtr == NULL) {
+	    break;
+	}
+    } while (!TclAtomicCasPtr(stackPtr, topPtr,
+	    ((Batch *) ((char *) topPtr + batchOffset))->nextBatch));
+    return topPtr;
 }
 
 /*
@@ -787,6 +1166,7 @@ Block2Ptr(
 
     blockPtr->magicNum1 = blockPtr->magicNum2 = MAGIC;
     blockPtr->sourceBucket = bucket;
+    blockPtr->blockSampled = 0;
     blockPtr->blockReqSize = reqSize;
     ptr = ((void *) (blockPtr + 1));
 #if RCHECK
@@ -894,20 +1274,16 @@ PutBlocks(
     }
 
     /*
-     * Aquire the lock and place the list of blocks at the front of the shared
-     * cache bucket.
+     * Push the list of blocks as one batch onto the shared cache bucket; no
+     * lock is needed for this.
      */
 
-    LockBucket(cachePtr, bucket);
-    cachePtr->buckets[bucket].lastPtr->nextBlock
-	    = sharedPtr->buckets[bucket].firstPtr;
-    sharedPtr->buckets[bucket].firstPtr = firstPtr;
-    if (sharedPtr->buckets[bucket].numFree == 0) {
-	sharedPtr->buckets[bucket].lastPtr
-		= cachePtr->buckets[bucket].lastPtr;
-    }
-    sharedPtr->buckets[bucket].numFree += numMove;
-    UnlockBucket(cachePtr, bucket);
+    BLOCK_BATCH(firstPtr)->lastPtr = cachePtr->buckets[bucket].lastPtr;
+    firstPtr->blockReqSize = numMove;
+    PushBatch((void **) &sharedPtr->buckets[bucket].firstPtr, firstPtr,
+	    BLOCK_BATCH(firstPtr));
+    TclAtomicAddSize(&sharedPtr->buckets[bucket].numFree, numMove);
+    TclAtomicAddSize(&trimCredit, numMove * bucketInfo[bucket].blockSize);
 
     cachePtr->buckets[bucket].lastPtr = lastPtr;
 }
@@ -937,94 +1313,49 @@ GetBlocks(
     size_t n;
 
     /*
-     * First, attempt to move blocks from the shared cache. Note the
-     * potentially dirty read of numFree before acquiring the lock which is a
-     * slight performance enhancement. The value is verified after the lock is
-     * actually acquired.
+     * First, attempt to take a batch of blocks from the shared cache. Note
+     * the potentially dirty read of the stack before acquiring the lock
+     * which is a slight performance enhancement. The stack is read again
+     * after the lock is actually acquired.
      */
 
-    if (cachePtr != sharedPtr && sharedPtr->buckets[bucket].numFree > 0) {
+    if (cachePtr != sharedPtr
+	    && TclAtomicLoadPtr(&sharedPtr->buckets[bucket].firstPtr) != NULL) {
 	LockBucket(cachePtr, bucket);
-	if (sharedPtr->buckets[bucket].numFree > 0) {
-
-	    /*
-	     * Either move the entire list or walk the list to find the last
-	     * block to move.
-	     */
-
-	    n = bucketInfo[bucket].numMove;
-	    if (n >= sharedPtr->buckets[bucket].numFree) {
-		cachePtr->buckets[bucket].firstPtr =
-			sharedPtr->buckets[bucket].firstPtr;
-		cachePtr->buckets[bucket].lastPtr =
-			sharedPtr->buckets[bucket].lastPtr;
-		cachePtr->buckets[bucket].numFree =
-			sharedPtr->buckets[bucket].numFree;
-		sharedPtr->buckets[bucket].firstPtr = NULL;
-		sharedPtr->buckets[bucket].numFree = 0;
-	    } else {
-		blockPtr = sharedPtr->buckets[bucket].firstPtr;
-		cachePtr->buckets[bucket].firstPtr = blockPtr;
-		sharedPtr->buckets[bucket].numFree -= n;
-		cachePtr->buckets[bucket].numFree = n;
-		while (n-- > 1) {
-		    blockPtr = blockPtr->nextBlock;
-		}
-		sharedPtr->buckets[bucket].firstPtr = blockPtr->nextBlock;
-		cachePtr->buckets[bucket].lastPtr = blockPtr;
-		blockPtr->nextBlock = NULL;
-	    }
-	}
+	blockPtr = (Block *)PopBatch(
+		(void **) &sharedPtr->buckets[bucket].firstPtr, sizeof(Block));
 	UnlockBucket(cachePtr, bucket);
+	if (blockPtr != NULL) {
+	    n = blockPtr->blockReqSize;
+	    cachePtr->buckets[bucket].firstPtr = blockPtr;
+	    cachePtr->buckets[bucket].lastPtr =
+		    (Block *)BLOCK_BATCH(blockPtr)->lastPtr;
+	    cachePtr->buckets[bucket].numFree = n;
+	    TclAtomicAddSize(&sharedPtr->buckets[bucket].numFree, -n);
+	}
     }
 
     if (cachePtr->buckets[bucket].numFree == 0) {
-	size_t size;
-
-	/*
-	 * If no blocks could be moved from shared, first look for a larger
-	 * block in this cache to split up.
-	 */
-
-	blockPtr = NULL;
-	n = NBUCKETS;
-	size = 0;
-	while (n-- > (size_t)bucket + 1) {
-	    if (cachePtr->buckets[n].numFree > 0) {
-		size = bucketInfo[n].blockSize;
-		blockPtr = cachePtr->buckets[n].firstPtr;
-		cachePtr->buckets[n].firstPtr = blockPtr->nextBlock;
-		cachePtr->buckets[n].numFree--;
-		break;
-	    }
-	}
-
 	/*
-	 * Otherwise, allocate a big new block directly.
+	 * If no blocks could be moved from shared, carve some more out of
+	 * this cache's slab for the bucket, starting a new slab if needed.
+	 * Only about MAXALLOC bytes are carved at a time so that memory the
+	 * thread does not need is never touched.
 	 */
 
-	if (blockPtr == NULL) {
-	    size = MAXALLOC;
-	    blockPtr = (Block*)TclpSysAlloc(size);
+	if (cachePtr->buckets[bucket].numUncarved == 0) {
+	    blockPtr = NewSlab(bucket, &n);
 	    if (blockPtr == NULL) {
 		return 0;
 	    }
+	    cachePtr->buckets[bucket].carvePtr = blockPtr;
+	    cachePtr->buckets[bucket].numUncarved = n;
 	}
-
-	/*
-	 * Split the larger block into smaller blocks for this bucket.
-	 */
-
-	n = size / bucketInfo[bucket].blockSize;
-	cachePtr->buckets[bucket].numFree = n;
-	cachePtr->buckets[bucket].firstPtr = blockPtr;
-	while (n-- > 1) {
-	    blockPtr->nextBlock = (Block *)
-		((char *) blockPtr + bucketInfo[bucket].blockSize);
-	    blockPtr = blockPtr->nextBlock;
+	n = MAXALLOC / bucketInfo[bucket].blockSize;
+	if (n > cachePtr->buckets[bucket].numUncarved) {
+	    n = cachePtr->buckets[bucket].numUncarved;
 	}
-	cachePtr->buckets[bucket].lastPtr = blockPtr;
-	blockPtr->nextBlock = NULL;
+	CarveBlocks(cachePtr, bucket, n);
     }
     return 1;
 }
@@ -1032,10 +1363,10 @@ GetBlocks(
 /*
  *----------------------------------------------------------------------
  *
- * TclInitThreadAlloc --
+ * CarveBlocks --
  *
- *	Initializes the allocator cache-maintenance structures.
- *      It is done early and protected during the Tcl_InitSubsystems().
+ *	Carve blocks off the slab a cache is carving for a bucket and push
+ *	them on the free list of the bucket.
  *
  * Results:
  *	None.
@@ -1046,131 +1377,1587 @@ GetBlocks(
  *----------------------------------------------------------------------
  */
 
-void
-TclInitThreadAlloc(void)
+static void
+CarveBlocks(
+    Cache *cachePtr,
+    int bucket,
+    size_t n)			/* Number of blocks, at most numUncarved. */
 {
-    unsigned int i;
-
-    listLockPtr = TclpNewAllocMutex();
-    objLockPtr = TclpNewAllocMutex();
-    for (i = 0; i < NBUCKETS; ++i) {
-	bucketInfo[i].blockSize = MINALLOC << i;
-	bucketInfo[i].maxBlocks = ((size_t)1) << (NBUCKETS - 1 - i);
-	bucketInfo[i].numMove = i < NBUCKETS - 1 ?
-		(size_t)1 << (NBUCKETS - 2 - i) : 1;
-	bucketInfo[i].lockPtr = TclpNewAllocMutex();
+    Bucket *bucketPtr = &cachePtr->buckets[bucket];
+    Block *blockPtr = bucketPtr->carvePtr;
+    size_t blockSize = bucketInfo[bucket].blockSize;
+
+    bucketPtr->numUncarved -= n;
+    bucketPtr->numFree += n;
+    if (bucketPtr->firstPtr == NULL) {
+	bucketPtr->lastPtr = (Block *) ((char *) blockPtr + (n-1) * blockSize);
     }
-    TclpInitAllocCache();
+    while (n-- > 1) {
+	blockPtr->nextBlock = (Block *) ((char *) blockPtr + blockSize);
+	blockPtr = blockPtr->nextBlock;
+    }
+    blockPtr->nextBlock = bucketPtr->firstPtr;
+    bucketPtr->firstPtr = bucketPtr->carvePtr;
+    bucketPtr->carvePtr = (Block *) ((char *) blockPtr + blockSize);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * TclFinalizeThreadAlloc --
+ * TakeSlab, RecycleSlab --
  *
- *	This procedure is used to destroy all private resources used in this
- *	file.
+ *	Take a slab, preferring one emptied earlier over a never used one,
+ *	and mapping a new segment when there is neither; or put a slab no
+ *	longer used on the empty list.
  *
  * Results:
- *	None.
+ *	TakeSlab returns the slab, or NULL if the system is out of memory.
  *
  * Side effects:
- *	None.
+ *	May map a segment or recommit the pages of a released slab.
  *
  *----------------------------------------------------------------------
  */
 
-void
-TclFinalizeThreadAlloc(void)
+static Slab *
+TakeSlab(void)
 {
-    unsigned int i;
-
-    for (i = 0; i < NBUCKETS; ++i) {
-	TclpFreeAllocMutex(bucketInfo[i].lockPtr);
-	bucketInfo[i].lockPtr = NULL;
+    Slab *slabPtr;
+    Segment *segmentPtr;
+
+    Tcl_MutexLock(slabLockPtr);
+    slabPtr = emptySlabPtr;
+    if (slabPtr != NULL) {
+	emptySlabPtr = slabPtr->nextPtr;
+	slabStats.numEmpty--;
+    } else {
+	if (nextSlab == NSLABS) {
+	    segmentPtr = (Segment *)MapSegment();
+	    if (segmentPtr == NULL) {
+		Tcl_MutexUnlock(slabLockPtr);
+		return NULL;
+	    }
+	    segmentPtr->nextPtr = firstSegmentPtr;
+	    firstSegmentPtr = segmentPtr;
+	    nextSlab = 1;
+	    slabStats.numSegments++;
+	}
+	slabPtr = &firstSegmentPtr->slabs[nextSlab++];
     }
+    if (slabPtr->released) {
+	if (!ReuseSlab(SLAB_MEMORY(slabPtr))) {
+	    slabPtr->nextPtr = emptySlabPtr;
+	    emptySlabPtr = slabPtr;
+	    slabStats.numEmpty++;
+	    Tcl_MutexUnlock(slabLockPtr);
+	    return NULL;
+	}
+	slabPtr->released = 0;
+    }
+    slabStats.numSlabs++;
+    Tcl_MutexUnlock(slabLockPtr);
+    return slabPtr;
+}
 
-    TclpFreeAllocMutex(objLockPtr);
-    objLockPtr = NULL;
-
-    TclpFreeAllocMutex(listLockPtr);
-    listLockPtr = NULL;
-
-    TclpFreeAllocCache(NULL);
+static void
+RecycleSlab(
+    Slab *slabPtr)		/* An arena slab. */
+{
+    Tcl_MutexLock(slabLockPtr);
+    slabPtr->nextPtr = emptySlabPtr;
+    emptySlabPtr = slabPtr;
+    slabStats.numSlabs--;
+    slabStats.numArenaSlabs--;
+    slabStats.numEmpty++;
+    Tcl_MutexUnlock(slabLockPtr);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * TclFinalizeThreadAllocThread --
+ * NewSlab --
  *
- *	This procedure is used to destroy single thread private resources
- *	defined in this file. Called either during Tcl_FinalizeThread() or
- *	Tcl_Finalize().
+ *	Take a slab for a bucket.
  *
  * Results:
- *	None.
+ *	The first block of the slab, or NULL if the system is out of memory.
+ *	The number of blocks it holds is stored at numBlocksPtr.
  *
  * Side effects:
- *	None.
+ *	See TakeSlab.
  *
  *----------------------------------------------------------------------
  */
 
-void
-TclFinalizeThreadAllocThread(void)
+static Block *
+NewSlab(
+    int bucket,
+    size_t *numBlocksPtr)
 {
-    Cache *cachePtr = (Cache *)TclpGetAllocCache();
-    if (cachePtr != NULL) {
-	TclpFreeAllocCache(cachePtr);
+    Slab *slabPtr = TakeSlab();
+
+    if (slabPtr == NULL) {
+	return NULL;
     }
+    slabPtr->numBlocks = *numBlocksPtr = SLAB_SIZE / bucketInfo[bucket].blockSize;
+    return (Block *) SLAB_MEMORY(slabPtr);
 }
-
-#else /* !(TCL_THREADS && USE_THREAD_ALLOC) */
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_GetMemoryInfo --
+ * TclPushAllocArena, TclPopAllocArena, PopArena --
  *
- *	Return a list-of-lists of memory stats.
+ *	Open an arena that serves value storage for this thread (see
+ *	TclArenaAlloc) until it is closed again, or close the innermost one.
+ *	Arenas nest.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	List appended to given dstring.
+ *	Closing an arena copies the arena storage of the values still alive
+ *	out to the buckets, unless the arena is pinned, and recycles the slabs
+ *	whose blocks have thus all been freed.
  *
  *----------------------------------------------------------------------
  */
 
 void
-Tcl_GetMemoryInfo(
-    TCL_UNUSED(Tcl_DString *))
+TclPushAllocArena(void)
 {
-    Tcl_Panic("Tcl_GetMemoryInfo called when threaded memory allocator not in use");
+    Cache *cachePtr;
+    Arena *arenaPtr = (Arena *)TclpSysAlloc(sizeof(Arena));
+
+    if (arenaPtr == NULL) {
+	Tcl_Panic("alloc: could not allocate new arena");
+    }
+    GETCACHE(cachePtr);
+    memset(arenaPtr, 0, sizeof(Arena));
+    arenaPtr->parentPtr = cachePtr->arenaPtr;
+    cachePtr->arenaPtr = arenaPtr;
 }
-
-/*
- *----------------------------------------------------------------------
- *
- * TclFinalizeThreadAlloc --
- *
- *	This procedure is used to destroy all private resources used in this
- *	file.
- *
- * Results:
- *	None.
- *
- * Side effects:
- *	None.
- *
- *----------------------------------------------------------------------
- */
 
 void
-TclFinalizeThreadAlloc(void)
+TclPopAllocArena(void)
+{
+    Cache *cachePtr;
+
+    GETCACHE(cachePtr);
+    PopArena(cachePtr, 1);
+}
+
+static void
+PopArena(
+    Cache *cachePtr,
+    int promote)		/* Copy out the values still alive? Not when
+				 * the thread exits. */
+{
+    Arena *arenaPtr = cachePtr->arenaPtr;
+
+    if (arenaPtr == NULL) {
+	return;
+    }
+    ArenaRetireSlab(arenaPtr);
+    if (promote && !arenaPtr->pinned && arenaPtr->numValues > 0) {
+	/*
+	 * With no arena open, the copies come from the buckets.
+	 */
+
+	qsort(arenaPtr->slabs, arenaPtr->numSlabs, sizeof(Slab *),
+		CompareAddresses);
+	cachePtr->arenaPtr = NULL;
+	cachePtr->closingPtr = arenaPtr;
+	arenaPtr->numValues = TclPromoteArenaValues(arenaPtr->values,
+		arenaPtr->numValues);
+	cachePtr->closingPtr = NULL;
+    }
+    cachePtr->arenaPtr = arenaPtr->parentPtr;
+    if (promote && arenaPtr->parentPtr != NULL) {
+	/*
+	 * The values may also hold storage from the enclosing arena.
+	 */
+
+	size_t i;
+
+	for (i = 0; i < arenaPtr->numValues; i++) {
+	    Tcl_Obj *objPtr = arenaPtr->values[i];
+
+	    if (objPtr->bytes != NULL || objPtr->length != TCL_INDEX_NONE) {
+		ArenaTrackValue(arenaPtr->parentPtr, objPtr);
+	    }
+	}
+    }
+    if (arenaPtr->slabs != NULL) {
+	TclpSysFree(arenaPtr->slabs);
+    }
+    if (arenaPtr->values != NULL) {
+	TclpSysFree(arenaPtr->values);
+    }
+    TclpSysFree(arenaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclArenaAlloc, TclAttemptArenaAlloc --
+ *
+ *	Allocate storage for a value: its string rep, list store or dict.
+ *	While an arena is open it comes from the innermost one, otherwise
+ *	this is Tcl_Alloc or Tcl_AttemptAlloc. Everything else a script
+ *	allocates, such as procs, byte code or variables, lives on in the
+ *	interp and keeps using the buckets.
+ *
+ *	If objPtr is not NULL the storage is objPtr's own, and the arena
+ *	remembers objPtr to copy the storage out when it is closed. Storage
+ *	that several values share is remembered by the caller through
+ *	TclArenaTrackObj for each of them instead.
+ *
+ * Results:
+ *	The storage. TclAttemptArenaAlloc returns NULL if the system is out of
+ *	memory, TclArenaAlloc panics.
+ *
+ * Side effects:
+ *	See ArenaAlloc.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void *
+TclArenaAlloc(
+    Tcl_Obj *objPtr,		/* Value owning the storage, or NULL. */
+    size_t reqSize)
+{
+    void *ptr = TclAttemptArenaAlloc(objPtr, reqSize);
+
+    if (ptr == NULL) {
+	Tcl_Panic("unable to alloc %" TCL_Z_MODIFIER "u bytes", reqSize);
+    }
+    return ptr;
+}
+
+void *
+TclAttemptArenaAlloc(
+    Tcl_Obj *objPtr,		/* Value owning the storage, or NULL. */
+    size_t reqSize)
+{
+    Cache *cachePtr;
+    void *ptr = AllocFrom(reqSize, 1, TclCallerAddress());
+
+    if (objPtr != NULL && ptr != NULL
+	    && Ptr2Block(ptr)->sourceBucket == ARENA_BUCKET) {
+	GETCACHE(cachePtr);
+	ArenaTrackValue(cachePtr->arenaPtr, objPtr);
+    }
+    return ptr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclArenaTrackObj, TclIsArenaBlock, TclArenaOwns, TclPinAllocArenas --
+ *
+ *	TclArenaTrackObj has the innermost arena of the thread, if any,
+ *	remember a value that refers to storage from TclAttemptArenaAlloc.
+ *	TclIsArenaBlock tells whether such storage came from an arena.
+ *	TclArenaOwns tells whether a block belongs to the arena whose values
+ *	are being copied out. TclPinAllocArenas keeps the blocks of all arenas
+ *	of the thread where they are when they are closed, for the benefit of
+ *	code suspended with pointers into them, such as a coroutine.
+ *
+ * Results:
+ *	TclIsArenaBlock and TclArenaOwns return 1 or 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclArenaTrackObj(
+    Tcl_Obj *objPtr)
+{
+    Cache *cachePtr;
+
+    GETCACHE(cachePtr);
+    if (cachePtr->arenaPtr != NULL) {
+	ArenaTrackValue(cachePtr->arenaPtr, objPtr);
+    }
+}
+
+int
+TclIsArenaBlock(
+    void *ptr)			/* Storage from TclAttemptArenaAlloc. */
+{
+    return Ptr2Block(ptr)->sourceBucket == ARENA_BUCKET;
+}
+
+int
+TclArenaOwns(
+    const void *ptr)		/* Storage from Tcl_Alloc or
+				 * TclAttemptArenaAlloc. */
+{
+    Cache *cachePtr;
+    Arena *arenaPtr;
+    Slab *slabPtr = BLOCK_SLAB(ptr);
+    size_t low, high, mid;
+
+    GETCACHE(cachePtr);
+    arenaPtr = cachePtr->closingPtr;
+    if (arenaPtr == NULL) {
+	return 0;
+    }
+    low = 0;
+    high = arenaPtr->numSlabs;
+    while (low < high) {
+	mid = low + (high - low) / 2;
+	if (arenaPtr->slabs[mid] == slabPtr) {
+	    /*
+	     * Slabs of the arena freed up meanwhile may be serving the
+	     * buckets already.
+	     */
+
+	    return Ptr2Block((void *) ptr)->sourceBucket == ARENA_BUCKET;
+	} else if ((uintptr_t) arenaPtr->slabs[mid] < (uintptr_t) slabPtr) {
+	    low = mid + 1;
+	} else {
+	    high = mid;
+	}
+    }
+    return 0;
+}
+
+void
+TclPinAllocArenas(void)
+{
+    Cache *cachePtr;
+    Arena *arenaPtr;
+
+    GETCACHE(cachePtr);
+    for (arenaPtr = cachePtr->arenaPtr; arenaPtr != NULL;
+	    arenaPtr = arenaPtr->parentPtr) {
+	arenaPtr->pinned = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArenaAlloc, ArenaFree, ArenaRetireSlab, ArenaTrackValue --
+ *
+ *	Carve a block from an arena, free an arena block, have an arena let
+ *	go of its current slab, or remember a value given arena storage.
+ *
+ *	The blocks of the current slab of an arena are counted by the arena
+ *	in numAllocs, which only the owning thread touches, while other
+ *	threads subtract the blocks they free from numLive in the slab. The
+ *	sum of both is the number of live blocks. Retiring the slab adds
+ *	numAllocs to numLive, which cannot drop to zero before that; from
+ *	then on whoever frees the last block recycles the slab.
+ *
+ *	The values remembered may be freed and reused meanwhile, and the same
+ *	value may be remembered many times. When the list fills up, it is
+ *	sorted to drop repeats and freed values before it is grown.
+ *
+ * Results:
+ *	ArenaAlloc returns the block, or NULL if the system is out of memory.
+ *
+ * Side effects:
+ *	Slabs are taken and recycled.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Block *
+ArenaAlloc(
+    Arena *arenaPtr,
+    size_t size)		/* Size including the Block, <= MAXALLOC. */
+{
+    Block *blockPtr;
+    Slab *slabPtr;
+
+    size = (size + (TCL_ALLOCALIGN-1)) & ~(size_t) (TCL_ALLOCALIGN-1);
+    if ((size_t) (arenaPtr->endPtr - arenaPtr->freePtr) < size) {
+	slabPtr = arenaPtr->slabPtr;
+	if (slabPtr != NULL && arenaPtr->numAllocs
+		+ TclAtomicLoadSize(&slabPtr->numLive) == 0) {
+	    /*
+	     * Everything carved from the slab is gone already, start over.
+	     * Keep the sum at zero rather than write to numLive.
+	     */
+
+	    arenaPtr->numAllocs = -TclAtomicLoadSize(&slabPtr->numLive);
+	} else {
+	    ArenaRetireSlab(arenaPtr);
+	    if (arenaPtr->numSlabs == arenaPtr->maxSlabs) {
+		size_t maxSlabs = arenaPtr->maxSlabs ? 2 * arenaPtr->maxSlabs : 8;
+		Slab **slabs = (Slab **)TclpSysRealloc(arenaPtr->slabs,
+			maxSlabs * sizeof(Slab *));
+
+		if (slabs == NULL) {
+		    return NULL;
+		}
+		arenaPtr->slabs = slabs;
+		arenaPtr->maxSlabs = maxSlabs;
+	    }
+	    slabPtr = TakeSlab();
+	    if (slabPtr == NULL) {
+		return NULL;
+	    }
+	    slabPtr->numBlocks = 0;
+	    slabPtr->numLive = 0;
+	    Tcl_MutexLock(slabLockPtr);
+	    slabStats.numArenaSlabs++;
+	    Tcl_MutexUnlock(slabLockPtr);
+	    arenaPtr->slabs[arenaPtr->numSlabs++] = slabPtr;
+	    arenaPtr->slabPtr = slabPtr;
+	    arenaPtr->numAllocs = 0;
+	}
+	arenaPtr->freePtr = SLAB_MEMORY(slabPtr);
+	arenaPtr->endPtr = arenaPtr->freePtr + SLAB_SIZE;
+    }
+    blockPtr = (Block *) arenaPtr->freePtr;
+    arenaPtr->freePtr += size;
+    arenaPtr->numAllocs++;
+    return blockPtr;
+}
+
+static void
+ArenaFree(
+    Cache *cachePtr,
+    Block *blockPtr)
+{
+    Slab *slabPtr = BLOCK_SLAB(blockPtr);
+    Arena *arenaPtr = cachePtr->arenaPtr;
+
+    if (arenaPtr != NULL && arenaPtr->slabPtr == slabPtr) {
+	/*
+	 * A block of the slab this thread is carving. If it was the last one
+	 * carved, its space can even be reused.
+	 */
+
+	arenaPtr->numAllocs--;
+	if ((char *) blockPtr + ARENA_SIZE(blockPtr->blockReqSize)
+		== arenaPtr->freePtr) {
+	    arenaPtr->freePtr = (char *) blockPtr;
+	}
+	return;
+    }
+    if (TclAtomicAddFetchSize(&slabPtr->numLive, -1) == 0) {
+	RecycleSlab(slabPtr);
+    }
+}
+
+static void
+ArenaRetireSlab(
+    Arena *arenaPtr)
+{
+    Slab *slabPtr = arenaPtr->slabPtr;
+
+    if (slabPtr == NULL) {
+	return;
+    }
+    arenaPtr->slabPtr = NULL;
+    arenaPtr->freePtr = arenaPtr->endPtr = NULL;
+    if (TclAtomicAddFetchSize(&slabPtr->numLive, arenaPtr->numAllocs) == 0) {
+	RecycleSlab(slabPtr);
+    }
+}
+
+static void
+ArenaTrackValue(
+    Arena *arenaPtr,
+    Tcl_Obj *objPtr)
+{
+    size_t i, j;
+
+    if (arenaPtr->numValues > 0
+	    && arenaPtr->values[arenaPtr->numValues - 1] == objPtr) {
+	return;
+    }
+    if (arenaPtr->numValues == arenaPtr->maxValues) {
+	qsort(arenaPtr->values, arenaPtr->numValues, sizeof(Tcl_Obj *),
+		CompareAddresses);
+	for (i = j = 0; i < arenaPtr->numValues; i++) {
+	    Tcl_Obj *valuePtr = arenaPtr->values[i];
+
+	    if ((j > 0 && arenaPtr->values[j - 1] == valuePtr)
+		    || (valuePtr->bytes == NULL
+		    && valuePtr->length == TCL_INDEX_NONE)) {
+		continue;
+	    }
+	    arenaPtr->values[j++] = valuePtr;
+	}
+	arenaPtr->numValues = j;
+	if (j >= arenaPtr->maxValues / 2) {
+	    size_t maxValues = arenaPtr->maxValues ? 2 * arenaPtr->maxValues : 64;
+	    Tcl_Obj **values = (Tcl_Obj **)TclpSysRealloc(arenaPtr->values,
+		    maxValues * sizeof(Tcl_Obj *));
+
+	    if (values == NULL) {
+		Tcl_Panic("alloc: could not remember arena values");
+	    }
+	    arenaPtr->values = values;
+	    arenaPtr->maxValues = maxValues;
+	}
+    }
+    arenaPtr->values[arenaPtr->numValues++] = objPtr;
+}
+
+static int
+CompareAddresses(
+    const void *first,
+    const void *second)
+{
+    uintptr_t a = (uintptr_t) *(void *const *) first;
+    uintptr_t b = (uintptr_t) *(void *const *) second;
+
+    return (a > b) - (a < b);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadAllocIdle --
+ *
+ *	Called by the notifier when the thread is about to wait for events.
+ *	If enough memory has been freed to the shared cache since the last
+ *	time, flush the cache of this thread and return every slab whose
+ *	blocks are all in the shared cache to the system.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May shrink the resident size of the process.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclThreadAllocIdle(void)
+{
+    Cache *cachePtr;
+    Slab *emptyPtr = NULL, *slabPtr;
+    unsigned int bucket;
+
+    if (TclAtomicLoadSize(&trimCredit) < ALLOC_TRIM_THRESHOLD) {
+	return;
+    }
+    GETCACHE(cachePtr);
+    Tcl_MutexLock(trimLockPtr);
+    if (TclAtomicLoadSize(&trimCredit) < ALLOC_TRIM_THRESHOLD) {
+	/*
+	 * Another thread trimmed while this one waited for the lock.
+	 */
+
+	Tcl_MutexUnlock(trimLockPtr);
+	return;
+    }
+    for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	if (cachePtr->buckets[bucket].numFree > 0) {
+	    PutBlocks(cachePtr, bucket, cachePtr->buckets[bucket].numFree);
+	}
+    }
+    TclAtomicStoreSize(&trimCredit, 0);
+    for (bucket = 0; bucket < NBUCKETS; ++bucket) {
+	emptyPtr = TrimBucket(cachePtr, bucket, emptyPtr);
+    }
+    Tcl_MutexUnlock(trimLockPtr);
+
+    /*
+     * The slabs are out of circulation now, so their pages can be released
+     * without holding any lock.
+     */
+
+    for (slabPtr = emptyPtr; slabPtr != NULL; slabPtr = slabPtr->nextPtr) {
+	ReleaseSlab(SLAB_MEMORY(slabPtr));
+	slabPtr->released = 1;
+    }
+    Tcl_MutexLock(slabLockPtr);
+    slabStats.numTrims++;
+    while (emptyPtr != NULL) {
+	slabPtr = emptyPtr;
+	emptyPtr = slabPtr->nextPtr;
+	slabPtr->nextPtr = emptySlabPtr;
+	emptySlabPtr = slabPtr;
+	slabStats.numSlabs--;
+	slabStats.numEmpty++;
+	slabStats.numReleased++;
+    }
+    Tcl_MutexUnlock(slabLockPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TrimBucket --
+ *
+ *	Take the free blocks of a shared bucket out of circulation if their
+ *	whole slab is free. The slab descriptors count the free blocks of
+ *	each slab in two passes over the blocks; the third pass keeps the
+ *	blocks of partly used slabs, pushing them back in batches.
+ *
+ * Results:
+ *	emptyPtr, with the slabs found empty prepended.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Slab *
+TrimBucket(
+    Cache *cachePtr,
+    int bucket,
+    Slab *emptyPtr)		/* List of empty slabs to add to. */
+{
+    void **stackPtr = (void **) &sharedPtr->buckets[bucket].firstPtr;
+    Block *chainPtr = NULL, *blockPtr, *nextPtr, *firstPtr = NULL, *lastPtr;
+    Slab *slabPtr;
+    size_t numFree = 0, numKept = 0, numBatch = 0;
+    size_t numMove = bucketInfo[bucket].numMove;
+
+    /*
+     * Holding the bucket lock keeps others from popping; pushes can go on
+     * as they please.
+     */
+
+    LockBucket(cachePtr, bucket);
+    do {
+	blockPtr = (Block *)TclAtomicLoadPtr(stackPtr);
+    } while (blockPtr != NULL && !TclAtomicCasPtr(stackPtr, blockPtr, NULL));
+
+    /*
+     * Join the batches into one chain.
+     */
+
+    while (blockPtr != NULL) {
+	nextPtr = (Block *)BLOCK_BATCH(blockPtr)->nextBatch;
+	numFree += blockPtr->blockReqSize;
+	((Block *)BLOCK_BATCH(blockPtr)->lastPtr)->nextBlock = chainPtr;
+	chainPtr = blockPtr;
+	blockPtr = nextPtr;
+    }
+
+    for (blockPtr = chainPtr; blockPtr; blockPtr = blockPtr->nextBlock) {
+	BLOCK_SLAB(blockPtr)->numFound = 0;
+    }
+    for (blockPtr = chainPtr; blockPtr; blockPtr = blockPtr->nextBlock) {
+	BLOCK_SLAB(blockPtr)->numFound++;
+    }
+
+    lastPtr = NULL;
+    for (blockPtr = chainPtr; blockPtr; blockPtr = nextPtr) {
+	nextPtr = blockPtr->nextBlock;
+	slabPtr = BLOCK_SLAB(blockPtr);
+	if (slabPtr->numBlocks == 0) {
+	    continue;
+	}
+	if (slabPtr->numFound == slabPtr->numBlocks) {
+	    slabPtr->numBlocks = 0;
+	    slabPtr->nextPtr = emptyPtr;
+	    emptyPtr = slabPtr;
+	    continue;
+	}
+	if (numBatch == 0) {
+	    firstPtr = blockPtr;
+	} else {
+	    lastPtr->nextBlock = blockPtr;
+	}
+	lastPtr = blockPtr;
+	numKept++;
+	if (++numBatch == numMove) {
+	    lastPtr->nextBlock = NULL;
+	    BLOCK_BATCH(firstPtr)->lastPtr = lastPtr;
+	    firstPtr->blockReqSize = numBatch;
+	    PushBatch(stackPtr, firstPtr, BLOCK_BATCH(firstPtr));
+	    numBatch = 0;
+	}
+    }
+    if (numBatch > 0) {
+	lastPtr->nextBlock = NULL;
+	BLOCK_BATCH(firstPtr)->lastPtr = lastPtr;
+	firstPtr->blockReqSize = numBatch;
+	PushBatch(stackPtr, firstPtr, BLOCK_BATCH(firstPtr));
+    }
+    TclAtomicAddSize(&sharedPtr->buckets[bucket].numFree, numKept - numFree);
+    UnlockBucket(cachePtr, bucket);
+    return emptyPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapSegment, ReleaseSlab, ReuseSlab --
+ *
+ *	Get a SEGMENT_SIZE-aligned segment of memory from the system, return
+ *	the pages of a slab to it, and take them back before reuse.
+ *
+ * Results:
+ *	MapSegment returns the segment, or NULL. ReuseSlab returns 0 if the
+ *	pages could not be had again.
+ *
+ * Side effects:
+ *	Mapping changes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void *
+MapSegment(void)
+{
+    char *ptr, *alignedPtr;
+
+#ifdef _WIN32
+    /*
+     * Reserve twice the size to find an aligned address, then reserve just
+     * that. Another thread may take the address in between; try again then.
+     */
+
+    do {
+	ptr = (char *)VirtualAlloc(NULL, 2 * SEGMENT_SIZE, MEM_RESERVE,
+		PAGE_NOACCESS);
+	if (ptr == NULL) {
+	    return NULL;
+	}
+	alignedPtr = (char *) (((uintptr_t) ptr + SEGMENT_SIZE - 1)
+		& ~(uintptr_t) (SEGMENT_SIZE - 1));
+	VirtualFree(ptr, 0, MEM_RELEASE);
+	ptr = (char *)VirtualAlloc(alignedPtr, SEGMENT_SIZE,
+		MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    } while (ptr == NULL);
+#else
+    ptr = (char *)mmap(NULL, 2 * SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+	return NULL;
+    }
+    alignedPtr = (char *) (((uintptr_t) ptr + SEGMENT_SIZE - 1)
+	    & ~(uintptr_t) (SEGMENT_SIZE - 1));
+    if (alignedPtr > ptr) {
+	munmap(ptr, (size_t) (alignedPtr - ptr));
+    }
+    munmap(alignedPtr + SEGMENT_SIZE,
+	    (size_t) (ptr + SEGMENT_SIZE - alignedPtr));
+#endif
+    return alignedPtr;
+}
+
+static void
+ReleaseSlab(
+    void *memPtr)
+{
+#ifdef _WIN32
+    VirtualFree(memPtr, SLAB_SIZE, MEM_DECOMMIT);
+#elif defined(MADV_FREE) && !defined(__linux__)
+    madvise(memPtr, SLAB_SIZE, MADV_FREE);
+#else
+    /*
+     * Linux implements MADV_FREE lazily, the resident size only shrinks
+     * under memory pressure; MADV_DONTNEED drops the pages at once.
+     */
+
+    madvise(memPtr, SLAB_SIZE, MADV_DONTNEED);
+#endif
+}
+
+static int
+ReuseSlab(
+    void *memPtr)
+{
+#ifdef _WIN32
+    return VirtualAlloc(memPtr, SLAB_SIZE, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    (void) memPtr;
+    return 1;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetAllocProfileRate --
+ *
+ *	Start the sampling heap profiler, taking a sample about once per
+ *	'rate' bytes allocated by each thread, or stop it if 'rate' is 0.
+ *	Samples already taken are kept after the profiler stops, and go away
+ *	as their memory is freed or TclResetAllocProfile is called.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the allocator cannot profile.
+ *
+ * Side effects:
+ *	The calling thread starts over counting down to its next sample;
+ *	other threads pick up the new rate at their next check.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetAllocProfileRate(
+    size_t rate)
+{
+    Cache *cachePtr;
+
+    GETCACHE(cachePtr);
+    Tcl_MutexLock(profileLockPtr);
+    TclAtomicStoreSize(&profileRate, rate);
+    Tcl_MutexUnlock(profileLockPtr);
+    cachePtr->bytesToSample = 0;
+    cachePtr->objsToSample = 0;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetAllocProfile --
+ *
+ *	Report the memory held by the sites that allocated it, as far as the
+ *	profiler's live samples tell.
+ *
+ * Results:
+ *	A list of dictionaries with keys proc, file, line, caller, bytes and
+ *	samples, one for each site with live samples, biggest first.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+typedef struct {
+    char *key;			/* Copy of the site key. */
+    AllocSite site;		/* Copy of the counts. */
+} SiteCopy;
+
+Tcl_Obj *
+TclGetAllocProfile(void)
+{
+    static const char *const fields[] = {
+	"proc", "file", "line", "caller", NULL
+    };
+    SiteCopy *copies = NULL;
+    size_t i, numCopies = 0;
+    Tcl_Obj *resultPtr;
+
+    /*
+     * Copy the sites with the system allocator, as building the result
+     * under the lock could try to take a sample and deadlock.
+     */
+
+    Tcl_MutexLock(profileLockPtr);
+    if (profileInitialized && profileSites.numEntries > 0) {
+	Tcl_HashSearch search;
+	Tcl_HashEntry *hPtr;
+
+	copies = (SiteCopy *)TclpSysAlloc(
+		profileSites.numEntries * sizeof(SiteCopy));
+	if (copies == NULL) {
+	    Tcl_Panic("alloc: could not copy profile");
+	}
+	for (hPtr = Tcl_FirstHashEntry(&profileSites, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    AllocSite *sitePtr = (AllocSite *)Tcl_GetHashValue(hPtr);
+	    const char *key = (const char *)
+		    Tcl_GetHashKey(&profileSites, hPtr);
+
+	    if (sitePtr->numLive == 0) {
+		continue;
+	    }
+	    copies[numCopies].key = (char *)TclpSysAlloc(strlen(key) + 1);
+	    if (copies[numCopies].key == NULL) {
+		Tcl_Panic("alloc: could not copy profile");
+	    }
+	    strcpy(copies[numCopies].key, key);
+	    copies[numCopies].site = *sitePtr;
+	    numCopies++;
+	}
+    }
+    Tcl_MutexUnlock(profileLockPtr);
+
+    qsort(copies, numCopies, sizeof(SiteCopy), CompareSites);
+    TclNewObj(resultPtr);
+    for (i = 0; i < numCopies; i++) {
+	Tcl_Obj *dictPtr = Tcl_NewDictObj();
+	char *part = copies[i].key;
+	int field;
+
+	/*
+	 * The fields of the key are separated by newlines; see GetSiteKey.
+	 */
+
+	for (field = 0; fields[field] != NULL; field++) {
+	    char *end = strchr(part, '\n');
+	    Tcl_Obj *valuePtr;
+
+	    if (end == NULL) {
+		end = part + strlen(part);
+	    }
+	    valuePtr = Tcl_NewStringObj(part, end - part);
+	    Tcl_DictObjPut(NULL, dictPtr, Tcl_NewStringObj(fields[field], -1),
+		    valuePtr);
+	    part = (*end != '\0') ? end + 1 : end;
+	}
+	Tcl_DictObjPut(NULL, dictPtr, Tcl_NewStringObj("bytes", -1),
+		Tcl_NewWideIntObj((Tcl_WideInt) copies[i].site.liveBytes));
+	Tcl_DictObjPut(NULL, dictPtr, Tcl_NewStringObj("samples", -1),
+		Tcl_NewWideIntObj((Tcl_WideInt) copies[i].site.numLive));
+	Tcl_ListObjAppendElement(NULL, resultPtr, dictPtr);
+	TclpSysFree(copies[i].key);
+    }
+    if (copies != NULL) {
+	TclpSysFree(copies);
+    }
+    return resultPtr;
+}
+
+static int
+CompareSites(
+    const void *first,
+    const void *second)
+{
+    size_t firstBytes = ((const SiteCopy *) first)->site.liveBytes;
+    size_t secondBytes = ((const SiteCopy *) second)->site.liveBytes;
+
+    if (firstBytes != secondBytes) {
+	return (firstBytes < secondBytes) ? 1 : -1;
+    }
+    return strcmp(((const SiteCopy *) first)->key,
+	    ((const SiteCopy *) second)->key);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclResetAllocProfile --
+ *
+ *	Discard all samples and sites of the profiler.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory sampled so far is no longer accounted for.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclResetAllocProfile(void)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    size_t i;
+
+    Tcl_MutexLock(profileLockPtr);
+    if (profileInitialized) {
+	for (hPtr = Tcl_FirstHashEntry(&profileSamples, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    TclpSysFree(Tcl_GetHashValue(hPtr));
+	}
+	Tcl_DeleteHashTable(&profileSamples);
+	for (hPtr = Tcl_FirstHashEntry(&profileSites, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    TclpSysFree(Tcl_GetHashValue(hPtr));
+	}
+	Tcl_DeleteHashTable(&profileSites);
+	profileInitialized = 0;
+    }
+
+    /*
+     * Blocks keep their flag; freeing them finds no sample, which is fine.
+     */
+
+    for (i = 0; i < OBJ_FILTER_SIZE; i++) {
+	TclAtomicStoreSize(&objFilter[i], 0);
+    }
+    TclAtomicStoreSize(&tclNumSampledObjs, 0);
+    Tcl_MutexUnlock(profileLockPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NextSample --
+ *
+ *	Draw the distance to the next sample of a thread, in allocations of
+ *	'unit' bytes: half the mean distance plus up to the mean distance
+ *	more, so that the mean holds and no allocation pattern can dodge the
+ *	samples. While the profiler is stopped, the thread checks back now
+ *	and then.
+ *
+ * Results:
+ *	The number of bytes or objects to allocate before the next check.
+ *
+ * Side effects:
+ *	Advances the random state of the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static size_t
+NextSample(
+    Cache *cachePtr,
+    size_t rate,
+    size_t unit)
+{
+    size_t mean;
+
+    if (rate == 0) {
+	return (unit == 1) ? PROFILE_IDLE_BYTES : PROFILE_IDLE_OBJS;
+    }
+    mean = rate / unit;
+    if (mean < 2) {
+	return 1;
+    }
+    if (cachePtr->profileSeed == 0) {
+	cachePtr->profileSeed = (unsigned int) (uintptr_t) cachePtr | 1;
+    }
+    cachePtr->profileSeed = cachePtr->profileSeed * 1103515245 + 12345;
+    return mean / 2 + (cachePtr->profileSeed >> 1) % mean;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakeSample, ReleaseSample --
+ *
+ *	Record a sample of the memory just allocated, once a thread has
+ *	counted down to it, or release the sample of memory being freed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The site of the allocation gains or loses the bytes the sample
+ *	stands for. TakeSample also restarts the countdown of the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TakeSample(
+    Cache *cachePtr,
+    void *memPtr,		/* User pointer of a block, or an object. */
+    size_t size,		/* Bytes allocated. */
+    int isObj,
+    void *caller)		/* C code that asked for the memory. */
+{
+    size_t rate = TclAtomicLoadSize(&profileRate);
+    char key[PROFILE_SITE_SIZE];
+    Tcl_HashEntry *hPtr;
+    AllocSample *samplePtr;
+    AllocSite *sitePtr;
+    int isNew;
+
+    if (isObj) {
+	cachePtr->objsToSample = NextSample(cachePtr, rate, TCL_OBJ_SIZE);
+    } else {
+	cachePtr->bytesToSample = NextSample(cachePtr, rate, 1);
+    }
+    if (rate == 0 || cachePtr->inProfiler) {
+	return;
+    }
+    cachePtr->inProfiler = 1;
+    GetSiteKey(cachePtr, caller, key, sizeof(key));
+
+    Tcl_MutexLock(profileLockPtr);
+    if (!profileInitialized) {
+	Tcl_InitCustomHashTable(&profileSites, TCL_CUSTOM_TYPE_KEYS,
+		&siteKeyType);
+	Tcl_InitCustomHashTable(&profileSamples, TCL_CUSTOM_PTR_KEYS,
+		&sampleKeyType);
+	profileInitialized = 1;
+    }
+    hPtr = Tcl_CreateHashEntry(&profileSites, key, &isNew);
+    if (isNew) {
+	sitePtr = (AllocSite *)TclpSysAlloc(sizeof(AllocSite));
+	if (sitePtr == NULL) {
+	    Tcl_Panic("alloc: could not allocate profile site");
+	}
+	sitePtr->liveBytes = sitePtr->numLive = 0;
+	Tcl_SetHashValue(hPtr, sitePtr);
+    } else {
+	sitePtr = (AllocSite *)Tcl_GetHashValue(hPtr);
+    }
+
+    hPtr = Tcl_CreateHashEntry(&profileSamples, memPtr, &isNew);
+    if (isNew) {
+	samplePtr = (AllocSample *)TclpSysAlloc(sizeof(AllocSample));
+	if (samplePtr == NULL) {
+	    Tcl_Panic("alloc: could not allocate profile sample");
+	}
+	Tcl_SetHashValue(hPtr, samplePtr);
+	if (isObj) {
+	    TclAtomicAddSize(&OBJ_FILTER(memPtr), 1);
+	    TclAtomicAddSize(&tclNumSampledObjs, 1);
+	}
+    } else {
+	/*
+	 * Left over from memory freed while its flag was lost to a reset.
+	 */
+
+	samplePtr = (AllocSample *)Tcl_GetHashValue(hPtr);
+	samplePtr->sitePtr->liveBytes -= samplePtr->weight;
+	samplePtr->sitePtr->numLive--;
+    }
+    samplePtr->sitePtr = sitePtr;
+    samplePtr->weight = (size > rate) ? size : rate;
+    sitePtr->liveBytes += samplePtr->weight;
+    sitePtr->numLive++;
+    if (!isObj) {
+	(((Block *) memPtr) - 1)->blockSampled = 1;
+    }
+    Tcl_MutexUnlock(profileLockPtr);
+    cachePtr->inProfiler = 0;
+}
+
+static void
+ReleaseSample(
+    void *memPtr,		/* User pointer of a block, or an object. */
+    int isObj)
+{
+    Tcl_HashEntry *hPtr = NULL;
+
+    if (profileLockPtr == NULL) {
+	return;
+    }
+    Tcl_MutexLock(profileLockPtr);
+    if (profileInitialized) {
+	hPtr = Tcl_FindHashEntry(&profileSamples, memPtr);
+    }
+    if (hPtr != NULL) {
+	AllocSample *samplePtr = (AllocSample *)Tcl_GetHashValue(hPtr);
+
+	samplePtr->sitePtr->liveBytes -= samplePtr->weight;
+	samplePtr->sitePtr->numLive--;
+	TclpSysFree(samplePtr);
+	Tcl_DeleteHashEntry(hPtr);
+	if (isObj) {
+	    TclAtomicAddSize(&OBJ_FILTER(memPtr), -1);
+	    TclAtomicAddSize(&tclNumSampledObjs, -1);
+	}
+    }
+    Tcl_MutexUnlock(profileLockPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetSiteKey --
+ *
+ *	Describe the site of an allocation being sampled: the proc being
+ *	evaluated by the thread, the line of the command it is at, within its
+ *	file if it has been sourced, and the C code that asked for the
+ *	memory, separated by newlines. Nothing is known of Tcl code that has
+ *	not been evaluated through TclNRRunCallbacks. The line is that of the
+ *	command being invoked by the current proc, so the memory allocated by
+ *	instructions compiled inline in its body is charged to the proc
+ *	alone, at line 0.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores the description in 'buf', truncated to 'bufSize' bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GetSiteKey(
+    Cache *cachePtr,
+    void *caller,
+    char *buf,
+    size_t bufSize)
+{
+    Interp *iPtr = (Interp *) cachePtr->evalInterp;
+    const char *nsName = "", *procName = "", *fileName = "";
+    char callerBuf[2 * sizeof(void *) + 3] = "";
+    Tcl_Obj *pathPtr = NULL;
+    int line = 0;
+
+    if (iPtr != NULL && !(iPtr->flags & DELETED)) {
+	CallFrame *framePtr = iPtr->framePtr;
+	CmdFrame *cfPtr = iPtr->cmdFramePtr;
+
+	/*
+	 * Take names only from strings that are there already: generating
+	 * one would allocate.
+	 */
+
+	if (framePtr->procPtr != NULL) {
+	    Command *cmdPtr = framePtr->procPtr->cmdPtr;
+
+	    if (cmdPtr != NULL && cmdPtr->hPtr != NULL) {
+		nsName = cmdPtr->nsPtr->fullName;
+		procName = (const char *)
+			Tcl_GetHashKey(cmdPtr->hPtr->tablePtr, cmdPtr->hPtr);
+	    } else if (framePtr->objc > 0 && framePtr->objv[0]->bytes) {
+		procName = framePtr->objv[0]->bytes;
+	    }
+	}
+
+	if (cfPtr != NULL && cfPtr->framePtr == framePtr) {
+	    CmdFrame ctx = *cfPtr;
+
+	    if (ctx.type == TCL_LOCATION_BC && ctx.data.tebc.pc != NULL) {
+		TclGetSrcInfoForPc(&ctx);
+		if (ctx.type == TCL_LOCATION_SOURCE) {
+		    pathPtr = ctx.data.eval.path;
+		}
+	    }
+	    if (ctx.type != TCL_LOCATION_BC && ctx.type != TCL_LOCATION_PREBC) {
+		if (ctx.nline > 0 && ctx.line != NULL) {
+		    line = ctx.line[0];
+		}
+		if (ctx.type == TCL_LOCATION_SOURCE && ctx.data.eval.path
+			&& ctx.data.eval.path->bytes) {
+		    fileName = ctx.data.eval.path->bytes;
+		}
+	    }
+	}
+    }
+    if (caller != NULL) {
+	snprintf(callerBuf, sizeof(callerBuf), "%p", caller);
+    }
+    snprintf(buf, bufSize, "%s%s%s\n%s\n%d\n%s", nsName,
+	    (nsName[0] != '\0' && strcmp(nsName, "::") != 0) ? "::" : "",
+	    procName, fileName, line, callerBuf);
+    if (pathPtr != NULL) {
+	Tcl_DecrRefCount(pathPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocSiteEntry, CompareSiteKeys, AllocSampleEntry, FreeProfileEntry --
+ *
+ *	Hash table entries of the profiler, taken from the system allocator.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+AllocSiteEntry(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)
+{
+    const char *key = (const char *) keyPtr;
+    size_t size = offsetof(Tcl_HashEntry, key) + strlen(key) + 1;
+    Tcl_HashEntry *hPtr;
+
+    if (size < sizeof(Tcl_HashEntry)) {
+	size = sizeof(Tcl_HashEntry);
+    }
+    hPtr = (Tcl_HashEntry *)TclpSysAlloc(size);
+    if (hPtr == NULL) {
+	Tcl_Panic("alloc: could not allocate profile site");
+    }
+    strcpy(hPtr->key.string, key);
+    Tcl_SetHashValue(hPtr, NULL);
+    return hPtr;
+}
+
+static int
+CompareSiteKeys(
+    void *keyPtr,
+    Tcl_HashEntry *hPtr)
+{
+    return strcmp((const char *) keyPtr, hPtr->key.string) == 0;
+}
+
+static Tcl_HashEntry *
+AllocSampleEntry(
+    TCL_UNUSED(Tcl_HashTable *),
+    void *keyPtr)
+{
+    Tcl_HashEntry *hPtr = (Tcl_HashEntry *)
+	    TclpSysAlloc(sizeof(Tcl_HashEntry));
+
+    if (hPtr == NULL) {
+	Tcl_Panic("alloc: could not allocate profile sample");
+    }
+    hPtr->key.oneWordValue = (char *) keyPtr;
+    Tcl_SetHashValue(hPtr, NULL);
+    return hPtr;
+}
+
+static void
+FreeProfileEntry(
+    Tcl_HashEntry *hPtr)
+{
+    TclpSysFree(hPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitThreadAlloc --
+ *
+ *	Initializes the allocator cache-maintenance structures.
+ *      It is done early and protected during the Tcl_InitSubsystems().
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclInitThreadAlloc(void)
+{
+    unsigned int i;
+
+    listLockPtr = TclpNewAllocMutex();
+    objLockPtr = TclpNewAllocMutex();
+    slabLockPtr = TclpNewAllocMutex();
+    trimLockPtr = TclpNewAllocMutex();
+    profileLockPtr = TclpNewAllocMutex();
+    for (i = 0; i < NBUCKETS; ++i) {
+	unsigned int power = i / 2;
+	size_t size = MINALLOC << power;
+
+	if (i & 1) {
+	    size = (size + size / 2 + (TCL_ALLOCALIGN-1)) & ~(TCL_ALLOCALIGN-1);
+	}
+	bucketInfo[i].blockSize = size;
+	bucketInfo[i].maxBlocks = ((size_t)1) << (NPOWERS - 1 - power);
+	bucketInfo[i].numMove = power < NPOWERS - 1 ?
+		(size_t)1 << (NPOWERS - 2 - power) : 1;
+	bucketInfo[i].lockPtr = TclpNewAllocMutex();
+    }
+    TclpInitAllocCache();
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeThreadAlloc --
+ *
+ *	This procedure is used to destroy all private resources used in this
+ *	file.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeThreadAlloc(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < NBUCKETS; ++i) {
+	TclpFreeAllocMutex(bucketInfo[i].lockPtr);
+	bucketInfo[i].lockPtr = NULL;
+    }
+
+    TclpFreeAllocMutex(objLockPtr);
+    objLockPtr = NULL;
+
+    TclpFreeAllocMutex(slabLockPtr);
+    slabLockPtr = NULL;
+    TclpFreeAllocMutex(trimLockPtr);
+    trimLockPtr = NULL;
+
+    TclResetAllocProfile();
+    profileRate = 0;
+    TclpFreeAllocMutex(profileLockPtr);
+    profileLockPtr = NULL;
+
+    TclpFreeAllocMutex(listLockPtr);
+    listLockPtr = NULL;
+
+    TclpFreeAllocCache(NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeThreadAllocThread --
+ *
+ *	This procedure is used to destroy single thread private resources
+ *	defined in this file. Called either during Tcl_FinalizeThread() or
+ *	Tcl_Finalize().
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeThreadAllocThread(void)
+{
+    Cache *cachePtr = (Cache *)TclpGetAllocCache();
+    if (cachePtr != NULL) {
+	TclpFreeAllocCache(cachePtr);
+    }
+}
+
+#else /* !(TCL_THREADS && USE_THREAD_ALLOC) */
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_GetMemoryInfo --
+ *
+ *	Return a list-of-lists of memory stats.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	List appended to given dstring.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_GetMemoryInfo(
+    TCL_UNUSED(Tcl_DString *))
+{
+    Tcl_Panic("Tcl_GetMemoryInfo called when threaded memory allocator not in use");
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFinalizeThreadAlloc --
+ *
+ *	This procedure is used to destroy all private resources used in this
+ *	file.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFinalizeThreadAlloc(void)
+{
+    Tcl_Panic("TclFinalizeThreadAlloc called when threaded memory allocator not in use");
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclPushAllocArena, TclPopAllocArena, TclArenaAlloc, ... --
+ *
+ *	Arenas need the threaded memory allocator; without it, value storage
+ *	in an arena scope is allocated as usual.
+ *
+ * Results:
+ *	See the threaded versions above.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclPushAllocArena(void)
+{
+}
+
+void
+TclPopAllocArena(void)
+{
+}
+
+void *
+TclArenaAlloc(
+    TCL_UNUSED(Tcl_Obj *),
+    size_t reqSize)
+{
+    return Tcl_Alloc(reqSize);
+}
+
+void *
+TclAttemptArenaAlloc(
+    TCL_UNUSED(Tcl_Obj *),
+    size_t reqSize)
+{
+    return Tcl_AttemptAlloc(reqSize);
+}
+
+void
+TclArenaTrackObj(
+    TCL_UNUSED(Tcl_Obj *))
+{
+}
+
+int
+TclIsArenaBlock(
+    TCL_UNUSED(void *))
+{
+    return 0;
+}
+
+int
+TclArenaOwns(
+    TCL_UNUSED(const void *))
+{
+    return 0;
+}
+
+void
+TclPinAllocArenas(void)
+{
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetAllocProfileRate, TclGetAllocProfile, TclResetAllocProfile --
+ *
+ *	The heap profiler needs the threaded memory allocator.
+ *
+ * Results:
+ *	TCL_ERROR and NULL respectively.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetAllocProfileRate(
+    TCL_UNUSED(size_t) /*rate*/)
+{
+    return TCL_ERROR;
+}
+
+Tcl_Obj *
+TclGetAllocProfile(void)
+{
+    return NULL;
+}
+
+void
+TclResetAllocProfile(void)
 {
-    Tcl_Panic("TclFinalizeThreadAlloc called when threaded memory allocator not in use");
 }
 #endif /* TCL_THREADS && USE_THREAD_ALLOC */
 
@@ -105,6 +105,39 @@ typedef struct ThreadEventResult {
 
 static ThreadEventResult *resultList;
 
+/*
+ * Queue through which "testthread transfer" hands lists of objects to a
+ * consumer thread, which frees them. This exercises the allocator paths for
+ * memory released by a thread other than the one that allocated it.
+ */
+
+typedef struct TransferItem {
+    Tcl_Obj *listPtr;		/* List of objects to free. */
+    struct TransferItem *nextPtr;
+} TransferItem;
+
+typedef struct TransferQueue {
+    Tcl_Mutex mutex;		/* Guards the fields below. */
+    Tcl_Condition cond;		/* Signaled when an item is queued or done is
+				 * set. */
+    TransferItem *firstPtr;	/* Queued lists, oldest first. */
+    TransferItem *lastPtr;
+    int done;			/* Set when nothing more will be queued. */
+    Tcl_Size numFreed;		/* Objects freed by the consumer. */
+} TransferQueue;
+
+/*
+ * A thread started by "testthread frozen", which evaluates a script in an
+ * interpreter of its own with the variable "value" set to a frozen value.
+ */
+
+typedef struct FrozenWorker {
+    Tcl_ThreadId id;		/* The thread. */
+    Tcl_Obj *valuePtr;		/* The thread's own handle on the value. */
+    const char *script;		/* Script to evaluate. */
+    char *result;		/* Result of the script, set by the thread. */
+} FrozenWorker;
+
 /*
  * This is for simple error handling when a thread script exits badly.
  */
@@ -128,6 +161,11 @@ static int		ThreadSend(Tcl_Interp *interp, Tcl_ThreadId id,
 			    const char *script, int wait);
 static int		ThreadCancel(Tcl_Interp *interp, Tcl_ThreadId id,
 			    const char *result, int flags);
+static int		ThreadTransfer(Tcl_Interp *interp, Tcl_Size count);
+static Tcl_ThreadCreateType	TransferThread(void *clientData);
+static int		ThreadFrozen(Tcl_Interp *interp, Tcl_Obj *valuePtr,
+			    Tcl_Size count, const char *script);
+static Tcl_ThreadCreateType	FrozenThread(void *clientData);
 
 static Tcl_ThreadCreateType	NewTestThread(void *clientData);
 static void		ListRemove(ThreadSpecificData *tsdPtr);
@@ -212,13 +250,13 @@ ThreadCmd(
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
     static const char *const threadOptions[] = {
 	"cancel", "create", "event", "exit", "id",
-	"join", "names", "send", "wait", "errorproc",
-	NULL
+	"join", "names", "send", "wait", "errorproc", "transfer",
+	"frozen", NULL
     };
     enum options {
 	THREAD_CANCEL, THREAD_CREATE, THREAD_EVENT, THREAD_EXIT,
 	THREAD_ID, THREAD_JOIN, THREAD_NAMES, THREAD_SEND,
-	THREAD_WAIT, THREAD_ERRORPROC
+	THREAD_WAIT, THREAD_ERRORPROC, THREAD_TRANSFER, THREAD_FROZEN
     } option;
 
     if (objc < 2) {
@@ -438,6 +476,31 @@ ThreadCmd(
 	Tcl_MutexUnlock(&threadMutex);
 	return TCL_OK;
     }
+    case THREAD_TRANSFER: {
+	Tcl_WideInt count;
+
+	if (objc != 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "count");
+	    return TCL_ERROR;
+	}
+	if (Tcl_GetWideIntFromObj(interp, objv[2], &count) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	return ThreadTransfer(interp, (Tcl_Size) count);
+    }
+    case THREAD_FROZEN: {
+	Tcl_WideInt count;
+
+	if (objc != 5) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "value count script");
+	    return TCL_ERROR;
+	}
+	if (Tcl_GetWideIntFromObj(interp, objv[3], &count) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	return ThreadFrozen(interp, objv[2], (Tcl_Size) count,
+		Tcl_GetString(objv[4]));
+    }
     case THREAD_WAIT:
 	if (objc > 2) {
 	    Tcl_WrongNumArgs(interp, 2, objv, "");
@@ -523,6 +586,241 @@ ThreadCreate(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadTransfer --
+ *
+ *	This procedure is invoked to process "testthread transfer". It creates
+ *	count string objects of assorted lengths in the current thread and
+ *	passes them, a list at a time, to a new thread that frees them.
+ *
+ * Results:
+ *	A standard Tcl result, which is the number of objects the other thread
+ *	freed.
+ *
+ * Side effects:
+ *	Creates and joins a thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ThreadTransfer(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size count)		/* Number of objects to transfer. */
+{
+    TransferQueue queue;
+    TransferItem *itemPtr;
+    Tcl_ThreadId id;
+    Tcl_Size i;
+    int status;
+
+    memset(&queue, 0, sizeof(queue));
+    Tcl_MutexLock(&queue.mutex);	/* Creates the mutex before sharing it */
+    if (Tcl_CreateThread(&id, TransferThread, &queue,
+	    TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+	Tcl_MutexUnlock(&queue.mutex);
+	Tcl_MutexFinalize(&queue.mutex);
+	Tcl_AppendResult(interp, "cannot create a new thread", (char *)NULL);
+	return TCL_ERROR;
+    }
+    Tcl_MutexUnlock(&queue.mutex);
+
+    for (i = 0; i < count; ) {
+	itemPtr = (TransferItem *)Tcl_Alloc(sizeof(TransferItem));
+	itemPtr->listPtr = Tcl_NewListObj(0, NULL);
+	itemPtr->nextPtr = NULL;
+	do {
+	    Tcl_ListObjAppendElement(NULL, itemPtr->listPtr, Tcl_ObjPrintf(
+		    "%d%*s", (int) i, (int) (i % 300), ""));
+	} while (++i < count && i % 256);
+	Tcl_IncrRefCount(itemPtr->listPtr);
+
+	Tcl_MutexLock(&queue.mutex);
+	if (queue.lastPtr) {
+	    queue.lastPtr->nextPtr = itemPtr;
+	} else {
+	    queue.firstPtr = itemPtr;
+	}
+	queue.lastPtr = itemPtr;
+	Tcl_ConditionNotify(&queue.cond);
+	Tcl_MutexUnlock(&queue.mutex);
+    }
+
+    Tcl_MutexLock(&queue.mutex);
+    queue.done = 1;
+    Tcl_ConditionNotify(&queue.cond);
+    Tcl_MutexUnlock(&queue.mutex);
+    Tcl_JoinThread(id, &status);
+    Tcl_ConditionFinalize(&queue.cond);
+    Tcl_MutexFinalize(&queue.mutex);
+
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(queue.numFreed));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TransferThread --
+ *
+ *	The "main()" of the consumer thread of "testthread transfer": frees
+ *	the queued lists until told there are no more.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	Frees objects allocated by another thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+TransferThread(
+    void *clientData)
+{
+    TransferQueue *queuePtr = (TransferQueue *)clientData;
+    TransferItem *itemPtr;
+    Tcl_Size length;
+
+    Tcl_MutexLock(&queuePtr->mutex);
+    while (1) {
+	while (queuePtr->firstPtr == NULL && !queuePtr->done) {
+	    Tcl_ConditionWait(&queuePtr->cond, &queuePtr->mutex, NULL);
+	}
+	itemPtr = queuePtr->firstPtr;
+	if (itemPtr == NULL) {
+	    break;
+	}
+	queuePtr->firstPtr = itemPtr->nextPtr;
+	if (queuePtr->firstPtr == NULL) {
+	    queuePtr->lastPtr = NULL;
+	}
+	Tcl_MutexUnlock(&queuePtr->mutex);
+
+	Tcl_ListObjLength(NULL, itemPtr->listPtr, &length);
+	Tcl_DecrRefCount(itemPtr->listPtr);
+	Tcl_Free(itemPtr);
+
+	Tcl_MutexLock(&queuePtr->mutex);
+	queuePtr->numFreed += length;
+    }
+    Tcl_MutexUnlock(&queuePtr->mutex);
+    Tcl_ExitThread(0);
+
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadFrozen --
+ *
+ *	This procedure is invoked to process "testthread frozen". It freezes
+ *	a value and starts count threads, each of which evaluates a script
+ *	with the variable "value" set to its own handle on the frozen value.
+ *
+ * Results:
+ *	A standard Tcl result, which is the list of the results of the
+ *	scripts.
+ *
+ * Side effects:
+ *	Creates and joins threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ThreadFrozen(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Obj *valuePtr,		/* Value to freeze. */
+    Tcl_Size count,		/* Number of threads to start. */
+    const char *script)		/* Script for the threads to evaluate. */
+{
+    FrozenWorker *workers;
+    Tcl_Obj *frozenPtr, *resultPtr;
+    Tcl_Size i, numStarted;
+    int status, code = TCL_OK;
+
+    if (count < 1) {
+	count = 1;
+    }
+    frozenPtr = Tcl_FreezeObj(valuePtr);
+    Tcl_IncrRefCount(frozenPtr);
+    workers = (FrozenWorker *)Tcl_Alloc(count * sizeof(FrozenWorker));
+    for (numStarted = 0; numStarted < count; numStarted++) {
+	FrozenWorker *workerPtr = &workers[numStarted];
+
+	workerPtr->valuePtr = Tcl_FreezeObj(frozenPtr);
+	Tcl_IncrRefCount(workerPtr->valuePtr);
+	workerPtr->script = script;
+	workerPtr->result = NULL;
+	if (Tcl_CreateThread(&workerPtr->id, FrozenThread, workerPtr,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+	    Tcl_DecrRefCount(workerPtr->valuePtr);
+	    Tcl_AppendResult(interp, "cannot create a new thread", (char *)NULL);
+	    code = TCL_ERROR;
+	    break;
+	}
+    }
+    Tcl_DecrRefCount(frozenPtr);
+
+    resultPtr = Tcl_NewListObj(0, NULL);
+    for (i = 0; i < numStarted; i++) {
+	Tcl_JoinThread(workers[i].id, &status);
+	Tcl_ListObjAppendElement(NULL, resultPtr,
+		Tcl_NewStringObj(workers[i].result, TCL_INDEX_NONE));
+	Tcl_Free(workers[i].result);
+    }
+    Tcl_Free(workers);
+
+    if (code == TCL_OK) {
+	Tcl_SetObjResult(interp, resultPtr);
+    } else {
+	Tcl_DecrRefCount(resultPtr);
+    }
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FrozenThread --
+ *
+ *	The "main()" of a thread started by "testthread frozen".
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Creates an interpreter, evaluates the script and stores a copy of its
+ *	result.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+FrozenThread(
+    void *clientData)
+{
+    FrozenWorker *workerPtr = (FrozenWorker *)clientData;
+    Tcl_Interp *interp = Tcl_CreateInterp();
+    const char *result;
+
+    Tcl_SetVar2Ex(interp, "value", NULL, workerPtr->valuePtr, 0);
+    Tcl_DecrRefCount(workerPtr->valuePtr);
+    Tcl_EvalEx(interp, workerPtr->script, TCL_INDEX_NONE, 0);
+    result = Tcl_GetStringResult(interp);
+    workerPtr->result = (char *)Tcl_Alloc(strlen(result) + 1);
+    strcpy(workerPtr->result, result);
+    Tcl_DeleteInterp(interp);
+    Tcl_ExitThread(0);
+
+    TCL_THREAD_CREATE_RETURN;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -30,7 +30,9 @@ static int		CompareVarKeys(void *keyPtr, Tcl_HashEntry *hPtr);
 
 static const Tcl_HashKeyType tclVarHashKeyType = {
     TCL_HASH_KEY_TYPE_VERSION,	/* version */
-    TCL_HASH_KEY_DIRECT_COMPARE,/* allows compare keys by pointers */
+    TCL_HASH_KEY_DIRECT_COMPARE|TCL_HASH_KEY_INCREMENTAL_REHASH,
+				/* allows compare keys by pointers, large
+				 * arrays grow without pauses */
     TclHashObjKey,		/* hashKeyProc */
     CompareVarKeys,		/* compareKeysProc */
     AllocVarEntry,		/* allocEntryProc */
@@ -257,7 +259,7 @@ static Tcl_DupInternalRepProc	DupParsedVarName;
  *			Tcl_Obj), or NULL if it is a scalar variable
  */
 
-static const Tcl_ObjType localVarNameType = {
+const Tcl_ObjType tclLocalVarNameType = {
     "localVarName",
     FreeLocalVarName, DupLocalVarName, NULL, NULL,
     TCL_OBJTYPE_V0
@@ -270,18 +272,18 @@ static const Tcl_ObjType localVarNameType = {
 	if (ptr) {Tcl_IncrRefCount(ptr);}				\
 	ir.twoPtrValue.ptr1 = ptr;					\
 	ir.twoPtrValue.ptr2 = INT2PTR(index);				\
-	Tcl_StoreInternalRep((objPtr), &localVarNameType, &ir);		\
+	Tcl_StoreInternalRep((objPtr), &tclLocalVarNameType, &ir);	\
     } while (0)
 
 #define LocalGetInternalRep(objPtr, index, name)			\
     do {								\
 	const Tcl_ObjInternalRep *irPtr;				\
-	irPtr = TclFetchInternalRep((objPtr), &localVarNameType);	\
+	irPtr = TclFetchInternalRep((objPtr), &tclLocalVarNameType);	\
 	(name) = irPtr ? (Tcl_Obj *)irPtr->twoPtrValue.ptr1 : NULL;	\
 	(index) = irPtr ? PTR2INT(irPtr->twoPtrValue.ptr2) : TCL_INDEX_NONE; \
     } while (0)
 
-static const Tcl_ObjType parsedVarNameType = {
+const Tcl_ObjType tclParsedVarNameType = {
     "parsedVarName",
     FreeParsedVarName, DupParsedVarName, NULL, NULL,
     TCL_OBJTYPE_V0
@@ -296,13 +298,13 @@ static const Tcl_ObjType parsedVarNameType = {
 	if (ptr2) {Tcl_IncrRefCount(ptr2);}				\
 	ir.twoPtrValue.ptr1 = ptr1;					\
 	ir.twoPtrValue.ptr2 = ptr2;					\
-	Tcl_StoreInternalRep((objPtr), &parsedVarNameType, &ir);	\
+	Tcl_StoreInternalRep((objPtr), &tclParsedVarNameType, &ir);	\
     } while (0)
 
 #define ParsedGetInternalRep(objPtr, parsed, array, elem)		\
     do {								\
 	const Tcl_ObjInternalRep *irPtr;				\
-	irPtr = TclFetchInternalRep((objPtr), &parsedVarNameType);	\
+	irPtr = TclFetchInternalRep((objPtr), &tclParsedVarNameType);	\
 	(parsed) = (irPtr != NULL);					\
 	(array) = irPtr ? (Tcl_Obj *)irPtr->twoPtrValue.ptr1 : NULL;	\
 	(elem) = irPtr ? (Tcl_Obj *)irPtr->twoPtrValue.ptr2 : NULL;	\
@@ -533,8 +535,8 @@ TclLookupVar(
  *
  * Side effects:
  *	New hashtable entries may be created if createPart1 or createPart2
- *	are 1. The object part1Ptr is converted to one of localVarNameType
- *	or parsedVarNameType and caches as much of the lookup as it can.
+ *	are 1. The object part1Ptr is converted to one of tclLocalVarNameType
+ *	or tclParsedVarNameType and caches as much of the lookup as it can.
  *	When createPart1 is 1, callers must IncrRefCount part1Ptr if they
  *	plan to DecrRefCount it.
  *
@@ -650,7 +652,7 @@ TclObjLookupVarEx(
     }
 
     /*
-     * If part1Ptr is a parsedVarNameType, retrieve the preparsed parts.
+     * If part1Ptr is a tclParsedVarNameType, retrieve the preparsed parts.
      */
 
     ParsedGetInternalRep(part1Ptr, parsed, arrayPtr, elem);
@@ -6815,6 +6817,11 @@ CompareVarKeys(
      * if (objPtr1 == objPtr2) return 1;
      */
 
+    if (TclHasInternalRep(objPtr1, &tclInternType)
+	    && TclHasInternalRep(objPtr2, &tclInternType)) {
+	return objPtr1 == objPtr2;
+    }
+
     /*
      * Don't use Tcl_GetStringFromObj as it would prevent l1 and l2 being in a
      * register.
@@ -244,6 +244,9 @@ enum ZipCompressionMethods {
 
 #define ZIP_MAX_FILE_SIZE		INT_MAX
 #define DEFAULT_WRITE_MAX_SIZE		ZIP_MAX_FILE_SIZE
+#define DEFAULT_CACHE_MAX_SIZE		(8 * 1024 * 1024)
+#define DEFAULT_MK_THREADS		TCL_PARALLEL_MAX_THREADS
+#define MK_BATCH_SIZE			(16 * 1024 * 1024)
 
 /*
  * Mutex to protect localtime(3) when no reentrant version available.
@@ -307,8 +310,14 @@ typedef struct ZipEntry {
     int isEncrypted;		/* True if data is encrypted */
     int flags;			/* See ZipEntryFlags for bit definitions. */
     unsigned char *data;	/* File data if written */
+    struct ZipCacheBuf *cached;	/* Inflated data in the cache, or NULL.
+				 * Protected by ZipCacheMutex. */
     struct ZipEntry *next;	/* Next file in the same archive */
     struct ZipEntry *tnext;	/* Next top-level dir in archive */
+    Tcl_HashEntry *parentPtr;	/* Entry of the parent directory in
+				 * ZipFS.dirHash, or NULL if not indexed. */
+    struct ZipEntry *nextChild;	/* Next entry in the same directory */
+    struct ZipEntry *prevChild;	/* Previous entry in the same directory */
 } ZipEntry;
 
 enum ZipEntryFlags {
@@ -325,6 +334,10 @@ enum ZipEntryFlags {
  * method), ubuf points directly to the mapped zip file data in memory. No
  * additional storage is allocated and so ubufToFree is NULL.
  *
+ * For READ-ONLY files that are compressed but not encrypted, ubuf points to
+ * the inflated data held by cacheBuf, which is shared with the inflate cache
+ * and with other channels on the same file, and released on close.
+ *
  * In all other combinations of compression and encryption or if channel is
  * writable, storage is allocated for the decrypted and/or uncompressed data
  * and a pointer to it is stored in ubufToFree and ubuf. When channel is
@@ -343,6 +356,9 @@ typedef struct ZipChannel {
 				 * need freeing. Else memory to free (ubuf
 				 * may point *inside* the block) */
     Tcl_Size ubufSize;		/* Size of allocated ubufToFree */
+    struct ZipCacheBuf *cacheBuf;
+				/* Inflated data shared with the cache, or
+				 * NULL. */
     int iscompr;		/* True if data is compressed */
     int isDirectory;		/* Set to 1 if directory, or -1 if root */
     int isEncrypted;		/* True if data is encrypted */
@@ -357,6 +373,42 @@ ZipChannelWritable(
     return (info->mode & (O_WRONLY | O_RDWR)) != 0;
 }
 
+/*
+ * Inflated data of a deflated, unencrypted file, kept so that opening the
+ * file again (from any interpreter or thread) does not inflate it again.
+ * The buffers in the cache form a list in least recently used order; the
+ * total size of the buffers in the cache is bounded by ZipCache.maxSize.
+ * A buffer is freed when it is neither in the cache nor used by a channel.
+ */
+
+typedef struct ZipCacheBuf {
+    size_t refCount;		/* Channels using the buffer, plus one while
+				 * it is in the cache. */
+    ZipEntry *entry;		/* File of the data, or NULL when evicted. */
+    struct ZipCacheBuf *prevPtr;/* More recently used buffer. */
+    struct ZipCacheBuf *nextPtr;/* Less recently used buffer. */
+    size_t size;		/* Size of the data. */
+    unsigned char data[TCLFLEXARRAY];
+				/* The inflated data. */
+} ZipCacheBuf;
+
+static struct {
+    int maxSize;		/* Maximum total size of the cache; only
+				 * written to from Tcl code in a trusted
+				 * interpreter, so NOT protected by mutex. */
+    size_t size;		/* Total size of the buffers in the cache. */
+    size_t numBufs;		/* Number of buffers in the cache. */
+    ZipCacheBuf *firstPtr;	/* Most recently used buffer. */
+    ZipCacheBuf *lastPtr;	/* Least recently used buffer. */
+    Tcl_WideInt hits;		/* Opens that found the data in the cache. */
+    Tcl_WideInt misses;		/* Opens that had to inflate the data. */
+    Tcl_WideInt evictions;	/* Buffers dropped to make room. */
+} ZipCache = {
+    DEFAULT_CACHE_MAX_SIZE, 0, 0, NULL, NULL, 0, 0, 0
+};
+
+TCL_DECLARE_MUTEX(ZipCacheMutex)
+
 /*
  * Global variables.
  *
@@ -368,15 +420,26 @@ ZipChannelWritable(
  *
  * The "zipHash" components is the process wide global table of all mounted
  * ZIP archive files.
+ *
+ * The "dirHash" component indexes the members of "fileHash" by the name of
+ * their parent directory, so that globbing a directory only visits the
+ * entries in that directory.
  */
 
 static struct {
     int initialized;		/* True when initialized */
     int lock;			/* RW lock, see below */
     int waiters;		/* RW lock, see below */
+    int readers;		/* RW lock, see below */
+    int writer;			/* RW lock, see below */
+    int wantWrite;		/* RW lock, see below */
     int wrmax;			/* Maximum write size of a file; only written
 				 * to from Tcl code in a trusted interpreter,
 				 * so NOT protected by mutex. */
+    int mkThreads;		/* Maximum number of threads compressing files
+				 * when building an archive; only written to
+				 * from Tcl code in a trusted interpreter, so
+				 * NOT protected by mutex. */
     char *fallbackEntryEncoding;/* The fallback encoding for ZIP entries when
 				 * they are believed to not be UTF-8; only
 				 * written to from Tcl code in a trusted
@@ -384,8 +447,11 @@ static struct {
     int idCount;		/* Counter for channel names */
     Tcl_HashTable fileHash;	/* File name to ZipEntry mapping */
     Tcl_HashTable zipHash;	/* Mount to ZipFile mapping */
+    Tcl_HashTable dirHash;	/* Directory name to first ZipEntry in the
+				 * directory */
 } ZipFS = {
-    0, 0, 0, DEFAULT_WRITE_MAX_SIZE, NULL, 0,
+    0, 0, 0, 0, 0, 0, DEFAULT_WRITE_MAX_SIZE, DEFAULT_MK_THREADS, NULL, 0,
+	    {0,{0,0,0,0},0,0,0,0,0,0,0,0,0},
 	    {0,{0,0,0,0},0,0,0,0,0,0,0,0,0},
 	    {0,{0,0,0,0},0,0,0,0,0,0,0,0,0}
 };
@@ -408,6 +474,10 @@ static int		DescribeMounted(Tcl_Interp *interp,
 			    const char *mountPoint);
 static int		InitReadableChannel(Tcl_Interp *interp,
 			    ZipChannel *info, ZipEntry *z);
+static ZipCacheBuf *	ZipCacheGet(ZipEntry *z);
+static void		ZipCachePut(ZipCacheBuf *cacheBuf, ZipEntry *z);
+static void		ZipCacheRelease(ZipCacheBuf *cacheBuf);
+static void		ZipCacheForget(ZipEntry *z);
 static int		InitWritableChannel(Tcl_Interp *interp,
 			    ZipChannel *info, ZipEntry *z, int trunc);
 static int		ListMountPoints(Tcl_Interp *interp);
@@ -653,6 +723,13 @@ ZipWriteShort(
  *	POSIX like rwlock functions to support multiple readers and single
  *	writer on internal structs.
  *
+ *	Readers only change atomic counters unless a writer holds the lock or
+ *	is checking for readers, so lookups in mounted archives do not take
+ *	ZipFSMutex. ZipFS.readers counts readers, ZipFS.writer is 1 while a
+ *	writer holds the lock and 2 while one checks for readers, and
+ *	ZipFS.wantWrite counts writers waiting for readers to leave. As with
+ *	the mutex-only version, waiting writers do not keep new readers out.
+ *
  *	Limitations:
  *	 - a read lock cannot be promoted to a write lock
  *	 - a write lock may not be nested
@@ -666,6 +743,89 @@ TCL_DECLARE_MUTEX(ZipFSMutex)
 
 static Tcl_Condition ZipFSCond;
 
+#ifdef TCL_ATOMIC_BUILTINS
+
+static inline void
+LeaveRead(void)
+{
+    TclAtomicAddInt(&ZipFS.readers, -1);
+    if (TclAtomicLoadInt(&ZipFS.wantWrite) > 0) {
+	Tcl_MutexLock(&ZipFSMutex);
+	Tcl_ConditionNotify(&ZipFSCond);
+	Tcl_MutexUnlock(&ZipFSMutex);
+    }
+}
+
+static inline void
+ReadLock(void)
+{
+    while (1) {
+	TclAtomicAddInt(&ZipFS.readers, 1);
+	if (TclAtomicLoadInt(&ZipFS.writer) == 0) {
+	    return;
+	}
+
+	/*
+	 * A writer is active. Step back and wait until it is done.
+	 */
+
+	LeaveRead();
+	Tcl_MutexLock(&ZipFSMutex);
+	while (TclAtomicLoadInt(&ZipFS.writer) != 0) {
+	    ZipFS.waiters++;
+	    Tcl_ConditionWait(&ZipFSCond, &ZipFSMutex, NULL);
+	    ZipFS.waiters--;
+	}
+	Tcl_MutexUnlock(&ZipFSMutex);
+    }
+}
+
+static inline void
+WriteLock(void)
+{
+    Tcl_MutexLock(&ZipFSMutex);
+    TclAtomicAddInt(&ZipFS.wantWrite, 1);
+    while (1) {
+	if (TclAtomicLoadInt(&ZipFS.writer) == 0) {
+	    TclAtomicStoreInt(&ZipFS.writer, 2);
+	    if (TclAtomicLoadInt(&ZipFS.readers) == 0) {
+		break;
+	    }
+	    TclAtomicStoreInt(&ZipFS.writer, 0);
+	    if (ZipFS.waiters > 0) {
+		Tcl_ConditionNotify(&ZipFSCond);
+	    }
+	}
+	ZipFS.waiters++;
+	Tcl_ConditionWait(&ZipFSCond, &ZipFSMutex, NULL);
+	ZipFS.waiters--;
+    }
+    TclAtomicStoreInt(&ZipFS.writer, 1);
+    TclAtomicAddInt(&ZipFS.wantWrite, -1);
+    Tcl_MutexUnlock(&ZipFSMutex);
+}
+
+static inline void
+Unlock(void)
+{
+    /*
+     * Readers never see ZipFS.writer at 1 while they hold the lock.
+     */
+
+    if (TclAtomicLoadInt(&ZipFS.writer) == 1) {
+	Tcl_MutexLock(&ZipFSMutex);
+	TclAtomicStoreInt(&ZipFS.writer, 0);
+	if (ZipFS.waiters > 0) {
+	    Tcl_ConditionNotify(&ZipFSCond);
+	}
+	Tcl_MutexUnlock(&ZipFSMutex);
+    } else {
+	LeaveRead();
+    }
+}
+
+#else /* !TCL_ATOMIC_BUILTINS */
+
 static inline void
 ReadLock(void)
 {
@@ -706,6 +866,7 @@ Unlock(void)
     }
     Tcl_MutexUnlock(&ZipFSMutex);
 }
+#endif /* TCL_ATOMIC_BUILTINS */
 
 #else /* !TCL_THREADS */
 #define ReadLock()	do {} while (0)
@@ -1269,6 +1430,114 @@ ZipFSLookupZip(
     return zf;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ZipFSParentLength --
+ *
+ *	Computes the length of the name of the directory holding a ZIP
+ *	archive member, which is the name up to its last slash, or the root
+ *	volume for a member at the top level.
+ *
+ * Results:
+ *	The length of the directory name within the given name.
+ *
+ * Side effects:
+ *	None.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static inline size_t
+ZipFSParentLength(
+    const char *name,
+    size_t nameLen)
+{
+    size_t len = nameLen;
+
+    while ((len > 0) && (name[len - 1] != '/')) {
+	len--;
+    }
+    if (len > 0) {
+	len--;
+    }
+    if (len < ZIPFS_VOLUME_LEN) {
+	len = ZIPFS_VOLUME_LEN;
+    }
+    return len;
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ZipFSIndexEntry, ZipFSUnindexEntry --
+ *
+ *	Add a member of the global file table to, or remove it from, the list
+ *	of entries in its directory kept in ZipFS.dirHash. Caller must hold
+ *	the write lock.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The directory index is updated.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static void
+ZipFSIndexEntry(
+    ZipEntry *z)
+{
+    size_t nameLen = strlen(z->name);
+    size_t parentLen = ZipFSParentLength(z->name, nameLen);
+    Tcl_DString ds;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (parentLen >= nameLen) {
+	/*
+	 * The root volume is not in any directory.
+	 */
+
+	return;
+    }
+    Tcl_DStringInit(&ds);
+    Tcl_DStringAppend(&ds, z->name, parentLen);
+    hPtr = Tcl_CreateHashEntry(&ZipFS.dirHash, Tcl_DStringValue(&ds),
+	    &isNew);
+    Tcl_DStringFree(&ds);
+
+    z->parentPtr = hPtr;
+    z->prevChild = NULL;
+    z->nextChild = isNew ? NULL : (ZipEntry *) Tcl_GetHashValue(hPtr);
+    if (z->nextChild) {
+	z->nextChild->prevChild = z;
+    }
+    Tcl_SetHashValue(hPtr, z);
+}
+
+static void
+ZipFSUnindexEntry(
+    ZipEntry *z)
+{
+    if (!z->parentPtr) {
+	return;
+    }
+    if (z->nextChild) {
+	z->nextChild->prevChild = z->prevChild;
+    }
+    if (z->prevChild) {
+	z->prevChild->nextChild = z->nextChild;
+    } else if (z->nextChild) {
+	Tcl_SetHashValue(z->parentPtr, z->nextChild);
+    } else {
+	Tcl_DeleteHashEntry(z->parentPtr);
+    }
+    z->parentPtr = NULL;
+    z->nextChild = z->prevChild = NULL;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -2025,6 +2294,7 @@ ZipFSCatalogFilesystem(
 	    if (!strcmp(z->name, ZIPFS_VOLUME)) {
 		z->flags |= ZE_F_VOLUME; /* Mark as root volume */
 	    }
+	    ZipFSIndexEntry(z);
 	    Tcl_Time t;
 	    Tcl_GetTime(&t);
 	    z->timestamp = t.sec;
@@ -2148,6 +2418,7 @@ ZipFSCatalogFilesystem(
 
 	Tcl_SetHashValue(hPtr, z);
 	z->name = (char *) Tcl_GetHashKey(&ZipFS.fileHash, hPtr);
+	ZipFSIndexEntry(z);
 	z->next = zf->entries;
 	zf->entries = z;
 	if (isdir && (mountPoint[0] == '\0') && (z->depth == ZIPFS_ROOTDIR_DEPTH)) {
@@ -2189,6 +2460,7 @@ ZipFSCatalogFilesystem(
 		zd->compressMethod = ZIP_COMPMETH_STORED;
 		Tcl_SetHashValue(hPtr, zd);
 		zd->name = (char *) Tcl_GetHashKey(&ZipFS.fileHash, hPtr);
+		ZipFSIndexEntry(zd);
 		zd->next = zf->entries;
 		zf->entries = zd;
 		if ((mountPoint[0] == '\0') && (zd->depth == ZIPFS_ROOTDIR_DEPTH)) {
@@ -2237,8 +2509,10 @@ ZipfsSetup(void)
     Tcl_FSRegister(NULL, &zipfsFilesystem);
     Tcl_InitHashTable(&ZipFS.fileHash, TCL_STRING_KEYS);
     Tcl_InitHashTable(&ZipFS.zipHash, TCL_STRING_KEYS);
+    Tcl_InitHashTable(&ZipFS.dirHash, TCL_STRING_KEYS);
     ZipFS.idCount = 1;
     ZipFS.wrmax = DEFAULT_WRITE_MAX_SIZE;
+    ZipFS.mkThreads = DEFAULT_MK_THREADS;
     ZipFS.fallbackEntryEncoding = (char *)
 	    Tcl_Alloc(strlen(ZIPFS_FALLBACK_ENCODING) + 1);
     strcpy(ZipFS.fallbackEntryEncoding, ZIPFS_FALLBACK_ENCODING);
@@ -2324,6 +2598,8 @@ CleanupMount(
 	if (hPtr) {
 	    Tcl_DeleteHashEntry(hPtr);
 	}
+	ZipFSUnindexEntry(z);
+	ZipCacheForget(z);
 	if (z->data) {
 	    Tcl_Free(z->data);
 	}
@@ -2907,6 +3183,55 @@ RandomChar(
     return TCL_ERROR;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * MakeCryptHeader --
+ *
+ *	Worker for ZipAddFile() and WriteCompressedFile(). Builds the
+ *	encryption header that precedes the data of a password-protected
+ *	file, and sets up the keys for encrypting the data that follows it.
+ *
+ * Returns:
+ *	Tcl result code. The first ZIP_CRYPT_HDR_LEN bytes of kvbuf hold the
+ *	header on success.
+ *
+ * Side effects:
+ *	Advances the PRNG state (see RandomChar()). Overwrites keys and all of
+ *	kvbuf.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+MakeCryptHeader(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    const char *passwd,		/* Password for encoding the file. */
+    int crc,			/* CRC-32 of the unencoded file data. */
+    unsigned long keys[3],	/* Where to put the keys for the data. */
+    unsigned char *kvbuf)	/* Working buffer of 2*ZIP_CRYPT_HDR_LEN
+				 * bytes. */
+{
+    int i, ch, tmp;
+
+    init_keys(passwd, keys, crc32tab);
+    for (i = 0; i < ZIP_CRYPT_HDR_LEN - 2; i++) {
+	if (RandomChar(interp, i, &ch) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	kvbuf[i + ZIP_CRYPT_HDR_LEN] = UCHAR(zencode(keys, crc32tab, ch, tmp));
+    }
+    Tcl_ResetResult(interp);
+    init_keys(passwd, keys, crc32tab);
+    for (i = 0; i < ZIP_CRYPT_HDR_LEN - 2; i++) {
+	kvbuf[i] = UCHAR(zencode(keys, crc32tab,
+		kvbuf[i + ZIP_CRYPT_HDR_LEN], tmp));
+    }
+    kvbuf[i++] = UCHAR(zencode(keys, crc32tab, crc >> 16, tmp));
+    kvbuf[i++] = UCHAR(zencode(keys, crc32tab, crc >> 24, tmp));
+    return TCL_OK;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -3098,25 +3423,12 @@ ZipAddFile(
      */
 
     if (passwd) {
-	int i, ch, tmp;
 	unsigned char kvbuf[2*ZIP_CRYPT_HDR_LEN];
 
-	init_keys(passwd, keys, crc32tab);
-	for (i = 0; i < ZIP_CRYPT_HDR_LEN - 2; i++) {
-	    if (RandomChar(interp, i, &ch) != TCL_OK) {
-		Tcl_Close(interp, in);
-		return TCL_ERROR;
-	    }
-	    kvbuf[i + ZIP_CRYPT_HDR_LEN] = UCHAR(zencode(keys, crc32tab, ch, tmp));
-	}
-	Tcl_ResetResult(interp);
-	init_keys(passwd, keys, crc32tab);
-	for (i = 0; i < ZIP_CRYPT_HDR_LEN - 2; i++) {
-	    kvbuf[i] = UCHAR(zencode(keys, crc32tab,
-		    kvbuf[i + ZIP_CRYPT_HDR_LEN], tmp));
+	if (MakeCryptHeader(interp, passwd, crc, keys, kvbuf) != TCL_OK) {
+	    Tcl_Close(interp, in);
+	    return TCL_ERROR;
 	}
-	kvbuf[i++] = UCHAR(zencode(keys, crc32tab, crc >> 16, tmp));
-	kvbuf[i++] = UCHAR(zencode(keys, crc32tab, crc >> 24, tmp));
 	len = Tcl_Write(out, (char *) kvbuf, ZIP_CRYPT_HDR_LEN);
 	memset(kvbuf, 0, sizeof(kvbuf));
 	if (len != ZIP_CRYPT_HDR_LEN) {
@@ -3307,6 +3619,293 @@ ZipAddFile(
     return TCL_OK;
 }
 
+/*
+ * A file that ZipFSMkZipOrImg() has read and compressed by a worker thread,
+ * leaving only the writing to the thread building the archive.
+ */
+
+typedef struct ZipMkFile {
+    Tcl_Obj *pathObj;		/* Actual name of the file to add. Only used
+				 * by the thread building the archive. */
+    char *path;			/* Copy of the name for the worker thread, or
+				 * NULL if ZipAddFile() is to add the file. */
+    const char *name;		/* Name to use in the ZIP archive. */
+    int mtime;			/* Modification time of the file. */
+    int crc;			/* CRC-32 of the file data. */
+    int done;			/* True once the fields below are set. */
+    size_t numBytes;		/* Size of the file. */
+    unsigned char *data;	/* Contents of the file. */
+    size_t numCompressedBytes;	/* Size of the deflated contents. */
+    unsigned char *compressed;	/* Deflated contents of the file. */
+} ZipMkFile;
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * CompressFileTask --
+ *
+ *	Task run by TclRunParallel() for ZipFSMkZipOrImg(). Reads one file
+ *	into memory, computes its CRC and deflates it exactly as ZipAddFile()
+ *	would, leaving only the writing to the thread building the archive.
+ *	Files that cannot be handled here are left for ZipAddFile(), which
+ *	also reports any errors.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in the file's data fields and sets its done flag on success.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static void
+CompressFileTask(
+    void *clientData,		/* The files of the batch. */
+    Tcl_Size taskIndex)		/* Which file to compress. */
+{
+    ZipMkFile *filePtr = (ZipMkFile *) clientData + taskIndex;
+    Tcl_Obj *pathObj;
+    Tcl_Channel in;
+    Tcl_Size len;
+    size_t nbyte = 0, bound;
+    unsigned char *data, *compressed;
+    z_stream stream;
+
+    if (!filePtr->path) {
+	return;
+    }
+
+    /*
+     * The path object of the caller cannot be shared with this thread.
+     */
+
+    pathObj = Tcl_NewStringObj(filePtr->path, TCL_INDEX_NONE);
+    Tcl_IncrRefCount(pathObj);
+    in = Tcl_FSOpenFileChannel(NULL, pathObj, "rb", 0);
+    Tcl_DecrRefCount(pathObj);
+    if (!in) {
+	return;
+    }
+
+    /*
+     * Read one byte more than expected to notice a file that has grown.
+     */
+
+    data = (unsigned char *) Tcl_AttemptAlloc(filePtr->numBytes + 1);
+    if (!data) {
+	Tcl_Close(NULL, in);
+	return;
+    }
+    while (nbyte <= filePtr->numBytes) {
+	len = Tcl_Read(in, (char *) data + nbyte,
+		filePtr->numBytes + 1 - nbyte);
+	if (len <= 0) {
+	    break;
+	}
+	nbyte += len;
+    }
+    Tcl_Close(NULL, in);
+    if ((len < 0) || (nbyte > filePtr->numBytes)) {
+	Tcl_Free(data);
+	return;
+    }
+
+    memset(&stream, 0, sizeof(z_stream));
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (deflateInit2(&stream, 9, Z_DEFLATED, -15, 8,
+	    Z_DEFAULT_STRATEGY) != Z_OK) {
+	Tcl_Free(data);
+	return;
+    }
+    bound = deflateBound(&stream, nbyte);
+    compressed = (unsigned char *) Tcl_AttemptAlloc(bound);
+    if (!compressed) {
+	deflateEnd(&stream);
+	Tcl_Free(data);
+	return;
+    }
+    stream.avail_in = nbyte;
+    stream.next_in = data;
+    stream.avail_out = bound;
+    stream.next_out = compressed;
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+	deflateEnd(&stream);
+	Tcl_Free(compressed);
+	Tcl_Free(data);
+	return;
+    }
+    deflateEnd(&stream);
+
+    filePtr->numBytes = nbyte;
+    filePtr->crc = crc32(0, data, nbyte);
+    filePtr->data = data;
+    filePtr->numCompressedBytes = bound - stream.avail_out;
+    filePtr->compressed = compressed;
+    filePtr->done = 1;
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * WriteCompressedFile --
+ *
+ *	This procedure is used by ZipFSMkZipOrImg() to add a file compressed
+ *	by CompressFileTask() to the output ZIP archive file being written.
+ *	It writes the same bytes as ZipAddFile() would, but in one pass and
+ *	without seeking, and records a ZipEntry in the same way.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	The file is written to the output ZIP archive file.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+WriteCompressedFile(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    ZipMkFile *filePtr,		/* The compressed file. */
+    Tcl_Channel out,		/* The open ZIP archive being built. */
+    const char *passwd,		/* Password for encoding the file, or NULL if
+				 * the file is to be unprotected. */
+    char *buf,			/* Working buffer. */
+    int bufsize,		/* Size of buf */
+    Tcl_HashTable *fileHash)	/* Where to record ZIP entry metdata so we can
+				 * built the central directory. */
+{
+    const unsigned char *start = (unsigned char *) buf;
+    const unsigned char *end = (unsigned char *) buf + bufsize;
+    Tcl_HashEntry *hPtr;
+    ZipEntry *z;
+    Tcl_DString zpathDs;
+    const char *zpathTcl = filePtr->name;
+    const unsigned char *data;
+    int zpathlen, isNew, compMeth = ZIP_COMPMETH_DEFLATED;
+    size_t nbyte = filePtr->numBytes, nbytecompr, ndata;
+    Tcl_Size len, align = 0;
+    long long headerStartOffset;
+    unsigned long keys[3];
+
+    if (Tcl_UtfToExternalDStringEx(interp, tclUtf8Encoding, zpathTcl,
+	    TCL_INDEX_NONE, 0, &zpathDs, NULL) != TCL_OK) {
+	Tcl_DStringFree(&zpathDs);
+	return TCL_ERROR;
+    }
+    zpathlen = Tcl_DStringLength(&zpathDs);
+    if (zpathlen + ZIP_CENTRAL_HEADER_LEN > bufsize) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"path too long for \"%s\"", TclGetString(filePtr->pathObj)));
+	ZIPFS_ERROR_CODE(interp, "PATH_LEN");
+	Tcl_DStringFree(&zpathDs);
+	return TCL_ERROR;
+    }
+    if (Tcl_FindHashEntry(fileHash, zpathTcl)) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"non-unique path name \"%s\"", TclGetString(filePtr->pathObj)));
+	ZIPFS_ERROR_CODE(interp, "DUPLICATE_PATH");
+	Tcl_DStringFree(&zpathDs);
+	return TCL_ERROR;
+    }
+
+    /*
+     * Same choice between deflated and stored data as ZipAddFile().
+     */
+
+    data = filePtr->compressed;
+    ndata = filePtr->numCompressedBytes;
+    nbytecompr = ndata + (passwd ? ZIP_CRYPT_HDR_LEN : 0);
+    if (nbyte - nbytecompr <= 0) {
+	data = filePtr->data;
+	ndata = nbyte;
+	nbytecompr = ndata + (passwd ? ZIP_CRYPT_HDR_LEN : 0);
+	compMeth = ZIP_COMPMETH_STORED;
+    }
+
+    /*
+     * Write the local header, the name and the alignment padding.
+     */
+
+    headerStartOffset = Tcl_Tell(out);
+    len = zpathlen + ZIP_LOCAL_HEADER_LEN;
+    if ((len + headerStartOffset) & 3) {
+	align = 4 + ((len + headerStartOffset) & 3);
+    }
+    z = AllocateZipEntry();
+    z->isEncrypted = (passwd ? 1 : 0);
+    z->offset = headerStartOffset;
+    z->crc32 = filePtr->crc;
+    z->timestamp = filePtr->mtime;
+    z->numBytes = nbyte;
+    z->numCompressedBytes = nbytecompr;
+    z->compressMethod = compMeth;
+    SerializeLocalEntryHeader(start, end, (unsigned char *) buf, z,
+	    zpathlen, align);
+    memcpy(buf + ZIP_LOCAL_HEADER_LEN, Tcl_DStringValue(&zpathDs), zpathlen);
+    Tcl_DStringFree(&zpathDs);
+    if (align) {
+	ZipWriteShort(start, end, (unsigned char *) buf + len, 0xffff);
+	ZipWriteShort(start, end, (unsigned char *) buf + len + 2, align - 4);
+	ZipWriteInt(start, end, (unsigned char *) buf + len + 4, 0x03020100);
+	len += align;
+    }
+    if (Tcl_Write(out, buf, len) != len) {
+	goto writeError;
+    }
+
+    /*
+     * Write the data, encoding it if we were asked to.
+     */
+
+    if (passwd) {
+	unsigned char kvbuf[2*ZIP_CRYPT_HDR_LEN];
+	size_t done;
+
+	if (MakeCryptHeader(interp, passwd, filePtr->crc, keys,
+		kvbuf) != TCL_OK) {
+	    Tcl_Free(z);
+	    return TCL_ERROR;
+	}
+	len = Tcl_Write(out, (char *) kvbuf, ZIP_CRYPT_HDR_LEN);
+	memset(kvbuf, 0, sizeof(kvbuf));
+	if (len != ZIP_CRYPT_HDR_LEN) {
+	    goto writeError;
+	}
+	for (done = 0; done < ndata; done += len) {
+	    Tcl_Size i;
+	    int tmp;
+
+	    len = (ndata - done > (size_t) bufsize) ? bufsize
+		    : (Tcl_Size) (ndata - done);
+	    for (i = 0; i < len; i++) {
+		buf[i] = (char) zencode(keys, crc32tab, data[done + i], tmp);
+	    }
+	    if (Tcl_Write(out, buf, len) != len) {
+		goto writeError;
+	    }
+	}
+    } else if (ndata && (Tcl_Write(out, (const char *) data, ndata)
+	    != (Tcl_Size) ndata)) {
+	goto writeError;
+    }
+
+    hPtr = Tcl_CreateHashEntry(fileHash, zpathTcl, &isNew);
+    Tcl_SetHashValue(hPtr, z);
+    z->name = (char *) Tcl_GetHashKey(fileHash, hPtr);
+    return TCL_OK;
+
+  writeError:
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+	    "write error on \"%s\": %s",
+	    TclGetString(filePtr->pathObj), Tcl_PosixError(interp)));
+    Tcl_Free(z);
+    return TCL_ERROR;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -3392,6 +3991,139 @@ ComputeNameInArchive(
     return name;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ZipAddFilesParallel --
+ *
+ *	This procedure is used by ZipFSMkZipOrImg() to add the files to the
+ *	output ZIP archive file when worker threads may compress them. Files
+ *	are taken in batches of at most MK_BATCH_SIZE bytes, so that memory
+ *	use stays bounded. The files of a batch are compressed in parallel,
+ *	then written in order. Files too large for a batch, files outside the
+ *	native filesystem, and files that a worker could not read, are added
+ *	by ZipAddFile() in their turn. The archive is identical to the one
+ *	written by ZipAddFile() alone.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Input files are read and (compressed and) written to the output ZIP
+ *	archive file.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+ZipAddFilesParallel(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Size lobjc,		/* Number of words in lobjv. */
+    Tcl_Obj *const lobjv[],	/* The files to add, or the pairs of file and
+				 * name in the archive. */
+    int isMapping,		/* Whether lobjv holds pairs. */
+    const char *strip,		/* A prefix to strip from the file names; may
+				 * be NULL if no stripping need be done. */
+    Tcl_Size slen,		/* The length of the prefix. */
+    Tcl_Channel out,		/* The open ZIP archive being built. */
+    const char *passwd,		/* Password for encoding the files, or NULL
+				 * if the files are to be unprotected. */
+    char *buf,			/* Working buffer. */
+    int bufsize,		/* Size of buf */
+    Tcl_HashTable *fileHash)	/* Where to record ZIP entry metdata so we can
+				 * built the central directory. */
+{
+    ZipMkFile *files;
+    Tcl_Size i, first, last, numFiles = 0;
+    int ret = TCL_OK;
+
+    files = (ZipMkFile *) Tcl_Alloc(sizeof(ZipMkFile) * lobjc);
+    memset(files, 0, sizeof(ZipMkFile) * lobjc);
+    for (i = 0; i < lobjc; i += (isMapping ? 2 : 1)) {
+	ZipMkFile *filePtr = &files[numFiles];
+	Tcl_StatBuf statBuf;
+	const char *path;
+	Tcl_Size len;
+
+	filePtr->pathObj = lobjv[i];
+	filePtr->name = ComputeNameInArchive(lobjv[i],
+		(isMapping ? lobjv[i + 1] : NULL), strip, slen);
+	if (filePtr->name[0] == '\0') {
+	    continue;
+	}
+	numFiles++;
+
+	/*
+	 * Only regular files of the native filesystem small enough for a
+	 * batch go to the workers. Other filesystems, zipfs itself among
+	 * them, may keep per-thread state or call back into the interpreter.
+	 */
+
+	if ((Tcl_FSGetFileSystemForPath(lobjv[i]) != &tclNativeFilesystem)
+		|| (Tcl_FSStat(lobjv[i], &statBuf) != 0)
+		|| !S_ISREG(statBuf.st_mode)
+		|| (statBuf.st_size >= MK_BATCH_SIZE)) {
+	    continue;
+	}
+	path = TclGetStringFromObj(lobjv[i], &len);
+	filePtr->path = (char *) Tcl_Alloc(len + 1);
+	memcpy(filePtr->path, path, len + 1);
+	filePtr->mtime = statBuf.st_mtime;
+	filePtr->numBytes = statBuf.st_size;
+    }
+
+    for (first = 0; first < numFiles; first = last) {
+	size_t batchSize = 0;
+	int numWork = 0;
+
+	for (last = first; last < numFiles; last++) {
+	    if (files[last].path) {
+		if (numWork
+			&& (batchSize + files[last].numBytes > MK_BATCH_SIZE)) {
+		    break;
+		}
+		batchSize += files[last].numBytes;
+		numWork++;
+	    }
+	}
+	if (numWork) {
+	    TclRunParallel(last - first, ZipFS.mkThreads, CompressFileTask,
+		    files + first);
+	}
+
+	for (i = first; i < last; i++) {
+	    ZipMkFile *filePtr = &files[i];
+
+	    if (ret == TCL_OK) {
+		if (filePtr->done) {
+		    ret = WriteCompressedFile(interp, filePtr, out, passwd,
+			    buf, bufsize, fileHash);
+		} else {
+		    ret = ZipAddFile(interp, filePtr->pathObj, filePtr->name,
+			    out, passwd, buf, bufsize, fileHash);
+		}
+	    }
+	    if (filePtr->path) {
+		Tcl_Free(filePtr->path);
+	    }
+	    if (filePtr->done) {
+		Tcl_Free(filePtr->data);
+		Tcl_Free(filePtr->compressed);
+	    }
+	}
+	if (ret != TCL_OK) {
+	    for (i = last; i < numFiles; i++) {
+		if (files[i].path) {
+		    Tcl_Free(files[i].path);
+		}
+	    }
+	    break;
+	}
+    }
+    Tcl_Free(files);
+    return ret;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -3629,18 +4361,25 @@ ZipFSMkZipOrImg(
 	    strip = NULL;
 	}
     }
-    for (i = 0; i < lobjc; i += (mappingList ? 2 : 1)) {
-	Tcl_Obj *pathObj = lobjv[i];
-	const char *name = ComputeNameInArchive(pathObj,
-		(mappingList ? lobjv[i + 1] : NULL), strip, slen);
-
-	if (name[0] == '\0') {
-	    continue;
-	}
-	if (ZipAddFile(interp, pathObj, name, out, pw, buf, sizeof(buf),
-		&fileHash) != TCL_OK) {
+    if (ZipFS.mkThreads > 1) {
+	if (ZipAddFilesParallel(interp, lobjc, lobjv, mappingList != NULL,
+		strip, slen, out, pw, buf, sizeof(buf), &fileHash) != TCL_OK) {
 	    goto done;
 	}
+    } else {
+	for (i = 0; i < lobjc; i += (mappingList ? 2 : 1)) {
+	    Tcl_Obj *pathObj = lobjv[i];
+	    const char *name = ComputeNameInArchive(pathObj,
+		    (mappingList ? lobjv[i + 1] : NULL), strip, slen);
+
+	    if (name[0] == '\0') {
+		continue;
+	    }
+	    if (ZipAddFile(interp, pathObj, name, out, pw, buf, sizeof(buf),
+		    &fileHash) != TCL_OK) {
+		goto done;
+	    }
+	}
     }
 
     /*
@@ -4145,7 +4884,8 @@ ZipFSExistsObjCmd(
  *	This procedure is invoked to process the [zipfs info] command.  On
  *	success, it returns a Tcl list made up of name of ZIP archive file,
  *	size uncompressed, size compressed, and archive offset of a file in
- *	the ZIP filesystem.
+ *	the ZIP filesystem. Without a file, it returns a dictionary of the
+ *	statistics of the inflate cache.
  *
  * Results:
  *	A standard Tcl result.
@@ -4167,8 +4907,28 @@ ZipFSInfoObjCmd(
     ZipEntry *z;
     int ret;
 
+    if (objc == 1) {
+	Tcl_Obj *result;
+
+	TclNewObj(result);
+	Tcl_MutexLock(&ZipCacheMutex);
+	TclDictPut(NULL, result, "hits", Tcl_NewWideIntObj(ZipCache.hits));
+	TclDictPut(NULL, result, "misses",
+		Tcl_NewWideIntObj(ZipCache.misses));
+	TclDictPut(NULL, result, "evictions",
+		Tcl_NewWideIntObj(ZipCache.evictions));
+	TclDictPut(NULL, result, "entries",
+		Tcl_NewWideIntObj((Tcl_WideInt) ZipCache.numBufs));
+	TclDictPut(NULL, result, "size",
+		Tcl_NewWideIntObj((Tcl_WideInt) ZipCache.size));
+	Tcl_MutexUnlock(&ZipCacheMutex);
+	TclDictPut(NULL, result, "maxsize",
+		Tcl_NewWideIntObj(ZipCache.maxSize));
+	Tcl_SetObjResult(interp, result);
+	return TCL_OK;
+    }
     if (objc != 2) {
-	Tcl_WrongNumArgs(interp, 1, objv, "filename");
+	Tcl_WrongNumArgs(interp, 1, objv, "?filename?");
 	return TCL_ERROR;
     }
     filename = TclGetString(objv[1]);
@@ -4509,6 +5269,7 @@ ZipChannelClose(
 	info->ubufSize = 0;
 
 	/* Replace old content */
+	ZipCacheForget(z);
 	if (z->data) {
 	    Tcl_Free(z->data);
 	}
@@ -4531,6 +5292,11 @@ ZipChannelClose(
 	info->ubufToFree = NULL;
 	info->ubufSize = 0;
     }
+    if (info->cacheBuf) {
+	ZipCacheRelease(info->cacheBuf);
+	info->cacheBuf = NULL;
+	info->ubuf = NULL;
+    }
     Tcl_Free(info);
     return TCL_OK;
 }
@@ -4987,6 +5753,9 @@ ZipChannelOpen(
 		Tcl_Free(info->ubufToFree);
 		info->ubufSize = 0;
 	    }
+	    if (info->cacheBuf) {
+		ZipCacheRelease(info->cacheBuf);
+	    }
 	    Tcl_Free(info);
 	    goto error;
 	}
@@ -5184,6 +5953,159 @@ InitWritableChannel(
     return TCL_ERROR;
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ZipCacheGet, ZipCachePut, ZipCacheRelease, ZipCacheForget --
+ *
+ *	The inflate cache. ZipCacheGet looks up the inflated data of a file
+ *	and counts a hit or a miss. ZipCachePut offers freshly inflated data
+ *	to the cache, evicting the least recently used buffers to keep within
+ *	the size limit. ZipCacheRelease drops a channel's use of a buffer.
+ *	ZipCacheForget removes the data of a file that is being changed or
+ *	freed.
+ *
+ * Returns:
+ *	ZipCacheGet returns the buffer, with its use counted, or NULL.
+ *
+ * Side effects:
+ *	Buffers are freed when no longer in use.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static inline void
+ZipCacheUnlink(
+    ZipCacheBuf *cacheBuf)
+{
+    if (cacheBuf->prevPtr) {
+	cacheBuf->prevPtr->nextPtr = cacheBuf->nextPtr;
+    } else {
+	ZipCache.firstPtr = cacheBuf->nextPtr;
+    }
+    if (cacheBuf->nextPtr) {
+	cacheBuf->nextPtr->prevPtr = cacheBuf->prevPtr;
+    } else {
+	ZipCache.lastPtr = cacheBuf->prevPtr;
+    }
+    ZipCache.size -= cacheBuf->size;
+    ZipCache.numBufs--;
+}
+
+static inline void
+ZipCacheLinkFirst(
+    ZipCacheBuf *cacheBuf)
+{
+    cacheBuf->prevPtr = NULL;
+    cacheBuf->nextPtr = ZipCache.firstPtr;
+    if (ZipCache.firstPtr) {
+	ZipCache.firstPtr->prevPtr = cacheBuf;
+    } else {
+	ZipCache.lastPtr = cacheBuf;
+    }
+    ZipCache.firstPtr = cacheBuf;
+    ZipCache.size += cacheBuf->size;
+    ZipCache.numBufs++;
+}
+
+static ZipCacheBuf *
+ZipCacheGet(
+    ZipEntry *z)		/* File to look up. */
+{
+    ZipCacheBuf *cacheBuf;
+
+    Tcl_MutexLock(&ZipCacheMutex);
+    cacheBuf = z->cached;
+    if (cacheBuf) {
+	cacheBuf->refCount++;
+	if (cacheBuf != ZipCache.firstPtr) {
+	    ZipCacheUnlink(cacheBuf);
+	    ZipCacheLinkFirst(cacheBuf);
+	}
+	ZipCache.hits++;
+    } else {
+	ZipCache.misses++;
+    }
+    Tcl_MutexUnlock(&ZipCacheMutex);
+    return cacheBuf;
+}
+
+static void
+ZipCachePut(
+    ZipCacheBuf *cacheBuf,	/* Inflated data, used by one channel. */
+    ZipEntry *z)		/* File of the data. */
+{
+    ZipCacheBuf *freePtr = NULL;
+
+    Tcl_MutexLock(&ZipCacheMutex);
+    if (z->cached || ZipCache.maxSize <= 0
+	    || cacheBuf->size > (size_t) ZipCache.maxSize) {
+	/* Inflated meanwhile by another thread, or not worth keeping. */
+	Tcl_MutexUnlock(&ZipCacheMutex);
+	return;
+    }
+    cacheBuf->entry = z;
+    cacheBuf->refCount++;
+    z->cached = cacheBuf;
+    ZipCacheLinkFirst(cacheBuf);
+
+    while (ZipCache.size > (size_t) ZipCache.maxSize) {
+	ZipCacheBuf *lastPtr = ZipCache.lastPtr;
+
+	ZipCacheUnlink(lastPtr);
+	lastPtr->entry->cached = NULL;
+	lastPtr->entry = NULL;
+	ZipCache.evictions++;
+	if (--lastPtr->refCount == 0) {
+	    lastPtr->nextPtr = freePtr;
+	    freePtr = lastPtr;
+	}
+    }
+    Tcl_MutexUnlock(&ZipCacheMutex);
+
+    while (freePtr) {
+	cacheBuf = freePtr;
+	freePtr = freePtr->nextPtr;
+	Tcl_Free(cacheBuf);
+    }
+}
+
+static void
+ZipCacheRelease(
+    ZipCacheBuf *cacheBuf)	/* Buffer no longer used by a channel. */
+{
+    size_t refCount;
+
+    Tcl_MutexLock(&ZipCacheMutex);
+    refCount = --cacheBuf->refCount;
+    Tcl_MutexUnlock(&ZipCacheMutex);
+    if (refCount == 0) {
+	Tcl_Free(cacheBuf);
+    }
+}
+
+static void
+ZipCacheForget(
+    ZipEntry *z)		/* File being changed or freed. */
+{
+    ZipCacheBuf *cacheBuf;
+
+    Tcl_MutexLock(&ZipCacheMutex);
+    cacheBuf = z->cached;
+    if (cacheBuf) {
+	ZipCacheUnlink(cacheBuf);
+	z->cached = NULL;
+	cacheBuf->entry = NULL;
+	if (--cacheBuf->refCount) {
+	    cacheBuf = NULL;
+	}
+    }
+    Tcl_MutexUnlock(&ZipCacheMutex);
+    if (cacheBuf) {
+	Tcl_Free(cacheBuf);
+    }
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -5226,6 +6148,18 @@ InitReadableChannel(
     assert(z->numBytes >= 0 && z->numCompressedBytes >= 0);
     info->numBytes = z->numBytes;
 
+    if (info->iscompr && !info->isEncrypted) {
+	/*
+	 * Inflated before? Then share the data.
+	 */
+
+	info->cacheBuf = ZipCacheGet(z);
+	if (info->cacheBuf) {
+	    info->ubuf = info->cacheBuf->data;
+	    return TCL_OK;
+	}
+    }
+
     if (info->isEncrypted) {
 	assert(z->numCompressedBytes >= ZIP_CRYPT_HDR_LEN); /* caller should have checked*/
 	if (DecodeCryptHeader(interp, z, info->keys, info->ubuf) != TCL_OK) {
@@ -5267,13 +6201,29 @@ InitReadableChannel(
 	    stream.next_in = info->ubuf;
 	}
 
-	info->ubufSize = info->numBytes ? info->numBytes : 1;
-	info->ubufToFree = (unsigned char *)Tcl_AttemptAlloc(info->ubufSize);
-	info->ubuf = info->ubufToFree;
-	stream.next_out = info->ubuf;
-	if (!info->ubuf) {
-	    goto memoryError;
+	if (!info->isEncrypted) {
+	    /*
+	     * Inflate into a buffer that can go into the cache.
+	     */
+
+	    info->cacheBuf = (ZipCacheBuf *) Tcl_AttemptAlloc(
+		    offsetof(ZipCacheBuf, data) + info->numBytes + 1);
+	    if (!info->cacheBuf) {
+		goto memoryError;
+	    }
+	    info->cacheBuf->refCount = 1;
+	    info->cacheBuf->entry = NULL;
+	    info->cacheBuf->size = info->numBytes;
+	    info->ubuf = info->cacheBuf->data;
+	} else {
+	    info->ubufSize = info->numBytes ? info->numBytes : 1;
+	    info->ubufToFree = (unsigned char *)Tcl_AttemptAlloc(info->ubufSize);
+	    info->ubuf = info->ubufToFree;
+	    if (!info->ubuf) {
+		goto memoryError;
+	    }
 	}
+	stream.next_out = info->ubuf;
 	stream.avail_out = info->numBytes;
 	if (inflateInit2(&stream, -15) != Z_OK) {
 	    goto corruptionError;
@@ -5300,6 +6250,9 @@ InitReadableChannel(
 	    memset(info->keys, 0, sizeof(info->keys));
 	    Tcl_Free(ubuf);
 	}
+	if (info->cacheBuf) {
+	    ZipCachePut(info->cacheBuf, z);
+	}
     } else if (info->isEncrypted) {
 	unsigned int j, len;
 
@@ -5347,6 +6300,11 @@ InitReadableChannel(
 	info->ubuf = NULL;
 	info->ubufSize = 0;
     }
+    if (info->cacheBuf) {
+	ZipCacheRelease(info->cacheBuf);
+	info->cacheBuf = NULL;
+	info->ubuf = NULL;
+    }
 
     return TCL_ERROR;
 }
@@ -5734,9 +6692,9 @@ ZipFSMatchInDirectoryProc(
     foundInHash = (z != NULL);
 
     /*
-     * We've got to work for our supper and do the actual globbing. And all
-     * we've got really is an undifferentiated pile of all the filenames we've
-     * got from all our ZIP mounts.
+     * We've got to work for our supper and do the actual globbing. The
+     * directory index gives us the filenames in the directory from all our
+     * ZIP mounts; mount points below it are handled separately.
      */
 
     l = strlen(pattern);
@@ -5759,10 +6717,18 @@ ZipFSMatchInDirectoryProc(
     Tcl_HashEntry *hPtr;
     Tcl_HashSearch search;
     if (foundInHash) {
-	for (hPtr = Tcl_FirstHashEntry(&ZipFS.fileHash, &search); hPtr;
-		hPtr = Tcl_NextHashEntry(&search)) {
-	    z = (ZipEntry *)Tcl_GetHashValue(hPtr);
+	/*
+	 * Only the entries in the directory can match.
+	 */
+
+	size_t dirLen = ZipFSParentLength(pat, len);
+	char save = pat[dirLen];
 
+	pat[dirLen] = '\0';
+	hPtr = Tcl_FindHashEntry(&ZipFS.dirHash, pat);
+	pat[dirLen] = save;
+	for (z = hPtr ? (ZipEntry *) Tcl_GetHashValue(hPtr) : NULL; z;
+		z = z->nextChild) {
 	    if ((wanted == (TCL_GLOB_TYPE_DIR | TCL_GLOB_TYPE_FILE)) ||
 		    (wanted == TCL_GLOB_TYPE_DIR && z->isDirectory) ||
 		    (wanted == TCL_GLOB_TYPE_FILE && !z->isDirectory)) {
@@ -6376,6 +7342,10 @@ TclZipfs_Init(
 	if (!Tcl_IsSafe(interp)) {
 	    Tcl_LinkVar(interp, "::tcl::zipfs::wrmax", (char *) &ZipFS.wrmax,
 		    TCL_LINK_INT);
+	    Tcl_LinkVar(interp, "::tcl::zipfs::cachemax",
+		    (char *) &ZipCache.maxSize, TCL_LINK_INT);
+	    Tcl_LinkVar(interp, "::tcl::zipfs::mkthreads",
+		    (char *) &ZipFS.mkThreads, TCL_LINK_INT);
 	    Tcl_LinkVar(interp, "::tcl::zipfs::fallbackEntryEncoding",
 		    (char *) &ZipFS.fallbackEntryEncoding, TCL_LINK_STRING);
 	}
@@ -6473,6 +7443,7 @@ TclZipfsFinalize(void)
     Tcl_FSUnregister(&zipfsFilesystem);
     Tcl_DeleteHashTable(&ZipFS.fileHash);
     Tcl_DeleteHashTable(&ZipFS.zipHash);
+    Tcl_DeleteHashTable(&ZipFS.dirHash);
     if (ZipFS.fallbackEntryEncoding) {
 	Tcl_Free(ZipFS.fallbackEntryEncoding);
 	ZipFS.fallbackEntryEncoding = NULL;
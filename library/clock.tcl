@@ -247,6 +247,7 @@ proc ::tcl::clock::Initialize {} {
     # Define the directories for time zone data and message catalogs.
 
     variable DataDir [file join $LibDir tzdata]
+    variable TZDatabase [file join $LibDir tzdata.db]
 
     # Number of days in the months, in common years and leap years.
 
@@ -1227,6 +1228,7 @@ proc ::tcl::clock::GuessWindowsTimeZone {} {
 
 proc ::tcl::clock::LoadTimeZoneFile { fileName } {
     variable DataDir
+    variable TZDatabase
     variable TZData
 
     if { [info exists TZData($fileName)] } {
@@ -1242,6 +1244,14 @@ proc ::tcl::clock::LoadTimeZoneFile { fileName } {
 	    -errorcode [list CLOCK badTimeZone :$fileName] \
 	    "time zone \":$fileName\" not valid"
     }
+
+    # Prefer the packed database made by tools/tclZIC.tcl, if installed.
+
+    if { [file isfile $TZDatabase]
+	    && ![catch {ReadTZDatabase $TZDatabase $fileName} data] } {
+	set TZData(:$fileName) $data
+	return
+    }
     try {
 	source [file join $DataDir $fileName]
     } on error {} {
@@ -41,7 +41,7 @@ namespace eval ::tcl::unsupported::icu {
 	# Ignore all errors. Do not want to hold up Tcl
 	# if ICU not available
 	if {[catch {
-	    foreach tclName [encoding names] {
+	    foreach tclName [lsort [encoding names]] {
 		if {[catch {
 		    set icuNames [aliases $tclName]
 		} erMsg]} {
@@ -66,8 +66,15 @@ namespace eval ::tcl::unsupported::icu {
 		} else {
 		    set tclToIcu($tclName) $icuNames
 		}
+		# Prefer a Tcl name identical to the ICU one so the mapping
+		# does not depend on the order of [encoding names]
 		foreach icuName $icuNames {
-		    lappend icuToTcl($icuName) $tclName
+		    if {[string equal -nocase $icuName $tclName]} {
+			set icuToTcl($icuName) [linsert \
+				[lindex [array get icuToTcl $icuName] 1] 0 $tclName]
+		    } else {
+			lappend icuToTcl($icuName) $tclName
+		    }
 		}
 	    }
 	} errMsg]} {
@@ -0,0 +1,109 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# hash.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of string hashing (arrays, dicts, literal and command tables).
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Hash {
+
+namespace path {::tclTestPerf}
+
+# Key sets of realistic shape, 10000 keys each:
+proc _keys {kind {n 10000}} {
+  set keys {}
+  switch -- $kind {
+    ident {
+      for {set i 0} {$i < $n} {incr i} {
+        lappend keys [format "var_%s_%d" [lindex {count name idx tmp value} [expr {$i % 5}]] $i]
+      }
+    }
+    num {
+      for {set i 0} {$i < $n} {incr i} {
+        lappend keys [expr {$i * 7}]
+      }
+    }
+    path {
+      for {set i 0} {$i < $n} {incr i} {
+        lappend keys /usr/lib/tcl9.1/pkg[expr {$i % 37}]/src/file$i.tcl
+      }
+    }
+    long {
+      set pfx [string repeat "abcdefghij" 20]
+      for {set i 0} {$i < $n} {incr i} {
+        lappend keys $pfx$i
+      }
+    }
+  }
+  return $keys
+}
+
+# Longest chain of the bucket distribution reported by "array statistics":
+proc _maxchain {arrName} {
+  upvar 1 $arrName a
+  set max 0
+  foreach line [split [array statistics a] \n] {
+    if {[regexp {with (\d+)(?: or more)? entries: (\d+)} $line -> n count] && $count} {
+      set max $n
+    }
+  }
+  return $max
+}
+
+proc test-hash-array {{reptime 1000}} {
+  foreach kind {ident num path long} {
+    _test_run -no-result $reptime [string map [list @kind@ $kind] {
+      # array set/get, 10000 @kind@ keys:
+      setup { set keys [::tclTestPerf-Hash::_keys @kind@]; unset -nocomplain a; llength $keys }
+      { unset -nocomplain a; foreach k $keys { set a($k) 1 } }
+      { foreach k $keys { set a($k) } }
+      { foreach k $keys { info exists a(x$k) } }
+      cleanup { puts "# max chain: [::tclTestPerf-Hash::_maxchain a]"; unset -nocomplain a }
+    }]
+  }
+}
+
+proc test-hash-dict {{reptime 1000}} {
+  foreach kind {ident num path long} {
+    _test_run -no-result $reptime [string map [list @kind@ $kind] {
+      # dict set/get, 10000 @kind@ keys:
+      setup { set keys [::tclTestPerf-Hash::_keys @kind@]; set d {}; llength $keys }
+      { set d {}; foreach k $keys { dict set d $k 1 } }
+      { foreach k $keys { dict get $d $k } }
+      { foreach k $keys { dict exists $d x$k } }
+      cleanup { unset d }
+    }]
+  }
+}
+
+proc test {{reptime 1000}} {
+  test-hash-array $reptime
+  test-hash-dict $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Hash
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-Hash::test $in(-time)
+}
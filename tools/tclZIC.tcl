@@ -7,13 +7,17 @@
 #	information files for Tcl.
 #
 # Usage:
-#	tclsh tclZIC.tcl inputDir outputDir
+#	tclsh tclZIC.tcl inputDir outputDir ?dbFile?
+#	tclsh tclZIC.tcl -database outputDir dbFile
 #
 # Parameters:
 #	inputDir - Directory (e.g., tzdata2022a) where Olson's source
 #		   files are to be found.
 #	outputDir - Directory (e.g., ../library/tzdata) where
 #		    the time zone information files are to be placed.
+#	dbFile - File (e.g., ../library/tzdata.db) where the packed time
+#		 zone database, made from the information files, is to be
+#		 placed. The second form only makes the database.
 #
 # Results:
 #	May produce error messages on the standard error.  An exit
@@ -1340,18 +1344,138 @@ proc writeLinks {outDir} {
     return
 }
 
+#----------------------------------------------------------------------
+#
+# writeDatabase --
+#
+#	Write the packed time zone database read by the C code of the
+#	'clock' command, from the time zone information files.
+#
+# Parameters:
+#	dataDir - Directory where the time zone information files are.
+#	dbFile - Name of the database file.
+#
+# Results:
+#	None.
+#
+# Side effects:
+#	Creates the database file, or replaces it with a new file.
+#
+# The file is big-endian: a header of "TCLTZDB1", the number of zones, the
+# number of transitions, the size of the name pool and a zero word; the
+# zones sorted by name, each {name firstTransition numTransitions 0}; the
+# transitions, each {time offset dst name}, with dst in the top byte of
+# the last word; and the pool of NUL-terminated names. Zones with the
+# same data (links, mostly) share their transitions.
+#
+#----------------------------------------------------------------------
+
+proc writeDatabase {dataDir dbFile} {
+    puts "creating database: $dbFile"
+
+    # Load every information file; a link loads its target relative to the
+    # data directory.
+
+    namespace eval ::tzdb [list variable DataDir $dataDir]
+    namespace eval ::tzdb {
+	variable TZData
+	proc LoadTimeZoneFile {fileName} {
+	    variable DataDir
+	    namespace eval ::tzdb [list source -encoding utf-8 \
+		    [file join $DataDir $fileName]]
+	}
+    }
+    set dirs [list $dataDir]
+    while {[llength $dirs]} {
+	set dirs [lassign $dirs dir]
+	foreach path [lsort [glob -nocomplain -directory $dir *]] {
+	    if {[file isdirectory $path]} {
+		lappend dirs $path
+	    } else {
+		namespace eval ::tzdb [list source -encoding utf-8 $path]
+	    }
+	}
+    }
+    upvar #0 ::tzdb::TZData TZData
+
+    # Build the name pool, the transitions and the index.
+
+    set pool ""
+    set names {}
+    set trans ""
+    set ntrans 0
+    set shared {}
+    set index ""
+    set zoneNames {}
+    foreach key [array names TZData :*] {
+	lappend zoneNames [string range $key 1 end]
+    }
+    set zoneNames [lsort $zoneNames]
+    set allNames $zoneNames
+    foreach zoneName $zoneNames {
+	foreach row $TZData(:$zoneName) {
+	    lappend allNames [lindex $row 3]
+	}
+    }
+    foreach name $allNames {
+	if {![dict exists $names $name]} {
+	    dict set names $name [string length $pool]
+	    append pool [encoding convertto utf-8 $name] \0
+	}
+    }
+    if {[string length $pool] >= 0x1000000} {
+	error "time zone database name pool too large"
+    }
+    foreach zoneName $zoneNames {
+	set data $TZData(:$zoneName)
+	if {![dict exists $shared $data]} {
+	    dict set shared $data $ntrans
+	    foreach row $data {
+		lassign $row time offset dst name
+		append trans [binary format WII $time $offset [expr {
+		    (($dst & 0xFF) << 24) | [dict get $names $name]
+		}]]
+		incr ntrans
+	    }
+	}
+	append index [binary format IIII [dict get $names $zoneName] \
+		[dict get $shared $data] [llength $data] 0]
+    }
+    namespace delete ::tzdb
+
+    # Running processes may have the old file mapped: write a new file and
+    # rename it into place rather than truncating the old one.
+
+    set tmpFile $dbFile.[pid].tmp
+    set f [open $tmpFile wb]
+    puts -nonewline $f [binary format a8IIII TCLTZDB1 \
+	    [llength $zoneNames] $ntrans [string length $pool] 0]
+    puts -nonewline $f $index$trans$pool
+    close $f
+    file rename -force $tmpFile $dbFile
+    puts "[llength $zoneNames] zones, $ntrans transitions"
+
+    return
+}
+
 #----------------------------------------------------------------------
 #
 # MAIN PROGRAM
 #
 #----------------------------------------------------------------------
 
+if {[lindex $argv 0] eq "-database"} {
+    lassign $argv - outDir dbFile
+    writeDatabase $outDir $dbFile
+    exit
+}
+
 puts "Compiling time zones -- [clock format [clock seconds] \
 	                           -format {%x %X} -locale system]"
 
 # Determine directories
 
-lassign $argv inDir outDir
+lassign $argv inDir outDir dbFile
 
 puts "Olson files in $inDir"
 puts "Tcl files to be placed in $outDir"
@@ -1381,6 +1505,9 @@ writeLinks $outDir
 if {$errorCount > 0} {
     exit 1
 }
+if {$dbFile ne ""} {
+    writeDatabase $outDir $dbFile
+}
 
 # All done!
 
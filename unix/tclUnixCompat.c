@@ -11,6 +11,17 @@
 #include <errno.h>
 #include <string.h>
 
+/*
+ * getrandom() is in glibc from 2.25 on; elsewhere TclpRandomBytes reads
+ * /dev/urandom.
+ */
+
+#if defined(__linux__) && defined(__GLIBC__) \
+	&& (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+#   include <sys/random.h>
+#   define HAVE_GETRANDOM 1
+#endif
+
 /*
  * See also: SC_BLOCKING_STYLE in unix/tcl.m4
  */
@@ -967,6 +978,69 @@ CopyString(
  * End:
  */
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TclpRandomBytes --
+ *
+ *	Fills a buffer with random bytes from the operating system, using
+ *	getrandom() where available and /dev/urandom otherwise.
+ *
+ * Results:
+ *	1 if the buffer was filled, 0 if no source of random bytes could be
+ *	used.
+ *
+ * Side effects:
+ *	None.
+ *
+ *------------------------------------------------------------------------
+ */
+
+int
+TclpRandomBytes(
+    void *buffer,		/* Where to store the bytes. */
+    size_t length)		/* Number of bytes wanted. */
+{
+    unsigned char *p = (unsigned char *) buffer;
+    ssize_t n;
+    int fd;
+
+#ifdef HAVE_GETRANDOM
+    while (length > 0) {
+	n = getrandom(p, length, 0);
+	if (n < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    break;
+	}
+	p += n;
+	length -= n;
+    }
+    if (length == 0) {
+	return 1;
+    }
+#endif /* HAVE_GETRANDOM */
+
+    fd = TclOSopen("/dev/urandom", O_RDONLY, 0);
+    if (fd < 0) {
+	return 0;
+    }
+    while (length > 0) {
+	n = read(fd, p, length);
+	if (n < 0 && errno == EINTR) {
+	    continue;
+	}
+	if (n <= 0) {
+	    break;
+	}
+	p += n;
+	length -= n;
+    }
+    close(fd);
+    return (length == 0);
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -370,6 +370,36 @@ Tcl_GetCurrentThread(void)
     return (Tcl_ThreadId) 0;
 #endif
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpNumProcessors --
+ *
+ *	This procedure returns the number of processors that are currently
+ *	online, for use when deciding how many worker threads to start.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpNumProcessors(void)
+{
+#if TCL_THREADS && defined(_SC_NPROCESSORS_ONLN)
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (num > 1) {
+	return (num > INT_MAX) ? INT_MAX : (int) num;
+    }
+#endif
+    return 1;
+}
 
 /*
  *----------------------------------------------------------------------
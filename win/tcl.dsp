@@ -964,6 +964,10 @@ SOURCE=..\generic\regexec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\generic\regexecb.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\generic\regfree.c
 # End Source File
 # Begin Source File
@@ -1008,6 +1012,10 @@ SOURCE=..\generic\tclClock.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\generic\tclClockTz.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\generic\tclCmdAH.c
 # End Source File
 # Begin Source File
@@ -414,6 +414,53 @@ TclWinDriveLetterForVolMountPoint(
     return -1;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TclpRandomBytes --
+ *
+ *	Fills a buffer with random bytes from the system preferred random
+ *	number generator, through BCryptGenRandom. bcrypt.dll is loaded here
+ *	rather than linked, as this is only needed once per process.
+ *
+ * Results:
+ *	1 if the buffer was filled, 0 if BCryptGenRandom could not be used.
+ *
+ * Side effects:
+ *	None.
+ *
+ *------------------------------------------------------------------------
+ */
+
+int
+TclpRandomBytes(
+    void *buffer,		/* Where to store the bytes. */
+    size_t length)		/* Number of bytes wanted. */
+{
+    typedef LONG(WINAPI genRandomProc)(void *, PUCHAR, ULONG, ULONG);
+    HMODULE handle = LoadLibraryW(L"bcrypt.dll");
+    genRandomProc *genRandom;
+    int result = 0;
+
+    if (handle == NULL) {
+	return 0;
+    }
+    genRandom = (genRandomProc *)(void *)
+	    GetProcAddress(handle, "BCryptGenRandom");
+
+    /*
+     * 0x2 is BCRYPT_USE_SYSTEM_PREFERRED_RNG, which needs no algorithm
+     * handle. A status >= 0 is success.
+     */
+
+    if (genRandom != NULL && length <= 0xFFFFFFFF
+	    && genRandom(NULL, (PUCHAR) buffer, (ULONG) length, 0x2) >= 0) {
+	result = 1;
+    }
+    FreeLibrary(handle);
+    return result;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -325,6 +325,33 @@ Tcl_GetCurrentThread(void)
 {
     return (Tcl_ThreadId)INT2PTR(GetCurrentThreadId());
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpNumProcessors --
+ *
+ *	This procedure returns the number of processors available to the
+ *	process, for use when deciding how many worker threads to start.
+ *
+ * Results:
+ *	The number of processors, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpNumProcessors(void)
+{
+    SYSTEM_INFO sysInfo;
+
+    GetSystemInfo(&sysInfo);
+    return (sysInfo.dwNumberOfProcessors > 1)
+	    ? (int) sysInfo.dwNumberOfProcessors : 1;
+}
 
 /*
  *----------------------------------------------------------------------